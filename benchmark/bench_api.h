@@ -10,6 +10,11 @@ struct BenchOptions {
     std::string test_filter {}; // optional substring match on test name (case-insensitive)
     uint64_t watchdog_ms = 0;   // optional per-test watchdog; 0 disables
     bool force_ppc_exec = false;// run via ppc_exec instead of ppc_exec_until
+    bool threaded = false;      // run through the predecoded threaded interpreter
+    bool jit = false;           // translate hot blocks to host code
+    bool fastmem = false;       // access guest memory through host address space windows
+    uint32_t event_check = 0;   // instructions between checks for pending events (engine default if zero)
+    bool check_overhead = false;// rerun tests with an event check after every instruction and compare
     bool verbose_dump = false;  // optionally dump encoded snippet for debugging
     std::string log_dir;        // directory for log files / artifacts (may be empty)
 };
@@ -66,6 +66,8 @@ int run(const BenchOptions& options) {
     constexpr uint64_t tbr_freq = 16705000;
 
     ppc_cpu_init(grackle_obj, PPC_VER::MPC750, false, tbr_freq);
+    ppc_exec_mode = options.jit ? EXEC_MODE::jit :
+                    options.threaded ? EXEC_MODE::threaded_int : EXEC_MODE::interpreter;
 
     for (size_t i = 0; i < sizeof(cs_code) / sizeof(cs_code[0]); i++) {
         mmu_write_vmem<uint32_t>(0, i * 4, cs_code[i]);
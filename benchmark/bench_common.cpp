@@ -10,8 +10,14 @@ void bench_init_logging(int argc, char** argv) {
     loguru::init(argc, argv);
 }
 
+bool bench_deliver_exceptions = false;
+
 #if defined(PPC_BENCHMARKS)
 void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
+    if (bench_deliver_exceptions) {
+        ppc_deliver_exception(exception_type, srr1_bits);
+        return;
+    }
     power_on = false;
     power_off_reason = po_benchmark_exception;
 }
@@ -8,3 +8,7 @@ void bench_init_logging(int argc, char** argv);
 // Benchmark builds install a lightweight exception handler to stop execution
 // cleanly when the guest raises an exception.
 void bench_install_exception_handler();
+
+// When set, guest exceptions are vectored to their handlers like on real
+// hardware instead of stopping the benchmark.
+extern bool bench_deliver_exceptions;
@@ -37,9 +37,13 @@ Benchmark specifically for instruction dispatch overhead
 #include <cinttypes>
 #include "benchmark/bench_api.h"
 #include "benchmark/bench_common.h"
+#include "cpu/ppc/ppcblockcache.h"
 #include "cpu/ppc/ppcemu.h"
+#include "cpu/ppc/ppcfastmem.h"
 #include "cpu/ppc/ppcmmu.h"
+#include "devices/common/mmiodevice.h"
 #include "devices/memctrl/mpc106.h"
+#include "memaccess.h"
 #include <thirdparty/loguru/loguru.hpp>
 
 // Tight loop with minimal ALU work - focuses on dispatch overhead
@@ -270,11 +274,30 @@ constexpr uint32_t encode_fadds(uint8_t frd, uint8_t fra, uint8_t frb) {
            (static_cast<uint32_t>(frb) << 11) | (21u << 1);
 }
 
+// A-form floating-point arithmetic (opcd 59 for single, 63 for double precision)
+constexpr uint32_t encode_fp_arith(uint8_t opcd, uint8_t xo, uint8_t frd, uint8_t fra,
+                                   uint8_t frb, uint8_t frc) {
+    return (static_cast<uint32_t>(opcd) << 26) | (static_cast<uint32_t>(frd) << 21) |
+           (static_cast<uint32_t>(fra) << 16) | (static_cast<uint32_t>(frb) << 11) |
+           (static_cast<uint32_t>(frc) << 6) | (static_cast<uint32_t>(xo) << 1);
+}
+
+constexpr uint32_t encode_mtspr(uint16_t spr, uint8_t rs) {
+    // SPR number is encoded with its 5-bit halves swapped
+    uint32_t spr_field = ((spr & 0x1Fu) << 5) | ((spr >> 5) & 0x1Fu);
+    return (31u << 26) | (static_cast<uint32_t>(rs) << 21) | (spr_field << 11) | (467u << 1);
+}
+
+constexpr uint32_t encode_mtsr(uint8_t sr, uint8_t rs) {
+    return (31u << 26) | (static_cast<uint32_t>(rs) << 21) | (static_cast<uint32_t>(sr & 0xF) << 16) |
+           (210u << 1);
+}
+
 static int16_t branch_disp(size_t from_index, size_t to_index) {
     // Returns branch displacement in *words* (BD field), not bytes.
     int32_t from_bytes = static_cast<int32_t>(from_index * 4);
     int32_t to_bytes = static_cast<int32_t>(to_index * 4);
-    int32_t offset_bytes = to_bytes - (from_bytes + 4);
+    int32_t offset_bytes = to_bytes - from_bytes; // relative to the branch itself
     return static_cast<int16_t>(offset_bytes / 4);
 }
 
@@ -321,6 +344,39 @@ static std::vector<uint32_t> build_branch_random_code(uint32_t table_base) {
     return code;
 }
 
+static std::vector<uint32_t> build_int_flags_code() {
+    // Record forms as emitted by compilers: most CR0 results are overwritten
+    // before a branch reads them, adde consumes the carry of addic.
+    std::vector<uint32_t> code;
+    code.reserve(20);
+    code.push_back(encode_addis(4, 0, 0));          // patched HI(iter)
+    code.push_back(encode_ori(4, 4, 0));            // patched LO(iter)
+    code.push_back(encode_addis(8, 0, 0x1234));
+    code.push_back(encode_ori(8, 8, 0x5678));
+    code.push_back(encode_addi(7, 0, 1));
+    code.push_back(0x7C8903A6);                     // mtctr r4
+
+    size_t loop_start = code.size();
+    code.push_back(0x7CE74215);                     // add. r7, r7, r8
+    code.push_back(0x54E91839);                     // rlwinm. r9, r7, 3, 0, 28
+    code.push_back(0x7D493851);                     // subf. r10, r9, r7
+    code.push_back(0x7D4B1671);                     // srawi. r11, r10, 2
+    code.push_back(0x318C0001);                     // addic r12, r12, 1
+    code.push_back(0x7DAD5914);                     // adde r13, r13, r11
+    code.push_back(0x7D086A79);                     // xor. r8, r8, r13
+    code.push_back(0x7D0E3839);                     // and. r14, r8, r7
+    size_t beq_index = code.size();
+    code.push_back(0);                              // beq placeholder
+    code.push_back(0x38630001);                     // addi r3, r3, 1
+    size_t bdnz_index = code.size();
+    code.push_back(0);                              // bdnz placeholder
+    code.push_back(0x4E800020);                     // blr
+
+    code[beq_index] = encode_bc(12, 2, branch_disp(beq_index, bdnz_index));
+    code[bdnz_index] = encode_bc(16, 0, branch_disp(bdnz_index, loop_start));
+    return code;
+}
+
 static std::vector<uint32_t> build_stride_sweep_code(uint32_t stride_bytes, uint16_t mask) {
     std::vector<uint32_t> code = {
         encode_addis(4, 0, 0),          // patched HI(iter)
@@ -414,6 +470,34 @@ static std::vector<uint32_t> build_fpu_loop_code(uint16_t mask) {
     return code;
 }
 
+static std::vector<uint32_t> build_fpu_arith_code(uint32_t base) {
+    // Register-only FP kernel typical for geometry code: every operation
+    // updates FPRF and the sticky exception bits of the FPSCR.
+    std::vector<uint32_t> code;
+    code.reserve(24);
+    code.push_back(encode_addis(4, 0, 0));                  // patched HI(iter)
+    code.push_back(encode_ori(4, 4, 0));                    // patched LO(iter)
+    code.push_back(encode_addis(5, 0, base >> 16));         // base hi
+    code.push_back(encode_ori(5, 5, base));                 // base lo
+    code.push_back(encode_lfs(1, 5, 0));                    // lfs f1, 0(r5)
+    code.push_back(encode_lfs(2, 5, 4));                    // lfs f2, 4(r5)
+    code.push_back(0x7C8903A6);                             // mtctr r4
+
+    size_t loop_start = code.size();
+    code.push_back(encode_fp_arith(63, 29, 3, 1, 3, 2));    // fmadd f3, f1, f2, f3
+    code.push_back(encode_fp_arith(63, 25, 4, 3, 0, 1));    // fmul f4, f3, f1
+    code.push_back(encode_fp_arith(63, 20, 5, 4, 2, 0));    // fsub f5, f4, f2
+    code.push_back(encode_fp_arith(59, 18, 6, 5, 2, 0));    // fdivs f6, f5, f2
+    code.push_back(encode_fp_arith(63, 21, 7, 6, 1, 0));    // fadd f7, f6, f1
+    code.push_back(encode_fp_arith(59, 25, 8, 7, 0, 2));    // fmuls f8, f7, f2
+    size_t bdnz_index = code.size();
+    code.push_back(0);                                      // bdnz placeholder
+    code.push_back(0x4E800020);                             // blr
+
+    code[bdnz_index] = encode_bc(16, 0, branch_disp(bdnz_index, loop_start));
+    return code;
+}
+
 static std::vector<uint32_t> build_memcpy_guest_code(uint32_t src, uint32_t dst) {
     std::vector<uint32_t> code;
     code.reserve(20);
@@ -459,6 +543,288 @@ static std::vector<uint32_t> build_mmio_poll_code(uint32_t mmio_addr) {
     return code;
 }
 
+// Every load takes a DSI: data translation is enabled with an empty hashed
+// page table. The handler at 0x300 skips the faulting load and returns.
+static std::vector<uint32_t> build_dsi_storm_code() {
+    const uint32_t handler[] = {
+        0x7D7A02A6,                                 // mfspr r11, SRR0
+        0x396B0004,                                 // addi r11, r11, 4
+        0x7D7A03A6,                                 // mtspr SRR0, r11
+        0x4C000064                                  // rfi
+    };
+    for (size_t i = 0; i < sizeof(handler) / 4; i++)
+        mmu_write_vmem<uint32_t>(0, 0x300 + i * 4, handler[i]);
+
+    std::vector<uint32_t> code;
+    code.reserve(16);
+    code.push_back(encode_addis(4, 0, 0));          // patched HI(iter)
+    code.push_back(encode_ori(4, 4, 0));            // patched LO(iter)
+    code.push_back(0x7C8903A6);                     // mtctr r4
+    code.push_back(encode_addis(9, 0, 0x0010));     // 64KB page table at 1MB
+    code.push_back(0x7D3903A6);                     // mtspr SDR1, r9
+    code.push_back(encode_addis(5, 0, 0x0020));     // unmapped data address
+    code.push_back(encode_addi(10, 0, 0x10));       // MSR[DR]
+    code.push_back(0x7D400124);                     // mtmsr r10
+
+    size_t loop_start = code.size();
+    code.push_back(0x80E50000);                     // lwz r7, 0(r5)
+    code.push_back(0x38630001);                     // addi r3, r3, 1
+    size_t bdnz_index = code.size();
+    code.push_back(0);                              // bdnz placeholder
+    code.push_back(0x4E800020);                     // blr
+
+    code[bdnz_index] = encode_bc(16, 0, branch_disp(bdnz_index, loop_start));
+    return code;
+}
+
+// Switches the segment context on every iteration like an OS scheduler would.
+// Data accesses go through DBAT0 (8MB at 0), so each mtsr/isync pair flushes
+// PAT derived TLB entries while the loads have to revalidate their BAT ones.
+static std::vector<uint32_t> build_ctx_switch_code(uint32_t data_base) {
+    std::vector<uint32_t> code;
+    code.reserve(24);
+    code.push_back(encode_addis(4, 0, 0));          // patched HI(iter)
+    code.push_back(encode_ori(4, 4, 0));            // patched LO(iter)
+    code.push_back(0x7C8903A6);                     // mtctr r4
+    code.push_back(encode_addi(9, 0, 2));           // PP = read/write
+    code.push_back(encode_mtspr(537, 9));           // mtspr DBAT0L, r9
+    code.push_back(encode_addi(9, 0, 0xFF));        // BL = 8MB, Vs = Vp = 1
+    code.push_back(encode_mtspr(536, 9));           // mtspr DBAT0U, r9
+    code.push_back(encode_addis(5, 0, data_base >> 16));
+    code.push_back(encode_ori(5, 5, data_base));    // data base
+    code.push_back(encode_addi(8, 0, 0));           // initial VSID
+    code.push_back(encode_addi(10, 0, 0x10));       // MSR[DR]
+    code.push_back(0x7D400124);                     // mtmsr r10
+    code.push_back(0x4C00012C);                     // isync
+
+    size_t loop_start = code.size();
+    code.push_back(encode_mtsr(1, 8));              // mtsr SR1, r8
+    code.push_back(0x4C00012C);                     // isync
+    code.push_back(0x80E50000);                     // lwz r7, 0(r5)
+    code.push_back(0x80E51000);                     // lwz r7, 0x1000(r5)
+    code.push_back(0x80E52000);                     // lwz r7, 0x2000(r5)
+    code.push_back(0x80E53000);                     // lwz r7, 0x3000(r5)
+    code.push_back(0x69080001);                     // xori r8, r8, 1 (next VSID)
+    size_t bdnz_index = code.size();
+    code.push_back(0);                              // bdnz placeholder
+    code.push_back(0x4E800020);                     // blr
+
+    code[bdnz_index] = encode_bc(16, 0, branch_disp(bdnz_index, loop_start));
+    return code;
+}
+
+// Same as above but the data pages are translated through a hashed page table
+// mapped for two VSIDs, so every load after a context switch refills its TLB
+// entry from the page table.
+static std::vector<uint32_t> build_ptab_walk_code(uint32_t num_pages) {
+    constexpr uint32_t htab_base = 0x00100000; // 64KB page table at 1MB
+    constexpr uint32_t data_ea   = 0x10000000; // segment 1
+    constexpr uint32_t data_pa   = 0x00200000;
+    constexpr uint32_t vsid_base = 0x124; // even, toggled by xori
+
+    for (uint32_t off = 0; off < 0x10000; off += 4)
+        mmu_write_vmem<uint32_t>(0, htab_base + off, 0);
+
+    // Primary PTEGs are full of other mappings like in a busy page table,
+    // so the PTEs end up in the secondary PTEGs.
+    for (uint32_t vsid = vsid_base; vsid <= vsid_base + 1; vsid++) {
+        for (uint32_t page = 0; page < num_pages; page++) {
+            uint32_t hash  = (vsid ^ page) & 0x3FF;
+            uint32_t pteg1 = htab_base | (hash << 6);
+            uint32_t pteg2 = htab_base | ((~hash & 0x3FF) << 6);
+            for (uint32_t slot = 0; slot < 8; slot++)
+                mmu_write_vmem<uint32_t>(0, pteg1 + slot * 8, 0x80000000 | (0xABCDE << 7) | slot);
+            uint32_t slot = 0;
+            while (slot < 7 && mmu_read_vmem<uint32_t>(0, pteg2 + slot * 8))
+                slot++;
+            mmu_write_vmem<uint32_t>(0, pteg2 + slot * 8, 0x80000040 | (vsid << 7));
+            mmu_write_vmem<uint32_t>(0, pteg2 + slot * 8 + 4, (data_pa + (page << 12)) | 2);
+        }
+    }
+
+    std::vector<uint32_t> code;
+    code.reserve(16 + num_pages);
+    code.push_back(encode_addis(4, 0, 0));          // patched HI(iter)
+    code.push_back(encode_ori(4, 4, 0));            // patched LO(iter)
+    code.push_back(0x7C8903A6);                     // mtctr r4
+    code.push_back(encode_addis(9, 0, htab_base >> 16));
+    code.push_back(0x7D3903A6);                     // mtspr SDR1, r9
+    code.push_back(encode_addi(8, 0, vsid_base));   // initial VSID
+    code.push_back(encode_addis(5, 0, data_ea >> 16));
+    code.push_back(encode_addi(10, 0, 0x10));       // MSR[DR]
+    code.push_back(0x7D400124);                     // mtmsr r10
+    code.push_back(0x4C00012C);                     // isync
+
+    size_t loop_start = code.size();
+    code.push_back(encode_mtsr(1, 8));              // mtsr SR1, r8
+    code.push_back(0x4C00012C);                     // isync
+    for (uint32_t page = 0; page < num_pages; page++)
+        code.push_back(0x80E50000 | (page << 12));  // lwz r7, page*4K(r5)
+    code.push_back(0x69080001);                     // xori r8, r8, 1 (next VSID)
+    size_t bdnz_index = code.size();
+    code.push_back(0);                              // bdnz placeholder
+    code.push_back(0x4E800020);                     // blr
+
+    code[bdnz_index] = encode_bc(16, 0, branch_disp(bdnz_index, loop_start));
+    return code;
+}
+
+// Every load refills its TLB entry because tlbie drops the translation right
+// after it. The loads go to a RAM mirror at the end of the physical address
+// map, so each refill has to look past all other regions.
+static std::vector<uint32_t> build_tlb_refill_code(uint32_t data_base) {
+    std::vector<uint32_t> code;
+    code.reserve(8);
+    code.push_back(encode_addis(4, 0, 0));          // patched HI(iter)
+    code.push_back(encode_ori(4, 4, 0));            // patched LO(iter)
+    code.push_back(0x7C8903A6);                     // mtctr r4
+    code.push_back(encode_addis(5, 0, data_base >> 16));
+
+    size_t loop_start = code.size();
+    code.push_back(0x80E50000);                     // lwz r7, 0(r5)
+    code.push_back(0x7C002A64);                     // tlbie r5
+    size_t bdnz_index = code.size();
+    code.push_back(0);                              // bdnz placeholder
+    code.push_back(0x4E800020);                     // blr
+
+    code[bdnz_index] = encode_bc(16, 0, branch_disp(bdnz_index, loop_start));
+    return code;
+}
+
+// Function prologue/epilogue: saves and restores r14-r31 with stmw/lmw.
+static std::vector<uint32_t> build_save_restore_code(uint32_t frame) {
+    std::vector<uint32_t> code;
+    code.reserve(8);
+    code.push_back(encode_addis(4, 0, 0));          // patched HI(iter)
+    code.push_back(encode_ori(4, 4, 0));            // patched LO(iter)
+    code.push_back(0x7C8903A6);                     // mtctr r4
+    code.push_back(encode_addis(5, 0, frame >> 16));
+    code.push_back(encode_ori(5, 5, frame));        // frame base
+
+    size_t loop_start = code.size();
+    code.push_back(0xBDC50000);                     // stmw r14, 0(r5)
+    code.push_back(0xB9C50000);                     // lmw r14, 0(r5)
+    size_t bdnz_index = code.size();
+    code.push_back(0);                              // bdnz placeholder
+    code.push_back(0x4E800020);                     // blr
+
+    code[bdnz_index] = encode_bc(16, 0, branch_disp(bdnz_index, loop_start));
+    return code;
+}
+
+// Clears a 4 KB page one cache block at a time, over and over.
+static std::vector<uint32_t> build_dcbz_page_code(uint32_t page) {
+    std::vector<uint32_t> code;
+    code.reserve(12);
+    code.push_back(encode_addis(4, 0, 0));          // patched HI(iter)
+    code.push_back(encode_ori(4, 4, 0));            // patched LO(iter)
+    code.push_back(0x7C8903A6);                     // mtctr r4
+    code.push_back(encode_addis(5, 0, page >> 16));
+    code.push_back(encode_ori(5, 5, page));         // page base
+    code.push_back(0x38C00000);                     // li r6, 0
+
+    size_t loop_start = code.size();
+    code.push_back(0x7C062FEC);                     // dcbz r6, r5
+    code.push_back(0x38C60020);                     // addi r6, r6, 32
+    code.push_back(0x70C60FE0);                     // andi. r6, r6, 0x0FE0
+    size_t bdnz_index = code.size();
+    code.push_back(0);                              // bdnz placeholder
+    code.push_back(0x4E800020);                     // blr
+
+    code[bdnz_index] = encode_bc(16, 0, branch_disp(bdnz_index, loop_start));
+    return code;
+}
+
+// Copies words from RAM into the VRAM aperture of BenchFramebuffer,
+// wrapping around after 1 MB.
+static std::vector<uint32_t> build_vram_blit_code(uint32_t src, uint32_t vram) {
+    std::vector<uint32_t> code;
+    code.reserve(16);
+    code.push_back(encode_addis(4, 0, 0));          // patched HI(iter)
+    code.push_back(encode_ori(4, 4, 0));            // patched LO(iter)
+    code.push_back(0x7C8903A6);                     // mtctr r4
+    code.push_back(encode_addis(5, 0, src >> 16));
+    code.push_back(encode_ori(5, 5, src));          // source base
+    code.push_back(encode_addis(8, 0, vram >> 16)); // VRAM base
+    code.push_back(0x38C00000);                     // li r6, 0
+
+    size_t loop_start = code.size();
+    code.push_back(0x7CE5302E);                     // lwzx r7, r5, r6
+    code.push_back(0x7CE8312E);                     // stwx r7, r8, r6
+    code.push_back(0x38C60004);                     // addi r6, r6, 4
+    code.push_back(0x54C6033A);                     // rlwinm r6, r6, 0, 12, 29
+    size_t bdnz_index = code.size();
+    code.push_back(0);                              // bdnz placeholder
+    code.push_back(0x4E800020);                     // blr
+
+    code[bdnz_index] = encode_bc(16, 0, branch_disp(bdnz_index, loop_start));
+    return code;
+}
+
+// Stand-in for the linear VRAM aperture of a video card.
+class BenchFramebuffer : public MMIODevice {
+public:
+    static constexpr uint32_t VRAM_SIZE = 0x100000;
+
+    BenchFramebuffer() : vram(new uint8_t[VRAM_SIZE]()) {
+        this->name = "BenchFramebuffer";
+    }
+
+    uint32_t read(uint32_t rgn_start, uint32_t offset, int size) override {
+        return read_mem(&this->vram[offset], size);
+    }
+
+    void write(uint32_t rgn_start, uint32_t offset, uint32_t value, int size) override {
+        write_mem(&this->vram[offset], value, size);
+    }
+
+    uint8_t* get_direct_page(uint32_t rgn_start, uint32_t offset) override {
+        return &this->vram[offset];
+    }
+
+private:
+    std::unique_ptr<uint8_t[]> vram;
+};
+
+// Like above but with data translation enabled. The data is mapped by the
+// last of four DBATs and each load refills its TLB entry through BAT lookup.
+static std::vector<uint32_t> build_bat_refill_code(uint32_t data_base) {
+    std::vector<uint32_t> code;
+    code.reserve(40);
+    code.push_back(encode_addis(4, 0, 0));          // patched HI(iter)
+    code.push_back(encode_ori(4, 4, 0));            // patched LO(iter)
+    code.push_back(0x7C8903A6);                     // mtctr r4
+
+    // DBAT0-2 map 128KB blocks at 0x80000000, 0x90000000 and 0xA0000000
+    for (uint32_t bat = 0; bat < 3; bat++) {
+        code.push_back(encode_addi(9, 0, 2));           // PP = read/write
+        code.push_back(encode_mtspr(537 + bat * 2, 9)); // mtspr DBATxL, r9
+        code.push_back(encode_addis(9, 0, 0x8000 + bat * 0x1000));
+        code.push_back(encode_ori(9, 9, 3));            // BL = 128KB, Vs = Vp = 1
+        code.push_back(encode_mtspr(536 + bat * 2, 9)); // mtspr DBATxU, r9
+    }
+    code.push_back(encode_addi(9, 0, 2));           // PP = read/write
+    code.push_back(encode_mtspr(543, 9));           // mtspr DBAT3L, r9
+    code.push_back(encode_addi(9, 0, 0xFF));        // BL = 8MB, Vs = Vp = 1
+    code.push_back(encode_mtspr(542, 9));           // mtspr DBAT3U, r9
+
+    code.push_back(encode_addis(5, 0, data_base >> 16));
+    code.push_back(encode_ori(5, 5, data_base));    // data base
+    code.push_back(encode_addi(10, 0, 0x10));       // MSR[DR]
+    code.push_back(0x7D400124);                     // mtmsr r10
+    code.push_back(0x4C00012C);                     // isync
+
+    size_t loop_start = code.size();
+    code.push_back(0x80E50000);                     // lwz r7, 0(r5)
+    code.push_back(0x7C002A64);                     // tlbie r5
+    size_t bdnz_index = code.size();
+    code.push_back(0);                              // bdnz placeholder
+    code.push_back(0x4E800020);                     // blr
+
+    code[bdnz_index] = encode_bc(16, 0, branch_disp(bdnz_index, loop_start));
+    return code;
+}
+
 constexpr uint32_t kDefaultSamples = 100;
 constexpr uint32_t kDefaultRuns = 10;
 
@@ -505,7 +871,8 @@ struct BenchWatchdog {
     }
 };
 
-static void run_benchmark(const char* name, uint32_t* code, size_t code_size,
+// Returns the best ns/insn over all runs, 0 if the test failed
+static double run_benchmark(const char* name, uint32_t* code, size_t code_size,
                           uint32_t iterations, uint32_t target_pc,
                           uint32_t runs, uint32_t samples_per_run,
                           const BenchOptions& options,
@@ -532,6 +899,9 @@ static void run_benchmark(const char* name, uint32_t* code, size_t code_size,
     uint32_t lo = iterations & 0xFFFF;
     mmu_write_vmem<uint32_t>(0, 0, (code[0] & 0xFFFF0000) | hi);
     mmu_write_vmem<uint32_t>(0, 4, (code[1] & 0xFFFF0000) | lo);
+
+    // Code has been replaced behind the CPU's back, drop predecoded blocks
+    ppc_block_cache_flush();
     
     auto run_stepper = [&](uint32_t target_pc_local, uint64_t iterations_local, BenchWatchdog& watchdog) -> bool {
         // Allow generous step budget: iterations * code_insns * 2 (but clamp to a sane minimum)
@@ -601,8 +971,9 @@ static void run_benchmark(const char* name, uint32_t* code, size_t code_size,
         ppc_state.gpr[6] = 0;
         ppc_state.gpr[7] = 0;
         // Clear MSR to disable address translation; this keeps effective == physical and avoids
-        // unmapped warnings under stepper runs.
-        ppc_state.msr = 0;
+        // unmapped warnings under stepper runs. MSR[FP] stays set so the FPU loops
+        // don't end up in the floating-point unavailable handler.
+        ppc_msr_did_change(ppc_state.msr, MSR::FP, false);
         ppc_state.spr[SPR::CTR] = iter_val; // ensure non-zero so stepper doesn't exit early
         power_on = true;
     };
@@ -614,7 +985,7 @@ static void run_benchmark(const char* name, uint32_t* code, size_t code_size,
         if (use_ppc_exec || options.force_ppc_exec) {
             if (!run_stepper(target_pc, iterations, watchdog)) {
                 LOG_F(ERROR, "Warm-up stepper failed for %s", name);
-                return;
+                return 0.0;
             }
         } else {
             ppc_exec_until(target_pc);
@@ -622,6 +993,7 @@ static void run_benchmark(const char* name, uint32_t* code, size_t code_size,
     }
     
     // Run benchmark
+    double best_ns_per_insn = 0.0;
     for (uint32_t i = 0; i < runs; i++) {
         LOG_F(INFO, "[%s] run %u/%u, samples_per_run=%u", name, i + 1, runs, samples_per_run);
         std::vector<uint64_t> samples;
@@ -636,7 +1008,7 @@ static void run_benchmark(const char* name, uint32_t* code, size_t code_size,
                 if (!run_stepper(target_pc, iterations, watchdog)) {
                     LOG_F(ERROR, "Stepper failed for %s (run %u/%u, sample %u/%u)",
                           name, i + 1, runs, j + 1, samples_per_run);
-                    return;
+                    return 0.0;
                 }
             } else {
                 ppc_exec_until(target_pc);
@@ -649,7 +1021,7 @@ static void run_benchmark(const char* name, uint32_t* code, size_t code_size,
                 LOG_F(ERROR, "Watchdog triggered for %s (iteration %u/%u). pc=0x%08X ctr=0x%08X",
                       name, i + 1, runs,
                       ppc_state.pc, (uint32_t)ppc_state.spr[SPR::CTR]);
-                return;
+                return 0.0;
             }
             
             uint64_t sample = time_elapsed.count();
@@ -660,7 +1032,7 @@ static void run_benchmark(const char* name, uint32_t* code, size_t code_size,
         }
         if (samples.empty()) {
             LOG_F(ERROR, "[%s] no samples collected (runs=%u, samples/run=%u)", name, runs, samples_per_run);
-            return;
+            return 0.0;
         }
         std::sort(samples.begin(), samples.end());
         uint64_t med_sample = samples[samples.size() / 2];
@@ -671,7 +1043,10 @@ static void run_benchmark(const char* name, uint32_t* code, size_t code_size,
         double minsn_per_sec = ns_per_insn > 0 ? (1000.0 / ns_per_insn) : 0.0;
         LOG_F(INFO, "(%u) best %" PRIu64 " ns, median %" PRIu64 " ns, p95 %" PRIu64 " ns, %.4f ns/insn (best), %.2f Minsn/s",
               i + 1, static_cast<uint64_t>(best_sample), static_cast<uint64_t>(med_sample), static_cast<uint64_t>(p95_sample), ns_per_insn, minsn_per_sec);
+        if (!i || ns_per_insn < best_ns_per_insn)
+            best_ns_per_insn = ns_per_insn;
     }
+    return best_ns_per_insn;
 }
 
 static void run_host_memcpy(const char* name, std::vector<uint8_t>& dst,
@@ -708,6 +1083,9 @@ int run(const BenchOptions& options) {
     const uint32_t runs = options.runs ? options.runs : kDefaultRuns;
     const uint32_t samples = options.samples ? options.samples : kDefaultSamples;
 
+    // guest RAM has to be allocated with fastmem already in place
+    ppc_fastmem_enabled = options.fastmem;
+
     MPC106* grackle_obj = new MPC106;
 
     // Allocate a larger RAM window so strided tests stay mapped even if the MMU offsets
@@ -720,8 +1098,23 @@ int run(const BenchOptions& options) {
         return -1;
     }
 
+    // Stand-ins for PCI BARs and a memory mirror so that physical address
+    // lookups don't always succeed on the first address map entry.
+    constexpr uint32_t phys_mirror_base = 0x50000000;
+    for (uint32_t bar = 0; bar < 32; bar++)
+        grackle_obj->add_mmio_region(0x80000000 + bar * 0x10000, 0x1000, grackle_obj);
+    grackle_obj->add_mem_mirror_partial(phys_mirror_base, 0, 0x200000, 0x100000);
+
+    constexpr uint32_t vram_base = 0x90000000;
+    BenchFramebuffer* fb_obj = new BenchFramebuffer;
+    grackle_obj->add_mmio_region(vram_base, BenchFramebuffer::VRAM_SIZE, fb_obj);
+
     constexpr uint64_t tbr_freq = 16705000;
     ppc_cpu_init(grackle_obj, PPC_VER::MPC750, false, tbr_freq);
+    ppc_exec_mode = options.jit ? EXEC_MODE::jit :
+                    options.threaded ? EXEC_MODE::threaded_int : EXEC_MODE::interpreter;
+    const uint32_t event_check = options.event_check ? options.event_check : PPC_EVENT_CHECK_INTERVAL;
+    ppc_event_check_interval = event_check;
 
     // Ensure a log directory exists for redirected logs / artifacts
     std::error_code ec;
@@ -768,6 +1161,10 @@ int run(const BenchOptions& options) {
 
     LOG_F(INFO, "PowerPC Dispatch Overhead Benchmark");
     LOG_F(INFO, "====================================");
+    LOG_F(INFO, "Execution engine: %s",
+          opts.jit ? "JIT" : opts.threaded ? "threaded interpreter" : "interpreter");
+    LOG_F(INFO, "Event check interval: %u instructions", event_check);
+    LOG_F(INFO, "Fastmem: %s", ppc_fastmem_enabled ? "on" : "off");
 
     // Table-driven registry to keep things DRY
     struct DispatchTest {
@@ -779,15 +1176,26 @@ int run(const BenchOptions& options) {
         uint32_t iterations = 0;
         uint32_t loop_pc_hint = 0;
         bool use_ppc_exec = false;
+        bool deliver_exceptions = false;
     };
 
     // Loop PC hints to keep stepper iteration counting solid
     constexpr uint32_t LP_BRANCH_RAND = 0x10;
     constexpr uint32_t LP_STRIDE = 7 * 4;
     constexpr uint32_t LP_MIXED = 7 * 4;
+    constexpr uint32_t LP_INT_FLAGS = 6 * 4;
     constexpr uint32_t LP_FPU = 7 * 4;
+    constexpr uint32_t LP_FPU_ARITH = 7 * 4;
     constexpr uint32_t LP_MEMCPY = 7 * 4;
     constexpr uint32_t LP_MMIO = 5 * 4;
+    constexpr uint32_t LP_DSI_STORM = 8 * 4;
+    constexpr uint32_t LP_CTX_SWITCH = 13 * 4;
+    constexpr uint32_t LP_PTAB_WALK = 10 * 4;
+    constexpr uint32_t LP_TLB_REFILL = 4 * 4;
+    constexpr uint32_t LP_SAVE_RESTORE = 5 * 4;
+    constexpr uint32_t LP_DCBZ = 6 * 4;
+    constexpr uint32_t LP_VRAM_BLIT = 7 * 4;
+    constexpr uint32_t LP_BAT_REFILL = 27 * 4;
 
     const DispatchTest tests[] = {
         {"1M iterations", "Tight ALU", {}, tight_loop_code, sizeof(tight_loop_code), 1000000, 0, false},
@@ -806,10 +1214,20 @@ int run(const BenchOptions& options) {
         {"Stride 2 lines (128B) 2K iters", "Stride 2 lines", []() { return build_stride_sweep_code(128, 0x0FFC); }, nullptr, 0, 2000, LP_STRIDE, true},
         {"Stride 4 lines (256B) 2K iters", "Stride 4 lines", []() { return build_stride_sweep_code(256, 0x0FFC); }, nullptr, 0, 2000, LP_STRIDE, true},
         {"Stride 8 lines (512B) 2K iters", "Stride 8 lines", []() { return build_stride_sweep_code(512, 0x0FFC); }, nullptr, 0, 2000, LP_STRIDE, true},
-        {"Mixed instruction mix 2K", "Mixed instruction", []() { return build_mixed_mix_code(0x0FFC); }, nullptr, 0, 2000, LP_MIXED, false},
-        {"FPU add/store 200K", "FPU", []() { return build_fpu_loop_code(0x0FFC); }, nullptr, 0, 200000, LP_FPU, true},
+        {"Mixed instruction mix 2K", "Mixed instruction", []() { return build_mixed_mix_code(mixed_base | 0x0FFC); }, nullptr, 0, 2000, LP_MIXED, false},
+        {"Integer flags 200K", "Integer flags", build_int_flags_code, nullptr, 0, 200000, LP_INT_FLAGS, false},
+        {"FPU add/store 200K", "FPU", []() { return build_fpu_loop_code(fpu_base | 0x0FFC); }, nullptr, 0, 200000, LP_FPU, true},
+        {"FPU arithmetic 200K", "FPU arithmetic", [fpu_base]() { return build_fpu_arith_code(fpu_base); }, nullptr, 0, 200000, LP_FPU_ARITH, false},
         {"Guest memcpy 1K words", "Guest memcpy", [memcpy_src, memcpy_dst]() { return build_memcpy_guest_code(memcpy_src, memcpy_dst); }, nullptr, 0, 1024, LP_MEMCPY, true},
         {"MMIO poll 100K (RAM)", "MMIO", []() { return build_mmio_poll_code(0x00001000); }, nullptr, 0, 100000, LP_MMIO, true},
+        {"DSI storm 20K", "DSI storm", build_dsi_storm_code, nullptr, 0, 20000, LP_DSI_STORM, false, true},
+        {"Context switch 20K", "Context switch", []() { return build_ctx_switch_code(mixed_base); }, nullptr, 0, 20000, LP_CTX_SWITCH, false},
+        {"Page table walk 20K", "Page table walk", []() { return build_ptab_walk_code(8); }, nullptr, 0, 20000, LP_PTAB_WALK, false},
+        {"TLB refill 100K", "TLB refill", []() { return build_tlb_refill_code(phys_mirror_base); }, nullptr, 0, 100000, LP_TLB_REFILL, false},
+        {"Save/restore 18 regs 100K", "Save/restore", []() { return build_save_restore_code(mixed_base); }, nullptr, 0, 100000, LP_SAVE_RESTORE, false},
+        {"dcbz 4KB page 100K", "dcbz", []() { return build_dcbz_page_code(memcpy_dst); }, nullptr, 0, 100000, LP_DCBZ, false},
+        {"BAT refill 100K", "BAT refill", []() { return build_bat_refill_code(mixed_base); }, nullptr, 0, 100000, LP_BAT_REFILL, false},
+        {"VRAM blit 200K words", "VRAM blit", [memcpy_src, vram_base]() { return build_vram_blit_code(memcpy_src, vram_base); }, nullptr, 0, 200000, LP_VRAM_BLIT, false},
     };
 
     bool any_ran = false;
@@ -820,15 +1238,35 @@ int run(const BenchOptions& options) {
         }
         any_ran = true;
         LOG_F(INFO, "\nTest: %s", t.label);
-        if (t.static_code) {
-            const uint32_t target_pc = static_cast<uint32_t>(t.static_code_bytes - 4);
-            run_benchmark(t.label, const_cast<uint32_t*>(t.static_code), t.static_code_bytes,
-                          t.iterations, target_pc, runs, samples, opts, t.use_ppc_exec, t.loop_pc_hint);
-        } else {
+        bench_deliver_exceptions = t.deliver_exceptions;
+        auto run_test = [&]() {
+            if (t.static_code) {
+                const uint32_t target_pc = static_cast<uint32_t>(t.static_code_bytes - 4);
+                return run_benchmark(t.label, const_cast<uint32_t*>(t.static_code), t.static_code_bytes,
+                                     t.iterations, target_pc, runs, samples, opts, t.use_ppc_exec, t.loop_pc_hint);
+            }
             auto code_vec = t.build_dynamic();
             const uint32_t target_pc = static_cast<uint32_t>(code_vec.size() * 4 - 4);
-            run_benchmark(t.label, code_vec.data(), code_vec.size() * 4,
-                          t.iterations, target_pc, runs, samples, opts, t.use_ppc_exec, t.loop_pc_hint);
+            return run_benchmark(t.label, code_vec.data(), code_vec.size() * 4,
+                                 t.iterations, target_pc, runs, samples, opts, t.use_ppc_exec, t.loop_pc_hint);
+        };
+        double ns_per_insn = run_test();
+        if (opts.check_overhead && ns_per_insn > 0) {
+            // rerun with an event check after every instruction
+            ppc_event_check_interval = 1;
+            double every_insn = run_test();
+            ppc_event_check_interval = event_check;
+            if (every_insn > 0) {
+                LOG_F(INFO, "[%s] event check overhead: %.4f ns/insn every %u insns, %.4f ns/insn every insn (%+.1f%%)",
+                      t.label, ns_per_insn, event_check, every_insn,
+                      (every_insn - ns_per_insn) * 100.0 / ns_per_insn);
+            }
+        }
+        bench_deliver_exceptions = false;
+        if (ppc_state.msr & (MSR::IR | MSR::DR)) {
+            // leave the guest with translation off for the following tests
+            ppc_state.msr = 0;
+            mmu_change_mode();
         }
     }
 
@@ -852,6 +1290,7 @@ int run(const BenchOptions& options) {
     }
 
     delete(grackle_obj);
+    delete(fb_obj);
     return 0;
 }
 
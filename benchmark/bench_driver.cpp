@@ -17,6 +17,10 @@ namespace bench_dispatch {
 void register_benchmarks(std::vector<Bench>& benches);
 }
 
+namespace bench_timers {
+void register_benchmarks(std::vector<Bench>& benches);
+}
+
 static void list_benchmarks(const std::vector<Bench>& benches) {
     std::cout << "Available benchmarks:\n";
     for (const auto& b : benches) {
@@ -31,6 +35,7 @@ int main(int argc, char** argv) {
     std::vector<Bench> benches;
     bench_checksum::register_benchmarks(benches);
     bench_dispatch::register_benchmarks(benches);
+    bench_timers::register_benchmarks(benches);
 
     CLI::App app{"DingusPPC benchmark suite"};
     std::string bench_name;
@@ -45,6 +50,11 @@ int main(int argc, char** argv) {
     app.add_option("--test-filter", options.test_filter, "Substring filter for test names (case-insensitive)");
     app.add_option("--watchdog-ms", options.watchdog_ms, "Per-test watchdog in ms (0 disables)");
     app.add_flag("--force-ppc-exec", options.force_ppc_exec, "Use ppc_exec instead of ppc_exec_until for all tests");
+    app.add_flag("--threaded", options.threaded, "Use the predecoded threaded interpreter");
+    app.add_flag("--jit", options.jit, "Translate hot blocks to host code");
+    app.add_flag("--fastmem", options.fastmem, "Access guest memory directly through host address space windows");
+    app.add_option("--event-check", options.event_check, "Instructions between checks for pending events (engine default if 0)");
+    app.add_flag("--check-overhead", options.check_overhead, "Report the cost of checking for events after every instruction");
     app.add_flag("--verbose-dump", options.verbose_dump, "Dump encoded snippets for debugging");
     app.add_option("--logfile", log_path, "Log output path (default ./tmp/benchmarks.log)");
     try {
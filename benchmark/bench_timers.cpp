@@ -0,0 +1,123 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+Timer churn benchmark: devices arming, cancelling and re-arming timers
+the way ViaCuda, Swim3Ctrl and the DMA/IDE code do, next to a few cyclic
+VBL-style timers that get re-armed on every expiry.
+*/
+
+#include <stdlib.h>
+#include <chrono>
+#include <cinttypes>
+#include <vector>
+#include "benchmark/bench_api.h"
+#include "benchmark/bench_common.h"
+#include "core/timermanager.h"
+#include <thirdparty/loguru/loguru.hpp>
+
+constexpr uint32_t kDefaultSamples = 20;
+constexpr uint32_t kDefaultRuns = 5;
+constexpr uint32_t kNumDevices = 16;     // devices with a pending one-shot timer
+constexpr uint32_t kNumCyclic = 4;       // VBL-like cyclic timers
+constexpr uint32_t kOpsPerSample = 100000;
+
+namespace bench_timers {
+
+static uint64_t fake_time_ns = 0;
+
+int run(const BenchOptions& options) {
+    const uint32_t samples = options.samples ? options.samples : kDefaultSamples;
+    const uint32_t runs = options.runs ? options.runs : kDefaultRuns;
+
+    TimerManager* tm = TimerManager::get_instance();
+    tm->set_time_now_cb([]() { return fake_time_ns; });
+    tm->set_notify_changes_cb([]() {});
+
+    uint64_t fired = 0;
+
+    std::vector<uint32_t> cyclic_ids;
+    for (uint32_t i = 0; i < kNumCyclic; i++) {
+        cyclic_ids.push_back(tm->add_cyclic_timer(16000 + i * 1000, [&fired]() { fired++; }));
+    }
+
+    std::vector<uint32_t> dev_timers(kNumDevices, 0);
+
+    srand(0xCAFEBABE);
+
+    for (uint32_t i = 0; i < runs; i++) {
+        uint64_t best_sample = UINT64_MAX;
+        for (uint32_t j = 0; j < samples; j++) {
+            auto start_time = std::chrono::steady_clock::now();
+
+            for (uint32_t op = 0; op < kOpsPerSample; op++) {
+                uint32_t dev = op % kNumDevices;
+
+                // cancel the pending timeout and arm a new one, as a device
+                // does when the guest touches it before the timeout expired
+                if (dev_timers[dev])
+                    tm->cancel_timer(dev_timers[dev]);
+                dev_timers[dev] = tm->add_oneshot_timer(100 + (rand() & 0x3FF),
+                    [&fired, &dev_timers, dev]() {
+                        dev_timers[dev] = 0;
+                        fired++;
+                    });
+
+                // some devices post their interrupt through an immediate timer
+                if (!(op & 7))
+                    tm->add_immediate_timer([&fired]() { fired++; });
+
+                fake_time_ns += 50;
+                tm->process_timers();
+            }
+
+            auto end_time     = std::chrono::steady_clock::now();
+            auto time_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
+            uint64_t sample = time_elapsed.count();
+            if (sample < best_sample)
+                best_sample = sample;
+        }
+        LOG_F(INFO, "(%u) %" PRIu64 " ns, %.2lf ns per op", i + 1,
+              static_cast<uint64_t>(best_sample), double(best_sample) / kOpsPerSample);
+    }
+
+    LOG_F(INFO, "Timers fired: %" PRIu64, fired);
+
+    for (auto id : dev_timers) {
+        if (id)
+            tm->cancel_timer(id);
+    }
+    for (auto id : cyclic_ids) {
+        tm->cancel_timer(id);
+    }
+
+    return 0;
+}
+
+void register_benchmarks(std::vector<Bench>& benches) {
+    benches.push_back({
+        .name = "timers",
+        .description = "TimerManager add/cancel/re-arm churn",
+        .run = run,
+    });
+}
+
+} // namespace bench_timers
@@ -0,0 +1,112 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** Commands sent to the emulation thread by other host threads. */
+
+#include "commandqueue.h"
+#include <loguru.hpp>
+
+#include <atomic>
+#include <cinttypes>
+
+CommandQueue CommandQueue::command_queue;
+
+CommandQueue::CommandQueue() {
+    // a slot is free for the producer whose position matches its sequence
+    for (uint32_t i = 0; i < QUEUE_SIZE; i++)
+        this->slots[i].seq.store(i, std::memory_order_relaxed);
+}
+
+bool CommandQueue::post(command_fn fn, void* ctx, uint64_t arg) {
+    uint64_t     pos = this->tail.load(std::memory_order_relaxed);
+    CommandSlot* slot;
+
+    while (true) {
+        slot = &this->slots[pos & (QUEUE_SIZE - 1)];
+
+        int64_t diff = int64_t(slot->seq.load(std::memory_order_acquire) - pos);
+        if (!diff) {
+            if (this->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            // the consumer hasn't freed this slot yet; logging here could
+            // block a real-time thread so leave that to the consumer
+            this->num_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = this->tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->fn  = fn;
+    slot->ctx = ctx;
+    slot->arg = arg;
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    // make the command visible before the consumer is asked to look,
+    // pairs with the fence in process_commands()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    auto notify = this->notify_cb.load(std::memory_order_relaxed);
+    if (notify)
+        notify();
+
+    return true;
+}
+
+void CommandQueue::process_commands() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (this->num_dropped.load(std::memory_order_relaxed)) [[unlikely]] {
+        uint32_t dropped = this->num_dropped.exchange(0, std::memory_order_relaxed);
+        LOG_F(WARNING, "CommandQueue: queue full, %u command(s) lost", dropped);
+    }
+
+    while (true) {
+        CommandSlot& slot = this->slots[this->head & (QUEUE_SIZE - 1)];
+
+        if (slot.seq.load(std::memory_order_acquire) != this->head + 1)
+            break; // empty or the producer hasn't finished writing
+
+        command_fn fn  = slot.fn;
+        void*      ctx = slot.ctx;
+        uint64_t   arg = slot.arg;
+
+        // hand the slot back to the producer one lap ahead
+        slot.seq.store(this->head + QUEUE_SIZE, std::memory_order_release);
+        this->head++;
+
+        fn(ctx, arg);
+    }
+}
+
+void CommandQueue::discard(void* ctx) {
+    uint64_t tail = this->tail.load(std::memory_order_acquire);
+
+    for (uint64_t pos = this->head; pos != tail; pos++) {
+        CommandSlot& slot = this->slots[pos & (QUEUE_SIZE - 1)];
+
+        // slots still being written belong to producers that are running,
+        // callers make sure the ones posting with ctx have finished
+        if (slot.seq.load(std::memory_order_acquire) == pos + 1 && slot.ctx == ctx)
+            slot.fn = [](void*, uint64_t) {};
+    }
+}
@@ -0,0 +1,90 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Commands sent to the emulation thread by other host threads.
+
+    The emulated machine is owned by the emulation thread. Other host
+    threads (the audio callback, input, debugger or signal handlers) don't
+    touch it directly but post a command here: raise an interrupt, arm a
+    timer, hand over data. The emulation thread runs pending commands at
+    the next execution block boundary.
+
+    The queue is a bounded array of slots with per-slot sequence numbers
+    (Vyukov's bounded queue, reduced to one consumer). Posting never
+    blocks or allocates, so it is safe from real-time threads and from
+    signal handlers.
+ */
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cinttypes>
+
+/** Command to run on the emulation thread. */
+typedef void (*command_fn)(void* ctx, uint64_t arg);
+
+class CommandQueue {
+public:
+    static CommandQueue* get_instance() {
+        return &command_queue;
+    }
+
+    // called after a command has been posted, from the posting thread
+    void set_notify_cb(void (*cb)()) {
+        this->notify_cb.store(cb, std::memory_order_relaxed);
+    }
+
+    // post a command from any thread, returns false if the queue is full;
+    // dropped commands are counted and reported by process_commands()
+    bool post(command_fn fn, void* ctx, uint64_t arg = 0);
+
+    // run all pending commands, emulation thread only
+    void process_commands();
+
+    // turn pending commands posted with ctx into no-ops, emulation thread only
+    void discard(void* ctx);
+
+private:
+    // constructed at startup, getting it from a signal handler must not allocate
+    static CommandQueue command_queue;
+    CommandQueue(); // private constructor to implement a singleton
+
+    static constexpr uint32_t QUEUE_SIZE = 256; // must be a power of two
+
+    typedef struct CommandSlot {
+        std::atomic<uint64_t> seq;
+        command_fn            fn;
+        void*                 ctx;
+        uint64_t              arg;
+    } CommandSlot;
+
+    std::array<CommandSlot, QUEUE_SIZE> slots;
+
+    alignas(64) std::atomic<uint64_t> tail{0}; // next slot to be claimed by a producer
+    alignas(64) uint64_t              head = 0; // next slot to be run
+
+    std::atomic<void (*)()> notify_cb{nullptr};
+    std::atomic<uint32_t>   num_dropped{0}; // posts that found the queue full
+};
+
+#endif // COMMAND_QUEUE_H
@@ -25,83 +25,153 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "timermanager.h"
 
 #include <cinttypes>
-#include <memory>
-#include <mutex>
+#include <utility>
 
 TimerManager* TimerManager::timer_manager;
 
-uint32_t TimerManager::add_oneshot_timer(uint64_t timeout, timer_cb cb)
-{
-    TimerInfo* ti = new TimerInfo;
+bool TimerManager::expires_before(uint32_t l, uint32_t r) const {
+    const TimerInfo& lt = this->timer_pool[l];
+    const TimerInfo& rt = this->timer_pool[r];
+    return lt.timeout_ns < rt.timeout_ns ||
+        (lt.timeout_ns == rt.timeout_ns && lt.seq < rt.seq);
+}
 
-    ti->id          = ++this->id;
-    ti->timeout_ns  = this->get_time_now() + timeout;
-    ti->interval_ns = 0;
-    ti->cb          = cb;
+void TimerManager::queue_place(uint32_t pos, uint32_t slot) {
+    this->timer_queue[pos] = slot;
+    this->timer_pool[slot].queue_pos = pos;
+}
 
-    std::shared_ptr<TimerInfo> timer_desc(ti);
+void TimerManager::queue_sift_up(uint32_t pos) {
+    uint32_t slot = this->timer_queue[pos];
 
-    // add new timer to the timer queue
-    this->timer_queue.push(timer_desc);
+    while (pos) {
+        uint32_t parent = (pos - 1) >> 1;
+        if (!expires_before(slot, this->timer_queue[parent]))
+            break;
+        queue_place(pos, this->timer_queue[parent]);
+        pos = parent;
+    }
 
-    // notify listeners about changes in the timer queue
-    if (!this->cb_active) {
-        this->notify_timer_changes();
+    queue_place(pos, slot);
+}
+
+void TimerManager::queue_sift_down(uint32_t pos) {
+    uint32_t slot = this->timer_queue[pos];
+    uint32_t size = (uint32_t)this->timer_queue.size();
+
+    for (uint32_t child = pos * 2 + 1; child < size; child = pos * 2 + 1) {
+        if (child + 1 < size && expires_before(this->timer_queue[child + 1], this->timer_queue[child]))
+            child++;
+        if (!expires_before(this->timer_queue[child], slot))
+            break;
+        queue_place(pos, this->timer_queue[child]);
+        pos = child;
     }
 
-    return ti->id;
+    queue_place(pos, slot);
 }
 
-uint32_t TimerManager::add_immediate_timer(timer_cb cb) {
-    TimerInfo* ti = new TimerInfo;
+void TimerManager::queue_remove(uint32_t pos) {
+    uint32_t last = this->timer_queue.back();
+    this->timer_queue.pop_back();
 
-    ti->id          = ++this->id;
-    ti->timeout_ns  = this->get_time_now();
-    ti->interval_ns = 0;
-    ti->cb          = cb;
+    if (pos < this->timer_queue.size()) {
+        queue_place(pos, last);
+        queue_sift_up(pos);
+        queue_sift_down(this->timer_pool[last].queue_pos);
+    }
+}
 
-    std::shared_ptr<TimerInfo> timer_desc(ti);
+TimerInfo* TimerManager::find_timer(uint32_t id) {
+    uint32_t slot = id & (TIMER_MAX_SLOTS - 1);
 
-    // add new timer to the timer queue
-    this->timer_queue.push(timer_desc);
+    if (slot >= this->timer_pool.size())
+        return nullptr;
 
-    // notify listeners about changes in the timer queue
-    if (!this->cb_active) {
-        this->notify_timer_changes();
-    }
+    TimerInfo* ti = &this->timer_pool[slot];
+    if (ti->gen != (id >> TIMER_SLOT_BITS) || ti->queue_pos == TIMER_UNQUEUED)
+        return nullptr;
 
-    return ti->id;
+    return ti;
 }
 
-uint32_t TimerManager::add_cyclic_timer(uint64_t interval, uint64_t delay, timer_cb cb)
+void TimerManager::free_timer(uint32_t slot) {
+    TimerInfo& ti = this->timer_pool[slot];
+
+    ti.cb        = nullptr;
+    ti.queue_pos = TIMER_UNQUEUED;
+    ti.gen       = (ti.gen + 1) & TIMER_GEN_MASK;
+    if (!ti.gen)
+        ti.gen = 1; // keep timer IDs non-zero
+
+    this->free_slots.push_back(slot);
+}
+
+uint32_t TimerManager::add_timer(uint64_t timeout, uint64_t interval, timer_cb&& cb)
 {
-    TimerInfo* ti = new TimerInfo;
+    uint32_t slot;
+
+    if (!this->free_slots.empty()) {
+        slot = this->free_slots.back();
+        this->free_slots.pop_back();
+    } else {
+        // only grows until the busiest moment has been seen once
+        slot = (uint32_t)this->timer_pool.size();
+        if (slot >= TIMER_MAX_SLOTS)
+            ABORT_F("TimerManager: too many active timers");
+        this->timer_pool.push_back({});
+        this->timer_pool[slot].gen = 1;
+        this->free_slots.reserve(this->timer_pool.capacity());
+        this->timer_queue.reserve(this->timer_pool.capacity());
+    }
 
-    ti->id          = ++this->id;
-    ti->timeout_ns  = this->get_time_now() + delay;
-    ti->interval_ns = interval;
-    ti->cb          = cb;
+    TimerInfo& ti = this->timer_pool[slot];
 
-    std::shared_ptr<TimerInfo> timer_desc(ti);
+    ti.timeout_ns  = timeout;
+    ti.interval_ns = interval;
+    ti.seq         = this->timer_seq++;
+    ti.cb          = std::move(cb);
 
     // add new timer to the timer queue
-    this->timer_queue.push(timer_desc);
+    this->timer_queue.push_back(slot);
+    queue_sift_up((uint32_t)this->timer_queue.size() - 1);
+
+    uint32_t id = (ti.gen << TIMER_SLOT_BITS) | slot;
 
     // notify listeners about changes in the timer queue
     if (!this->cb_active) {
         this->notify_timer_changes();
     }
 
-    return ti->id;
+    return id;
+}
+
+uint32_t TimerManager::add_oneshot_timer(uint64_t timeout, timer_cb cb)
+{
+    return this->add_timer(this->get_time_now() + timeout, 0, std::move(cb));
+}
+
+uint32_t TimerManager::add_immediate_timer(timer_cb cb) {
+    return this->add_timer(this->get_time_now(), 0, std::move(cb));
+}
+
+uint32_t TimerManager::add_cyclic_timer(uint64_t interval, uint64_t delay, timer_cb cb)
+{
+    return this->add_timer(this->get_time_now() + delay, interval, std::move(cb));
 }
 
 uint32_t TimerManager::add_cyclic_timer(uint64_t interval, timer_cb cb) {
-    return this->add_cyclic_timer(interval, interval, cb);
+    return this->add_cyclic_timer(interval, interval, std::move(cb));
 }
 
 void TimerManager::cancel_timer(uint32_t id)
 {
-    this->timer_queue.remove_by_id(id);
+    TimerInfo* ti = this->find_timer(id);
+    if (ti) {
+        queue_remove(ti->queue_pos);
+        free_timer(id & (TIMER_MAX_SLOTS - 1));
+    }
+
     if (!this->cb_active) {
         this->notify_timer_changes();
     }
@@ -109,30 +179,33 @@ void TimerManager::cancel_timer(uint32_t id)
 
 uint64_t TimerManager::process_timers()
 {
-    std::shared_ptr<TimerInfo> cur_timer;
     uint64_t time_now = get_time_now();
 
-{ // mtx scope
-    std::lock_guard<std::recursive_mutex> lk(this->timer_queue.get_mtx());
-    if (this->timer_queue.empty()) {
-        return 0ULL;
-    }
-
     // scan for expired timers
-    cur_timer = this->timer_queue.top();
-} // ] mtx scope
-    while (cur_timer->timeout_ns <= time_now) {
-        timer_cb cb = cur_timer->cb;
-
-        // re-arm cyclic timers
-        if (cur_timer->interval_ns) {
-            std::lock_guard<std::recursive_mutex> lk(this->timer_queue.get_mtx());
-            cur_timer->timeout_ns = time_now + cur_timer->interval_ns;
-            this->timer_queue.remove_by_id(cur_timer->id);
-            this->timer_queue.push(cur_timer);
+    while (!this->timer_queue.empty()) {
+        uint32_t   slot      = this->timer_queue[0];
+        TimerInfo& cur_timer = this->timer_pool[slot];
+
+        if (cur_timer.timeout_ns > time_now) {
+            // return time slice in nanoseconds until next timer's expiry
+            return cur_timer.timeout_ns - time_now;
+        }
+
+        // the callback may cancel or add timers, which can reuse the slot
+        // or move the pool, so run it from a local copy
+        timer_cb cb = std::move(cur_timer.cb);
+        uint32_t id = (cur_timer.gen << TIMER_SLOT_BITS) | slot;
+        bool cyclic = cur_timer.interval_ns != 0;
+
+        if (cyclic) {
+            // re-arm cyclic timers in place
+            cur_timer.timeout_ns = time_now + cur_timer.interval_ns;
+            cur_timer.seq        = this->timer_seq++;
+            queue_sift_down(0);
         } else {
             // remove one-shot timers from queue
-            this->timer_queue.pop();
+            queue_remove(0);
+            free_timer(slot);
         }
 
         this->cb_active = true;
@@ -142,17 +215,13 @@ uint64_t TimerManager::process_timers()
 
         this->cb_active = false;
 
-        // process next timer
-{ // [ mtx scope
-        std::lock_guard<std::recursive_mutex> lk(this->timer_queue.get_mtx());
-        if (this->timer_queue.empty()) {
-            return 0ULL;
+        // hand the callback back unless the timer was cancelled meanwhile
+        if (cyclic) {
+            TimerInfo* ti = this->find_timer(id);
+            if (ti)
+                ti->cb = std::move(cb);
         }
-
-        cur_timer = this->timer_queue.top();
-} // ] mtx scope
     }
 
-    // return time slice in nanoseconds until next timer's expiry
-    return cur_timer->timeout_ns - time_now;
+    return 0ULL;
 }
@@ -23,13 +23,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #define TIMER_MANAGER_H
 
 #include <atomic>
-#include <algorithm>
 #include <cinttypes>
 #include <functional>
-#include <memory>
-#include <queue>
 #include <vector>
-#include <mutex>
 
 constexpr auto NS_PER_SEC     = 1000000000;
 constexpr auto USEC_PER_SEC   = 1000000;
@@ -42,68 +38,20 @@ constexpr auto ONE_BILLION_NS = 1000000000;
 
 typedef std::function<void()> timer_cb;
 
-/** Extend std::priority_queue as suggested here:
-    https://stackoverflow.com/a/36711682
-    to be able to remove arbitrary elements.
- */
-template <typename T, class Container = std::vector<T>, class Compare = std::less<typename Container::value_type>>
-class my_priority_queue : public std::priority_queue<T, Container, Compare> {
-public:
-    bool remove_by_id(const uint32_t id){
-        std::lock_guard<std::recursive_mutex> lk(mtx);
-        auto el = this->top();
-        if (el->id == id) {
-            std::priority_queue<T, Container, Compare>::pop();
-            return true;
-        }
-        auto it = std::find_if(
-            this->c.begin(), this->c.end(), [id](const T& el) { return el->id == id; });
-        if (it != this->c.end()) {
-            this->c.erase(it);
-            std::make_heap(this->c.begin(), this->c.end(), this->comp);
-            return true;
-        }
-        return false;
-    }
-
-    void push(T val)
-    {
-        std::lock_guard<std::recursive_mutex> lk(mtx);
-        std::priority_queue<T, Container, Compare>::push(val);
-    }
-
-    T pop()
-    {
-        std::lock_guard<std::recursive_mutex> lk(mtx);
-        T val = std::priority_queue<T, Container, Compare>::top();
-        std::priority_queue<T, Container, Compare>::pop();
-        return val;
-    }
-
-    std::recursive_mutex& get_mtx()
-    {
-        return mtx;
-    }
-
-private:
-    std::recursive_mutex mtx;
-};
-
+/** Timer slot in the TimerManager pool. Slots are recycled, a timer ID
+    combines the slot number with the generation of the slot so that IDs
+    of expired or cancelled timers don't match the next user of the slot. */
 typedef struct TimerInfo {
-    uint32_t id;
     uint64_t timeout_ns;  // timer expiry
     uint64_t interval_ns; // 0 for one-shot timers
+    uint64_t seq;         // keeps timers with the same expiry in FIFO order
     timer_cb cb;          // timer callback
+    uint32_t gen;         // generation of the slot
+    uint32_t queue_pos;   // position in the timer queue, TIMER_UNQUEUED if free
 } TimerInfo;
 
-// Custom comparator for sorting our timer queue in ascending order
-class MyGtComparator {
-public:
-    bool operator()(const std::shared_ptr<TimerInfo>& l, const std::shared_ptr<TimerInfo>& r) {
-        return l.get()->timeout_ns > r.get()->timeout_ns;
-    }
-};
-
+/** Timers of the emulated machine. Only the emulation thread may use them,
+    other host threads post a command through the CommandQueue instead. */
 class TimerManager {
 public:
     static TimerManager* get_instance() {
@@ -139,14 +87,30 @@ private:
     static TimerManager* timer_manager;
     TimerManager(){} // private constructor to implement a singleton
 
-    // timer queue
-    my_priority_queue<std::shared_ptr<TimerInfo>, std::vector<std::shared_ptr<TimerInfo>>, MyGtComparator> timer_queue;
+    static constexpr uint32_t TIMER_SLOT_BITS = 12;
+    static constexpr uint32_t TIMER_MAX_SLOTS = 1 << TIMER_SLOT_BITS;
+    static constexpr uint32_t TIMER_GEN_MASK  = (1U << (32 - TIMER_SLOT_BITS)) - 1;
+    static constexpr uint32_t TIMER_UNQUEUED  = 0xFFFFFFFFUL;
+
+    uint32_t add_timer(uint64_t timeout, uint64_t interval, timer_cb&& cb);
+    TimerInfo* find_timer(uint32_t id);
+    void free_timer(uint32_t slot);
+
+    // binary min-heap operations on timer_queue
+    bool expires_before(uint32_t l, uint32_t r) const;
+    void queue_place(uint32_t pos, uint32_t slot);
+    void queue_sift_up(uint32_t pos);
+    void queue_sift_down(uint32_t pos);
+    void queue_remove(uint32_t pos);
+
+    std::vector<TimerInfo> timer_pool;
+    std::vector<uint32_t>  free_slots;
+    std::vector<uint32_t>  timer_queue; // pool slots ordered by expiry
+    uint64_t               timer_seq = 0;
 
     std::function<uint64_t()>   get_time_now;
     std::function<void()>       notify_timer_changes;
 
-    std::atomic<uint32_t> id{0};
-
     // cb_active is written by timer processing and read during timer additions
     // std::atomic ensures thread safety across different callback contexts
     std::atomic<bool> cb_active{false}; // true if a timer callback is executing
@@ -216,6 +216,8 @@ void dppc_interpreter::power_lscbx(uint32_t opcode) {
 
     while (bytes_remaining > 0) {
         uint8_t return_value = mmu_read_vmem<uint8_t>(opcode, ea);
+        if (ppc_faulted())
+            return;
 
         ppc_result_d |= return_value << shift_amount;
         if (!shift_amount) {
@@ -244,6 +246,7 @@ void dppc_interpreter::power_lscbx(uint32_t opcode) {
     ppc_state.spr[SPR::XER] = (ppc_state.spr[SPR::XER] & ~0x7F) | (bytes_to_load - bytes_remaining);
 
     if (rec) {
+        ppc_discard_crf0();
         ppc_state.cr =
             (ppc_state.cr & 0x0FFFFFFFUL) |
             (is_match ? CRx_bit::CR_EQ : 0) |
@@ -494,11 +497,7 @@ void dppc_interpreter::power_sraiq(uint32_t opcode) {
     ppc_result_a           = (int32_t)ppc_result_d >> rot_sh;
     ppc_state.spr[SPR::MQ] = ROTR_32(ppc_result_d, rot_sh);
 
-    if ((int32_t(ppc_result_d) < 0) && (ppc_result_d & mask)) {
-        ppc_state.spr[SPR::XER] |= XER::CA;
-    } else {
-        ppc_state.spr[SPR::XER] &= ~XER::CA;
-    }
+    ppc_set_ca((int32_t(ppc_result_d) < 0) && (ppc_result_d & mask));
 
     if (rec)
         ppc_changecrf0(ppc_result_a);
@@ -517,11 +516,7 @@ void dppc_interpreter::power_sraq(uint32_t opcode) {
     ppc_result_a           = (int32_t)ppc_result_d >> ((ppc_result_b & 0x20) ? 31 : rot_sh);
     ppc_state.spr[SPR::MQ] = ROTL_32(ppc_result_d, rot_sh);
 
-    if ((int32_t(ppc_result_d) < 0) && (ppc_result_d & mask)) {
-        ppc_state.spr[SPR::XER] |= XER::CA;
-    } else {
-        ppc_state.spr[SPR::XER] &= ~XER::CA;
-    }
+    ppc_set_ca((int32_t(ppc_result_d) < 0) && (ppc_result_d & mask));
 
     ppc_state.spr[SPR::MQ] = ROTR_32(ppc_result_d, rot_sh);
 
@@ -560,11 +555,7 @@ void dppc_interpreter::power_srea(uint32_t opcode) {
     uint32_t r             = ROTR_32(ppc_result_d, rot_sh);
     uint32_t mask          = -1U >> rot_sh;
 
-    if ((int32_t(ppc_result_d) < 0) && (r & ~mask)) {
-        ppc_state.spr[SPR::XER] |= XER::CA;
-    } else {
-        ppc_state.spr[SPR::XER] &= ~XER::CA;
-    }
+    ppc_set_ca((int32_t(ppc_result_d) < 0) && (r & ~mask));
 
     if (rec)
         ppc_changecrf0(ppc_result_a);
@@ -0,0 +1,203 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Cache of predecoded basic blocks for the threaded interpreter. */
+
+#include "ppcblockcache.h"
+#include "ppcemu.h"
+#include "ppcjit.h"
+#include "ppcmmu.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+/** Storage for cached blocks and their decoded instructions.
+    Both are allocated linearly and reclaimed as a whole on flush. */
+constexpr uint32_t PPC_BLOCK_ARENA_SIZE  = 1 << 17;
+constexpr uint32_t PPC_BLOCK_HEADER_SIZE = 1 << 15;
+
+PPCBlockCacheEntry ppc_block_cache[PPC_BLOCK_CACHE_SIZE];
+uint32_t           ppc_block_generation = 1;
+uint32_t           ppc_code_generation  = 1;
+
+/** Lists of the blocks decoded from each physical page, hashed by page
+    number. A list is only valid in the cache generation it was started in. */
+constexpr uint32_t PPC_BLOCK_PAGE_SLOTS = 1 << 12;
+
+typedef struct PPCBlockPageList {
+    uint32_t            generation;
+    PPCDecodedBlock*    head;
+} PPCBlockPageList;
+
+static PPCBlockPageList block_pages[PPC_BLOCK_PAGE_SLOTS];
+
+static std::unique_ptr<PPCDecodedInsn[]>  insn_arena;
+static std::unique_ptr<PPCDecodedBlock[]> block_arena;
+static uint32_t insn_arena_used  = 0;
+static uint32_t block_arena_used = 0;
+
+/** Returns true if the instruction terminates a block. Blocks run on past
+    forward conditional branches, taking one of them leaves the block early. */
+static inline bool ends_block(uint32_t opcode) {
+    switch (opcode >> 26) {
+    case 16: // bc
+        return (((opcode >> 21) & 0x14) == 0x14) || (opcode & 3) || int16_t(opcode) <= 0;
+    case 17: // sc
+    case 18: // b
+        return true;
+    case 19:
+        switch ((opcode >> 1) & 0x3FF) {
+        case 16:  // bclr
+        case 50:  // rfi
+        case 150: // isync
+        case 528: // bcctr
+            return true;
+        }
+        break;
+    }
+    return false;
+}
+
+static inline PPCBlockPageList* block_page_list(uint32_t phys_addr) {
+    PPCBlockPageList* list = &block_pages[(phys_addr >> PPC_PAGE_SIZE_BITS) &
+                                          (PPC_BLOCK_PAGE_SLOTS - 1)];
+    if (list->generation != ppc_block_generation) {
+        list->generation = ppc_block_generation;
+        list->head       = nullptr;
+    }
+    return list;
+}
+
+void ppc_block_cache_flush() {
+    if (!++ppc_block_generation) {
+        // generation counter wrapped, make sure no stale block survives
+        std::memset(ppc_block_cache, 0, sizeof(ppc_block_cache));
+        std::memset(block_pages, 0, sizeof(block_pages));
+        if (block_arena)
+            std::fill_n(block_arena.get(), PPC_BLOCK_HEADER_SIZE, PPCDecodedBlock{});
+        ppc_block_generation = 1;
+    }
+    ppc_code_generation++;
+    insn_arena_used  = 0;
+    block_arena_used = 0;
+
+    ppc_jit_flush();
+}
+
+void ppc_block_cache_invalidate(uint32_t start, uint32_t end) {
+    uint32_t first_page = start >> PPC_PAGE_SIZE_BITS;
+    uint32_t last_page  = end >> PPC_PAGE_SIZE_BITS;
+
+    // lists are shared by pages a multiple of PPC_BLOCK_PAGE_SLOTS apart,
+    // a range spanning more pages than that visits every list once
+    uint32_t num_lists = std::min(last_page - first_page, PPC_BLOCK_PAGE_SLOTS - 1) + 1;
+
+    for (uint32_t i = 0; i < num_lists; i++) {
+        PPCBlockPageList* list = block_page_list((first_page + i) << PPC_PAGE_SIZE_BITS);
+
+        for (PPCDecodedBlock** prev = &list->head; *prev;) {
+            PPCDecodedBlock* blk  = *prev;
+            uint32_t         page = blk->phys_addr >> PPC_PAGE_SIZE_BITS;
+            if (page >= first_page && page <= last_page) {
+                // links never leave the page so they may point to a dropped block
+                for (auto& gen : blk->link_gen)
+                    gen = 0;
+                if (blk->phys_addr <= end && blk->phys_addr + blk->num_insns * 4 > start) {
+                    PPCBlockCacheEntry* entry =
+                        &ppc_block_cache[(blk->phys_addr >> 2) & (PPC_BLOCK_CACHE_SIZE - 1)];
+                    if (entry->blk == blk)
+                        entry->generation = 0;
+                    *prev = blk->page_next;
+                    continue;
+                }
+            }
+            prev = &blk->page_next;
+        }
+    }
+
+    ppc_code_generation++;
+}
+
+PPCDecodedBlock* ppc_block_decode(uint32_t guest_pa, const uint8_t* host_va, uint32_t tag) {
+    PPCBlockCacheEntry* entry = &ppc_block_cache[(guest_pa >> 2) & (PPC_BLOCK_CACHE_SIZE - 1)];
+
+    // MPC601 has a unified cache so software isn't obliged to use icbi
+    // after modifying code. Revalidate cached blocks against memory instead.
+    if (entry->tag == tag && entry->generation == ppc_block_generation) {
+        PPCDecodedBlock* blk = entry->blk;
+        uint32_t i = 0;
+        for (; i < blk->num_insns; i++) {
+            if (ppc_read_instruction(host_va + i * 4) != blk->insns[i].opcode)
+                break;
+        }
+        if (i == blk->num_insns)
+            return blk;
+    }
+
+    if (!insn_arena) {
+        insn_arena  = std::make_unique<PPCDecodedInsn[]>(PPC_BLOCK_ARENA_SIZE);
+        block_arena = std::make_unique<PPCDecodedBlock[]>(PPC_BLOCK_HEADER_SIZE);
+    }
+
+    if (insn_arena_used + PPC_BLOCK_MAX_INSNS > PPC_BLOCK_ARENA_SIZE ||
+        block_arena_used == PPC_BLOCK_HEADER_SIZE) {
+        ppc_block_cache_flush();
+    }
+
+    // a block never crosses a page boundary
+    uint32_t max_insns = std::min(PPC_BLOCK_MAX_INSNS,
+                                  (PPC_PAGE_SIZE - (guest_pa & ~PPC_PAGE_MASK)) >> 2);
+
+    PPCDecodedInsn* insns = &insn_arena[insn_arena_used];
+    uint32_t num_insns = 0;
+
+    while (num_insns < max_insns) {
+        uint32_t opcode = ppc_read_instruction(host_va + num_insns * 4);
+        insns[num_insns].handler = ppc_decode_opcode(opcode);
+        insns[num_insns].opcode  = opcode;
+        insns[num_insns].fused   = 0;
+        if (num_insns)
+            insns[num_insns - 1].fused = ppc_fuse_pair(insns[num_insns - 1].handler,
+                                                       insns[num_insns].handler);
+        num_insns++;
+        if (ends_block(opcode))
+            break;
+    }
+
+    insn_arena_used += num_insns;
+
+    PPCDecodedBlock* blk = &block_arena[block_arena_used++];
+    *blk = {};
+    blk->phys_addr = guest_pa;
+    blk->num_insns = num_insns;
+    blk->insns     = insns;
+
+    PPCBlockPageList* list = block_page_list(guest_pa);
+    blk->page_next = list->head;
+    list->head     = blk;
+
+    entry->tag        = tag;
+    entry->generation = ppc_block_generation;
+    entry->blk        = blk;
+
+    return blk;
+}
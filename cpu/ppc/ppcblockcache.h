@@ -0,0 +1,152 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Cache of predecoded basic blocks for the threaded interpreter.
+
+    A basic block is a run of instructions that starts at an arbitrary
+    address and ends with a branch, a context-synchronizing instruction
+    or the end of the memory page, whichever comes first.
+    Each instruction is decoded exactly once into a handler pointer and its
+    raw opcode so executing a cached block requires neither instruction
+    fetch nor table lookup. Common instruction pairs are additionally
+    marked so they can be dispatched as one fused handler.
+
+    Blocks are keyed by the physical address of their first instruction
+    so they survive address translation changes. Modified code must be
+    announced via ppc_block_cache_invalidate(), which the icbi instruction
+    does for its cache line as required by the architecture. Blocks are
+    also listed per physical page so that only the blocks overlapping the
+    modified range are dropped. The same happens to the affected range
+    when the physical memory map changes.
+ */
+
+#ifndef PPC_BLOCK_CACHE_H
+#define PPC_BLOCK_CACHE_H
+
+#include "ppcemu.h"
+#include "ppcmmu.h"
+
+#include <cinttypes>
+
+/** Maximum number of instructions in a predecoded block. */
+constexpr uint32_t PPC_BLOCK_MAX_INSNS = 64;
+
+typedef struct PPCDecodedInsn {
+    PPCOpcode   handler;
+    uint32_t    opcode;
+    uint32_t    fused;  // index into ppc_fused_pairs if this and the next instruction are fused
+} PPCDecodedInsn;
+
+/** Execution state shared between the dispatcher and translated code. */
+typedef struct PPCJitState {
+    struct PPCDecodedBlock* blk;         // block being executed
+    uint64_t                cycle_limit; // only continue into blocks ending before this cycle
+    uint32_t                blk_gen;     // cache generation blk was obtained in
+    uint32_t                pc;          // guest address of the first instruction of blk
+    uint32_t                goal_addr;   // don't continue into the block containing this address
+} PPCJitState;
+
+/** Host code for a block. Continues into translated blocks linked to it and
+    updates the state whenever it does so. Returns the number of instructions
+    executed in the last block. */
+typedef uint32_t (*PPCJitCode)(PPCJitState* state);
+
+typedef struct PPCDecodedBlock {
+    uint32_t                phys_addr;  // physical address of the first instruction
+    uint32_t                num_insns;
+    PPCDecodedInsn*         insns;
+
+    uint32_t                exec_count; // number of entries, used to find hot blocks
+    PPCJitCode              jit_code;   // translated host code if any
+    uint32_t                idle_wait;  // back-edges to ignore before the next idle check
+
+    // Successors within the same page, [0] for fall-through, [1] for the branch
+    // ending the block, [2] for branches leaving it early.
+    // Only valid in the cache generation they were established in.
+    uint32_t                link_gen[3];
+    uint32_t                link_offset[3];
+    struct PPCDecodedBlock* link[3];
+
+    struct PPCDecodedBlock* page_next;  // next block in the same page list
+} PPCDecodedBlock;
+
+typedef struct PPCBlockCacheEntry {
+    uint32_t            tag;        // physical address of the first instruction | FPU/AltiVec state
+    uint32_t            generation; // cache generation this entry was filled in
+    PPCDecodedBlock*    blk;
+} PPCBlockCacheEntry;
+
+constexpr uint32_t PPC_BLOCK_CACHE_BITS = 14;
+constexpr uint32_t PPC_BLOCK_CACHE_SIZE = 1 << PPC_BLOCK_CACHE_BITS;
+
+extern PPCBlockCacheEntry ppc_block_cache[PPC_BLOCK_CACHE_SIZE];
+extern uint32_t           ppc_block_generation;
+
+/** Changes whenever predecoded blocks are dropped, either all of them or
+    only some. Lets other caches derived from guest code notice that. */
+extern uint32_t           ppc_code_generation;
+
+/** Decode the block starting at guest_pa and place it into the cache. */
+extern PPCDecodedBlock* ppc_block_decode(uint32_t guest_pa, const uint8_t* host_va, uint32_t tag);
+
+/** Drop all predecoded blocks. */
+extern void ppc_block_cache_flush();
+
+/** Drop the predecoded blocks overlapping the physical range start..end. */
+extern void ppc_block_cache_invalidate(uint32_t start, uint32_t end);
+
+/** Return the predecoded block starting at guest_pa, decoding it if necessary. */
+inline PPCDecodedBlock* ppc_block_lookup(uint32_t guest_pa, const uint8_t* host_va) {
+    // instructions are word-aligned so bits 0 and 1 can hold the FPU and
+    // AltiVec state that determine which decoder the block was decoded with
+    uint32_t tag = guest_pa | !!(ppc_state.msr & MSR::FP) | (!!(ppc_state.msr & MSR::VEC) << 1);
+
+    PPCBlockCacheEntry* entry = &ppc_block_cache[(guest_pa >> 2) & (PPC_BLOCK_CACHE_SIZE - 1)];
+    if (entry->tag == tag && entry->generation == ppc_block_generation && !is_601) [[likely]]
+        return entry->blk;
+
+    return ppc_block_decode(guest_pa, host_va, tag);
+}
+
+/** Return the block control is transferred to from blk, linking them if possible.
+    blk_gen is the cache generation blk was obtained in, kind selects the link
+    slot: 0 if blk ran to its end without branching, 1 if its final branch was
+    taken and 2 if it was left early through a conditional branch. */
+inline PPCDecodedBlock* ppc_block_next(PPCDecodedBlock* blk, uint32_t blk_gen, int kind,
+                                       uint32_t next_offset, uint32_t page_pa,
+                                       const uint8_t* page_host_va) {
+    if (blk->link_offset[kind] == next_offset && blk->link_gen[kind] == ppc_block_generation)
+        [[likely]] return blk->link[kind];
+
+    PPCDecodedBlock* next = ppc_block_lookup(page_pa | next_offset, page_host_va + next_offset);
+
+    // don't link blocks that were flushed in the meantime;
+    // MPC601 blocks are revalidated on every entry so they can't be linked either
+    if (blk_gen == ppc_block_generation && !is_601) {
+        blk->link_offset[kind] = next_offset;
+        blk->link_gen[kind]    = blk_gen;
+        blk->link[kind]        = next;
+    }
+
+    return next;
+}
+
+#endif // PPC_BLOCK_CACHE_H
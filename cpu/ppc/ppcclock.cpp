@@ -0,0 +1,169 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Virtual clock of the emulated CPU. */
+
+#include "ppcclock.h"
+#include "ppcemu.h"
+#include "ppcmmu.h"
+
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+
+extern uint64_t g_icycles;
+
+bool     ppc_clock_calibrate = false;
+uint64_t ppc_clock_skipped;
+
+/** Host execution time each measurement of the instruction rate spans. */
+constexpr uint64_t PPC_CLOCK_WINDOW_NS = 250000000;
+
+/** Fewest instructions a measurement needs to be taken into account. */
+constexpr uint64_t PPC_CLOCK_MIN_SAMPLE = 100000;
+
+/** Weight of a new measurement, 1 / (1 << PPC_CLOCK_SMOOTH_SHIFT). */
+constexpr int PPC_CLOCK_SMOOTH_SHIFT = 2;
+
+/** Calibrated ratio bounds: 1/16 ns to 2048 ns per instruction. */
+constexpr uint64_t PPC_CLOCK_MIN_RATIO = 1ULL << (PPC_CLOCK_FRAC_BITS - 4);
+constexpr uint64_t PPC_CLOCK_MAX_RATIO = 2048ULL << PPC_CLOCK_FRAC_BITS;
+
+/** The base is moved up before the instruction delta times the ratio
+    could overflow. Exact for the fixed ratio which has no fraction. */
+constexpr uint64_t PPC_CLOCK_REBASE_CYCLES = 1ULL << 32;
+
+typedef std::chrono::steady_clock host_clock;
+
+static uint64_t base_ns;        // virtual time at base_cycles
+static uint64_t base_cycles;
+static uint64_t ratio;          // ns per instruction, PPC_CLOCK_FRAC_BITS fraction
+
+static bool     calibrating;
+static bool     calibrated;     // the ratio reflects a measurement
+static uint64_t logged_ratio;
+static host_clock::time_point host_last;
+static uint64_t busy_ns;        // host time spent executing in this window
+static uint64_t win_cycles;     // g_icycles at the start of the window
+static uint64_t win_skipped;    // ppc_clock_skipped at the start of the window
+
+uint64_t get_virt_time_ns()
+{
+    // include the instructions of the current block retired so far,
+    // a block never extends beyond its page
+    uint32_t in_block = ppc_state.pc - ppc_cycles_pc;
+    uint64_t cycles   = g_icycles + (in_block < PPC_PAGE_SIZE ? in_block >> 2 : 0);
+    return base_ns + (((cycles - base_cycles) * ratio) >> PPC_CLOCK_FRAC_BITS);
+}
+
+static void set_ratio(uint64_t new_ratio) {
+    base_ns     = get_virt_time_ns();
+    base_cycles = g_icycles;
+    ratio       = new_ratio;
+}
+
+static void restart_window() {
+    host_last   = host_clock::now();
+    busy_ns     = 0;
+    win_cycles  = g_icycles;
+    win_skipped = ppc_clock_skipped;
+}
+
+void ppc_clock_init(int shift) {
+    base_ns           = 0;
+    base_cycles       = g_icycles;
+    ratio             = 1ULL << (shift + PPC_CLOCK_FRAC_BITS);
+    ppc_clock_skipped = 0;
+
+    calibrating  = ppc_clock_calibrate && !is_deterministic;
+    calibrated   = false;
+    logged_ratio = ratio;
+    restart_window();
+}
+
+uint64_t ppc_clock_ns_to_cycles(uint64_t ns) {
+    // nothing is scheduled days ahead, avoid overflowing the shift
+    ns = std::min(ns, uint64_t(1) << (63 - PPC_CLOCK_FRAC_BITS));
+    return (ns << PPC_CLOCK_FRAC_BITS) / ratio;
+}
+
+double ppc_clock_mips() {
+    return 1000.0 * (1ULL << PPC_CLOCK_FRAC_BITS) / ratio;
+}
+
+void ppc_clock_resync() {
+    host_last = host_clock::now();
+}
+
+void ppc_clock_update() {
+    if (g_icycles - base_cycles >= PPC_CLOCK_REBASE_CYCLES)
+        set_ratio(ratio);
+
+    if (!calibrating)
+        return;
+
+    auto now     = host_clock::now();
+    uint64_t gap = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        now - host_last).count();
+    host_last = now;
+
+    // nothing runs this long between event checks unless the CPU thread
+    // was stopped (debugger, suspended host), so the window is useless
+    if (gap > PPC_CLOCK_WINDOW_NS) {
+        restart_window();
+        return;
+    }
+
+    busy_ns += gap;
+    if (busy_ns < PPC_CLOCK_WINDOW_NS)
+        return;
+
+    uint64_t executed = (g_icycles - win_cycles) - (ppc_clock_skipped - win_skipped);
+    uint64_t busy     = busy_ns;
+    restart_window();
+
+    if (executed < PPC_CLOCK_MIN_SAMPLE)
+        return;
+
+    uint64_t measured = std::clamp((busy << PPC_CLOCK_FRAC_BITS) / executed,
+                                   PPC_CLOCK_MIN_RATIO, PPC_CLOCK_MAX_RATIO);
+
+    // take the first measurement as is so that the guest sees a sensible
+    // speed early during boot, then follow changes gradually
+    uint64_t new_ratio = measured;
+    if (calibrated)
+        new_ratio = uint64_t(int64_t(ratio) +
+                             ((int64_t(measured) - int64_t(ratio)) >> PPC_CLOCK_SMOOTH_SHIFT));
+    calibrated = true;
+
+    set_ratio(std::max(new_ratio, PPC_CLOCK_MIN_RATIO));
+
+    LOG_F(9, "Clock: measured %.2f MIPS, running at %.2f MIPS",
+          1000.0 * (1ULL << PPC_CLOCK_FRAC_BITS) / measured, ppc_clock_mips());
+
+    // report once the rate has moved by more than 10%
+    if (ratio * 10 < logged_ratio * 9 || ratio * 10 > logged_ratio * 11) {
+        logged_ratio = ratio;
+        LOG_F(INFO, "Clock: calibrated to %.2f MIPS", ppc_clock_mips());
+    }
+}
@@ -0,0 +1,68 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Virtual clock of the emulated CPU.
+
+    Virtual time advances by a fixed-point number of nanoseconds for each
+    instruction. By default the ratio is 1 << icnt_factor and never changes.
+
+    With calibration enabled, the host time spent running guest code is
+    measured and the ratio follows the instruction rate actually achieved,
+    so guest delay loops and timers see the speed the guest really runs at.
+    Changes are smoothed and applied without any jump in virtual time.
+    Deterministic execution always keeps the fixed ratio.
+ */
+
+#ifndef PPC_CLOCK_H
+#define PPC_CLOCK_H
+
+#include <cinttypes>
+
+/** Fractional bits of the nanoseconds per instruction ratio. */
+constexpr int PPC_CLOCK_FRAC_BITS = 16;
+
+/** Adjust the ratio to the measured host speed. */
+extern bool ppc_clock_calibrate;
+
+/** Instructions virtual time was advanced by without executing them,
+    e.g. when skipping idle loops. */
+extern uint64_t ppc_clock_skipped;
+
+/** Restart virtual time at zero with 1 << shift nanoseconds per instruction. */
+extern void ppc_clock_init(int shift);
+
+/** Return the number of instructions that take ns nanoseconds of virtual time. */
+extern uint64_t ppc_clock_ns_to_cycles(uint64_t ns);
+
+/** Charge the host time since the previous call to the instructions executed
+    since then. Called by the execution loops whenever they check for events. */
+extern void ppc_clock_update();
+
+/** Don't charge the host time since the previous update to any instructions,
+    e.g. because the CPU thread has been sleeping. */
+extern void ppc_clock_resync();
+
+/** Return the instruction rate the virtual clock is based on, in MIPS. */
+extern double ppc_clock_mips();
+
+int test_ppc_clock(void);
+
+#endif // PPC_CLOCK_H
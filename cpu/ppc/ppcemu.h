@@ -29,7 +29,6 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <atomic>
 #include <cinttypes>
 #include <functional>
-#include <setjmp.h>
 #include <string>
 
 // Uncomment this to have a more graceful approach to illegal opcodes
@@ -49,11 +48,35 @@ enum endian_switch { big_end = 0, little_end = 1 };
 
 typedef void (*PPCOpcode)(uint32_t opcode);
 
+/** Handler executing two adjacent instructions at once.
+    The second instruction is skipped if the first one sets exec_flags. */
+typedef void (*PPCFusedOp)(uint32_t first, uint32_t second);
+
+/** Second decoding level for one primary opcode.
+    The handler is table[opcode & mask]; mask is zero for primary opcodes
+    that map to a single handler. */
+typedef struct PPCOpcodeGroup {
+    PPCOpcode*  table;
+    uint32_t    mask;
+} PPCOpcodeGroup;
+
 union FPR_storage {
     double dbl64_r;      // double floating-point representation
     uint64_t int64_r;    // double integer representation
 };
 
+/** AltiVec vector register.
+    Elements are numbered in big-endian order like in the PowerPC manuals.
+    Words are kept in host byte order with uw[0] holding element 0 so that
+    element-wise operations can work on all lanes at once. Narrower elements
+    have to be accessed by their architectural index (see velem()). */
+union alignas(16) VR_storage {
+    uint8_t  ub[16];
+    uint16_t uh[8];
+    uint32_t uw[4];
+    float    f[4];
+};
+
 /**
 Except for the floating-point registers, all registers require
 32 bits for representation. Floating-point registers need 64 bits.
@@ -66,6 +89,8 @@ fpscr = FP Status and Condition Register
   spr = Special Register
   msr = Machine State Register
    sr = Segment Register
+   vr = Vector Register (AltiVec)
+ vscr = Vector Status and Control Register (AltiVec)
 **/
 
 typedef struct struct_ppc_state {
@@ -79,6 +104,8 @@ typedef struct struct_ppc_state {
     uint32_t msr;
     uint32_t sr[16];
     bool reserve;    // reserve bit used for lwarx and stcwx
+    VR_storage vr[32];
+    uint32_t vscr;
 } SetPRS;
 
 extern SetPRS ppc_state;
@@ -100,6 +127,7 @@ enum SPR : int {
     SDR1    = 25,
     SRR0    = 26,
     SRR1    = 27,
+    VRSAVE  = 256, // AltiVec
     TBL_U   = 268, // user mode TBL
     TBU_U   = 269, // user mode TBU
     SPRG0   = 272,
@@ -130,6 +158,7 @@ enum PPC_VER : uint32_t {
     MPC603EV    = 0x00070101,
     MPC750      = 0x00080200,
     MPC604E     = 0x00090202,
+    MPC7400     = 0x000C0209,
     MPC970MP    = 0x00440100,
 };
 
@@ -189,6 +218,8 @@ enum {
     EXEF_EXCEPTION      = 1 << 1, // Exception handler invoked
     EXEF_RFI            = 1 << 2, // RFI instruction executed
     EXEF_OPC_DECODER    = 1 << 3, // Opcode decoder has changed
+    EXEF_POW            = 1 << 4, // Power saving mode entered via MSR[POW]
+    EXEF_FAULT          = 1 << 5, // Current instruction raised a synchronous exception
 };
 
 enum CR_select : int32_t {
@@ -220,6 +251,7 @@ enum FPSCR : uint32_t {
     UE          = 1UL << 5,
     OE          = 1UL << 6,
     VE          = 1UL << 7,
+    EN_MASK     = VE | OE | UE | ZE | XE, // exception enables
     VXCVI       = 1UL << 8,
     VXSQRT      = 1UL << 9,
     VXSOFT      = 1UL << 10,
@@ -247,6 +279,12 @@ enum FPSCR : uint32_t {
     FX          = 1UL << 31
 };
 
+/** Bit definitions for the AltiVec Vector Status and Control Register. */
+enum VSCR : uint32_t {
+    SAT = 1UL << 0,  // saturation
+    NJ  = 1UL << 16, // non-Java mode
+};
+
 /** Bit definitions for the Machine State Register (MSR). */
 enum MSR : int {
 // ----------------------------------------------------------------------------------------
@@ -297,6 +335,13 @@ enum MSR : int {
 // ----------------------------------------------------------------------------------------
 };
 
+/** HID0 bits selecting the power saving mode entered when MSR[POW] is set. */
+enum HID0_PM : uint32_t {
+    HID0_DOZE  = 1 << 23,
+    HID0_NAP   = 1 << 22,
+    HID0_SLEEP = 1 << 21,
+};
+
 enum XER : uint32_t {
     CA = 1UL << 29,
     OV = 1UL << 30,
@@ -324,7 +369,8 @@ enum class Except_Type {
     EXC_NO_FPU,
     EXC_DECR,
     EXC_SYSCALL = 12,
-    EXC_TRACE   = 13
+    EXC_TRACE   = 13,
+    EXC_NO_VEC  = 14
 };
 
 /** Program Exception subclasses. */
@@ -337,7 +383,12 @@ enum Exc_Cause : uint32_t {
 
 extern unsigned exec_flags;
 
-extern jmp_buf exc_env;
+/** Returns true if the instruction being executed has raised a synchronous
+    exception. Its handler must return without touching any further guest
+    state, execution continues at the exception vector. */
+inline bool ppc_faulted() {
+    return exec_flags & EXEF_FAULT;
+}
 
 enum Po_Cause : int {
     po_none,
@@ -377,6 +428,20 @@ extern bool is_64bit;      // For PowerPC G5 Emulation
 // Make execution deterministic (ignore external input, used a fixed date, etc.)
 extern bool is_deterministic;
 
+// Execution engine used by ppc_exec() and ppc_exec_until()
+extern EXEC_MODE ppc_exec_mode;
+
+/** Maximum number of instructions executed between two checks for pending
+    events, must be at least 1. Timer deadlines are met exactly, this bounds
+    how late a request from a timer callback or another thread is noticed. */
+extern uint32_t ppc_event_check_interval;
+
+/** Address of the instruction g_icycles was last brought up to date at.
+    The execution loops add the instructions of a block to g_icycles when
+    it ends, so virtual time adds those retired before ppc_state.pc. */
+extern uint32_t ppc_cycles_pc;
+constexpr uint32_t PPC_EVENT_CHECK_INTERVAL = 64;
+
 // Important Addressing Integers
 extern uint32_t ppc_next_instruction_address;
 
@@ -384,6 +449,67 @@ inline uint32_t ppc_read_instruction(const uint8_t* ptr) {
     return READ_DWORD_BE_A(ptr);
 }
 
+/** Lazily evaluated integer flags.
+
+    Integer instructions with Rc=1 only record their result and XER[SO],
+    CR0 is computed from them when the CR is read. Likewise, XER[CA] is
+    kept apart from XER until XER itself is read. Code looking at
+    ppc_state.cr or XER directly must call ppc_sync_flags() first.
+ */
+typedef struct PPCLazyFlags {
+    uint32_t cr0_result; // result CR0 has to be computed from
+    uint32_t cr0_state;  // 0 if CR0 is up to date, recorded XER[SO] | LAZY_CR0 otherwise
+    uint32_t ca;         // 0 if XER[CA] is up to date, LAZY_CA | CA value otherwise
+} PPCLazyFlags;
+
+enum : uint32_t {
+    LAZY_CR0 = 1,
+    LAZY_CA  = 2,
+};
+
+extern PPCLazyFlags ppc_lazy_flags;
+
+extern void ppc_materialize_flags();
+
+inline void ppc_sync_flags() {
+    if (ppc_lazy_flags.cr0_state | ppc_lazy_flags.ca)
+        ppc_materialize_flags();
+}
+
+inline uint32_t ppc_lazy_crf0() {
+    uint32_t set_result = ppc_lazy_flags.cr0_result;
+    return ((set_result == 0) ? CRx_bit::CR_EQ :
+            (int32_t(set_result) < 0) ? CRx_bit::CR_LT : CRx_bit::CR_GT) |
+        ((ppc_lazy_flags.cr0_state & XER::SO) >> 3); // copy XER[SO] into CR0[SO].
+}
+
+// Current CR value for instructions that only read it
+inline uint32_t ppc_get_cr() {
+    if (!ppc_lazy_flags.cr0_state)
+        return ppc_state.cr;
+    return (ppc_state.cr & 0x0FFFFFFFU) | ppc_lazy_crf0();
+}
+
+// Affects CR Field 0 - For integer operations
+inline void ppc_changecrf0(uint32_t set_result) {
+    ppc_lazy_flags.cr0_result = set_result;
+    ppc_lazy_flags.cr0_state  = (ppc_state.spr[SPR::XER] & XER::SO) | LAZY_CR0;
+}
+
+// Drop a pending CR0 update for instructions overwriting the whole CR0 field
+inline void ppc_discard_crf0() {
+    ppc_lazy_flags.cr0_state = 0;
+}
+
+// Affects the XER register's Carry Bit
+inline void ppc_set_ca(bool ca) {
+    ppc_lazy_flags.ca = LAZY_CA | ca;
+}
+
+inline uint32_t ppc_get_ca() {
+    return ppc_lazy_flags.ca ? (ppc_lazy_flags.ca & 1) : (ppc_state.spr[SPR::XER] >> 29) & 1;
+}
+
 // Profiling Stats
 #ifdef CPU_PROFILING
 extern uint64_t num_executed_instrs;
@@ -453,17 +579,18 @@ extern void ppc_cpu_init(MemCtrlBase* mem_ctrl, uint32_t cpu_version, bool inclu
 extern void ppc_mmu_init();
 
 void ppc_illegalop(uint32_t opcode);
+void ppc_vec_off(uint32_t opcode);
 void ppc_assert_int();
 void ppc_release_int();
 
 void initialize_ppc_opcode_table();
 
-void ppc_changecrf0(uint32_t set_result);
 void set_host_rounding_mode(uint8_t mode);
 void update_fpscr(uint32_t new_fpscr);
 
 /* Exception handlers. */
 void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits);
+void ppc_deliver_exception(Except_Type exception_type, uint32_t srr1_bits);
 [[noreturn]] void dbg_exception_handler(Except_Type exception_type, uint32_t srr1_bits);
 void ppc_floating_point_exception(uint32_t opcode);
 void ppc_alignment_exception(uint32_t opcode, uint32_t ea);
@@ -677,6 +804,95 @@ template <field_rc rec> extern void power_srq(uint32_t opcode);
 }    // namespace dppc_interpreter
 
 // AltiVec instructions
+namespace dppc_interpreter {
+template <class T> extern void ppc_vaddum(uint32_t opcode);
+template <class T> extern void ppc_vsubum(uint32_t opcode);
+template <class T> extern void ppc_vadds(uint32_t opcode);
+template <class T> extern void ppc_vsubs(uint32_t opcode);
+extern void ppc_vaddcuw(uint32_t opcode);
+extern void ppc_vsubcuw(uint32_t opcode);
+template <class T> extern void ppc_vmax(uint32_t opcode);
+template <class T> extern void ppc_vmin(uint32_t opcode);
+template <class T> extern void ppc_vavg(uint32_t opcode);
+template <class T> extern void ppc_vmule(uint32_t opcode);
+template <class T> extern void ppc_vmulo(uint32_t opcode);
+extern void ppc_vmsumubm(uint32_t opcode);
+extern void ppc_vmsummbm(uint32_t opcode);
+extern void ppc_vmsumuhm(uint32_t opcode);
+extern void ppc_vmsumuhs(uint32_t opcode);
+extern void ppc_vmsumshm(uint32_t opcode);
+extern void ppc_vmsumshs(uint32_t opcode);
+extern void ppc_vmhaddshs(uint32_t opcode);
+extern void ppc_vmhraddshs(uint32_t opcode);
+extern void ppc_vmladduhm(uint32_t opcode);
+extern void ppc_vsum4ubs(uint32_t opcode);
+extern void ppc_vsum4sbs(uint32_t opcode);
+extern void ppc_vsum4shs(uint32_t opcode);
+extern void ppc_vsum2sws(uint32_t opcode);
+extern void ppc_vsumsws(uint32_t opcode);
+
+template <logical_fun logical_op> extern void ppc_vlogical(uint32_t opcode);
+extern void ppc_vsel(uint32_t opcode);
+template <class T> extern void ppc_vrl(uint32_t opcode);
+template <class T> extern void ppc_vshl(uint32_t opcode);
+template <class T> extern void ppc_vshr(uint32_t opcode);
+template <class T> extern void ppc_vsra(uint32_t opcode);
+extern void ppc_vsl(uint32_t opcode);
+extern void ppc_vsr(uint32_t opcode);
+extern void ppc_vslo(uint32_t opcode);
+extern void ppc_vsro(uint32_t opcode);
+
+template <class T, field_rc rec> extern void ppc_vcmpeq(uint32_t opcode);
+template <class T, field_rc rec> extern void ppc_vcmpgt(uint32_t opcode);
+
+extern void ppc_vperm(uint32_t opcode);
+extern void ppc_vsldoi(uint32_t opcode);
+template <class T> extern void ppc_vmrgh(uint32_t opcode);
+template <class T> extern void ppc_vmrgl(uint32_t opcode);
+template <class T> extern void ppc_vsplt(uint32_t opcode);
+template <class T> extern void ppc_vspltis(uint32_t opcode);
+template <class T> extern void ppc_vpkum(uint32_t opcode);
+template <class T, class N> extern void ppc_vpks(uint32_t opcode);
+extern void ppc_vpkpx(uint32_t opcode);
+template <class T> extern void ppc_vupkh(uint32_t opcode);
+template <class T> extern void ppc_vupkl(uint32_t opcode);
+extern void ppc_vupkhpx(uint32_t opcode);
+extern void ppc_vupklpx(uint32_t opcode);
+
+extern void ppc_vaddfp(uint32_t opcode);
+extern void ppc_vsubfp(uint32_t opcode);
+extern void ppc_vmaddfp(uint32_t opcode);
+extern void ppc_vnmsubfp(uint32_t opcode);
+extern void ppc_vmaxfp(uint32_t opcode);
+extern void ppc_vminfp(uint32_t opcode);
+extern void ppc_vrefp(uint32_t opcode);
+extern void ppc_vrsqrtefp(uint32_t opcode);
+extern void ppc_vexptefp(uint32_t opcode);
+extern void ppc_vlogefp(uint32_t opcode);
+extern void ppc_vrfin(uint32_t opcode);
+extern void ppc_vrfiz(uint32_t opcode);
+extern void ppc_vrfip(uint32_t opcode);
+extern void ppc_vrfim(uint32_t opcode);
+extern void ppc_vcfux(uint32_t opcode);
+extern void ppc_vcfsx(uint32_t opcode);
+extern void ppc_vctuxs(uint32_t opcode);
+extern void ppc_vctsxs(uint32_t opcode);
+template <field_rc rec> extern void ppc_vcmpeqfp(uint32_t opcode);
+template <field_rc rec> extern void ppc_vcmpgefp(uint32_t opcode);
+template <field_rc rec> extern void ppc_vcmpgtfp(uint32_t opcode);
+template <field_rc rec> extern void ppc_vcmpbfp(uint32_t opcode);
+
+extern void ppc_mfvscr(uint32_t opcode);
+extern void ppc_mtvscr(uint32_t opcode);
+
+extern void ppc_lvx(uint32_t opcode);
+extern void ppc_stvx(uint32_t opcode);
+template <class T> extern void ppc_lvex(uint32_t opcode);
+template <class T> extern void ppc_stvex(uint32_t opcode);
+extern void ppc_lvsl(uint32_t opcode);
+extern void ppc_lvsr(uint32_t opcode);
+extern void ppc_dst(uint32_t opcode);
+}    // namespace dppc_interpreter
 
 // 64-bit instructions
 
@@ -684,13 +900,27 @@ template <field_rc rec> extern void power_srq(uint32_t opcode);
 
 extern uint64_t get_virt_time_ns(void);
 
-extern void ppc_main_opcode(PPCOpcode* ppc_opcode_grabber, uint32_t opcode);
+extern void ppc_main_opcode(const PPCOpcodeGroup* ppc_opcode_grabber, uint32_t opcode);
+extern PPCOpcode ppc_decode_opcode(uint32_t opcode);
+
+typedef struct PPCFusedPair {
+    PPCOpcode   first;
+    PPCOpcode   second;
+    PPCFusedOp  fused;
+} PPCFusedPair;
+
+/** Fused instruction pairs, entry 0 is unused. */
+extern const PPCFusedPair ppc_fused_pairs[];
+
+/** Return the index of the pair two adjacent instructions form in
+    ppc_fused_pairs, 0 if they aren't fused. */
+extern uint32_t ppc_fuse_pair(PPCOpcode first, PPCOpcode second);
 extern void ppc_exec(void);
 extern void ppc_exec_single(void);
 extern void ppc_exec_until(uint32_t goal_addr);
 extern void ppc_exec_dbg(uint32_t start_addr, uint32_t size);
 
-extern PPCOpcode* ppc_opcode_grabber;
+extern const PPCOpcodeGroup* ppc_opcode_grabber;
 extern void ppc_msr_did_change(uint32_t old_msr_val, uint32_t new_msr_val, bool set_next_instruction_address = true);
 
 /* debugging support API */
@@ -25,18 +25,16 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "ppcemu.h"
 #include "ppcmmu.h"
 
-#include <setjmp.h>
 #include <stdexcept>
 #include <string>
 
-jmp_buf exc_env; /* Global exception environment. */
-
-#if !defined(PPC_TESTS) && !defined(PPC_BENCHMARKS)
-void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
+void ppc_deliver_exception(Except_Type exception_type, uint32_t srr1_bits) {
 #ifdef CPU_PROFILING
     exceptions_processed++;
 #endif
 
+    ppc_sync_flags();
+
     switch (exception_type) {
     case Except_Type::EXC_SYSTEM_RESET:
         ppc_state.spr[SPR::SRR0]     = ppc_state.pc & 0xFFFFFFFC;
@@ -108,6 +106,11 @@ void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
         ppc_next_instruction_address = 0x0D00;
         break;
 
+    case Except_Type::EXC_NO_VEC:
+        ppc_state.spr[SPR::SRR0]     = ppc_state.pc & 0xFFFFFFFC;
+        ppc_next_instruction_address = 0x0F20;
+        break;
+
     default:
         ABORT_F("Unknown exception occurred: %X\n", (unsigned)exception_type);
         break;
@@ -116,6 +119,11 @@ void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
     ppc_state.spr[SPR::SRR1] = (ppc_state.msr & 0x0000FF73) | srr1_bits;
     uint32_t old_msr_val = ppc_state.msr;
     uint32_t new_msr_val = old_msr_val & 0xFFFB1041;
+    /* AltiVec processors save and clear MSR[VEC] as well */
+    if (is_altivec) {
+        ppc_state.spr[SPR::SRR1] |= ppc_state.msr & MSR::VEC;
+        new_msr_val &= ~MSR::VEC;
+    }
     /* copy MSR[ILE] to MSR[LE] */
     if (!is_601) {
         new_msr_val = (new_msr_val & ~MSR::LE) | !!(new_msr_val & MSR::ILE);
@@ -137,10 +145,17 @@ void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
 
     mmu_change_mode();
 
+    // synchronous exceptions abort the current instruction, its handler
+    // returns and the execution loop continues at the exception vector
     if (exception_type != Except_Type::EXC_EXT_INT && exception_type != Except_Type::EXC_DECR) {
-        longjmp(exc_env, 2); /* return to the main execution loop. */
+        exec_flags |= EXEF_FAULT;
     }
 }
+
+#if !defined(PPC_TESTS) && !defined(PPC_BENCHMARKS)
+void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
+    ppc_deliver_exception(exception_type, srr1_bits);
+}
 #endif
 
 [[noreturn]] void dbg_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
@@ -196,6 +211,10 @@ void ppc_exception_handler(Except_Type exception_type, uint32_t srr1_bits) {
     case Except_Type::EXC_TRACE:
         exc_descriptor = "Trace exception occurred";
         break;
+
+    case Except_Type::EXC_NO_VEC:
+        exc_descriptor = "AltiVec unavailable exception occurred";
+        break;
     }
 
     throw std::invalid_argument(exc_descriptor);
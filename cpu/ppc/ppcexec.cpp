@@ -19,38 +19,27 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <core/commandqueue.h>
 #include <core/timermanager.h>
 #include <loguru.hpp>
+#include "ppcblockcache.h"
 #include "ppcemu.h"
+#include "ppcidle.h"
+#include "ppcjit.h"
 #include "ppcmmu.h"
+#include "ppcclock.h"
 #include "ppcdisasm.h"
+#include "ppcpacing.h"
 
 #include <algorithm>
-#include <chrono>
+#include <array>
 #include <cstring>
 #include <iostream>
 #include <map>
-#include <setjmp.h>
 #include <stdexcept>
 #include <stdio.h>
 #include <string>
 
-#ifdef __APPLE__
-#include <mach/mach_time.h>
-#undef EXC_SYSCALL
-static struct mach_timebase_info timebase_info;
-static uint64_t
-ConvertHostTimeToNanos2(uint64_t host_time)
-{
-    if (timebase_info.numer == timebase_info.denom)
-        return host_time;
-    long double answer = host_time;
-    answer *= timebase_info.numer;
-    answer /= timebase_info.denom;
-    return (uint64_t)answer;
-}
-#endif
-
 using namespace std;
 using namespace dppc_interpreter;
 
@@ -58,9 +47,13 @@ MemCtrlBase* mem_ctrl_instance = 0;
 
 bool is_601 = false;
 bool include_601 = false;
+bool is_altivec = false;
 
 bool is_deterministic = false;
 
+EXEC_MODE ppc_exec_mode = EXEC_MODE::interpreter;
+uint32_t  ppc_event_check_interval = PPC_EVENT_CHECK_INTERVAL;
+
 // power_on is written by VIA CUDA, host events, debugger (potentially from different threads)
 // and read by CPU execution loops - std::atomic ensures thread safety
 std::atomic<bool> power_on{false};
@@ -75,8 +68,9 @@ SetPRS ppc_state;
 uint32_t ppc_next_instruction_address;    // Used for branching, setting up the NIA
 
 unsigned exec_flags; // execution control flags
-// exec_timer is set by timer callbacks (via force_cycle_counter_reload) and
-// read by the main CPU execution loop - std::atomic ensures thread safety
+// exec_timer is set by timer callbacks and posted commands (via
+// force_cycle_counter_reload) and read by the CPU execution loops at block boundaries - std::atomic ensures
+// thread safety, a relaxed load is enough as it only requests a check
 std::atomic<bool> exec_timer;
 // int_pin is set by interrupt controllers (potentially from DBDMA/timer callbacks)
 // and read by CPU exception handling - std::atomic ensures thread safety
@@ -85,15 +79,9 @@ std::atomic<bool> int_pin{false};
 // read by CPU execution - std::atomic ensures thread safety  
 std::atomic<bool> dec_exception_pending{false};
 
-/* copy of local variable bb_start_la. Need for correct
-   calculation of CPU cycles after setjmp that clobbers
-   non-volatile local variables. */
-uint32_t    glob_bb_start_la;
-
 /* variables related to virtual time */
-const bool g_realtime = false;
-uint64_t g_nanoseconds_base;
 uint64_t g_icycles;
+uint32_t ppc_cycles_pc;
 int      icnt_factor;
 
 /* global variables related to the timebase facility */
@@ -121,6 +109,15 @@ uint64_t num_int_stores;
 uint64_t exceptions_processed;
 #ifdef CPU_PROFILING_OPS
 std::unordered_map<uint32_t, uint64_t> num_opcodes;
+std::unordered_map<uint64_t, uint64_t> num_op_pairs;
+
+// Count adjacent instructions by operation, regardless of their operands
+static inline void count_op_pair(uint32_t first, uint32_t second) {
+    auto op_only = [](uint32_t opcode) {
+        return opcode & (0xFC000000UL | ppc_opcode_grabber[opcode >> 26].mask);
+    };
+    num_op_pairs[(uint64_t(op_only(first)) << 32) | op_only(second)]++;
+}
 #endif
 
 #include "utils/profiler.h"
@@ -153,6 +150,10 @@ public:
                         .format = ProfileVarFmt::DEC,
                         .value = exceptions_processed});
 
+        vars.push_back({.name = "Virtual Clock Rate (MIPS)",
+                        .format = ProfileVarFmt::DEC,
+                        .value = uint64_t(ppc_clock_mips())});
+
         // Generate top N op counts with readable names.
 #ifdef CPU_PROFILING_OPS
         PPCDisasmContext ctx;
@@ -178,6 +179,33 @@ public:
                             .value = pair.second,
                             .count_total = num_executed_instrs});
         }
+
+        // Generate top N pairs of adjacent operations, candidates for fusing.
+        auto op_mnemonic = [&ctx](uint32_t opcode) {
+            ctx.instr_code = opcode;
+            auto op_name = disassemble_single(&ctx);
+            return op_name.substr(0, op_name.find(' '));
+        };
+        std::vector<std::pair<std::string, uint64_t>> pair_name_counts;
+        for (const auto& pair : num_op_pairs) {
+            pair_name_counts.emplace_back(op_mnemonic(uint32_t(pair.first >> 32)) + "+" +
+                                          op_mnemonic(uint32_t(pair.first)), pair.second);
+        }
+        size_t top_pairs_size = std::min(pair_name_counts.size(), size_t(20));
+        std::partial_sort(
+            pair_name_counts.begin(), pair_name_counts.begin() + top_pairs_size,
+            pair_name_counts.end(),
+            [](const auto& a, const auto& b) {
+                return b.second < a.second;
+            }
+        );
+        pair_name_counts.resize(top_pairs_size);
+        for (const auto& pair : pair_name_counts) {
+            vars.push_back({.name = "Pair " + pair.first,
+                            .format = ProfileVarFmt::COUNT,
+                            .value = pair.second,
+                            .count_total = num_executed_instrs});
+        }
 #endif
     }
 
@@ -189,27 +217,67 @@ public:
         exceptions_processed = 0;
 #ifdef CPU_PROFILING_OPS
         num_opcodes.clear();
+        num_op_pairs.clear();
 #endif
     }
 };
 
 #endif
 
-/** Opcode lookup table, indexed by
-    primary opcode (bits 0...5) and modifier (bits 21...31). */
-static PPCOpcode OpcodeGrabber[64 * 2048];
+/** Opcode handler storage layout.
+    Primary opcodes without modifier bits get one handler each, bc and b
+    get one per AA/LK combination, opcodes 19, 31, 59 and 63 get one per
+    modifier (bits 21...31). AltiVec instructions (opcode 4) get one per
+    modifier as well, they're only reachable while MSR[VEC] is set. */
+constexpr uint32_t OPC_TBL_BRANCH = 64;
+constexpr uint32_t OPC_TBL_EXT    = OPC_TBL_BRANCH + 2 * 4;
+constexpr uint32_t OPC_TBL_SIZE   = OPC_TBL_EXT + 5 * 2048;
+
+static PPCOpcode OpcodeTable[OPC_TBL_SIZE];
 
-/** Alternate lookup table when floating point instructions are disabled.
+/** Alternate handlers when floating point instructions are disabled.
     Floating point instructions are mapped to ppc_fpu_off,
     everything else is the same.*/
-static PPCOpcode OpcodeGrabberNoFPU[64 * 2048];
+static PPCOpcode OpcodeTableNoFPU[OPC_TBL_SIZE];
+
+static constexpr std::array<PPCOpcodeGroup, 64> ppc_make_decoder(PPCOpcode* tbl, bool vec) {
+    std::array<PPCOpcodeGroup, 64> groups{};
+
+    for (uint32_t i = 0; i < 64; i++)
+        groups[i] = {&tbl[i], 0};
+
+    // with MSR[VEC] cleared, all AltiVec instructions share a single handler
+    if (vec)
+        groups[4] = {&tbl[OPC_TBL_EXT + 4 * 2048],  0x7FF};
+
+    groups[16] = {&tbl[OPC_TBL_BRANCH],             3};
+    groups[18] = {&tbl[OPC_TBL_BRANCH + 4],         3};
+    groups[19] = {&tbl[OPC_TBL_EXT],                0x7FF};
+    groups[31] = {&tbl[OPC_TBL_EXT + 1 * 2048],     0x7FF};
+    groups[59] = {&tbl[OPC_TBL_EXT + 2 * 2048],     0x7FF};
+    groups[63] = {&tbl[OPC_TBL_EXT + 3 * 2048],     0x7FF};
+
+    return groups;
+}
+
+/** Opcode lookup tables indexed by primary opcode (bits 0...5).
+    They only depend on the storage layout and are built at compile time. */
+static constexpr std::array<PPCOpcodeGroup, 64> OpcodeGrabber = ppc_make_decoder(OpcodeTable, false);
+static constexpr std::array<PPCOpcodeGroup, 64> OpcodeGrabberNoFPU = ppc_make_decoder(OpcodeTableNoFPU, false);
+static constexpr std::array<PPCOpcodeGroup, 64> OpcodeGrabberVec = ppc_make_decoder(OpcodeTable, true);
+static constexpr std::array<PPCOpcodeGroup, 64> OpcodeGrabberNoFPUVec = ppc_make_decoder(OpcodeTableNoFPU, true);
+
+static const PPCOpcodeGroup* ppc_select_decoder(uint32_t msr_val) {
+    if (msr_val & MSR::VEC)
+        return (msr_val & MSR::FP) ? OpcodeGrabberVec.data() : OpcodeGrabberNoFPUVec.data();
+    return (msr_val & MSR::FP) ? OpcodeGrabber.data() : OpcodeGrabberNoFPU.data();
+}
 
 void ppc_msr_did_change(uint32_t old_msr_val, uint32_t new_msr_val, bool set_next_instruction_address) {
     ppc_state.msr = new_msr_val;
-    if ((old_msr_val ^ new_msr_val) & MSR::FP) {
-        bool newFP = (new_msr_val & MSR::FP) != 0;
-        ppc_opcode_grabber = newFP ? OpcodeGrabber : OpcodeGrabberNoFPU;
-        //LOG_F(INFO, "changed FP to %s", newFP ? "yes" : "no");
+    if ((old_msr_val ^ new_msr_val) & (MSR::FP | MSR::VEC)) {
+        ppc_opcode_grabber = ppc_select_decoder(new_msr_val);
+        //LOG_F(INFO, "changed FP to %s", (new_msr_val & MSR::FP) ? "yes" : "no");
 #if 1
         exec_flags |= EXEF_OPC_DECODER;
         if (set_next_instruction_address) {
@@ -224,7 +292,7 @@ void ppc_msr_did_change(uint32_t old_msr_val, uint32_t new_msr_val, bool set_nex
     }
 }
 
-PPCOpcode* ppc_opcode_grabber = OpcodeGrabberNoFPU;
+const PPCOpcodeGroup* ppc_opcode_grabber = OpcodeGrabberNoFPU.data();
 
 /** Exception helpers. */
 
@@ -236,6 +304,10 @@ void ppc_fpu_off(uint32_t opcode) {
     ppc_exception_handler(Except_Type::EXC_NO_FPU, Exc_Cause::FPU_OFF);
 }
 
+void ppc_vec_off(uint32_t opcode) {
+    ppc_exception_handler(Except_Type::EXC_NO_VEC, 0);
+}
+
 void ppc_assert_int() {
     int_pin = true;
     if (ppc_state.msr & MSR::EE) {
@@ -253,7 +325,7 @@ void ppc_release_int() {
 /** Opcode decoding functions. */
 
 /* Dispatch using primary and modifier opcode */
-void ppc_main_opcode(PPCOpcode *opcodeGrabber, uint32_t opcode)
+void ppc_main_opcode(const PPCOpcodeGroup* opcodeGrabber, uint32_t opcode)
 {
 #ifdef CPU_PROFILING
     num_executed_instrs++;
@@ -261,43 +333,66 @@ void ppc_main_opcode(PPCOpcode *opcodeGrabber, uint32_t opcode)
     num_opcodes[opcode]++;
 #endif
 #endif
-    opcodeGrabber[(opcode >> 15 & 0x1F800) | (opcode & 0x7FF)](opcode);
+    const PPCOpcodeGroup& group = opcodeGrabber[opcode >> 26];
+    group.table[opcode & group.mask](opcode);
 }
 
-static long long cpu_now_ns() {
-#ifdef __APPLE__
-    return ConvertHostTimeToNanos2(mach_absolute_time());
-#else
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::high_resolution_clock::now().time_since_epoch()).count();
-#endif
-}
-
-uint64_t get_virt_time_ns()
+/* Return the handler for an opcode using the currently active table */
+PPCOpcode ppc_decode_opcode(uint32_t opcode)
 {
-    if (g_realtime) {
-        return cpu_now_ns() - g_nanoseconds_base;
-    } else {
-        return g_icycles << icnt_factor;
-    }
+    const PPCOpcodeGroup& group = ppc_opcode_grabber[opcode >> 26];
+    return group.table[opcode & group.mask];
 }
 
 static uint64_t process_events()
 {
-    exec_timer = false;
+    exec_timer.store(false, std::memory_order_relaxed);
+    ppc_clock_update();
+    if (ppc_realtime && ppc_pacing_sync(get_virt_time_ns(), exec_timer))
+        ppc_clock_resync();
+    CommandQueue::get_instance()->process_commands();
     uint64_t slice_ns = TimerManager::get_instance()->process_timers();
     if (slice_ns == 0) {
         // execute 25.000 cycles
         // if there are no pending timers
         return g_icycles + 25000;
     }
-    return g_icycles + (slice_ns >> icnt_factor) + 1;
+    return g_icycles + ppc_clock_ns_to_cycles(slice_ns) + 1;
+}
+
+/** Halt the CPU in a power saving mode until an interrupt wakes it up.
+    Nothing can happen before the next timer event, so time jumps straight
+    to it. Returns the new cycle limit for the execution loop. */
+static uint64_t ppc_power_save()
+{
+    uint64_t max_cycles;
+
+    exec_flags &= ~EXEF_POW;
+
+    while (true) {
+        max_cycles = process_events();
+        if (!(ppc_state.msr & MSR::POW) || !power_on)
+            break;
+        ppc_clock_skipped += max_cycles - g_icycles;
+        g_icycles = max_cycles;
+    }
+
+    return max_cycles;
 }
 
 static void force_cycle_counter_reload()
 {
     // tell the interpreter loop to reload cycle counter
-    exec_timer = true;
+    exec_timer.store(true, std::memory_order_relaxed);
+}
+
+/** Return the number of instructions the execution loops may run before
+    checking for events again, at most limit. Execution stops right after
+    the instruction the next timer is due at. */
+static inline uint32_t ppc_event_budget(uint64_t max_cycles, uint32_t limit)
+{
+    uint64_t due = g_icycles <= max_cycles ? max_cycles - g_icycles + 1 : 1;
+    return uint32_t(std::min<uint64_t>(due, std::min(limit, ppc_event_check_interval)));
 }
 
 typedef enum {
@@ -311,45 +406,82 @@ template <ppc_exec_type_t exec_type>
 static void ppc_exec_inner(uint32_t start_addr, uint32_t size)
 {
     uint64_t max_cycles = 0;
-    uint32_t page_start, eb_start, eb_end = 0;
+    uint32_t page_start = 1; // never page aligned, forces a translation
+    uint32_t blk_start, num_insns;
     uint32_t opcode;
-    PPCOpcode* opcode_grabber = ppc_opcode_grabber;
-    uint8_t* pc_real;
+    const PPCOpcodeGroup* opcode_grabber = ppc_opcode_grabber;
+    uint8_t* pc_real = nullptr;
+    uint8_t* pc_last;
 
     while (power_on) {
         if (exec_type == debug)
             if (ppc_state.pc >= start_addr && ppc_state.pc < start_addr + size)
                 break;
 
-        if (ppc_state.pc >= eb_end) {
-            // define boundaries of the next execution block
-            // max execution block length = one memory page
-            eb_start   = ppc_state.pc;
-            page_start = eb_start & PPC_PAGE_MASK;
-            eb_end     = page_start + PPC_PAGE_SIZE - 1;
+        if ((ppc_state.pc & PPC_PAGE_MASK) != page_start) {
+            page_start = ppc_state.pc & PPC_PAGE_MASK;
             exec_flags = 0;
-            pc_real    = mmu_translate_imem(eb_start);
+            pc_real    = mmu_translate_imem(ppc_state.pc);
+            if (!pc_real) {
+                // instruction fetch raised an ISI, continue at its vector
+                ppc_state.pc = ppc_next_instruction_address;
+                exec_flags   = 0;
+                page_start   = 1;
+                continue;
+            }
+        }
+
+        // define boundaries of the next execution block
+        // max execution block length = rest of the memory page
+        blk_start     = ppc_state.pc;
+        ppc_cycles_pc = blk_start;
+        num_insns = ppc_event_budget(max_cycles,
+                                     (PPC_PAGE_SIZE - (blk_start & ~PPC_PAGE_MASK)) >> 2);
+        if (exec_type == until) {
+            uint32_t goal_idx = (start_addr - blk_start) >> 2;
+            if (goal_idx && goal_idx < num_insns && !(start_addr & 3))
+                num_insns = goal_idx;
+        } else if (exec_type == debug) {
+            // the address range is checked before every instruction
+            num_insns = 1;
+        }
+        pc_last = pc_real + (num_insns - 1) * 4;
+
+        while (true) {
+            opcode = ppc_read_instruction(pc_real);
+            ppc_main_opcode(opcode_grabber, opcode);
+            if (exec_flags || pc_real == pc_last)
+                break;
+            ppc_state.pc += 4;
+            pc_real += 4;
         }
 
-        opcode = ppc_read_instruction(pc_real);
-        ppc_main_opcode(opcode_grabber, opcode);
-        if (g_icycles++ >= max_cycles || exec_timer) [[unlikely]]
+        // ppc_state.pc still points to the last executed instruction
+        g_icycles += ((ppc_state.pc - blk_start) >> 2) + 1;
+        ppc_cycles_pc = ppc_state.pc;
+        if (g_icycles > max_cycles || exec_timer.load(std::memory_order_relaxed)) [[unlikely]]
             max_cycles = process_events();
 
         if (exec_flags) {
+            if (exec_flags & EXEF_POW) [[unlikely]] {
+                max_cycles     = ppc_power_save();
+                opcode_grabber = ppc_opcode_grabber;
+            }
             if (exec_flags & EXEF_OPC_DECODER) [[unlikely]] {
                 opcode_grabber = ppc_opcode_grabber;
             }
-            // define next execution block
-            eb_start = ppc_next_instruction_address;
-            if (!(exec_flags & EXEF_RFI) && (eb_start & PPC_PAGE_MASK) == page_start) {
-                pc_real += (int)eb_start - (int)ppc_state.pc;
-            } else {
-                page_start = eb_start & PPC_PAGE_MASK;
-                eb_end = page_start + PPC_PAGE_SIZE - 1;
-                pc_real = mmu_translate_imem(eb_start);
+            uint32_t next_pc = ppc_next_instruction_address;
+            if (exec_flags & (EXEF_RFI | EXEF_EXCEPTION)) {
+                // the MSR may have changed the instruction address mapping
+                page_start = 1;
+            } else if ((next_pc & PPC_PAGE_MASK) == page_start) {
+                pc_real += (int)next_pc - (int)ppc_state.pc;
+                // fast forward through idle loops at their back-edge
+                if (exec_flags == EXEF_BRANCH && next_pc <= ppc_state.pc &&
+                    ppc_state.pc - next_pc < PPC_IDLE_MAX_INSNS * 4)
+                    g_icycles += ppc_idle_skip(next_pc, ppc_state.pc, pc_real, max_cycles);
             }
-            ppc_state.pc = eb_start;
+            ppc_state.pc = next_pc;
             exec_flags = 0;
         } else { [[likely]]
             ppc_state.pc += 4;
@@ -362,6 +494,172 @@ static void ppc_exec_inner(uint32_t start_addr, uint32_t size)
     }
 }
 
+// inner loop of the threaded interpreter, optionally running translated blocks
+template <ppc_exec_type_t exec_type, bool use_jit>
+static void ppc_exec_threaded_inner(uint32_t goal_addr)
+{
+    uint64_t max_cycles = 0;
+    uint32_t page_la, page_pa, blk_gen, branch_pc = 0;
+    uint32_t pc; // kept in sync with ppc_state.pc, saves reloading it
+    uint8_t* page_host_va;
+    PPCDecodedBlock* blk = nullptr;
+    int kind; // link slot of the successor, see ppc_block_next()
+    const uint32_t check_interval = ppc_event_check_interval;
+
+    exec_flags = 0;
+
+    while (power_on) {
+        if (!blk) {
+            pc           = ppc_state.pc;
+            page_la      = pc & PPC_PAGE_MASK;
+            page_host_va = mmu_translate_imem(page_la, &page_pa);
+            if (!page_host_va) {
+                // instruction fetch raised an ISI, continue at its vector
+                ppc_state.pc = ppc_next_instruction_address;
+                exec_flags   = 0;
+                continue;
+            }
+            uint32_t offset = pc & ~PPC_PAGE_MASK;
+            blk_gen = ppc_block_generation;
+            blk     = ppc_block_lookup(page_pa | offset, page_host_va + offset);
+        }
+
+        ppc_cycles_pc = pc;
+
+        const PPCDecodedInsn* insn = blk->insns;
+        uint32_t num_insns = blk->num_insns;
+        if (g_icycles + num_insns > max_cycles || num_insns > check_interval) [[unlikely]]
+            num_insns = ppc_event_budget(max_cycles, num_insns);
+
+        // stop right at the goal address instead of checking it after every instruction
+        if (exec_type == until) {
+            uint32_t goal_idx = (goal_addr - pc) >> 2;
+            if (goal_idx && goal_idx < num_insns && !(goal_addr & 3))
+                num_insns = goal_idx;
+        }
+        const PPCDecodedInsn* last = insn + num_insns - 1;
+
+        if (use_jit) {
+            if (!blk->jit_code && ++blk->exec_count == PPC_JIT_THRESHOLD)
+                ppc_jit_enqueue(blk);
+
+            // translated code doesn't check for timers between instructions,
+            // only enter it when none can expire inside the block
+            if (blk->jit_code && num_insns == blk->num_insns &&
+                g_icycles + blk->num_insns < max_cycles) {
+                // it may continue into linked blocks unless events have to be
+                // checked more often than at the end of every block
+                PPCJitState jit_state = {
+                    blk, check_interval < PPC_BLOCK_MAX_INSNS ? 0 : max_cycles, blk_gen, pc,
+                    exec_type == until ? goal_addr : 0xFFFFFFFFU};
+#ifdef CPU_PROFILING
+                uint64_t start_cycles = g_icycles;
+#endif
+                uint32_t num_done = blk->jit_code(&jit_state);
+#ifdef CPU_PROFILING
+                num_executed_instrs += g_icycles - start_cycles;
+#endif
+                blk     = jit_state.blk;
+                blk_gen = jit_state.blk_gen;
+                pc      = jit_state.pc + (num_done - 1) * 4;
+                ppc_state.pc  = pc;
+                ppc_cycles_pc = pc;
+                if (exec_timer.load(std::memory_order_relaxed)) [[unlikely]] {
+                    max_cycles = process_events();
+                    ppc_jit_compile_pending();
+                }
+                if (exec_flags & EXEF_POW) [[unlikely]]
+                    max_cycles = ppc_power_save();
+                branch_pc = pc;
+                if (exec_flags)
+                    pc = ppc_next_instruction_address;
+                else
+                    pc += 4;
+                ppc_state.pc = pc;
+                kind = exec_flags ? (num_done == blk->num_insns ? 1 : 2) : 0;
+                goto block_done;
+            }
+        }
+
+        while (true) {
+#ifdef CPU_PROFILING
+            num_executed_instrs++;
+#if defined(CPU_PROFILING_OPS)
+            num_opcodes[insn->opcode]++;
+            if (insn != blk->insns)
+                count_op_pair(insn[-1].opcode, insn->opcode);
+#endif
+#endif
+            if (insn->fused && insn != last) {
+#ifdef CPU_PROFILING
+                num_executed_instrs++;
+#if defined(CPU_PROFILING_OPS)
+                num_opcodes[insn[1].opcode]++;
+                count_op_pair(insn[0].opcode, insn[1].opcode);
+#endif
+#endif
+                ppc_fused_pairs[insn->fused].fused(insn[0].opcode, insn[1].opcode);
+                // the second instruction didn't run if the first one set exec_flags
+                insn += (ppc_state.pc - pc) >> 2;
+                pc    = ppc_state.pc;
+            } else {
+                insn->handler(insn->opcode);
+            }
+            if (exec_flags || insn == last)
+                break;
+            pc += 4;
+            ppc_state.pc = pc;
+            insn++;
+        }
+
+        // ppc_state.pc still points to the last executed instruction
+        g_icycles += insn - blk->insns + 1;
+        ppc_cycles_pc = pc;
+        if (g_icycles > max_cycles || exec_timer.load(std::memory_order_relaxed)) [[unlikely]] {
+            max_cycles = process_events();
+            if (use_jit)
+                ppc_jit_compile_pending();
+        }
+
+        if (exec_flags) {
+            if (exec_flags & EXEF_POW) [[unlikely]]
+                max_cycles = ppc_power_save();
+            branch_pc = pc;
+            pc        = ppc_next_instruction_address;
+            kind      = insn == last ? 1 : 2;
+        } else {
+            pc  += 4;
+            kind = 0;
+        }
+        ppc_state.pc = pc;
+
+block_done:
+        if (exec_type == until)
+            if (pc == goal_addr)
+                break;
+
+        // plain branches within the same page don't need a new translation
+        // and can be linked directly to their target block
+        uint32_t offset = pc - page_la;
+        if ((exec_flags & ~EXEF_BRANCH) || offset >= PPC_PAGE_SIZE) {
+            exec_flags = 0;
+            blk        = nullptr;
+        } else {
+            // fast forward through idle loops at their back-edge
+            if (kind && branch_pc - pc < PPC_IDLE_MAX_INSNS * 4) {
+                if (blk->idle_wait)
+                    blk->idle_wait--;
+                else
+                    g_icycles += ppc_idle_skip_block(blk, pc, branch_pc,
+                                                     page_host_va + offset, max_cycles);
+            }
+            exec_flags = 0;
+            blk        = ppc_block_next(blk, blk_gen, kind, offset, page_pa, page_host_va);
+            blk_gen    = ppc_block_generation;
+        }
+    }
+}
+
 /** Execute PPC code as long as power is on. */
 
 // inner interpreter loop
@@ -370,40 +668,47 @@ template void ppc_exec_inner<main>(uint32_t start_addr, uint32_t size);
 // outer interpreter loop
 void ppc_exec()
 {
-    if (setjmp(exc_env)) {
-        // process low-level exceptions
-        //LOG_F(9, "PPC-EXEC: low_level exception raised!");
-        ppc_state.pc = ppc_next_instruction_address;
-    }
-
     while (power_on) {
-        ppc_exec_inner<main>(0, 0);
+        if (ppc_exec_mode == EXEC_MODE::jit)
+            ppc_exec_threaded_inner<main, true>(0);
+        else if (ppc_exec_mode == EXEC_MODE::threaded_int)
+            ppc_exec_threaded_inner<main, false>(0);
+        else
+            ppc_exec_inner<main>(0, 0);
     }
+
+    ppc_sync_flags();
 }
 
 /** Execute one PPC instruction. */
 void ppc_exec_single()
 {
-    if (setjmp(exc_env)) {
-        // process low-level exceptions
-        //LOG_F(9, "PPC-EXEC: low_level exception raised!");
+    uint8_t* pc_real = mmu_translate_imem(ppc_state.pc);
+    if (!pc_real) {
+        // instruction fetch raised an ISI, next step starts at its vector
         ppc_state.pc = ppc_next_instruction_address;
         exec_flags = 0;
+        ppc_sync_flags();
         return;
     }
 
-    uint8_t* pc_real = mmu_translate_imem(ppc_state.pc);
     uint32_t opcode = ppc_read_instruction(pc_real);
+    ppc_cycles_pc = ppc_state.pc;
     ppc_main_opcode(ppc_opcode_grabber, opcode);
     g_icycles++;
+    ppc_cycles_pc = ppc_state.pc;
     process_events();
 
     if (exec_flags) {
+        if (exec_flags & EXEF_POW)
+            ppc_power_save();
         ppc_state.pc = ppc_next_instruction_address;
         exec_flags = 0;
     } else {
         ppc_state.pc += 4;
     }
+
+    ppc_sync_flags();
 }
 
 /** Execute PPC code until goal_addr is reached. */
@@ -412,18 +717,19 @@ void ppc_exec_single()
 template void ppc_exec_inner<until>(uint32_t start_addr, uint32_t size);
 
 // outer interpreter loop
-void ppc_exec_until(volatile uint32_t goal_addr) {
-    if (setjmp(exc_env)) {
-        // process low-level exceptions
-        // LOG_F(9, "PPC-EXEC: low_level exception raised!");
-        ppc_state.pc = ppc_next_instruction_address;
-    }
-
+void ppc_exec_until(uint32_t goal_addr) {
     while (power_on) {
-        ppc_exec_inner<until>(goal_addr, 0);
+        if (ppc_exec_mode == EXEC_MODE::jit)
+            ppc_exec_threaded_inner<until, true>(goal_addr);
+        else if (ppc_exec_mode == EXEC_MODE::threaded_int)
+            ppc_exec_threaded_inner<until, false>(goal_addr);
+        else
+            ppc_exec_inner<until>(goal_addr, 0);
         if (ppc_state.pc == goal_addr)
             break;
     }
+
+    ppc_sync_flags();
 }
 
 /** Execute PPC code until control is reached the specified region. */
@@ -432,17 +738,13 @@ void ppc_exec_until(volatile uint32_t goal_addr) {
 template void ppc_exec_inner<debug>(uint32_t start_addr, uint32_t size);
 
 // outer interpreter loop
-void ppc_exec_dbg(volatile uint32_t start_addr, volatile uint32_t size)
+void ppc_exec_dbg(uint32_t start_addr, uint32_t size)
 {
-    if (setjmp(exc_env)) {
-        // process low-level exceptions
-        //LOG_F(9, "PPC-EXEC: low_level exception raised!");
-        ppc_state.pc = ppc_next_instruction_address;
-    }
-
     while (power_on && (ppc_state.pc < start_addr || ppc_state.pc >= start_addr + size)) {
         ppc_exec_inner<debug>(start_addr, size);
     }
+
+    ppc_sync_flags();
 }
 
 /*
@@ -458,28 +760,18 @@ Opcode table macros:
 
 #define OPr(opcode, mod, fn) \
 do { \
-    OpcodeGrabber[((opcode) << 11) | (mod)] = fn; \
+    OpcodeGrabber[opcode].table[(mod) & OpcodeGrabber[opcode].mask] = fn; \
 } while (0)
 
 #define OPr_fp(opcode, mod, fn) \
 do { \
     OPr(opcode, mod, fn); \
-    OpcodeGrabberNoFPU[((opcode) << 11) | (mod)] = ppc_fpu_off; \
+    OpcodeGrabberNoFPU[opcode].table[(mod) & OpcodeGrabberNoFPU[opcode].mask] = ppc_fpu_off; \
 } while (0)
 
-#define OP(opcode, fn) \
-do { \
-    for (uint32_t mod = 0; mod < 2048; mod++) { \
-        OPr(opcode, mod, fn); \
-    } \
-} while (0)
+#define OP(opcode, fn) OPr(opcode, 0, fn)
 
-#define OP_fp(opcode, fn) \
-do { \
-    for (uint32_t mod = 0; mod < 2048; mod++) { \
-        OPr_fp(opcode, mod, fn); \
-    } \
-} while (0)
+#define OP_fp(opcode, fn) OPr_fp(opcode, 0, fn)
 
 #define OPX(opcode, subopcode, fn) OPr(opcode, (subopcode)<<1, fn)
 
@@ -525,12 +817,7 @@ do { \
     OPr(opcode, ((subopcode)<<1) | 0x401, (fn<carry, RC1, OV1>)); \
 } while (0)
 
-#define OPla(opcode, subopcode, fn) \
-do { \
-    for (uint32_t mod = 0; mod < 512; mod++) { \
-        OPr(opcode, (mod << 2) | (subopcode), fn); \
-    } \
-} while (0)
+#define OPla(opcode, subopcode, fn) OPr(opcode, subopcode, fn)
 
 #define OP31(subopcode, fn) OPX(31, subopcode, fn)
 #define OP31_fp(subopcode, fn) OPX_fp(31, subopcode, fn)
@@ -552,13 +839,39 @@ do { \
     } \
 } while (0)
 
+// AltiVec instructions are only present in the decoder used while MSR[VEC] is set.
+#define OP4r(mod, fn) \
+do { \
+    OpcodeGrabberVec[4].table[(mod) & OpcodeGrabberVec[4].mask] = fn; \
+} while (0)
+
+#define OP4(subopcode, fn) OP4r(subopcode, fn)
+
+#define OP4dc(subopcode, fn, type) \
+do { \
+    OP4r((subopcode), (fn<type, RC0>)); \
+    OP4r((subopcode) | 0x400, (fn<type, RC1>)); \
+} while (0)
+
+#define OP4d(subopcode, fn) \
+do { \
+    OP4r((subopcode), fn<RC0>); \
+    OP4r((subopcode) | 0x400, fn<RC1>); \
+} while (0)
+
+#define OP4a(subopcode, fn) \
+do { \
+    for (uint32_t ccccc = 0; ccccc < 32; ccccc++) { \
+        OP4r((ccccc << 6) | (subopcode), fn); \
+    } \
+} while (0)
+
 void initialize_ppc_opcode_table() {
-    auto opcodeGrabberSize = sizeof(OpcodeGrabber) / sizeof(OpcodeGrabber[0]);
-    std::fill_n(OpcodeGrabber, opcodeGrabberSize, ppc_illegalop);
-    std::fill_n(OpcodeGrabberNoFPU, opcodeGrabberSize, ppc_illegalop);
+    std::fill_n(OpcodeTable, OPC_TBL_SIZE, ppc_illegalop);
+    std::fill_n(OpcodeTableNoFPU, OPC_TBL_SIZE, ppc_illegalop);
 
     OP(3,  ppc_twi);
-    //OP(4,  ppc_opcode4); - Altivec instructions not emulated yet. Uncomment once they're implemented.
+    if (is_altivec) OP(4, ppc_vec_off);
     OP(7,  ppc_mulli);
     OP(8,  ppc_subfic);
     if (is_601 || include_601) OP(9, power_dozi);
@@ -807,9 +1120,180 @@ void initialize_ppc_opcode_table() {
         OP63d(i + 31, ppc_fnmadd);
     }
 
-    for (auto i = 0; i < opcodeGrabberSize; i++) {
-        if (OpcodeGrabberNoFPU[i] != ppc_fpu_off) {
-            OpcodeGrabberNoFPU[i] = OpcodeGrabber[i];
+    if (is_altivec) {
+        OP4(0,      ppc_vaddum<uint8_t>);
+        OP4(64,     ppc_vaddum<uint16_t>);
+        OP4(128,    ppc_vaddum<uint32_t>);
+        OP4(384,    ppc_vaddcuw);
+        OP4(512,    ppc_vadds<uint8_t>);
+        OP4(576,    ppc_vadds<uint16_t>);
+        OP4(640,    ppc_vadds<uint32_t>);
+        OP4(768,    ppc_vadds<int8_t>);
+        OP4(832,    ppc_vadds<int16_t>);
+        OP4(896,    ppc_vadds<int32_t>);
+        OP4(1024,   ppc_vsubum<uint8_t>);
+        OP4(1088,   ppc_vsubum<uint16_t>);
+        OP4(1152,   ppc_vsubum<uint32_t>);
+        OP4(1408,   ppc_vsubcuw);
+        OP4(1536,   ppc_vsubs<uint8_t>);
+        OP4(1600,   ppc_vsubs<uint16_t>);
+        OP4(1664,   ppc_vsubs<uint32_t>);
+        OP4(1792,   ppc_vsubs<int8_t>);
+        OP4(1856,   ppc_vsubs<int16_t>);
+        OP4(1920,   ppc_vsubs<int32_t>);
+
+        OP4(2,      ppc_vmax<uint8_t>);
+        OP4(66,     ppc_vmax<uint16_t>);
+        OP4(130,    ppc_vmax<uint32_t>);
+        OP4(258,    ppc_vmax<int8_t>);
+        OP4(322,    ppc_vmax<int16_t>);
+        OP4(386,    ppc_vmax<int32_t>);
+        OP4(514,    ppc_vmin<uint8_t>);
+        OP4(578,    ppc_vmin<uint16_t>);
+        OP4(642,    ppc_vmin<uint32_t>);
+        OP4(770,    ppc_vmin<int8_t>);
+        OP4(834,    ppc_vmin<int16_t>);
+        OP4(898,    ppc_vmin<int32_t>);
+        OP4(1026,   ppc_vavg<uint8_t>);
+        OP4(1090,   ppc_vavg<uint16_t>);
+        OP4(1154,   ppc_vavg<uint32_t>);
+        OP4(1282,   ppc_vavg<int8_t>);
+        OP4(1346,   ppc_vavg<int16_t>);
+        OP4(1410,   ppc_vavg<int32_t>);
+
+        OP4(4,      ppc_vrl<uint8_t>);
+        OP4(68,     ppc_vrl<uint16_t>);
+        OP4(132,    ppc_vrl<uint32_t>);
+        OP4(260,    ppc_vshl<uint8_t>);
+        OP4(324,    ppc_vshl<uint16_t>);
+        OP4(388,    ppc_vshl<uint32_t>);
+        OP4(452,    ppc_vsl);
+        OP4(516,    ppc_vshr<uint8_t>);
+        OP4(580,    ppc_vshr<uint16_t>);
+        OP4(644,    ppc_vshr<uint32_t>);
+        OP4(708,    ppc_vsr);
+        OP4(772,    ppc_vsra<uint8_t>);
+        OP4(836,    ppc_vsra<uint16_t>);
+        OP4(900,    ppc_vsra<uint32_t>);
+        OP4(1028,   ppc_vlogical<ppc_and>);
+        OP4(1092,   ppc_vlogical<ppc_andc>);
+        OP4(1156,   ppc_vlogical<ppc_or>);
+        OP4(1220,   ppc_vlogical<ppc_xor>);
+        OP4(1284,   ppc_vlogical<ppc_nor>);
+        OP4(1540,   ppc_mfvscr);
+        OP4(1604,   ppc_mtvscr);
+
+        OP4dc(6,    ppc_vcmpeq, uint8_t);
+        OP4dc(70,   ppc_vcmpeq, uint16_t);
+        OP4dc(134,  ppc_vcmpeq, uint32_t);
+        OP4d(198,   ppc_vcmpeqfp);
+        OP4d(454,   ppc_vcmpgefp);
+        OP4dc(518,  ppc_vcmpgt, uint8_t);
+        OP4dc(582,  ppc_vcmpgt, uint16_t);
+        OP4dc(646,  ppc_vcmpgt, uint32_t);
+        OP4d(710,   ppc_vcmpgtfp);
+        OP4dc(774,  ppc_vcmpgt, int8_t);
+        OP4dc(838,  ppc_vcmpgt, int16_t);
+        OP4dc(902,  ppc_vcmpgt, int32_t);
+        OP4d(966,   ppc_vcmpbfp);
+
+        OP4(8,      ppc_vmulo<uint8_t>);
+        OP4(72,     ppc_vmulo<uint16_t>);
+        OP4(264,    ppc_vmulo<int8_t>);
+        OP4(328,    ppc_vmulo<int16_t>);
+        OP4(520,    ppc_vmule<uint8_t>);
+        OP4(584,    ppc_vmule<uint16_t>);
+        OP4(776,    ppc_vmule<int8_t>);
+        OP4(840,    ppc_vmule<int16_t>);
+        OP4(1544,   ppc_vsum4ubs);
+        OP4(1608,   ppc_vsum4shs);
+        OP4(1672,   ppc_vsum2sws);
+        OP4(1800,   ppc_vsum4sbs);
+        OP4(1928,   ppc_vsumsws);
+
+        OP4(10,     ppc_vaddfp);
+        OP4(74,     ppc_vsubfp);
+        OP4(266,    ppc_vrefp);
+        OP4(330,    ppc_vrsqrtefp);
+        OP4(394,    ppc_vexptefp);
+        OP4(458,    ppc_vlogefp);
+        OP4(522,    ppc_vrfin);
+        OP4(586,    ppc_vrfiz);
+        OP4(650,    ppc_vrfip);
+        OP4(714,    ppc_vrfim);
+        OP4(778,    ppc_vcfux);
+        OP4(842,    ppc_vcfsx);
+        OP4(906,    ppc_vctuxs);
+        OP4(970,    ppc_vctsxs);
+        OP4(1034,   ppc_vmaxfp);
+        OP4(1098,   ppc_vminfp);
+
+        OP4(12,     ppc_vmrgh<uint8_t>);
+        OP4(76,     ppc_vmrgh<uint16_t>);
+        OP4(140,    ppc_vmrgh<uint32_t>);
+        OP4(268,    ppc_vmrgl<uint8_t>);
+        OP4(332,    ppc_vmrgl<uint16_t>);
+        OP4(396,    ppc_vmrgl<uint32_t>);
+        OP4(524,    ppc_vsplt<uint8_t>);
+        OP4(588,    ppc_vsplt<uint16_t>);
+        OP4(652,    ppc_vsplt<uint32_t>);
+        OP4(780,    ppc_vspltis<int8_t>);
+        OP4(844,    ppc_vspltis<int16_t>);
+        OP4(908,    ppc_vspltis<int32_t>);
+        OP4(1036,   ppc_vslo);
+        OP4(1100,   ppc_vsro);
+
+        OP4(14,     ppc_vpkum<uint16_t>);
+        OP4(78,     ppc_vpkum<uint32_t>);
+        OP4(142,    (ppc_vpks<uint16_t, uint8_t>));
+        OP4(206,    (ppc_vpks<uint32_t, uint16_t>));
+        OP4(270,    (ppc_vpks<int16_t, uint8_t>));
+        OP4(334,    (ppc_vpks<int32_t, uint16_t>));
+        OP4(398,    (ppc_vpks<int16_t, int8_t>));
+        OP4(462,    (ppc_vpks<int32_t, int16_t>));
+        OP4(526,    ppc_vupkh<int8_t>);
+        OP4(590,    ppc_vupkh<int16_t>);
+        OP4(654,    ppc_vupkl<int8_t>);
+        OP4(718,    ppc_vupkl<int16_t>);
+        OP4(782,    ppc_vpkpx);
+        OP4(846,    ppc_vupkhpx);
+        OP4(974,    ppc_vupklpx);
+
+        OP4a(32,    ppc_vmhaddshs);
+        OP4a(33,    ppc_vmhraddshs);
+        OP4a(34,    ppc_vmladduhm);
+        OP4a(36,    ppc_vmsumubm);
+        OP4a(37,    ppc_vmsummbm);
+        OP4a(38,    ppc_vmsumuhm);
+        OP4a(39,    ppc_vmsumuhs);
+        OP4a(40,    ppc_vmsumshm);
+        OP4a(41,    ppc_vmsumshs);
+        OP4a(42,    ppc_vsel);
+        OP4a(43,    ppc_vperm);
+        OP4a(44,    ppc_vsldoi);
+        OP4a(46,    ppc_vmaddfp);
+        OP4a(47,    ppc_vnmsubfp);
+
+        OP31(6,     ppc_lvsl);
+        OP31(7,     ppc_lvex<uint8_t>);
+        OP31(38,    ppc_lvsr);
+        OP31(39,    ppc_lvex<uint16_t>);
+        OP31(71,    ppc_lvex<uint32_t>);
+        OP31(103,   ppc_lvx);
+        OP31(135,   ppc_stvex<uint8_t>);
+        OP31(167,   ppc_stvex<uint16_t>);
+        OP31(199,   ppc_stvex<uint32_t>);
+        OP31(231,   ppc_stvx);
+        OP31(342,   ppc_dst);   // dst
+        OP31(359,   ppc_lvx);   // lvxl
+        OP31(374,   ppc_dst);   // dstst
+        OP31(487,   ppc_stvx);  // stvxl
+        OP31(822,   ppc_dst);   // dss
+    }
+
+    for (uint32_t i = 0; i < OPC_TBL_SIZE; i++) {
+        if (OpcodeTableNoFPU[i] != ppc_fpu_off) {
+            OpcodeTableNoFPU[i] = OpcodeTable[i];
         }
     }
 }
@@ -824,18 +1308,18 @@ void ppc_cpu_init(MemCtrlBase* mem_ctrl, uint32_t cpu_version, bool do_include_6
     ppc_state.spr[SPR::PVR] = cpu_version;
     is_601 = (cpu_version >> 16) == 1;
     include_601 = !is_601 & do_include_601;
+    is_altivec = (cpu_version >> 16) == (PPC_VER::MPC7400 >> 16) ||
+                 cpu_version == PPC_VER::MPC970MP;
 
     initialize_ppc_opcode_table();
+    ppc_block_cache_flush();
 
     // initialize emulator timers
     TimerManager::get_instance()->set_time_now_cb(&get_virt_time_ns);
     TimerManager::get_instance()->set_notify_changes_cb(&force_cycle_counter_reload);
+    CommandQueue::get_instance()->set_notify_cb(&force_cycle_counter_reload);
 
     // initialize time base facility
-#ifdef __APPLE__
-    mach_timebase_info(&timebase_info);
-#endif
-    g_nanoseconds_base = cpu_now_ns();
     g_icycles = 0;
 
 //                    //                                        // PDM cpu clock calculated at 0x403036CC in r3
@@ -851,6 +1335,8 @@ void ppc_cpu_init(MemCtrlBase* mem_ctrl, uint32_t cpu_version, bool do_include_6
 //  icnt_factor =  2; // 1 instruction =    4 ns =  250.000 MHz // 0D3C3C3C =   222.051388 MHz =    4.503 ns // (100...) MHz = invalid clock for PDM gestalt calculation
 //  icnt_factor =  1; // 1 instruction =    2 ns =  500.000 MHz // 1A611A7B =   442.571387 MHz =    2.259 ns // (100...) MHz = invalid clock for PDM gestalt calculation
 //  icnt_factor =  0; // 1 instruction =    1 ns = 1500.000 MHz // 3465B2D9 =   879.080153 MHz =    1.137 ns // (100...) MHz = invalid clock for PDM gestalt calculation
+    ppc_clock_init(icnt_factor);
+    ppc_pacing_reset(0);
 
     tbr_wr_timestamp = 0;
     rtc_timestamp = 0;
@@ -866,6 +1352,8 @@ void ppc_cpu_init(MemCtrlBase* mem_ctrl, uint32_t cpu_version, bool do_include_6
 
     exec_flags = 0;
     exec_timer = false;
+    ppc_lazy_flags = {};
+    ppc_state.vscr = VSCR::NJ;
 
     timebase_counter = 0;
     dec_wr_value = 0;
@@ -910,7 +1398,7 @@ static map<string, int> SPRName2Num = {
     {"RTCL",   SPR::RTCL_S},    {"DSISR",  SPR::DSISR}, {"DAR",    SPR::DAR},
     {"MMCR0",  SPR::MMCR0},     {"PMC1",   SPR::PMC1},  {"PMC2",   SPR::PMC2},
     {"SDA",    SPR::SDA},       {"SIA",    SPR::SIA},   {"MMCR1",  SPR::MMCR1},
-    {"PMC3",   SPR::PMC3},      {"PMC4",   SPR::PMC4},
+    {"PMC3",   SPR::PMC3},      {"PMC4",   SPR::PMC4},  {"VRSAVE", SPR::VRSAVE},
 // get value from supervisor index same as we do for SPR268 and SPR269
     {"TBL_U",  SPR::TBL_S},     {"TBU_U",  SPR::TBU_S},
 };
@@ -920,6 +1408,9 @@ static uint64_t reg_op(string& reg_name, uint64_t val, bool is_write) {
     unsigned reg_num;
     map<string, int>::iterator spr;
 
+    // registers must be up to date before they can be shown or modified
+    ppc_sync_flags();
+
     if (reg_name.length() < 2)
         goto bail_out;
 
@@ -0,0 +1,337 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Direct host access to guest memory (fastmem). */
+
+#include "ppcfastmem.h"
+
+#include <loguru.hpp>
+
+#include <cinttypes>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+bool      ppc_fastmem_enabled = false;
+uint8_t*  fastmem_base        = nullptr;
+uint32_t* fastmem_slow_pages  = nullptr;
+
+#ifdef PPC_FASTMEM
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+/** Entry of the table built by FASTMEM_FIXUP(). */
+typedef struct FastmemFixup {
+    int32_t insn;  // faulting instruction, relative to this field
+    int32_t fixup; // where to continue, relative to this field
+} FastmemFixup;
+
+extern "C" const FastmemFixup __start_fastmem_fixups[] __attribute__((weak));
+extern "C" const FastmemFixup __stop_fastmem_fixups[] __attribute__((weak));
+
+constexpr uint64_t FASTMEM_WINDOW_SIZE = 1ULL << 32;
+constexpr uint32_t FASTMEM_NUM_WINDOWS = 3; // real, supervisor, user
+constexpr uint32_t FASTMEM_NUM_PAGES   = uint32_t(FASTMEM_WINDOW_SIZE >> 12);
+
+enum : uint8_t {
+    FM_UNMAPPED = 0,
+    FM_SEEN     = 1, // translated while the window was inactive, or unmapped again
+    FM_READ     = 2,
+    FM_WRITE    = 3,
+};
+
+typedef struct FastmemWindow {
+    uint8_t*              base;
+    bool                  active;
+    bool                  has_pat;    // has pages translated with the page table
+    std::vector<uint8_t>  page_state; // FM_XXX per guest page
+    std::unique_ptr<uint32_t[]> page_phys; // physical page, only set for mapped pages
+    std::vector<uint32_t> touched;    // pages whose state isn't FM_UNMAPPED
+    uint32_t              slow_pages[FASTMEM_SLOW_PAGES];
+} FastmemWindow;
+
+/** Guest memory that can be mapped into the windows. */
+typedef struct FastmemBacking {
+    uint8_t*    ptr;
+    size_t      size;
+    int         fd;
+} FastmemBacking;
+
+static uint8_t*                     window_area = nullptr;
+static FastmemWindow                windows[FASTMEM_NUM_WINDOWS];
+static FastmemWindow*               cur_window  = nullptr;
+static std::vector<FastmemBacking>  backings;
+static struct sigaction             prev_segv_action;
+
+uint8_t* fastmem_alloc(size_t size) {
+    if (!ppc_fastmem_enabled)
+        return nullptr;
+
+    int fd = memfd_create("dppc-guest-mem", MFD_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+
+#ifdef MADV_HUGEPAGE
+    // only honored for shared memory if the host allows huge pages there
+    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+
+    backings.push_back({(uint8_t*)ptr, size, fd});
+    return (uint8_t*)ptr;
+}
+
+bool fastmem_free(uint8_t* ptr) {
+    for (auto it = backings.begin(); it != backings.end(); ++it) {
+        if (it->ptr == ptr) {
+            munmap(it->ptr, it->size);
+            close(it->fd);
+            backings.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void fastmem_segv_handler(int sig, siginfo_t* info, void* context) {
+    ucontext_t* uc = (ucontext_t*)context;
+    uintptr_t   pc = uc->uc_mcontext.gregs[REG_RIP];
+    uint8_t*    fault_addr = (uint8_t*)info->si_addr;
+
+    if (fault_addr >= window_area &&
+        fault_addr < window_area + FASTMEM_NUM_WINDOWS * FASTMEM_WINDOW_SIZE) {
+        for (const FastmemFixup* f = __start_fastmem_fixups; f < __stop_fastmem_fixups; f++) {
+            if ((uintptr_t)&f->insn + f->insn == pc) {
+                uc->uc_mcontext.gregs[REG_RIP] = (greg_t)((uintptr_t)&f->fixup + f->fixup);
+                return;
+            }
+        }
+    }
+
+    // not ours, pass it on
+    if (prev_segv_action.sa_flags & SA_SIGINFO) {
+        prev_segv_action.sa_sigaction(sig, info, context);
+    } else if (prev_segv_action.sa_handler != SIG_DFL && prev_segv_action.sa_handler != SIG_IGN) {
+        prev_segv_action.sa_handler(sig);
+    } else {
+        // fault again with the default action
+        signal(sig, SIG_DFL);
+    }
+}
+
+static void fastmem_activate(FastmemWindow& win, bool active) {
+    win.active = active;
+    if (cur_window == &win)
+        fastmem_base = active ? win.base : nullptr;
+}
+
+static void fastmem_clear(FastmemWindow& win) {
+    std::memset(win.slow_pages, 0xFF, sizeof(win.slow_pages));
+    win.has_pat = false;
+
+    // only active windows have pages mapped
+    if (win.active) {
+        mmap(win.base, FASTMEM_WINDOW_SIZE, PROT_NONE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        fastmem_activate(win, false);
+    }
+
+    for (uint32_t page : win.touched)
+        win.page_state[page] = FM_UNMAPPED;
+    win.touched.clear();
+}
+
+void fastmem_init() {
+    fastmem_base = nullptr;
+    cur_window   = nullptr;
+
+    if (!ppc_fastmem_enabled)
+        return;
+
+    if (!window_area) {
+        void* area = mmap(nullptr, FASTMEM_NUM_WINDOWS * FASTMEM_WINDOW_SIZE, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (area == MAP_FAILED) {
+            LOG_F(WARNING, "Fastmem: could not reserve host address space, disabled");
+            ppc_fastmem_enabled = false;
+            return;
+        }
+        window_area = (uint8_t*)area;
+
+        for (uint32_t i = 0; i < FASTMEM_NUM_WINDOWS; i++) {
+            windows[i].base = window_area + i * FASTMEM_WINDOW_SIZE;
+            windows[i].page_state.assign(FASTMEM_NUM_PAGES, FM_UNMAPPED);
+            // left uninitialized so the host only backs the parts in use
+            windows[i].page_phys.reset(new uint32_t[FASTMEM_NUM_PAGES]);
+        }
+
+        struct sigaction sa = {};
+        sa.sa_sigaction = fastmem_segv_handler;
+        sa.sa_flags     = SA_SIGINFO;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGSEGV, &sa, &prev_segv_action);
+    }
+
+    for (auto& win : windows)
+        fastmem_clear(win);
+}
+
+void fastmem_select(uint8_t mmu_mode) {
+    if (!window_area)
+        return;
+
+    // DTLB modes: 0 - real addressing, 2 - supervisor, 3 - user
+    cur_window         = &windows[mmu_mode ? mmu_mode - 1 : 0];
+    fastmem_base       = cur_window->active ? cur_window->base : nullptr;
+    fastmem_slow_pages = cur_window->slow_pages;
+}
+
+void fastmem_map(uint32_t guest_va, uint32_t phys_addr, const uint8_t* host_page,
+                 bool writable, bool from_pat) {
+    if (!cur_window)
+        return;
+
+    FastmemWindow& win = *cur_window;
+    uint32_t page  = guest_va >> 12;
+    uint8_t  state = win.page_state[page];
+    uint8_t  want  = writable ? FM_WRITE : FM_READ;
+
+    if (state >= want)
+        return;
+
+    if (state == FM_UNMAPPED) {
+        win.touched.push_back(page);
+        if (!win.active) {
+            // wait for the page to be used again
+            win.page_state[page] = FM_SEEN;
+            return;
+        }
+    }
+
+    for (const auto& b : backings) {
+        if (host_page < b.ptr || host_page >= b.ptr + b.size)
+            continue;
+
+        size_t offset = host_page - b.ptr;
+        if (offset & 0xFFF)
+            break; // not page aligned within the backing
+
+        void* res = mmap(win.base + (uint64_t(page) << 12), 0x1000,
+                         writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                         MAP_SHARED | MAP_FIXED, b.fd, offset);
+        if (res == MAP_FAILED) {
+            // most likely out of mappings, start over
+            fastmem_clear(win);
+            return;
+        }
+        win.page_state[page] = want;
+        win.page_phys[page]  = phys_addr & ~0xFFFU;
+        win.has_pat |= from_pat;
+        if (!win.active)
+            fastmem_activate(win, true);
+        return;
+    }
+
+    win.page_state[page] = FM_SEEN;
+    fastmem_mark_slow(guest_va);
+}
+
+static void fastmem_unmap(FastmemWindow& win, uint32_t page) {
+    mmap(win.base + (uint64_t(page) << 12), 0x1000, PROT_NONE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    win.page_state[page] = FM_SEEN; // still listed in touched
+}
+
+void fastmem_unmap_page(uint32_t guest_va) {
+    uint32_t page = guest_va >> 12;
+
+    for (auto& win : windows) {
+        if (win.slow_pages[page & (FASTMEM_SLOW_PAGES - 1)] == page)
+            win.slow_pages[page & (FASTMEM_SLOW_PAGES - 1)] = UINT32_MAX;
+        if (win.page_state.empty() || win.page_state[page] < FM_READ)
+            continue;
+        fastmem_unmap(win, page);
+    }
+}
+
+void fastmem_unmap_translated(bool pat_only) {
+    if (!window_area)
+        return;
+
+    for (uint32_t i = 1; i < FASTMEM_NUM_WINDOWS; i++) {
+        if (!pat_only || windows[i].has_pat)
+            fastmem_clear(windows[i]);
+    }
+}
+
+void fastmem_unmap_phys_range(uint32_t start, uint32_t end) {
+    if (!window_area)
+        return;
+
+    for (auto& win : windows) {
+        // slow pages may have become memory
+        std::memset(win.slow_pages, 0xFF, sizeof(win.slow_pages));
+
+        for (uint32_t page : win.touched) {
+            if (win.page_state[page] >= FM_READ && win.page_phys[page] >= start &&
+                win.page_phys[page] <= end)
+                fastmem_unmap(win, page);
+        }
+    }
+}
+
+#else // PPC_FASTMEM
+
+uint8_t* fastmem_alloc(size_t size) {
+    return nullptr;
+}
+
+bool fastmem_free(uint8_t* ptr) {
+    return false;
+}
+
+void fastmem_init() {
+    if (ppc_fastmem_enabled) {
+        LOG_F(WARNING, "Fastmem isn't supported on this host");
+        ppc_fastmem_enabled = false;
+    }
+}
+
+void fastmem_select(uint8_t mmu_mode) {}
+void fastmem_map(uint32_t guest_va, uint32_t phys_addr, const uint8_t* host_page,
+                 bool writable, bool from_pat) {}
+void fastmem_unmap_page(uint32_t guest_va) {}
+void fastmem_unmap_translated(bool pat_only) {}
+void fastmem_unmap_phys_range(uint32_t start, uint32_t end) {}
+
+#endif // PPC_FASTMEM
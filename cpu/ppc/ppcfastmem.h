@@ -0,0 +1,180 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Direct host access to guest memory (fastmem).
+
+    Every data address translation context (real addressing, supervisor
+    and user mode with translation enabled) owns a 4 GB window of reserved
+    host address space. Once the TLB path has translated a guest memory
+    page, the page is mapped into the window of the current context at
+    its effective address so later loads and stores become a single host
+    access at window base + EA.
+
+    Accesses to pages that aren't mapped (not touched yet, MMIO, unmapped
+    physical memory) or are mapped read-only (ROM, write-protected pages,
+    pages whose PTE[C] bit isn't set yet) fault. The SIGSEGV handler only
+    recognizes faults of the accesses recorded in the fastmem_fixups table
+    and makes them return false so that the caller falls back to the TLB
+    path.
+
+    The windows of translated contexts are cleared whenever the DTLB gets
+    flushed, unless the flush only affects page table translations and the
+    window doesn't have any of them. A cleared window stays inactive until a page is translated for
+    the second time so that frequent context switches don't keep faulting
+    on pages that are touched once. Each window remembers the physical
+    page behind its mapped pages so that a change of the physical memory
+    map only removes the affected pages. Only guest memory allocated with
+    fastmem_alloc() can be mapped.
+ */
+
+#ifndef PPC_FASTMEM_H
+#define PPC_FASTMEM_H
+
+#include <endianswap.h>
+
+#include <cinttypes>
+#include <cstddef>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define PPC_FASTMEM
+#endif
+
+/** Fastmem was requested. Must be set before guest memory is allocated.
+    Cleared by fastmem_init() if the windows can't be set up. */
+extern bool ppc_fastmem_enabled;
+
+/** Window of the current data translation context, nullptr if inactive. */
+extern uint8_t* fastmem_base;
+
+/** Small cache of pages in the current window that always take the slow
+    path (MMIO, unmapped or non-shareable memory), so accesses to them don't
+    go through the fault handler each time. Indexed by the low page bits. */
+constexpr uint32_t FASTMEM_SLOW_PAGES = 16;
+extern uint32_t* fastmem_slow_pages;
+
+/** Allocate zeroed guest memory that can be mapped into the windows.
+    Returns nullptr if fastmem isn't enabled or available. */
+extern uint8_t* fastmem_alloc(size_t size);
+
+/** Release memory obtained from fastmem_alloc().
+    Returns false if ptr wasn't allocated by it. */
+extern bool fastmem_free(uint8_t* ptr);
+
+/** Reserve the windows and install the fault handler. */
+extern void fastmem_init();
+
+/** Switch to the window of the given DTLB mode. */
+extern void fastmem_select(uint8_t mmu_mode);
+
+/** Map the guest page containing guest_va into the current window.
+    phys_addr is the physical address it translates to, from_pat tells
+    whether the page was translated with the page table. */
+extern void fastmem_map(uint32_t guest_va, uint32_t phys_addr, const uint8_t* host_page,
+                        bool writable, bool from_pat);
+
+/** Remove the guest page containing guest_va from all windows. */
+extern void fastmem_unmap_page(uint32_t guest_va);
+
+/** Remove all pages from the windows of translated contexts.
+    Windows without page table translated pages are kept if pat_only is set. */
+extern void fastmem_unmap_translated(bool pat_only);
+
+/** Remove the pages translating to the physical range start..end from all
+    windows, including the real addressing one. */
+extern void fastmem_unmap_phys_range(uint32_t start, uint32_t end);
+
+/** Tell fastmem that the page containing guest_va isn't directly accessible. */
+static inline void fastmem_mark_slow(uint32_t guest_va) {
+    if (fastmem_base)
+        fastmem_slow_pages[(guest_va >> 12) & (FASTMEM_SLOW_PAGES - 1)] = guest_va >> 12;
+}
+
+/** Check whether an access of type T should try the window first. */
+template <class T>
+static inline bool fastmem_usable(uint32_t guest_va) {
+    return fastmem_base && !(guest_va & (sizeof(T) - 1)) &&
+        fastmem_slow_pages[(guest_va >> 12) & (FASTMEM_SLOW_PAGES - 1)] != (guest_va >> 12);
+}
+
+#ifdef PPC_FASTMEM
+// Record a host instruction touching guest memory in the fastmem_fixups
+// section along with the label to resume at when it faults. Offsets are
+// relative to the entry so the table doesn't need relocations.
+#define FASTMEM_FIXUP(label)                            \
+    ".pushsection fastmem_fixups, \"a\"\n"            \
+    ".balign 4\n"                                       \
+    ".long 1b - ., %l[" #label "] - .\n"               \
+    ".popsection\n"
+
+template <class T>
+static inline bool fastmem_load(uint32_t guest_va, T& val) {
+    const T* p = reinterpret_cast<const T*>(fastmem_base + guest_va);
+    T raw;
+
+    asm goto("1: mov %1, %0\n" FASTMEM_FIXUP(fault) : "=r"(raw) : "m"(*p) : : fault);
+
+    if constexpr (sizeof(T) == 1)
+        val = raw;
+    else if constexpr (sizeof(T) == 2)
+        val = BYTESWAP_16(raw);
+    else if constexpr (sizeof(T) == 4)
+        val = BYTESWAP_32(raw);
+    else
+        val = BYTESWAP_64(raw);
+    return true;
+
+fault:
+    return false;
+}
+
+template <class T>
+static inline bool fastmem_store(uint32_t guest_va, T val) {
+    T* p = reinterpret_cast<T*>(fastmem_base + guest_va);
+    T  raw;
+
+    if constexpr (sizeof(T) == 1)
+        raw = val;
+    else if constexpr (sizeof(T) == 2)
+        raw = BYTESWAP_16(val);
+    else if constexpr (sizeof(T) == 4)
+        raw = BYTESWAP_32(val);
+    else
+        raw = BYTESWAP_64(val);
+
+    asm goto("1: mov %0, (%1)\n" FASTMEM_FIXUP(fault) : : "r"(raw), "r"(p) : "memory" : fault);
+    return true;
+
+fault:
+    return false;
+}
+#else
+template <class T>
+static inline bool fastmem_load(uint32_t guest_va, T& val) {
+    return false;
+}
+
+template <class T>
+static inline bool fastmem_store(uint32_t guest_va, T val) {
+    return false;
+}
+#endif
+
+#endif // PPC_FASTMEM_H
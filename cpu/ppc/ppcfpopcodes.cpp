@@ -57,11 +57,21 @@ void set_host_rounding_mode(uint8_t mode) {
     }
 }
 
+// Host exception flags accumulated while all exceptions were disabled
+// must not be attributed to the next instruction.
+static inline void fpscr_enables_did_change(uint32_t old_fpscr) {
+    if (!(old_fpscr & FPSCR::EN_MASK) && (ppc_state.fpscr & FPSCR::EN_MASK))
+        std::feclearexcept(FE_ALL_EXCEPT);
+}
+
 void update_fpscr(uint32_t new_fpscr) {
-    if ((new_fpscr & FPSCR::RN_MASK) != (ppc_state.fpscr & FPSCR::RN_MASK))
+    uint32_t old_fpscr = ppc_state.fpscr;
+
+    if ((new_fpscr & FPSCR::RN_MASK) != (old_fpscr & FPSCR::RN_MASK))
         set_host_rounding_mode(new_fpscr & FPSCR::RN_MASK);
 
     ppc_state.fpscr = new_fpscr;
+    fpscr_enables_did_change(old_fpscr);
 }
 
 static int32_t round_to_zero(double f) {
@@ -116,7 +126,139 @@ static double set_endresult_nan(double ppc_result_d) {
     return std::numeric_limits<double>::quiet_NaN();
 }
 
-static void fpresult_update(double set_result) {
+// Operation classes for deriving the FPSCR exception bits
+enum class fp_op {
+    add, // src1 + src2
+    mul, // src1 * src2
+    div, // src1 / src2
+    fma, // src1 * src3 + src2
+};
+
+template <fp_op op>
+static inline double fp_compute(double src1, double src2, double src3) {
+    switch (op) {
+    case fp_op::add:
+        return src1 + src2;
+    case fp_op::mul:
+        return src1 * src2;
+    case fp_op::div:
+        return src1 / src2;
+    case fp_op::fma:
+        return std::fma(src1, src3, src2);
+    }
+}
+
+/** Whether the exact sum of four numbers is zero. They are accumulated into
+    a nonoverlapping expansion (Shewchuk's grow-expansion), whose nonzero
+    components can't cancel each other. Fast2Sum keeps every step exact
+    regardless of the rounding mode.
+ */
+static bool exact_sum_is_zero(double t0, double t1, double t2, double t3) {
+    double terms[4] = {t0, t1, t2, t3};
+    double comps[4];
+    int    num_comps = 0;
+
+    for (double q : terms) {
+        int n = 0;
+        for (int i = 0; i < num_comps; i++) {
+            double a = q, b = comps[i];
+            if (std::fabs(a) < std::fabs(b))
+                std::swap(a, b);
+            q = a + b;
+            double err = b - (q - a);
+            if (err != 0.0)
+                comps[n++] = err;
+        }
+        if (q != 0.0)
+            comps[n++] = q;
+        num_comps = n;
+    }
+
+    return !num_comps;
+}
+
+/** Derive the sticky OX, UX and ZX bits from the operands and the result.
+
+    Used while all FPSCR exception enables are clear: nothing can trap then,
+    so there is no need to query and clear the host exception flags after
+    every instruction, which is slow on most hosts. Only infinite, maximal
+    and tiny results need a closer look, everything else returns early.
+ */
+template <fp_op op, bool single>
+static uint32_t fp_derive_exceptions(double result, double src1, double src2, double src3) {
+    double mag = std::fabs(result);
+
+    if (std::isinf(result)) {
+        if (std::isinf(src1) || std::isinf(src2) || std::isinf(src3))
+            return 0;
+        if (op == fp_op::div && src2 == 0.0)
+            return FX | ZX;
+        return FX | OX;
+    }
+
+    if (mag == (single ? double(FLT_MAX) : DBL_MAX)) {
+        // Directed rounding clamps overflowing results to the largest finite
+        // number. They overflowed if the unrounded value reached 2^(Emax+1),
+        // which is checked on halved operands for double precision.
+        constexpr double half = single ? 1.0 : 0.5;
+        double val = fp_compute<op>(src1 * half,
+            (op == fp_op::add || op == fp_op::fma) ? src2 * half : src2, src3);
+        return std::fabs(val) >= (single ? 0x1p128 : 0x1p1023) ? (FX | OX) : 0;
+    }
+
+    if (mag >= (single ? double(FLT_MIN) : DBL_MIN))
+        return 0;
+
+    // A tiny result only underflows if it isn't exact. The error terms below
+    // are exact, operands are scaled out of the subnormal range for double
+    // precision products and quotients to keep them representable.
+    constexpr double scale = single ? 1.0 : 0x1p600;
+
+    double val = fp_compute<op>(src1, src2, src3);
+    bool inexact = mag != std::fabs(val);
+
+    switch (op) {
+    case fp_op::add:
+        if (std::fabs(src1) < std::fabs(src2))
+            std::swap(src1, src2);
+        inexact |= ((src1 - val) + src2) != 0.0;
+        break;
+    case fp_op::mul:
+        if (std::fabs(src1) < std::fabs(src2))
+            std::swap(src1, src2);
+        inexact |= std::fma(src1, src2 * scale, -val * scale) != 0.0;
+        break;
+    case fp_op::div:
+        if (!std::isinf(src2))
+            inexact |= std::fma(val * scale, src2, -src1 * scale) != 0.0;
+        break;
+    case fp_op::fma:
+        // The product splits into a rounded and an exact low part, the error
+        // is their sum plus the addend minus the result. Tiny products are
+        // scaled up so their low part stays representable, the addend and
+        // the result are tiny then as well and scale exactly. Products below
+        // the smallest subnormal can't be added exactly to anything.
+        if (src1 != 0.0 && src3 != 0.0) {
+            if (std::fabs(src1) < std::fabs(src3))
+                std::swap(src1, src3);
+            int exp = std::ilogb(src1) + std::ilogb(src3);
+            if (exp < -1076) {
+                inexact = true;
+            } else {
+                double f  = exp < -900 ? 0x1p600 : 1.0;
+                double hi = src1 * (src3 * f);
+                double lo = std::fma(src1, src3 * f, -hi);
+                inexact |= !exact_sum_is_zero(hi, lo, src2 * f, -val * f);
+            }
+        }
+        break;
+    }
+
+    return inexact ? (FX | UX) : 0;
+}
+
+template <fp_op op, bool single = false>
+static void fpresult_update(double set_result, double src1, double src2, double src3 = 1.0) {
     if (std::isnan(set_result)) {
         ppc_state.fpscr |= FPCC_FUNAN | FPRCD;
     } else {
@@ -128,20 +270,24 @@ static void fpresult_update(double set_result) {
             ppc_state.fpscr |= FPCC_ZERO;
         }
 
+        if (!(ppc_state.fpscr & FPSCR::EN_MASK)) {
+            ppc_state.fpscr |= fp_derive_exceptions<op, single>(set_result, src1, src2, src3);
+        } else {
 // Emscripten's fenv.h does not define FE_OVERFLOW/FE_UNDERFLOW/FE_DIVBYZERO.
 #ifndef __EMSCRIPTEN__
-        if (std::fetestexcept(FE_OVERFLOW)) {
-            ppc_state.fpscr |= (OX + FX);
-        }
-        if (std::fetestexcept(FE_UNDERFLOW)) {
-            ppc_state.fpscr |= (UX + FX);
-        }
-        if (std::fetestexcept(FE_DIVBYZERO)) {
-            ppc_state.fpscr |= (ZX + FX);
-        }
-
-        std::feclearexcept(FE_ALL_EXCEPT);
+            if (std::fetestexcept(FE_OVERFLOW)) {
+                ppc_state.fpscr |= (OX + FX);
+            }
+            if (std::fetestexcept(FE_UNDERFLOW)) {
+                ppc_state.fpscr |= (UX + FX);
+            }
+            if (std::fetestexcept(FE_DIVBYZERO)) {
+                ppc_state.fpscr |= (ZX + FX);
+            }
+
+            std::feclearexcept(FE_ALL_EXCEPT);
 #endif
+        }
 
         if (std::isinf(set_result))
             ppc_state.fpscr |= FPCC_FUNAN;
@@ -190,7 +336,7 @@ void dppc_interpreter::ppc_fadd(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::add>(ppc_dblresult64_d, val_reg_a, val_reg_b);
 
     if (rec)
         ppc_update_cr1();
@@ -220,7 +366,7 @@ void dppc_interpreter::ppc_fsub(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::add>(ppc_dblresult64_d, val_reg_a, -val_reg_b);
 
     if (rec)
         ppc_update_cr1();
@@ -237,7 +383,8 @@ void dppc_interpreter::ppc_fdiv(uint32_t opcode) {
 
     if (is_601 && FPR_INT(reg_b) == 0x8000000000000000 && val_reg_a > 0) {
         ppc_dblresult64_d = val_reg_b;
-        fpresult_update(ppc_dblresult64_d);
+        // -0.0 is passed through, no exception is signalled
+        fpresult_update<fp_op::add>(ppc_dblresult64_d, val_reg_b, 0.0);
 
         if (rec)
             ppc_update_cr1();
@@ -270,7 +417,7 @@ void dppc_interpreter::ppc_fdiv(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::div>(ppc_dblresult64_d, val_reg_a, val_reg_b);
 
     if (rec)
         ppc_update_cr1();
@@ -304,7 +451,7 @@ void dppc_interpreter::ppc_fmul(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::mul>(ppc_dblresult64_d, val_reg_a, val_reg_c);
 
     if (rec)
         ppc_update_cr1();
@@ -343,7 +490,7 @@ void dppc_interpreter::ppc_fmadd(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::fma>(ppc_dblresult64_d, val_reg_a, val_reg_b, val_reg_c);
 
     if (rec)
         ppc_update_cr1();
@@ -385,7 +532,7 @@ void dppc_interpreter::ppc_fmsub(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::fma>(ppc_dblresult64_d, val_reg_a, -val_reg_b, val_reg_c);
 
     if (rec)
         ppc_update_cr1();
@@ -428,7 +575,7 @@ void dppc_interpreter::ppc_fnmadd(uint32_t opcode) {
     }
 
     ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::fma>(ppc_dblresult64_d, val_reg_a, val_reg_b, val_reg_c);
 
     if (rec)
         ppc_update_cr1();
@@ -466,7 +613,7 @@ void dppc_interpreter::ppc_fnmsub(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::fma>(ppc_dblresult64_d, val_reg_a, -val_reg_b, val_reg_c);
 
     if (rec)
         ppc_update_cr1();
@@ -498,7 +645,7 @@ void dppc_interpreter::ppc_fadds(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::add, true>(ppc_dblresult64_d, val_reg_a, val_reg_b);
 
     if (rec)
         ppc_update_cr1();
@@ -529,7 +676,7 @@ void dppc_interpreter::ppc_fsubs(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::add, true>(ppc_dblresult64_d, val_reg_a, -val_reg_b);
 
     if (rec)
         ppc_update_cr1();
@@ -569,7 +716,7 @@ void dppc_interpreter::ppc_fdivs(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::div, true>(ppc_dblresult64_d, val_reg_a, val_reg_b);
 
     if (rec)
         ppc_update_cr1();
@@ -603,7 +750,7 @@ void dppc_interpreter::ppc_fmuls(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::mul, true>(ppc_dblresult64_d, val_reg_a, val_reg_c);
 
     if (rec)
         ppc_update_cr1();
@@ -638,7 +785,7 @@ void dppc_interpreter::ppc_fmadds(uint32_t opcode) {
     }
 
     ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::fma, true>(ppc_dblresult64_d, val_reg_a, val_reg_b, val_reg_c);
 
     if (rec)
         ppc_update_cr1();
@@ -672,7 +819,7 @@ void dppc_interpreter::ppc_fmsubs(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::fma, true>(ppc_dblresult64_d, val_reg_a, -val_reg_b, val_reg_c);
 
     if (rec)
         ppc_update_cr1();
@@ -709,7 +856,7 @@ void dppc_interpreter::ppc_fnmadds(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::fma, true>(ppc_dblresult64_d, val_reg_a, val_reg_b, val_reg_c);
 
     if (rec)
         ppc_update_cr1();
@@ -750,7 +897,7 @@ void dppc_interpreter::ppc_fnmsubs(uint32_t opcode) {
         ppc_store_fpresult_flt(reg_d, ppc_dblresult64_d);
     }
 
-    fpresult_update(ppc_dblresult64_d);
+    fpresult_update<fp_op::fma, true>(ppc_dblresult64_d, val_reg_a, -val_reg_b, val_reg_c);
 
     if (rec)
         ppc_update_cr1();
@@ -1020,6 +1167,8 @@ void dppc_interpreter::ppc_lfs(uint32_t opcode) {
     uint32_t ea = int32_t(int16_t(opcode));
     ea += (reg_a) ? val_reg_a : 0;
     uint32_t result = mmu_read_vmem<uint32_t>(opcode, ea);
+    if (ppc_faulted())
+        return;
     ppc_store_fpresult_flt(reg_d, *(float*)(&result));
 }
 
@@ -1030,6 +1179,8 @@ void dppc_interpreter::ppc_lfsu(uint32_t opcode) {
         uint32_t ea = int32_t(int16_t(opcode));
         ea += val_reg_a;
         uint32_t result = mmu_read_vmem<uint32_t>(opcode, ea);
+        if (ppc_faulted())
+            return;
         ppc_store_fpresult_flt(reg_d, *(float*)(&result));
         ppc_store_iresult_reg(reg_a, ea);
     }
@@ -1042,6 +1193,8 @@ void dppc_interpreter::ppc_lfsx(uint32_t opcode) {
     ppc_grab_regsfpdiab(opcode);
     uint32_t ea = val_reg_b + (reg_a ? val_reg_a : 0);
     uint32_t result = mmu_read_vmem<uint32_t>(opcode, ea);
+    if (ppc_faulted())
+        return;
     ppc_store_fpresult_flt(reg_d, *(float*)(&result));
 }
 
@@ -1051,6 +1204,8 @@ void dppc_interpreter::ppc_lfsux(uint32_t opcode) {
     if (reg_a != 0) {
         uint32_t ea = val_reg_a + val_reg_b;
         uint32_t result = mmu_read_vmem<uint32_t>(opcode, ea);
+        if (ppc_faulted())
+            return;
         ppc_store_fpresult_flt(reg_d, *(float*)(&result));
         ppc_store_iresult_reg(reg_a, ea);
     }
@@ -1065,6 +1220,8 @@ void dppc_interpreter::ppc_lfd(uint32_t opcode) {
     uint32_t ea = int32_t(int16_t(opcode));
     ea += (reg_a) ? val_reg_a : 0;
     uint64_t ppc_result64_d = mmu_read_vmem<uint64_t>(opcode, ea);
+    if (ppc_faulted())
+        return;
     ppc_store_fpresult_int(reg_d, ppc_result64_d);
 }
 
@@ -1075,6 +1232,8 @@ void dppc_interpreter::ppc_lfdu(uint32_t opcode) {
         uint32_t ea = int32_t(int16_t(opcode));
         ea += val_reg_a;
         uint64_t ppc_result64_d = mmu_read_vmem<uint64_t>(opcode, ea);
+        if (ppc_faulted())
+            return;
         ppc_store_fpresult_int(reg_d, ppc_result64_d);
         ppc_store_iresult_reg(reg_a, ea);
     }
@@ -1087,6 +1246,8 @@ void dppc_interpreter::ppc_lfdx(uint32_t opcode) {
     ppc_grab_regsfpdiab(opcode);
     uint32_t ea = val_reg_b + (reg_a ? val_reg_a : 0);
     uint64_t ppc_result64_d = mmu_read_vmem<uint64_t>(opcode, ea);
+    if (ppc_faulted())
+        return;
     ppc_store_fpresult_int(reg_d, ppc_result64_d);
 }
 
@@ -1096,6 +1257,8 @@ void dppc_interpreter::ppc_lfdux(uint32_t opcode) {
     if (reg_a != 0) {
         uint32_t ea = val_reg_a + val_reg_b;
         uint64_t ppc_result64_d = mmu_read_vmem<uint64_t>(opcode, ea);
+        if (ppc_faulted())
+            return;
         ppc_store_fpresult_int(reg_d, ppc_result64_d);
         ppc_store_iresult_reg(reg_a, ea);
     }
@@ -1120,6 +1283,8 @@ void dppc_interpreter::ppc_stfsu(uint32_t opcode) {
         ea += val_reg_a;
         float result = float(GET_FPR(reg_s));
         mmu_write_vmem<uint32_t>(opcode, ea, *(uint32_t*)(&result));
+        if (ppc_faulted())
+            return;
         ppc_store_iresult_reg(reg_a, ea);
     }
     else {
@@ -1141,6 +1306,8 @@ void dppc_interpreter::ppc_stfsux(uint32_t opcode) {
         uint32_t ea = val_reg_a + val_reg_b;
         float result = float(GET_FPR(reg_s));
         mmu_write_vmem<uint32_t>(opcode, ea, *(uint32_t*)(&result));
+        if (ppc_faulted())
+            return;
         ppc_store_iresult_reg(reg_a, ea);
     }
     else {
@@ -1162,6 +1329,8 @@ void dppc_interpreter::ppc_stfdu(uint32_t opcode) {
         uint32_t ea = int32_t(int16_t(opcode));
         ea += val_reg_a;
         mmu_write_vmem<uint64_t>(opcode, ea, FPR_INT(reg_s));
+        if (ppc_faulted())
+            return;
         ppc_store_iresult_reg(reg_a, ea);
     }
     else {
@@ -1181,6 +1350,8 @@ void dppc_interpreter::ppc_stfdux(uint32_t opcode) {
     if (reg_a != 0) {
         uint32_t ea = val_reg_a + val_reg_b;
         mmu_write_vmem<uint64_t>(opcode, ea, FPR_INT(reg_s));
+        if (ppc_faulted())
+            return;
         ppc_store_iresult_reg(reg_a, ea);
     }
     else {
@@ -1247,7 +1418,7 @@ void dppc_interpreter::ppc_mtfsf(uint32_t opcode) {
     cr_mask &= ~(FPSCR::FEX | FPSCR::VX);
 
     // copy FPR[reg_b] to FPSCR under control of cr_mask
-    ppc_state.fpscr = (ppc_state.fpscr & ~cr_mask) | (FPR_INT(reg_b) & cr_mask);
+    update_fpscr((ppc_state.fpscr & ~cr_mask) | (FPR_INT(reg_b) & cr_mask));
 
     if (rec)
         ppc_update_cr1();
@@ -1265,7 +1436,7 @@ void dppc_interpreter::ppc_mtfsfi(uint32_t opcode) {
     uint32_t mask = (0xF0000000UL >> crf_d) & ~(FPSCR::FEX | FPSCR::VX);
 
     // copy imm to FPSCR[crf_d] under control of the field mask
-    ppc_state.fpscr = (ppc_state.fpscr & ~mask) | ((imm >> crf_d) & mask);
+    update_fpscr((ppc_state.fpscr & ~mask) | ((imm >> crf_d) & mask));
 
     // Update FEX and VX according to the "usual rule"
     ppc_update_vx();
@@ -1282,7 +1453,7 @@ template <field_rc rec>
 void dppc_interpreter::ppc_mtfsb0(uint32_t opcode) {
     int crf_d = (opcode >> 21) & 0x1F;
     if (!crf_d || (crf_d > 2)) { // FEX and VX can't be explicitly cleared
-        ppc_state.fpscr &= ~(0x80000000UL >> crf_d);
+        update_fpscr(ppc_state.fpscr & ~(0x80000000UL >> crf_d));
     }
 
     if (rec)
@@ -1296,7 +1467,7 @@ template <field_rc rec>
 void dppc_interpreter::ppc_mtfsb1(uint32_t opcode) {
     int crf_d = (opcode >> 21) & 0x1F;
     if (!crf_d || (crf_d > 2)) { // FEX and VX can't be explicitly set
-        ppc_state.fpscr |= (0x80000000UL >> crf_d);
+        update_fpscr(ppc_state.fpscr | (0x80000000UL >> crf_d));
     }
 
     if (rec)
@@ -1309,6 +1480,8 @@ template void dppc_interpreter::ppc_mtfsb1<RC1>(uint32_t opcode);
 void dppc_interpreter::ppc_mcrfs(uint32_t opcode) {
     int crf_d = (opcode >> 21) & 0x1C;
     int crf_s = (opcode >> 16) & 0x1C;
+    if (!crf_d)
+        ppc_discard_crf0();
     ppc_state.cr = (
         (ppc_state.cr & ~(0xF0000000UL >> crf_d)) |
         (((ppc_state.fpscr << crf_s) & 0xF0000000UL) >> crf_d)
@@ -1352,6 +1525,8 @@ void dppc_interpreter::ppc_fcmpo(uint32_t opcode) {
 
     ppc_state.fpscr &= ~VE; //kludge to pass tests
     ppc_state.fpscr = (ppc_state.fpscr & ~FPSCR::FPCC_MASK) | (cmp_c >> 16); // update FPCC
+    if (!crf_d)
+        ppc_discard_crf0();
     ppc_state.cr = ((ppc_state.cr & ~(0xF0000000 >> crf_d)) | (cmp_c >> crf_d));
 }
 
@@ -1378,5 +1553,7 @@ void dppc_interpreter::ppc_fcmpu(uint32_t opcode) {
 
     ppc_state.fpscr &= ~VE; //kludge to pass tests
     ppc_state.fpscr = (ppc_state.fpscr & ~FPSCR::FPCC_MASK) | (cmp_c >> 16); // update FPCC
+    if (!crf_d)
+        ppc_discard_crf0();
     ppc_state.cr    = ((ppc_state.cr & ~(0xF0000000UL >> crf_d)) | (cmp_c >> crf_d));
 }
@@ -0,0 +1,468 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Detection of guest idle loops. */
+
+#include "ppcidle.h"
+#include "ppcclock.h"
+#include "ppcemu.h"
+#include "ppcmmu.h"
+#include <devices/memctrl/memctrlbase.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+extern uint64_t g_icycles;
+
+/** Longest step by which a loop polling time or I/O is advanced. */
+constexpr uint64_t PPC_IDLE_POLL_NS = 100000;
+
+PPCIdleLoop ppc_idle_cache[PPC_IDLE_CACHE_SIZE];
+
+// special registers tracked by the analysis
+enum : uint32_t { IDLE_XER = 1, IDLE_CTR = 2, IDLE_LR = 4 };
+
+/** Registers accessed by one instruction. */
+typedef struct IdleInsnAccess {
+    uint32_t gpr_rd, gpr_wr;
+    uint32_t cr_rd, cr_wr;      // CR bits in CR layout
+    uint32_t spr_rd, spr_wr;    // IDLE_XER/CTR/LR
+    bool     timed;             // result depends on time
+    bool     is_load;
+} IdleInsnAccess;
+
+/** Loop state that has to be identical on consecutive iterations. */
+typedef struct IdleAnalysis {
+    uint32_t gpr_mask;          // GPRs read before they are written
+    uint32_t cr_mask;
+    uint32_t spr_mask;
+    bool     timed;             // polls time or memory that might be I/O
+} IdleAnalysis;
+
+static struct {
+    PPCIdleLoop* loop = nullptr;
+    uint32_t     start_pc;
+    uint64_t     max_cycles;    // cycle limit the snapshot was taken under
+    bool         valid = false;
+    uint32_t     gpr[32];
+    uint32_t     cr, xer, ctr, lr;
+} snapshot;
+
+static inline uint32_t gpr_bit(uint32_t reg) {
+    return 1U << reg;
+}
+
+static inline uint32_t crf_bits(uint32_t crf) {
+    return 0xF0000000U >> (crf * 4);
+}
+
+static inline uint32_t crb_bit(uint32_t crb) {
+    return 0x80000000U >> crb;
+}
+
+/** Record the registers an instruction accesses.
+    Returns false for instructions with side effects. */
+static bool decode_access(uint32_t opcode, IdleInsnAccess& acc) {
+    uint32_t rd = (opcode >> 21) & 31;
+    uint32_t ra = (opcode >> 16) & 31;
+    uint32_t rb = (opcode >> 11) & 31;
+    bool     rc = opcode & 1;
+
+    acc = {};
+
+    switch (opcode >> 26) {
+    case 7:  // mulli
+    case 8:  // subfic
+    case 12: // addic
+    case 13: // addic.
+        acc.gpr_rd = gpr_bit(ra);
+        acc.gpr_wr = gpr_bit(rd);
+        if (opcode >> 26 != 7)
+            acc.spr_wr = IDLE_XER;
+        if (opcode >> 26 == 13) {
+            acc.spr_rd = IDLE_XER;
+            acc.cr_wr  = crf_bits(0);
+        }
+        return true;
+    case 10: // cmpli
+    case 11: // cmpi
+        acc.gpr_rd = gpr_bit(ra);
+        acc.spr_rd = IDLE_XER;
+        acc.cr_wr  = crf_bits(rd >> 2);
+        return true;
+    case 14: // addi
+    case 15: // addis
+        acc.gpr_rd = ra ? gpr_bit(ra) : 0;
+        acc.gpr_wr = gpr_bit(rd);
+        return true;
+    case 20: // rlwimi
+    case 21: // rlwinm
+    case 23: // rlwnm
+    case 24: // ori
+    case 25: // oris
+    case 26: // xori
+    case 27: // xoris
+    case 28: // andi.
+    case 29: // andis.
+        acc.gpr_rd = gpr_bit(rd);
+        if (opcode >> 26 == 20)
+            acc.gpr_rd |= gpr_bit(ra);
+        if (opcode >> 26 == 23)
+            acc.gpr_rd |= gpr_bit(rb);
+        acc.gpr_wr = gpr_bit(ra);
+        if ((opcode >> 26 >= 28) || (opcode >> 26 <= 23 && rc)) {
+            acc.spr_rd = IDLE_XER;
+            acc.cr_wr  = crf_bits(0);
+        }
+        return true;
+    case 32: // lwz
+    case 34: // lbz
+    case 40: // lhz
+    case 42: // lha
+        acc.gpr_rd  = ra ? gpr_bit(ra) : 0;
+        acc.gpr_wr  = gpr_bit(rd);
+        acc.is_load = true;
+        return true;
+    case 16: { // bc
+        uint32_t bo = rd;
+        if (!(bo & 0x04)) {
+            acc.spr_rd |= IDLE_CTR;
+            acc.spr_wr |= IDLE_CTR;
+        }
+        if (!(bo & 0x10))
+            acc.cr_rd = crb_bit(ra);
+        if (rc)
+            acc.spr_wr |= IDLE_LR;
+        return true;
+    }
+    case 18: // b
+        if (rc)
+            acc.spr_wr = IDLE_LR;
+        return true;
+    case 19:
+        switch ((opcode >> 1) & 0x3FF) {
+        case 0: // mcrf
+            acc.cr_rd = crf_bits(ra >> 2);
+            acc.cr_wr = crf_bits(rd >> 2);
+            return true;
+        case 16:    // bclr
+        case 528: { // bcctr
+            uint32_t bo = rd;
+            acc.spr_rd = (((opcode >> 1) & 0x3FF) == 16) ? IDLE_LR : IDLE_CTR;
+            if (!(bo & 0x04)) {
+                acc.spr_rd |= IDLE_CTR;
+                acc.spr_wr |= IDLE_CTR;
+            }
+            if (!(bo & 0x10))
+                acc.cr_rd = crb_bit(ra);
+            if (rc)
+                acc.spr_wr |= IDLE_LR;
+            return true;
+        }
+        case 33:  // crnor
+        case 129: // crandc
+        case 193: // crxor
+        case 225: // crnand
+        case 257: // crand
+        case 289: // creqv
+        case 417: // crorc
+        case 449: // cror
+            acc.cr_rd = crb_bit(ra) | crb_bit(rb);
+            acc.cr_wr = crb_bit(rd);
+            return true;
+        case 150: // isync
+            return true;
+        }
+        return false;
+    case 31:
+        break;
+    default:
+        return false;
+    }
+
+    uint32_t xo = (opcode >> 1) & 0x3FF;
+
+    switch (xo) {
+    case 0:  // cmp
+    case 32: // cmpl
+        acc.gpr_rd = gpr_bit(ra) | gpr_bit(rb);
+        acc.spr_rd = IDLE_XER;
+        acc.cr_wr  = crf_bits(rd >> 2);
+        return true;
+    case 19: // mfcr
+        acc.cr_rd  = 0xFFFFFFFFU;
+        acc.gpr_wr = gpr_bit(rd);
+        return true;
+    case 23:  // lwzx
+    case 87:  // lbzx
+    case 279: // lhzx
+    case 343: // lhax
+        acc.gpr_rd  = (ra ? gpr_bit(ra) : 0) | gpr_bit(rb);
+        acc.gpr_wr  = gpr_bit(rd);
+        acc.is_load = true;
+        return true;
+    case 339: // mfspr
+    case 371: { // mftb
+        uint32_t spr = (rb << 5) | ra;
+        acc.gpr_wr = gpr_bit(rd);
+        switch (spr) {
+        case SPR::XER:
+            acc.spr_rd = IDLE_XER;
+            return true;
+        case SPR::LR:
+            acc.spr_rd = IDLE_LR;
+            return true;
+        case SPR::CTR:
+            acc.spr_rd = IDLE_CTR;
+            return true;
+        case SPR::SPRG0:
+        case SPR::SPRG1:
+        case SPR::SPRG2:
+        case SPR::SPRG3:
+        case SPR::PVR:
+            return true;
+        case SPR::RTCU_U:
+        case SPR::RTCL_U:
+        case SPR::DEC_U:
+        case SPR::DEC_S:
+        case SPR::TBL_U:
+        case SPR::TBU_U:
+            acc.timed = true;
+            return true;
+        }
+        return false;
+    }
+    case 598: // sync
+    case 854: // eieio
+        return true;
+    }
+
+    // logical and shift instructions: rA = rS op rB
+    switch (xo) {
+    case 24:  // slw
+    case 28:  // and
+    case 60:  // andc
+    case 124: // nor
+    case 284: // eqv
+    case 316: // xor
+    case 412: // orc
+    case 444: // or
+    case 476: // nand
+    case 536: // srw
+    case 792: // sraw
+        acc.gpr_rd = gpr_bit(rd) | gpr_bit(rb);
+        acc.gpr_wr = gpr_bit(ra);
+        if (xo == 792)
+            acc.spr_wr = IDLE_XER;
+        break;
+    case 26:  // cntlzw
+    case 824: // srawi
+    case 922: // extsh
+    case 954: // extsb
+        acc.gpr_rd = gpr_bit(rd);
+        acc.gpr_wr = gpr_bit(ra);
+        if (xo == 824)
+            acc.spr_wr = IDLE_XER;
+        break;
+    default:
+        // XO-form arithmetic, OE is the topmost bit of the extended opcode
+        switch (xo & 0x1FF) {
+        case 8:   // subfc
+        case 10:  // addc
+        case 136: // subfe
+        case 138: // adde
+            if ((xo & 0x1FF) >= 136)
+                acc.spr_rd = IDLE_XER; // CA input
+            acc.spr_wr = IDLE_XER;
+            // fallthrough
+        case 11:  // mulhwu
+        case 40:  // subf
+        case 75:  // mulhw
+        case 235: // mullw
+        case 266: // add
+            acc.gpr_rd = gpr_bit(ra) | gpr_bit(rb);
+            break;
+        case 104: // neg
+            acc.gpr_rd = gpr_bit(ra);
+            break;
+        case 200: // subfze
+        case 202: // addze
+        case 232: // subfme
+        case 234: // addme
+            acc.gpr_rd = gpr_bit(ra);
+            acc.spr_rd = IDLE_XER;
+            acc.spr_wr = IDLE_XER;
+            break;
+        default:
+            return false;
+        }
+        acc.gpr_wr = gpr_bit(rd);
+        if (xo & 0x200) {
+            acc.spr_rd |= IDLE_XER; // SO is sticky
+            acc.spr_wr |= IDLE_XER;
+        }
+    }
+
+    if (rc) {
+        acc.spr_rd |= IDLE_XER;
+        acc.cr_wr  |= crf_bits(0);
+    }
+
+    return true;
+}
+
+/** Check whether a load reads RAM, which can't change before the next timer event. */
+static bool load_reads_ram(uint32_t opcode) {
+    uint32_t ra = (opcode >> 16) & 31;
+    uint32_t ea = ra ? ppc_state.gpr[ra] : 0;
+
+    if (opcode >> 26 == 31)
+        ea += ppc_state.gpr[(opcode >> 11) & 31];
+    else
+        ea += int32_t(int16_t(opcode));
+
+    uint32_t pa = ea;
+    if ((ppc_state.msr & MSR::DR) && !mmu_translate_dbg(ea, pa))
+        return false;
+
+    AddressMapEntry* entry = mem_ctrl_instance->find_range(pa);
+    return entry && (entry->type & RT_RAM);
+}
+
+/** Find out which state the loop carries between iterations. */
+static bool analyze_loop(const uint8_t* host_start, uint32_t num_insns, IdleAnalysis& an) {
+    uint32_t gpr_seen = 0, cr_seen = 0, spr_seen = 0;
+    uint32_t gpr_written = 0;
+    IdleInsnAccess acc;
+
+    an = {};
+
+    for (uint32_t i = 0; i < num_insns; i++) {
+        uint32_t opcode = ppc_read_instruction(host_start + i * 4);
+
+        if (!decode_access(opcode, acc))
+            return false;
+
+        // only the last instruction may branch
+        if (i < num_insns - 1) {
+            uint32_t primary = opcode >> 26;
+            uint32_t xo      = (opcode >> 1) & 0x3FF;
+            if (primary == 16 || primary == 18 || (primary == 19 && (xo == 16 || xo == 528)))
+                return false;
+        }
+
+        gpr_written |= acc.gpr_wr;
+    }
+
+    for (uint32_t i = 0; i < num_insns; i++) {
+        uint32_t opcode = ppc_read_instruction(host_start + i * 4);
+
+        decode_access(opcode, acc);
+
+        // state read before it's written is carried over from the previous iteration
+        an.gpr_mask |= acc.gpr_rd & ~gpr_seen;
+        an.cr_mask  |= acc.cr_rd & ~cr_seen;
+        an.spr_mask |= acc.spr_rd & ~spr_seen;
+
+        if (acc.timed)
+            an.timed = true;
+
+        // loads through registers computed in the loop can't be checked reliably
+        if (acc.is_load && ((acc.gpr_rd & gpr_written) || !load_reads_ram(opcode)))
+            an.timed = true;
+
+        gpr_seen |= acc.gpr_rd | acc.gpr_wr;
+        cr_seen  |= acc.cr_rd | acc.cr_wr;
+        spr_seen |= acc.spr_rd | acc.spr_wr;
+    }
+
+    return true;
+}
+
+static void take_snapshot(PPCIdleLoop* loop, uint32_t start_pc, uint64_t max_cycles) {
+    snapshot.loop       = loop;
+    snapshot.start_pc   = start_pc;
+    snapshot.max_cycles = max_cycles;
+    snapshot.valid      = true;
+    std::memcpy(snapshot.gpr, ppc_state.gpr, sizeof(snapshot.gpr));
+    snapshot.cr  = ppc_state.cr;
+    snapshot.xer = ppc_state.spr[SPR::XER];
+    snapshot.ctr = ppc_state.spr[SPR::CTR];
+    snapshot.lr  = ppc_state.spr[SPR::LR];
+}
+
+static bool snapshot_matches(const IdleAnalysis& an) {
+    for (uint32_t reg = 0; reg < 32; reg++) {
+        if ((an.gpr_mask & gpr_bit(reg)) && snapshot.gpr[reg] != ppc_state.gpr[reg])
+            return false;
+    }
+
+    return !((snapshot.cr ^ ppc_state.cr) & an.cr_mask) &&
+        !((an.spr_mask & IDLE_XER) && snapshot.xer != ppc_state.spr[SPR::XER]) &&
+        !((an.spr_mask & IDLE_CTR) && snapshot.ctr != ppc_state.spr[SPR::CTR]) &&
+        !((an.spr_mask & IDLE_LR)  && snapshot.lr  != ppc_state.spr[SPR::LR]);
+}
+
+uint64_t ppc_idle_check(PPCIdleLoop* loop, uint32_t start_pc, uint32_t branch_pc,
+                        const uint8_t* host_start, uint64_t max_cycles) {
+    ppc_sync_flags();
+
+    if (loop->host_start != host_start || loop->generation != ppc_code_generation) {
+        if (snapshot.loop == loop)
+            snapshot.valid = false;
+        loop->host_start = host_start;
+        loop->generation = ppc_code_generation;
+        loop->backoff    = 0;
+        loop->delay      = 0;
+    }
+
+    IdleAnalysis an;
+    loop->eligible = analyze_loop(host_start, ((branch_pc - start_pc) >> 2) + 1, an);
+    if (!loop->eligible)
+        return 0;
+
+    // timer callbacks may have changed memory the last iteration has already
+    // loaded, so compare only iterations that ran without events in between
+    if (!snapshot.valid || snapshot.loop != loop || snapshot.start_pc != start_pc ||
+        snapshot.max_cycles != max_cycles) {
+        take_snapshot(loop, start_pc, max_cycles);
+        return 0;
+    }
+
+    if (!snapshot_matches(an)) {
+        // the loop makes progress, look at it less often
+        loop->delay    = std::min(loop->delay * 2 + 1, PPC_IDLE_MAX_BACKOFF);
+        loop->backoff  = loop->delay;
+        snapshot.valid = false;
+        return 0;
+    }
+
+    loop->delay = 0;
+
+    uint64_t target = max_cycles;
+    if (an.timed)
+        target = std::min(target, g_icycles + ppc_clock_ns_to_cycles(PPC_IDLE_POLL_NS));
+
+    uint64_t skip = target > g_icycles ? target - g_icycles : 0;
+    ppc_clock_skipped += skip;
+    return skip;
+}
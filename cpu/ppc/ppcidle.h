@@ -0,0 +1,96 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Detection of guest idle loops.
+
+    An idle loop is a short backward branch loop without stores that
+    only computes from registers, memory loads and the time base/decrementer.
+    If the registers it carries from one iteration into the next are the
+    same on two consecutive iterations, every further iteration will be
+    identical until a timer fires, an interrupt arrives or time advances.
+
+    Loops that only read RAM can therefore be skipped up to the next timer
+    deadline. Loops reading time or MMIO registers are skipped in smaller
+    steps so that delay loops don't overshoot their target much.
+ */
+
+#ifndef PPC_IDLE_H
+#define PPC_IDLE_H
+
+#include "ppcblockcache.h"
+
+#include <cinttypes>
+
+/** Maximum length of a loop considered for idle detection. */
+constexpr uint32_t PPC_IDLE_MAX_INSNS = 16;
+
+/** Longest interval between checks of a loop that turned out to be busy. */
+constexpr uint32_t PPC_IDLE_MAX_BACKOFF = 4096;
+
+typedef struct PPCIdleLoop {
+    const uint8_t*  host_start; // host address of the first loop instruction
+    uint32_t        generation; // code generation the entry was filled in
+    bool            eligible;   // loop consists of idle-safe instructions only
+    uint32_t        backoff;    // back-edges to ignore before checking again
+    uint32_t        delay;      // current backoff interval
+} PPCIdleLoop;
+
+constexpr uint32_t PPC_IDLE_CACHE_SIZE = 64;
+
+extern PPCIdleLoop ppc_idle_cache[PPC_IDLE_CACHE_SIZE];
+
+extern uint64_t ppc_idle_check(PPCIdleLoop* loop, uint32_t start_pc, uint32_t branch_pc,
+                               const uint8_t* host_start, uint64_t max_cycles);
+
+/** Return the number of instruction cycles that can be skipped at the
+    back-edge of the loop [start_pc, branch_pc], zero if it isn't idle. */
+inline uint64_t ppc_idle_skip(uint32_t start_pc, uint32_t branch_pc, const uint8_t* host_start,
+                              uint64_t max_cycles) {
+    PPCIdleLoop* loop = &ppc_idle_cache[(uintptr_t(host_start) >> 2) & (PPC_IDLE_CACHE_SIZE - 1)];
+
+    if (loop->host_start == host_start && loop->generation == ppc_code_generation) {
+        if (!loop->eligible)
+            return 0;
+        if (loop->backoff) {
+            loop->backoff--;
+            return 0;
+        }
+    }
+
+    return ppc_idle_check(loop, start_pc, branch_pc, host_start, max_cycles);
+}
+
+/** Same as ppc_idle_skip() for the block ending with the back-edge, called
+    once the back-edges it was told to ignore in blk->idle_wait ran out.
+    The block counts them down itself, which saves the cache lookup on
+    every iteration of busy loops. */
+inline uint64_t ppc_idle_skip_block(PPCDecodedBlock* blk, uint32_t start_pc, uint32_t branch_pc,
+                                    const uint8_t* host_start, uint64_t max_cycles) {
+    PPCIdleLoop* loop = &ppc_idle_cache[(uintptr_t(host_start) >> 2) & (PPC_IDLE_CACHE_SIZE - 1)];
+    uint64_t skip = ppc_idle_check(loop, start_pc, branch_pc, host_start, max_cycles);
+    // loops that aren't eligible are looked at again after the longest backoff
+    // in case the block ends with an indirect branch to a different loop
+    blk->idle_wait = loop->eligible ? loop->backoff : PPC_IDLE_MAX_BACKOFF;
+    loop->backoff  = 0;
+    return skip;
+}
+
+#endif // PPC_IDLE_H
@@ -0,0 +1,798 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Block translator from PowerPC to x86-64 host code. */
+
+#include "ppcjit.h"
+#include "ppcemu.h"
+#include "ppcidle.h"
+
+#include <loguru.hpp>
+
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__APPLE__) && defined(MAP_JIT)
+#include <pthread.h>
+#define JIT_WRITE_PROTECT_NP
+#endif
+
+extern uint64_t g_icycles;
+extern std::atomic<bool> exec_timer;
+
+/** Size of the host code buffer. */
+constexpr uint32_t JIT_BUFFER_SIZE    = 16 * 1024 * 1024;
+/** Upper bound of host code emitted for one block. */
+constexpr uint32_t JIT_MAX_BLOCK_CODE = 8192;
+/** Number of hot blocks translated together. */
+constexpr uint32_t JIT_QUEUE_SIZE     = 16;
+
+static uint8_t* code_buf  = nullptr;
+static uint32_t code_used = 0;
+static bool     jit_ok    = true;
+
+// blocks waiting for translation, all from cache generation queue_gen
+static PPCDecodedBlock* queue[JIT_QUEUE_SIZE];
+static uint32_t         queue_len = 0;
+static uint32_t         queue_gen = 0;
+
+// first pass output, only used to count register accesses
+static uint8_t scratch_buf[JIT_MAX_BLOCK_CODE];
+
+#ifdef JIT_WRITE_PROTECT_NP
+// MAP_JIT buffer toggled per thread instead of with mprotect()
+static bool     use_write_protect_np = false;
+#endif
+
+// offsets of emulator globals from ppc_state, addressed through RBX
+static int32_t ofs_icycles, ofs_exec_flags, ofs_nia, ofs_lazy;
+static int32_t ofs_block_gen, ofs_exec_timer, ofs_cycles_pc;
+
+// x86 register numbers
+enum { EAX = 0, ECX = 1, EDX = 2, EBP = 5, R12 = 12, R13 = 13, R15 = 15 };
+
+// x86 condition codes
+enum { CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7, CC_S = 0x8, CC_G = 0xF };
+
+// x86 ALU operations, /digit of group 1 and the reg,r/m opcode
+enum { ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_XOR = 6, ALU_CMP = 7 };
+
+// callee-saved host registers guest GPRs are kept in
+static const int gpr_host_regs[] = {EBP, R12, R13, R15};
+
+static inline uint32_t rot_mask(unsigned rot_mb, unsigned rot_me) {
+    uint32_t m1 = 0xFFFFFFFFUL >> rot_mb;
+    uint32_t m2 = uint32_t(0xFFFFFFFFUL << (31 - rot_me));
+    return ((rot_mb <= rot_me) ? m2 & m1 : m1 | m2);
+}
+
+static inline int32_t ofs_gpr(int reg) {
+    return int32_t(offsetof(SetPRS, gpr) + reg * 4);
+}
+
+static inline int32_t ofs_spr(int spr) {
+    return int32_t(offsetof(SetPRS, spr) + spr * 4);
+}
+
+static constexpr int32_t OFS_PC = int32_t(offsetof(SetPRS, pc));
+static constexpr int32_t OFS_CR = int32_t(offsetof(SetPRS, cr));
+
+/** Minimal x86-64 emitter. Guest state is addressed via [rbx + disp32],
+    the guest address of the current block is kept in r14 and the
+    PPCJitState pointer at [rsp]. */
+class Emitter {
+public:
+    Emitter(uint8_t* p) : start(p), p(p) {
+        for (auto& hr : host_reg)
+            hr = -1;
+    }
+
+    uint8_t* start;
+    uint8_t* p;
+
+    /** Size of the prologue, chained blocks are entered right after it. */
+    static constexpr uint32_t PROLOGUE_SIZE = 25;
+
+    // guest GPRs kept in host registers, see alloc_gprs()
+    int8_t   host_reg[32];
+    uint32_t gpr_loaded = 0;    // host register holds the GPR
+    uint32_t gpr_dirty  = 0;    // host register differs from ppc_state
+    uint32_t gpr_uses[32] = {}; // accesses of each GPR
+
+    void u8(uint8_t v) { *p++ = v; }
+    void u32(uint32_t v) { for (int i = 0; i < 4; i++) *p++ = uint8_t(v >> (i * 8)); }
+    void u64(uint64_t v) { u32(uint32_t(v)); u32(uint32_t(v >> 32)); }
+
+    // REX prefix for registers r8..r15, omitted if not needed
+    void rex(int reg, int rm, bool w = false) {
+        uint8_t r = 0x40 | (w << 3) | ((reg & 8) >> 1) | ((rm & 8) >> 3);
+        if (r != 0x40)
+            u8(r);
+    }
+
+    void modrm_rbx(int reg, int32_t disp) { u8(0x80 | ((reg & 7) << 3) | 3); u32(disp); }
+    void modrm_rr(int reg, int rm) { u8(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+
+    // mov r32, [rbx + disp]
+    void load(int reg, int32_t disp) { rex(reg, 0); u8(0x8B); modrm_rbx(reg, disp); }
+    // mov [rbx + disp], r32
+    void store(int reg, int32_t disp) { rex(reg, 0); u8(0x89); modrm_rbx(reg, disp); }
+    // mov dword [rbx + disp], imm32
+    void store_imm(int32_t disp, uint32_t imm) { u8(0xC7); modrm_rbx(0, disp); u32(imm); }
+    // mov r32, imm32
+    void mov_imm(int reg, uint32_t imm) { rex(0, reg); u8(0xB8 + (reg & 7)); u32(imm); }
+    // mov r32, r32
+    void mov_rr(int dst, int src) { rex(src, dst); u8(0x89); modrm_rr(src, dst); }
+    // op r32, imm32
+    void alu_imm(int op, int reg, uint32_t imm) { u8(0x81); u8(0xC0 | (op << 3) | reg); u32(imm); }
+    // op r32, [rbx + disp]
+    void alu_mem(int op, int reg, int32_t disp) { rex(reg, 0); u8(0x03 + op * 8); modrm_rbx(reg, disp); }
+    // op r32, r32
+    void alu_rr(int op, int dst, int src) { rex(src, dst); u8(0x01 + op * 8); modrm_rr(src, dst); }
+    // not/neg eax
+    void not_eax() { u8(0xF7); u8(0xD0); }
+    void neg_eax() { u8(0xF7); u8(0xD8); }
+    // rol eax, imm8
+    void rol_eax(uint8_t sh) { u8(0xC1); u8(0xC0); u8(sh); }
+    // shr r32, imm8
+    void shr(int reg, uint8_t sh) { u8(0xC1); u8(0xE8 | reg); u8(sh); }
+    // test eax, eax
+    void test_eax() { u8(0x85); u8(0xC0); }
+    // test dword [rbx + disp], imm32
+    void test_mem(int32_t disp, uint32_t imm) { u8(0xF7); modrm_rbx(0, disp); u32(imm); }
+    // dec dword [rbx + disp]
+    void dec_mem(int32_t disp) { u8(0xFF); modrm_rbx(1, disp); }
+    // add qword [rbx + disp], imm8
+    void add_mem64(int32_t disp, uint8_t imm) { u8(0x48); u8(0x83); modrm_rbx(0, disp); u8(imm); }
+    // cmp dword [rbx + disp], 0
+    void cmp_mem_zero(int32_t disp) { u8(0x83); modrm_rbx(7, disp); u8(0); }
+    // lea eax, [r14 + disp]
+    void lea_pc(int32_t disp) { u8(0x41); u8(0x8D); u8(0x86); u32(disp); }
+    // mov edi, imm32; mov rax, imm64; call rax
+    void call_handler(PPCOpcode fn, uint32_t opcode) {
+        u8(0xBF); u32(opcode);
+        call(reinterpret_cast<void (*)()>(fn));
+    }
+    // mov rax, imm64; call rax (12 bytes)
+    void call(void (*fn)()) {
+        u8(0x48); u8(0xB8); u64(uint64_t(uintptr_t(fn)));
+        u8(0xFF); u8(0xD0);
+    }
+    // jcc rel8 over a fixed number of bytes
+    void jcc8(int cc, int8_t rel) { u8(0x70 | cc); u8(uint8_t(rel)); }
+    // jcc rel32 to be patched later, returns patch location
+    uint8_t* jcc32(int cc) { u8(0x0F); u8(0x80 | cc); u32(0); return p - 4; }
+    // jmp rel32 to be patched later, returns patch location
+    uint8_t* jmp32() { u8(0xE9); u32(0); return p - 4; }
+
+    void patch(uint8_t* loc, uint8_t* target) {
+        int32_t rel = int32_t(target - (loc + 4));
+        for (int i = 0; i < 4; i++) loc[i] = uint8_t(rel >> (i * 8));
+    }
+
+    void prologue() {
+        u8(0x53);                       // push rbx
+        u8(0x41); u8(0x56);             // push r14
+        u8(0x41); u8(0x57);             // push r15
+        u8(0x55);                       // push rbp
+        u8(0x41); u8(0x54);             // push r12
+        u8(0x41); u8(0x55);             // push r13
+        u8(0x57);                       // push rdi (keeps the stack aligned)
+        u8(0x48); u8(0xBB); u64(uint64_t(uintptr_t(&ppc_state))); // mov rbx, &ppc_state
+        u8(0x44); u8(0x8B); u8(0x77);   // mov r14d, [rdi + pc]
+        u8(uint8_t(offsetof(PPCJitState, pc)));
+    }
+
+    void epilogue() {
+        u8(0x5F);                       // pop rdi
+        u8(0x41); u8(0x5D);             // pop r13
+        u8(0x41); u8(0x5C);             // pop r12
+        u8(0x5D);                       // pop rbp
+        u8(0x41); u8(0x5F);             // pop r15
+        u8(0x41); u8(0x5E);             // pop r14
+        u8(0x5B);                       // pop rbx
+        u8(0xC3);                       // ret
+    }
+
+    /** Keep the GPRs accessed most often according to uses in host registers. */
+    void alloc_gprs(const uint32_t* uses) {
+        uint32_t taken = 0;
+        for (int hr : gpr_host_regs) {
+            int best = -1;
+            for (int gpr = 0; gpr < 32; gpr++)
+                if (!(taken & (1U << gpr)) && uses[gpr] >= 2 &&
+                    (best < 0 || uses[gpr] > uses[best]))
+                    best = gpr;
+            if (best < 0)
+                break;
+            taken |= 1U << best;
+            host_reg[best] = int8_t(hr);
+        }
+    }
+
+    // host register of gpr or -1, loading it first if its value is needed
+    int use_gpr(int gpr, bool read) {
+        gpr_uses[gpr]++;
+        int hr = host_reg[gpr];
+        if (hr >= 0) {
+            if (read && !(gpr_loaded & (1U << gpr)))
+                load(hr, ofs_gpr(gpr));
+            gpr_loaded |= 1U << gpr;
+            if (!read)
+                gpr_dirty |= 1U << gpr;
+        }
+        return hr;
+    }
+
+    void load_gpr(int reg, int gpr) {
+        int hr = use_gpr(gpr, true);
+        if (hr < 0)
+            load(reg, ofs_gpr(gpr));
+        else
+            mov_rr(reg, hr);
+    }
+
+    void store_gpr(int gpr, int reg) {
+        int hr = use_gpr(gpr, false);
+        if (hr < 0)
+            store(reg, ofs_gpr(gpr));
+        else
+            mov_rr(hr, reg);
+    }
+
+    void store_gpr_imm(int gpr, uint32_t imm) {
+        int hr = use_gpr(gpr, false);
+        if (hr < 0)
+            store_imm(ofs_gpr(gpr), imm);
+        else
+            mov_imm(hr, imm);
+    }
+
+    void alu_gpr(int op, int reg, int gpr) {
+        int hr = use_gpr(gpr, true);
+        if (hr < 0)
+            alu_mem(op, reg, ofs_gpr(gpr));
+        else
+            alu_rr(op, reg, hr);
+    }
+
+    // write modified GPRs back to ppc_state
+    void flush_gprs() {
+        for (int gpr = 0; gpr < 32; gpr++)
+            if (gpr_dirty & (1U << gpr))
+                store(host_reg[gpr], ofs_gpr(gpr));
+        gpr_dirty = 0;
+    }
+
+    // around interpreter calls, which may read and write any GPR
+    void flush_gprs_for_call() {
+        flush_gprs();
+        gpr_loaded = 0;
+    }
+
+    // ecx holds LT/GT/EQ in bits 31..29, add XER[SO] and store into CR field crf
+    void set_cr_field(int crf) {
+        load(EDX, ofs_spr(SPR::XER));
+        alu_imm(ALU_AND, EDX, XER::SO);
+        shr(EDX, 3);
+        u8(0x09); u8(0xD1);      // or ecx, edx
+        if (crf)
+            shr(ECX, crf * 4);
+        load(EDX, OFS_CR);
+        alu_imm(ALU_AND, EDX, ~(0xF0000000UL >> (crf * 4)));
+        u8(0x09); u8(0xCA);      // or edx, ecx
+        store(EDX, OFS_CR);
+    }
+
+    // record the result in eax for a lazy CR0 update, see ppc_changecrf0()
+    void set_cr0_from_eax() {
+        store(EAX, ofs_lazy + int32_t(offsetof(PPCLazyFlags, cr0_result)));
+        load(EDX, ofs_spr(SPR::XER));
+        alu_imm(ALU_AND, EDX, XER::SO);
+        alu_imm(ALU_OR, EDX, LAZY_CR0);
+        store(EDX, ofs_lazy + int32_t(offsetof(PPCLazyFlags, cr0_state)));
+    }
+
+    // bring CR0 up to date before reading it
+    void sync_cr0() {
+        cmp_mem_zero(ofs_lazy + int32_t(offsetof(PPCLazyFlags, cr0_state)));
+        jcc8(CC_E, 12);
+        call(ppc_materialize_flags);
+    }
+
+    // CR field from flags of a preceding compare
+    void set_cr_from_cmp(int crf, int cc_greater) {
+        if (!crf)
+            store_imm(ofs_lazy + int32_t(offsetof(PPCLazyFlags, cr0_state)), 0);
+        mov_imm(ECX, CRx_bit::CR_EQ);
+        jcc8(CC_E, 12);
+        mov_imm(ECX, CRx_bit::CR_GT);
+        jcc8(cc_greater, 5);
+        mov_imm(ECX, CRx_bit::CR_LT);
+        set_cr_field(crf);
+    }
+
+    /** Continue with the translated block linked to blk in slot kind, if any.
+        Falls through when that isn't possible. All GPRs must be flushed and
+        g_icycles must include the instructions of blk. A possible idle loop
+        only continues while the dispatcher would skip its idle check. */
+    void chain(const PPCDecodedBlock* blk, int kind, uint32_t next_offset, bool idle_loop) {
+        uint8_t* fail[7] = {};
+        uint32_t delta = next_offset - (blk->phys_addr & ~PPC_PAGE_MASK);
+
+        // mov rdx, blk
+        u8(0x48); u8(0xBA); u64(uint64_t(uintptr_t(blk)));
+        if (idle_loop) {
+            // cmp dword [rdx + idle_wait], 0
+            u8(0x83); u8(0xBA); u32(uint32_t(offsetof(PPCDecodedBlock, idle_wait))); u8(0);
+            fail[6] = jcc32(CC_E);
+            u8(0x48); u8(0x89); u8(0xD7); // mov rdi, rdx
+        }
+        // mov eax, [rdx + link_gen]; cmp eax, ppc_block_generation
+        u8(0x8B); u8(0x82); u32(uint32_t(offsetof(PPCDecodedBlock, link_gen) + kind * 4));
+        alu_mem(ALU_CMP, EAX, ofs_block_gen);
+        fail[0] = jcc32(CC_NE);
+        // cmp dword [rdx + link_offset], next_offset
+        u8(0x81); u8(0xBA); u32(uint32_t(offsetof(PPCDecodedBlock, link_offset) + kind * 4));
+        u32(next_offset);
+        fail[1] = jcc32(CC_NE);
+        // mov rdx, [rdx + link]; mov rcx, [rdx + jit_code]; test rcx, rcx
+        u8(0x48); u8(0x8B); u8(0x92); u32(uint32_t(offsetof(PPCDecodedBlock, link) + kind * 8));
+        u8(0x48); u8(0x8B); u8(0x8A); u32(uint32_t(offsetof(PPCDecodedBlock, jit_code)));
+        u8(0x48); u8(0x85); u8(0xC9);
+        fail[2] = jcc32(CC_E);
+        u8(0x48); u8(0x8B); u8(0x34); u8(0x24); // mov rsi, [rsp]
+        // the whole block has to run within the cycle limit
+        u8(0x8B); u8(0x82); u32(uint32_t(offsetof(PPCDecodedBlock, num_insns)));
+        u8(0x48); alu_mem(ALU_ADD, EAX, ofs_icycles);
+        u8(0x48); u8(0x3B); u8(0x46); u8(uint8_t(offsetof(PPCJitState, cycle_limit)));
+        fail[3] = jcc32(CC_AE);
+        // cmp byte [exec_timer], 0
+        u8(0x80); modrm_rbx(7, ofs_exec_timer); u8(0);
+        fail[4] = jcc32(CC_NE);
+        // (goal_addr - next pc) / 4 < num_insns if the block contains the goal
+        u8(0x8B); u8(0x46); u8(uint8_t(offsetof(PPCJitState, goal_addr)));
+        u8(0x44); u8(0x29); u8(0xF0);           // sub eax, r14d
+        alu_imm(ALU_SUB, EAX, delta);
+        shr(EAX, 2);
+        u8(0x3B); u8(0x82); u32(uint32_t(offsetof(PPCDecodedBlock, num_insns)));
+        fail[5] = jcc32(CC_B);
+
+        if (idle_loop) {
+            // dec dword [rdi + idle_wait]
+            u8(0xFF); u8(0x8F); u32(uint32_t(offsetof(PPCDecodedBlock, idle_wait)));
+        }
+
+        // update the PPCJitState and enter the block after its prologue
+        u8(0x48); u8(0x89); u8(0x56); u8(uint8_t(offsetof(PPCJitState, blk))); // mov [rsi + blk], rdx
+        load(EDX, ofs_block_gen);
+        u8(0x89); u8(0x56); u8(uint8_t(offsetof(PPCJitState, blk_gen))); // mov [rsi + blk_gen], edx
+        u8(0x41); u8(0x81); u8(0xC6); u32(delta);                        // add r14d, delta
+        u8(0x44); u8(0x89); u8(0x76); u8(uint8_t(offsetof(PPCJitState, pc))); // mov [rsi + pc], r14d
+        store_imm(ofs_exec_flags, 0);
+        u8(0x48); u8(0x83); u8(0xC1); u8(PROLOGUE_SIZE); // add rcx, PROLOGUE_SIZE
+        u8(0xFF); u8(0xE1);                              // jmp rcx
+
+        for (auto loc : fail)
+            if (loc)
+                patch(loc, p);
+    }
+};
+
+/** Make the code buffer range [start, start + size) writable and
+    non-executable (W^X), or executable and read-only again. Translation
+    only happens on the emulation thread between blocks, so no translated
+    code runs while a part of the buffer is writable. */
+static void jit_set_writable(uint8_t* start, uint32_t size, bool writable) {
+#ifdef JIT_WRITE_PROTECT_NP
+    if (use_write_protect_np) {
+        pthread_jit_write_protect_np(!writable);
+        return;
+    }
+#endif
+    uintptr_t page_mask = uintptr_t(sysconf(_SC_PAGESIZE)) - 1;
+    uintptr_t lo = reinterpret_cast<uintptr_t>(start) & ~page_mask;
+    uintptr_t hi = (reinterpret_cast<uintptr_t>(start) + size + page_mask) & ~page_mask;
+    if (mprotect(reinterpret_cast<void*>(lo), hi - lo,
+                 writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC))
+        ABORT_F("JIT: can't change protection of the code buffer");
+}
+static bool jit_init() {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    int prot  = PROT_READ | PROT_EXEC;
+#ifdef MAP_JIT
+    flags |= MAP_JIT;
+#endif
+#ifdef JIT_WRITE_PROTECT_NP
+    // MAP_JIT memory has to be mapped RWX, writes are then enabled per thread
+    if (__builtin_available(macOS 11.0, *)) {
+        use_write_protect_np = pthread_jit_write_protect_supported_np();
+        if (use_write_protect_np)
+            prot |= PROT_WRITE;
+    }
+#endif
+    void* mem = mmap(nullptr, JIT_BUFFER_SIZE, prot, flags, -1, 0);
+    if (mem == MAP_FAILED) {
+        LOG_F(WARNING, "JIT: can't allocate code buffer, using the threaded interpreter");
+        return false;
+    }
+
+    auto rel = [](const void* addr, int32_t& ofs) {
+        int64_t d = reinterpret_cast<intptr_t>(addr) - reinterpret_cast<intptr_t>(&ppc_state);
+        ofs = int32_t(d);
+        return d == ofs;
+    };
+
+    if (!rel(&g_icycles, ofs_icycles) || !rel(&exec_flags, ofs_exec_flags) ||
+        !rel(&ppc_next_instruction_address, ofs_nia) || !rel(&ppc_lazy_flags, ofs_lazy) ||
+        !rel(&ppc_block_generation, ofs_block_gen) || !rel(&exec_timer, ofs_exec_timer) ||
+        !rel(&ppc_cycles_pc, ofs_cycles_pc)) {
+        LOG_F(WARNING, "JIT: emulator state not addressable, using the threaded interpreter");
+        munmap(mem, JIT_BUFFER_SIZE);
+        return false;
+    }
+
+    code_buf = static_cast<uint8_t*>(mem);
+#ifdef JIT_WRITE_PROTECT_NP
+    if (use_write_protect_np)
+        pthread_jit_write_protect_np(1);
+#endif
+    return true;
+}
+
+/** Emit an instruction inline if possible. Returns false if the handler
+    needs to be called instead. */
+static bool emit_inline(Emitter& e, uint32_t opcode) {
+    int rd = (opcode >> 21) & 31;
+    int ra = (opcode >> 16) & 31;
+    int rb = (opcode >> 11) & 31;
+    uint32_t uimm = opcode & 0xFFFF;
+    int32_t  simm = int16_t(opcode);
+
+    switch (opcode >> 26) {
+    case 10: // cmpli
+        if (opcode & 0x200000)
+            return false;
+        e.load_gpr(EAX, ra);
+        e.alu_imm(ALU_CMP, EAX, uimm);
+        e.set_cr_from_cmp(rd >> 2, CC_A);
+        return true;
+    case 11: // cmpi
+        if (opcode & 0x200000)
+            return false;
+        e.load_gpr(EAX, ra);
+        e.alu_imm(ALU_CMP, EAX, uint32_t(simm));
+        e.set_cr_from_cmp(rd >> 2, CC_G);
+        return true;
+    case 14: // addi
+    case 15: // addis
+        if (opcode >> 26 == 15)
+            simm = int32_t(uint32_t(simm) << 16);
+        if (!ra) {
+            e.store_gpr_imm(rd, uint32_t(simm));
+        } else {
+            e.load_gpr(EAX, ra);
+            e.alu_imm(ALU_ADD, EAX, uint32_t(simm));
+            e.store_gpr(rd, EAX);
+        }
+        return true;
+    case 21: { // rlwinm
+        unsigned sh = rb;
+        e.load_gpr(EAX, rd);
+        if (sh)
+            e.rol_eax(sh);
+        e.alu_imm(ALU_AND, EAX, rot_mask((opcode >> 6) & 31, (opcode >> 1) & 31));
+        e.store_gpr(ra, EAX);
+        if (opcode & 1)
+            e.set_cr0_from_eax();
+        return true;
+    }
+    case 24: // ori
+    case 25: // oris
+    case 26: // xori
+    case 27: // xoris
+    case 28: // andi.
+    case 29: { // andis.
+        static const int ops[] = {ALU_OR, ALU_XOR, ALU_AND};
+        int primary = opcode >> 26;
+        if (primary & 1)
+            uimm <<= 16;
+        e.load_gpr(EAX, rd);
+        e.alu_imm(ops[(primary - 24) >> 1], EAX, uimm);
+        e.store_gpr(ra, EAX);
+        if (primary >= 28)
+            e.set_cr0_from_eax();
+        return true;
+    }
+    case 31:
+        break;
+    default:
+        return false;
+    }
+
+    bool rc = opcode & 1;
+
+    switch ((opcode >> 1) & 0x3FF) {
+    case 0:  // cmp
+    case 32: // cmpl
+        if (opcode & 0x200000)
+            return false;
+        e.load_gpr(EAX, ra);
+        e.alu_gpr(ALU_CMP, EAX, rb);
+        e.set_cr_from_cmp(rd >> 2, (opcode & 0x40) ? CC_A : CC_G);
+        return true;
+    case 40: // subf
+        if (rc)
+            return false;
+        e.load_gpr(EAX, rb);
+        e.alu_gpr(ALU_SUB, EAX, ra);
+        e.store_gpr(rd, EAX);
+        return true;
+    case 104: // neg
+        if (rc)
+            return false;
+        e.load_gpr(EAX, ra);
+        e.neg_eax();
+        e.store_gpr(rd, EAX);
+        return true;
+    case 266: // add
+        if (rc)
+            return false;
+        e.load_gpr(EAX, ra);
+        e.alu_gpr(ALU_ADD, EAX, rb);
+        e.store_gpr(rd, EAX);
+        return true;
+    case 28:  // and
+    case 60:  // andc
+    case 124: // nor
+    case 316: // xor
+    case 444: { // or
+        unsigned xo = (opcode >> 1) & 0x3FF;
+        if (xo == 60) {
+            e.load_gpr(EAX, rb);
+            e.not_eax();
+            e.alu_gpr(ALU_AND, EAX, rd);
+        } else {
+            e.load_gpr(EAX, rd);
+            e.alu_gpr(xo == 28 ? ALU_AND : xo == 316 ? ALU_XOR : ALU_OR, EAX, rb);
+            if (xo == 124)
+                e.not_eax();
+        }
+        e.store_gpr(ra, EAX);
+        if (rc)
+            e.set_cr0_from_eax();
+        return true;
+    }
+    case 339:   // mfspr
+    case 467: { // mtspr
+        uint32_t spr = (rb << 5) | ra;
+        if (spr != SPR::LR && spr != SPR::CTR)
+            return false;
+        if (((opcode >> 1) & 0x3FF) == 339) {
+            e.load(EAX, ofs_spr(spr));
+            e.store_gpr(rd, EAX);
+        } else {
+            e.load_gpr(EAX, rd);
+            e.store(EAX, ofs_spr(spr));
+        }
+        return true;
+    }
+    }
+
+    return false;
+}
+
+/** Emit a relative branch ending the block at instruction i. Returns false
+    for other forms. Exits that leave translated code jump to one of exits. */
+static bool emit_branch(Emitter& e, const PPCDecodedBlock* blk, uint32_t i, uint32_t pending,
+                        std::vector<uint8_t*>& exits) {
+    uint32_t opcode  = blk->insns[i].opcode;
+    uint32_t primary = opcode >> 26;
+
+    if ((primary != 16 && primary != 18) || (opcode & 2)) // AA=1 is rare
+        return false;
+
+    e.flush_gprs();
+    e.add_mem64(ofs_icycles, uint8_t(pending + 1));
+
+    int32_t pc_ofs = i * 4;
+
+    if (opcode & 1) { // LK
+        e.lea_pc(pc_ofs + 4);
+        e.store(EAX, ofs_spr(SPR::LR));
+    }
+
+    uint8_t* not_taken[2] = {};
+    int32_t  disp;
+
+    if (primary == 18) {
+        disp = int32_t((opcode & ~3UL) << 6) >> 6;
+    } else {
+        uint32_t bo = (opcode >> 21) & 0x1F;
+        uint32_t bi = (opcode >> 16) & 0x1F;
+        disp = int32_t(int16_t(opcode & ~3UL));
+
+        if (!(bo & 0x04)) {
+            e.dec_mem(ofs_spr(SPR::CTR));
+            not_taken[0] = e.jcc32((bo & 0x02) ? CC_NE : CC_E);
+        }
+        if (!(bo & 0x10)) {
+            if (bi < 4)
+                e.sync_cr0();
+            e.test_mem(OFS_CR, 0x80000000UL >> bi);
+            not_taken[1] = e.jcc32((bo & 0x08) ? CC_E : CC_NE);
+        }
+    }
+
+    // links only exist within a page
+    int32_t target = int32_t(blk->phys_addr & ~PPC_PAGE_MASK) + pc_ofs + disp;
+    if (target >= 0 && target < int32_t(PPC_PAGE_SIZE))
+        e.chain(blk, 1, uint32_t(target), disp <= 0 && uint32_t(-disp) < PPC_IDLE_MAX_INSNS * 4);
+
+    e.lea_pc(pc_ofs + disp);
+    e.store(EAX, ofs_nia);
+    e.store_imm(ofs_exec_flags, EXEF_BRANCH);
+    e.mov_imm(EAX, blk->num_insns);
+    exits.push_back(e.jmp32());
+
+    for (auto loc : not_taken)
+        if (loc)
+            e.patch(loc, e.p);
+
+    return true;
+}
+
+/** Emit host code for blk. */
+static void emit_block(Emitter& e, const PPCDecodedBlock* blk) {
+    std::vector<uint8_t*> exits;
+    uint32_t pending = 0; // instructions not yet added to g_icycles
+    uint32_t last    = blk->num_insns - 1;
+
+    e.prologue();
+
+    for (uint32_t i = 0; i <= last; i++) {
+        uint32_t opcode = blk->insns[i].opcode;
+
+        if (i == last && emit_branch(e, blk, i, pending, exits)) {
+            pending = 0;
+            break;
+        }
+
+        if (emit_inline(e, opcode)) {
+            pending++;
+            if (i == last) {
+                e.flush_gprs();
+                e.add_mem64(ofs_icycles, uint8_t(pending));
+                pending = 0;
+            }
+            continue;
+        }
+
+        // interpreter fallback, instructions retired so far must be
+        // accounted for in case the handler raises an exception or reads
+        // the time
+        e.flush_gprs_for_call();
+        if (pending)
+            e.add_mem64(ofs_icycles, uint8_t(pending));
+        pending = 0;
+        e.lea_pc(i * 4);
+        e.store(EAX, OFS_PC);
+        e.store(EAX, ofs_cycles_pc);
+        e.call_handler(blk->insns[i].handler, opcode);
+        e.add_mem64(ofs_icycles, 1);
+        e.mov_imm(EAX, i + 1);
+        e.cmp_mem_zero(ofs_exec_flags);
+        exits.push_back(e.jcc32(CC_NE));
+    }
+
+    // the block ran to its end without branching
+    uint32_t next_offset = (blk->phys_addr & ~PPC_PAGE_MASK) + blk->num_insns * 4;
+    if (next_offset < PPC_PAGE_SIZE)
+        e.chain(blk, 0, next_offset, false);
+    e.mov_imm(EAX, blk->num_insns);
+
+    for (auto loc : exits)
+        e.patch(loc, e.p);
+    e.epilogue();
+}
+
+/** Translate blk into the writable part of the code buffer. */
+static void jit_compile_block(PPCDecodedBlock* blk) {
+    // the first pass only counts GPR accesses to pick the cached registers
+    Emitter count(scratch_buf);
+    emit_block(count, blk);
+
+    Emitter e(code_buf + code_used);
+    e.alloc_gprs(count.gpr_uses);
+    emit_block(e, blk);
+
+    code_used += uint32_t(e.p - e.start);
+    code_used  = (code_used + 15) & ~15;
+
+    blk->jit_code = reinterpret_cast<PPCJitCode>(e.start);
+}
+
+void ppc_jit_enqueue(PPCDecodedBlock* blk) {
+    // queued blocks don't survive a cache flush
+    if (queue_gen != ppc_block_generation)
+        queue_len = 0;
+    queue_gen = ppc_block_generation;
+
+    queue[queue_len++] = blk;
+    if (queue_len == JIT_QUEUE_SIZE)
+        ppc_jit_compile_pending();
+}
+
+void ppc_jit_compile_pending() {
+    uint32_t num_blocks = queue_len;
+
+    if (!num_blocks)
+        return;
+    queue_len = 0;
+
+    if (queue_gen != ppc_block_generation)
+        return;
+
+    if (!code_buf) {
+        if (!jit_ok || !(jit_ok = jit_init()))
+            return;
+    }
+
+    uint32_t max_size = num_blocks * JIT_MAX_BLOCK_CODE;
+    if (code_used + max_size > JIT_BUFFER_SIZE) {
+        // make room by starting over, the blocks stay usable in interpreted form
+        ppc_block_cache_flush();
+        return;
+    }
+
+    uint8_t* start = code_buf + code_used;
+    jit_set_writable(start, max_size, true);
+
+    for (uint32_t i = 0; i < num_blocks; i++)
+        if (!queue[i]->jit_code)
+            jit_compile_block(queue[i]);
+
+    jit_set_writable(start, max_size, false);
+}
+
+void ppc_jit_flush() {
+    code_used = 0;
+    queue_len = 0;
+}
+
+#else
+
+void ppc_jit_enqueue(PPCDecodedBlock* blk) {
+}
+
+void ppc_jit_compile_pending() {
+}
+
+void ppc_jit_flush() {
+}
+
+#endif
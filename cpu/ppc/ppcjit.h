@@ -0,0 +1,68 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Block translator from PowerPC to x86-64 host code.
+
+    Predecoded blocks that were entered PPC_JIT_THRESHOLD times are
+    translated into host functions. Simple integer instructions and
+    relative branches are emitted inline and operate on the guest state
+    directly, keeping the GPRs a block uses most in host registers.
+    Everything else calls the interpreter handler of that instruction,
+    so privileged, floating-point and memory instructions behave exactly
+    as in the interpreter.
+
+    Translated code returns to the dispatcher after any handler that set
+    exec_flags. At the end of a block it jumps straight to the translated
+    successor recorded in the block links, as long as that block can run
+    to its end within the cycle limit passed in PPCJitState, doesn't contain
+    the goal address and no timer processing was requested. Short backward
+    branches only do so while the idle loop check of the block is backed
+    off, see ppc_idle_skip_block().
+
+    Hot blocks are queued and translated in batches. The code buffer is
+    never writable and executable at the same time: it is made writable
+    once per batch while the queued blocks are emitted.
+
+    On hosts other than x86-64 with the System V ABI no code is generated
+    and the jit execution mode runs the threaded interpreter.
+ */
+
+#ifndef PPC_JIT_H
+#define PPC_JIT_H
+
+#include "ppcblockcache.h"
+
+#include <cinttypes>
+
+/** Number of entries after which a block is translated. */
+constexpr uint32_t PPC_JIT_THRESHOLD = 32;
+
+/** Queue a hot block for translation. */
+extern void ppc_jit_enqueue(PPCDecodedBlock* blk);
+
+/** Translate the queued blocks. Blocks whose translation fails keep
+    blk->jit_code unset. */
+extern void ppc_jit_compile_pending();
+
+/** Drop all translated code, called when the block cache is flushed. */
+extern void ppc_jit_flush();
+
+#endif // PPC_JIT_H
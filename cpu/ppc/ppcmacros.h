@@ -210,4 +210,25 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
         double val_reg_b = GET_FPR(reg_b); \
         double val_reg_c = GET_FPR(reg_c);
 
+#define ppc_grab_regsvdab(opcode) \
+        int reg_d = (opcode >> 21) & 31; \
+        int reg_a = (opcode >> 16) & 31; \
+        int reg_b = (opcode >> 11) & 31; \
+        [[maybe_unused]] const VR_storage& vr_a = ppc_state.vr[reg_a]; \
+        [[maybe_unused]] const VR_storage& vr_b = ppc_state.vr[reg_b];
+
+#define ppc_grab_regsvdabc(opcode) \
+        int reg_d = (opcode >> 21) & 31; \
+        int reg_a = (opcode >> 16) & 31; \
+        int reg_b = (opcode >> 11) & 31; \
+        int reg_c = (opcode >> 6) & 31; \
+        [[maybe_unused]] const VR_storage& vr_a = ppc_state.vr[reg_a]; \
+        [[maybe_unused]] const VR_storage& vr_b = ppc_state.vr[reg_b]; \
+        [[maybe_unused]] const VR_storage& vr_c = ppc_state.vr[reg_c];
+
+#define ppc_grab_regsvdb(opcode) \
+        int reg_d = (opcode >> 21) & 31; \
+        int reg_b = (opcode >> 11) & 31; \
+        [[maybe_unused]] const VR_storage& vr_b = ppc_state.vr[reg_b];
+
 #endif    // PPC_MACROS_H
@@ -24,11 +24,15 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/memctrl/memctrlbase.h>
 #include <devices/common/mmiodevice.h>
 #include <memaccess.h>
+#include "ppcblockcache.h"
 #include "ppcemu.h"
+#include "ppcfastmem.h"
 #include "ppcmmu.h"
 
+#include <algorithm>
 #include <array>
 #include <cinttypes>
+#include <cstring>
 #include <loguru.hpp>
 #include <stdexcept>
 
@@ -55,6 +59,7 @@ uint64_t    dmem_writes_total  = 0; // counts writes to data memory
 uint64_t    iomem_writes_total = 0; // counts I/O memory writes
 uint64_t    exec_reads_total   = 0; // counts reads from executable memory
 uint64_t    bat_transl_total   = 0; // counts BAT translations
+uint64_t    bat_lut_rebuilds   = 0; // counts BAT lookup table rebuilds
 uint64_t    ptab_transl_total  = 0; // counts page table translations
 uint64_t    unaligned_reads    = 0; // counts unaligned reads
 uint64_t    unaligned_writes   = 0; // counts unaligned writes
@@ -73,6 +78,8 @@ uint64_t    num_primary_dtlb_hits   = 0; // number of hits in the primary DTLB
 uint64_t    num_secondary_dtlb_hits = 0; // number of hits in the secondary DTLB
 uint64_t    num_dtlb_refills        = 0; // number of DTLB refills
 uint64_t    num_entry_replacements  = 0; // number of entry replacements
+uint64_t    num_pte_cache_hits      = 0; // number of PTEs found in the PTE cache
+uint64_t    num_pteg_searches       = 0; // number of page table searches
 
 #endif // TLB_PROFILING
 
@@ -85,6 +92,55 @@ AddressMapEntry last_ptab_area;
 /** Dummy pages for catching writes to physical read-only pages */
 static std::array<uint64_t, 8192 / sizeof(uint64_t)> dummy_page;
 
+/** BAT lookup tables with an entry for every 128 KB block of the logical
+    address space, the smallest BAT block size. The low nibble of an entry
+    holds the number (1-4) of the BAT pair mapping the block in supervisor
+    mode, the high nibble the one for user mode, zero meaning no BAT does.
+    MPC601 keeps its unified BATs in the IBAT table. */
+constexpr uint32_t BAT_BLOCK_BITS = 17;
+
+typedef std::array<uint8_t, 1 << (32 - BAT_BLOCK_BITS)> BATLookupTable;
+
+static BATLookupTable ibat_lut;
+static BATLookupTable dbat_lut;
+
+static void bat_lut_rebuild(BATLookupTable& lut, const PPC_BAT_entry* bat_array, bool is_601)
+{
+#ifdef MMU_PROFILING
+    bat_lut_rebuilds++;
+#endif
+
+    lut.fill(0);
+
+    // lower numbered BATs take precedence so they're filled in last
+    for (int bat_index = 3; bat_index >= 0; bat_index--) {
+        const PPC_BAT_entry& bat_entry = bat_array[bat_index];
+        uint8_t modes;
+
+        if (is_601) {
+            modes = bat_entry.valid ? 0x11 : 0;
+        } else {
+            // Vs - supervisor, Vp - problem/user mode
+            modes = ((bat_entry.access & 2) ? 0x01 : 0) | ((bat_entry.access & 1) ? 0x10 : 0);
+        }
+        if (!modes)
+            continue;
+
+        const uint8_t  keep = ~(modes * 0xF);
+        const uint8_t  sel  = modes * (bat_index + 1);
+        const uint32_t base = bat_entry.bepi >> BAT_BLOCK_BITS;
+        const uint32_t free = ~bat_entry.hi_mask >> BAT_BLOCK_BITS;
+
+        // visit all blocks matching BEPI under the mask, BL doesn't have
+        // to be contiguous
+        uint32_t sub = 0;
+        do {
+            lut[base | sub] = (lut[base | sub] & keep) | sel;
+            sub = (sub - free) & free;
+        } while (sub);
+    }
+}
+
 /** 601-style block address translation. */
 static BATResult mpc601_block_address_translation(uint32_t la)
 {
@@ -92,7 +148,6 @@ static BATResult mpc601_block_address_translation(uint32_t la)
     uint8_t  prot;  // protection bits for the translated address
     unsigned key;
 
-    bool bat_hit    = false;
     unsigned msr_pr = !!(ppc_state.msr & MSR::PR);
 
     // I/O controller interface takes precedence over BAT in 601
@@ -101,68 +156,50 @@ static BATResult mpc601_block_address_translation(uint32_t la)
         return BATResult{false, 0, 0};
     }
 
-    for (int bat_index = 0; bat_index < 4; bat_index++) {
-        PPC_BAT_entry* bat_entry = &ibat_array[bat_index];
+    unsigned bat_num = ibat_lut[la >> BAT_BLOCK_BITS] & 0xF;
+    if (!bat_num)
+        return BATResult{false, 0, 0};
 
-        if (bat_entry->valid && ((la & bat_entry->hi_mask) == bat_entry->bepi)) {
-            bat_hit = true;
+    const PPC_BAT_entry* bat_entry = &ibat_array[bat_num - 1];
 
-            key = (((bat_entry->access & 1) & msr_pr) |
-                  (((bat_entry->access >> 1) & 1) & (msr_pr ^ 1)));
+    key = (((bat_entry->access & 1) & msr_pr) |
+          (((bat_entry->access >> 1) & 1) & (msr_pr ^ 1)));
 
-            // remapping BAT access from 601-style to PowerPC-style
-            static uint8_t access_conv[8] = {2, 2, 2, 1, 0, 1, 2, 1};
+    // remapping BAT access from 601-style to PowerPC-style
+    static uint8_t access_conv[8] = {2, 2, 2, 1, 0, 1, 2, 1};
 
-            prot = access_conv[(key << 2) | bat_entry->prot];
+    prot = access_conv[(key << 2) | bat_entry->prot];
 
 #ifdef MMU_PROFILING
-            bat_transl_total++;
+    bat_transl_total++;
 #endif
 
-            // logical to physical translation
-            pa = bat_entry->phys_hi | (la & ~bat_entry->hi_mask);
-            return BATResult{bat_hit, prot, pa};
-        }
-    }
-
-    return BATResult{bat_hit, 0, 0};
+    // logical to physical translation
+    pa = bat_entry->phys_hi | (la & ~bat_entry->hi_mask);
+    return BATResult{true, prot, pa};
 }
 
 /** PowerPC-style block address translation. */
 template <const BATType type>
 static BATResult ppc_block_address_translation(uint32_t la)
 {
-    uint32_t pa = 0;    // translated physical address
-    uint8_t  prot = 0;  // protection bits for the translated address
-    PPC_BAT_entry *bat_array;
-
-    bool bat_hit    = false;
-    unsigned msr_pr = (ppc_state.msr & MSR::PR) != 0;
+    const BATLookupTable& lut = (type == BATType::IBAT) ? ibat_lut : dbat_lut;
+    const PPC_BAT_entry* bat_array = (type == BATType::IBAT) ? ibat_array : dbat_array;
 
-    bat_array = (type == BATType::IBAT) ? ibat_array : dbat_array;
+    unsigned msr_pr  = (ppc_state.msr & MSR::PR) != 0;
+    unsigned bat_num = (lut[la >> BAT_BLOCK_BITS] >> (msr_pr * 4)) & 0xF;
 
-    // Format: %XY
-    // X - supervisor access bit, Y - problem/user access bit
-    // Those bits are mutually exclusive
-    unsigned access_bits = ((!msr_pr) << 1) | msr_pr;
-
-    for (int bat_index = 0; bat_index < 4; bat_index++) {
-        PPC_BAT_entry* bat_entry = &bat_array[bat_index];
+    if (!bat_num)
+        return BATResult{false, 0, 0};
 
-        if ((bat_entry->access & access_bits) != 0 && ((la & bat_entry->hi_mask) == bat_entry->bepi)) {
-            bat_hit = true;
+    const PPC_BAT_entry* bat_entry = &bat_array[bat_num - 1];
 
 #ifdef MMU_PROFILING
-            bat_transl_total++;
+    bat_transl_total++;
 #endif
-            // logical to physical translation
-            pa = bat_entry->phys_hi | (la & ~bat_entry->hi_mask);
-            prot = bat_entry->prot;
-            break;
-        }
-    }
 
-    return BATResult{bat_hit, prot, pa};
+    // logical to physical translation
+    return BATResult{true, bat_entry->prot, bat_entry->phys_hi | (la & ~bat_entry->hi_mask)};
 }
 
 static inline uint8_t* calc_pteg_addr(uint32_t hash)
@@ -227,6 +264,73 @@ static bool search_pteg(uint8_t* pteg_addr, uint8_t** ret_pte_addr, uint32_t vsi
     return false;
 }
 
+/** Shadow PTE cache.
+    Remembers where in the page table the PTE for a (VSID, page index) pair
+    was found so that secondary TLB misses don't need to hash and scan both
+    PTEGs again. Entries are indexed by the page index only so that tlbie,
+    which doesn't specify a VSID, can invalidate them precisely. The PTE is
+    re-read from guest memory on each hit and the entry is only used if the
+    PTE still matches, so guest updates of the page table are picked up
+    without snooping stores. */
+constexpr uint32_t PTE_CACHE_SETS = 16384;
+constexpr uint32_t PTE_CACHE_WAYS = 4;
+
+typedef struct PTECacheEntry {
+    uint32_t pte_word1;  // expected first PTE word, 0 if the entry is free
+    uint32_t page_index;
+    uint8_t* pte_addr;   // host address of the PTE
+} PTECacheEntry;
+
+static std::array<PTECacheEntry, PTE_CACHE_SETS * PTE_CACHE_WAYS> pte_cache;
+
+static inline PTECacheEntry* pte_cache_set(uint32_t page_index)
+{
+    return &pte_cache[(page_index & (PTE_CACHE_SETS - 1)) * PTE_CACHE_WAYS];
+}
+
+static inline uint8_t* pte_cache_lookup(uint32_t vsid, uint32_t page_index)
+{
+    // matching PTE word 1 regardless of the hash function (H) bit
+    uint32_t pte_check = 0x80000000 | (vsid << 7) | (page_index >> 10);
+
+    PTECacheEntry* set = pte_cache_set(page_index);
+    for (int way = 0; way < PTE_CACHE_WAYS; way++) {
+        PTECacheEntry& entry = set[way];
+        if ((entry.pte_word1 & ~0x40U) == pte_check && entry.page_index == page_index) {
+            if (READ_DWORD_BE_A(entry.pte_addr) == entry.pte_word1)
+                return entry.pte_addr;
+            entry.pte_word1 = 0; // PTE has been modified or moved
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+static inline void pte_cache_insert(uint32_t page_index, uint8_t* pte_addr)
+{
+    // keep the most recently inserted entry in way 0
+    PTECacheEntry* set = pte_cache_set(page_index);
+    for (int way = PTE_CACHE_WAYS - 1; way > 0; way--)
+        set[way] = set[way - 1];
+    set[0] = {READ_DWORD_BE_A(pte_addr), page_index, pte_addr};
+}
+
+void pte_cache_flush_entry(uint32_t ea)
+{
+    uint32_t page_index = (ea >> 12) & 0xFFFF;
+
+    PTECacheEntry* set = pte_cache_set(page_index);
+    for (int way = 0; way < PTE_CACHE_WAYS; way++) {
+        if (set[way].page_index == page_index)
+            set[way].pte_word1 = 0;
+    }
+}
+
+void pte_cache_flush()
+{
+    pte_cache.fill({});
+}
+
 static PATResult page_address_translation(uint32_t la, bool is_instr_fetch,
                                           unsigned msr_pr, int is_write)
 {
@@ -251,22 +355,35 @@ static PATResult page_address_translation(uint32_t la, bool is_instr_fetch,
     /* instruction fetch from a no-execute segment will cause ISI exception */
     if ((sr_val & 0x10000000) && is_instr_fetch) {
         mmu_exception_handler(Except_Type::EXC_ISI, 0x10000000);
+        return PATResult{0, 0, 0, true};
     }
 
     page_index = (la >> 12) & 0xFFFF;
     pteg_hash1 = (sr_val & 0x7FFFF) ^ page_index;
     vsid       = sr_val & 0x0FFFFFF;
 
-    if (!search_pteg(calc_pteg_addr(pteg_hash1), &pte_addr, vsid, page_index, 0)) {
-        if (!search_pteg(calc_pteg_addr(~pteg_hash1), &pte_addr, vsid, page_index, 1)) {
-            if (is_instr_fetch) {
-                mmu_exception_handler(Except_Type::EXC_ISI, 0x40000000);
-            } else {
-                ppc_state.spr[SPR::DSISR] = 0x40000000 | (is_write << 25);
-                ppc_state.spr[SPR::DAR]   = la;
-                mmu_exception_handler(Except_Type::EXC_DSI, 0);
+    pte_addr = pte_cache_lookup(vsid, page_index);
+    if (pte_addr) {
+#ifdef TLB_PROFILING
+        num_pte_cache_hits++;
+#endif
+    } else {
+#ifdef TLB_PROFILING
+        num_pteg_searches++;
+#endif
+        if (!search_pteg(calc_pteg_addr(pteg_hash1), &pte_addr, vsid, page_index, 0)) {
+            if (!search_pteg(calc_pteg_addr(~pteg_hash1), &pte_addr, vsid, page_index, 1)) {
+                if (is_instr_fetch) {
+                    mmu_exception_handler(Except_Type::EXC_ISI, 0x40000000);
+                } else {
+                    ppc_state.spr[SPR::DSISR] = 0x40000000 | (is_write << 25);
+                    ppc_state.spr[SPR::DAR]   = la;
+                    mmu_exception_handler(Except_Type::EXC_DSI, 0);
+                }
+                return PATResult{0, 0, 0, true};
             }
         }
+        pte_cache_insert(page_index, pte_addr);
     }
 
     pte_word2 = READ_DWORD_BE_A(pte_addr + 4);
@@ -288,6 +405,7 @@ static PATResult page_address_translation(uint32_t la, bool is_instr_fetch,
             ppc_state.spr[SPR::DAR]   = la;
             mmu_exception_handler(Except_Type::EXC_DSI, 0);
         }
+        return PATResult{0, 0, 0, true};
     }
 
     /* update R and C bits */
@@ -379,25 +497,33 @@ MapDmaResult mmu_map_dma_mem(uint32_t addr, uint32_t size, bool allow_mmio) {
     return MapDmaResult{cur_dma_rgn->type, is_writable, host_va, devobj, dev_base};
 }
 
+// TLBs of all MMU modes, ITLBs first, then DTLBs.
+// Pooled so that secondary entries can be numbered.
+constexpr uint32_t TLB_NUM_TABLES = 6;
+constexpr uint32_t TLB2_POOL_SIZE = TLB_NUM_TABLES * TLB_SIZE * TLB2_WAYS;
+
+static std::array<std::array<TLBEntry, TLB_SIZE>, TLB_NUM_TABLES>           tlb1_pool;
+static std::array<std::array<TLBEntry, TLB_SIZE*TLB2_WAYS>, TLB_NUM_TABLES> tlb2_pool;
+
 // primary ITLB for all MMU modes
-static std::array<TLBEntry, TLB_SIZE> itlb1_mode1;
-static std::array<TLBEntry, TLB_SIZE> itlb1_mode2;
-static std::array<TLBEntry, TLB_SIZE> itlb1_mode3;
+static auto& itlb1_mode1 = tlb1_pool[0];
+static auto& itlb1_mode2 = tlb1_pool[1];
+static auto& itlb1_mode3 = tlb1_pool[2];
 
 // secondary ITLB for all MMU modes
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> itlb2_mode1;
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> itlb2_mode2;
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> itlb2_mode3;
+static auto& itlb2_mode1 = tlb2_pool[0];
+static auto& itlb2_mode2 = tlb2_pool[1];
+static auto& itlb2_mode3 = tlb2_pool[2];
 
 // primary DTLB for all MMU modes
-static std::array<TLBEntry, TLB_SIZE> dtlb1_mode1;
-static std::array<TLBEntry, TLB_SIZE> dtlb1_mode2;
-static std::array<TLBEntry, TLB_SIZE> dtlb1_mode3;
+static auto& dtlb1_mode1 = tlb1_pool[3];
+static auto& dtlb1_mode2 = tlb1_pool[4];
+static auto& dtlb1_mode3 = tlb1_pool[5];
 
 // secondary DTLB for all MMU modes
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> dtlb2_mode1;
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> dtlb2_mode2;
-static std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> dtlb2_mode3;
+static auto& dtlb2_mode1 = tlb2_pool[3];
+static auto& dtlb2_mode2 = tlb2_pool[4];
+static auto& dtlb2_mode3 = tlb2_pool[5];
 
 TLBEntry *pCurITLB1; // current primary ITLB
 TLBEntry *pCurITLB2; // current secondary ITLB
@@ -406,6 +532,103 @@ TLBEntry *pCurDTLB2; // current secondary DTLB
 
 uint32_t tlb_size_mask = TLB_SIZE - 1;
 
+/** TLB generations.
+
+    Flushing BAT or PAT derived translations doesn't walk the TLB arrays.
+    It bumps the generation of the affected translation source instead.
+    Secondary TLB entries remember the generation they were created in
+    and are treated as invalid on lookup once it has moved on.
+
+    Primary TLB tags carry the epoch of their TLB in the page offset bits.
+    Advancing the epoch makes all primary entries miss so they will be
+    revalidated against the secondary TLB on next access.
+ */
+typedef struct TLBGens {
+    uint32_t src[4];    // generation per translation source, see tlb_src()
+    uint32_t epoch;     // primary TLB epoch, never reaches TLB_EPOCH_LIMIT
+} TLBGens;
+
+// must be below the page offset bits of TLB_INVALID_TAG
+constexpr uint32_t TLB_EPOCH_LIMIT = 0xFFF;
+
+static TLBGens itlb_gens;
+static TLBGens dtlb_gens;
+
+// translation source of a TLB entry: 0 - none (real addressing), 1 - BAT, 2 - PAT
+static inline uint32_t tlb_src(uint16_t flags) {
+    return (flags / TLBFlags::TLBE_FROM_BAT) & 3;
+}
+
+template <const TLBType tlb_type>
+static inline bool tlb2_entry_valid(const TLBEntry& tlb_entry) {
+    const TLBGens& gens = (tlb_type == TLBType::ITLB) ? itlb_gens : dtlb_gens;
+    return tlb_entry.gen == gens.src[tlb_src(tlb_entry.flags)];
+}
+
+template <const TLBType tlb_type>
+static inline bool tlb2_entry_free(const TLBEntry& tlb_entry) {
+    return tlb_entry.tag == TLB_INVALID_TAG || !tlb2_entry_valid<tlb_type>(tlb_entry);
+}
+
+template <const TLBType tlb_type>
+static inline uint32_t tlb1_tag(uint32_t tag) {
+    return tag | ((tlb_type == TLBType::ITLB) ? itlb_gens.epoch : dtlb_gens.epoch);
+}
+
+/** Reverse index of the secondary TLBs by physical address.
+
+    Each refill moves the secondary TLB entry to the list of the physical
+    megabyte it maps so that a change of the physical map only has to look
+    at the entries of the affected lists. The lists are doubly linked through
+    the numbers of the entries in tlb2_pool, their heads follow the entries.
+    Unlinked nodes point to themselves.
+
+    Primary entries are copies of secondary ones and are dropped together
+    with them, which includes evicting a secondary entry.
+ */
+constexpr uint32_t TLB_INDEX_SHIFT   = 20;
+constexpr uint32_t TLB_INDEX_BUCKETS = 1 << (32 - TLB_INDEX_SHIFT);
+
+static uint32_t tlb_index_next[TLB2_POOL_SIZE + TLB_INDEX_BUCKETS];
+static uint32_t tlb_index_prev[TLB2_POOL_SIZE + TLB_INDEX_BUCKETS];
+
+static void tlb_index_init()
+{
+    for (uint32_t node = 0; node < TLB2_POOL_SIZE + TLB_INDEX_BUCKETS; node++) {
+        tlb_index_next[node] = node;
+        tlb_index_prev[node] = node;
+    }
+}
+
+static inline void tlb_index_unlink(uint32_t node)
+{
+    tlb_index_next[tlb_index_prev[node]] = tlb_index_next[node];
+    tlb_index_prev[tlb_index_next[node]] = tlb_index_prev[node];
+    tlb_index_next[node] = node;
+    tlb_index_prev[node] = node;
+}
+
+static inline void tlb_index_add(TLBEntry* tlb_entry)
+{
+    const uint32_t node = uint32_t(tlb_entry - &tlb2_pool[0][0]);
+    const uint32_t head = TLB2_POOL_SIZE + (tlb_entry->phys_tag >> TLB_INDEX_SHIFT);
+
+    tlb_index_unlink(node);
+
+    tlb_index_next[node] = tlb_index_next[head];
+    tlb_index_prev[node] = head;
+    tlb_index_prev[tlb_index_next[head]] = node;
+    tlb_index_next[head] = node;
+}
+
+// drop the primary entry copied from the secondary entry at the given set
+static inline void tlb1_drop_copy(TLBEntry* tlb1, uint32_t set, uint32_t tag)
+{
+    TLBEntry* tlb_entry = &tlb1[set];
+    if ((tlb_entry->tag & ~0xFFFUL) == tag)
+        tlb_entry->tag = TLB_INVALID_TAG;
+}
+
 // fake TLB entry for handling of unmapped memory accesses
 uint64_t    UnmappedVal = -1ULL;
 TLBEntry    UnmappedMem = {TLB_INVALID_TAG, TLBFlags::PAGE_NOPHYS, 0, {{0}}};
@@ -461,6 +684,7 @@ void mmu_change_mode()
                 break;
         }
         CurDTLBMode = mmu_mode;
+        fastmem_select(mmu_mode);
     }
 }
 
@@ -475,29 +699,29 @@ static TLBEntry* tlb2_target_entry(uint32_t gp_va)
         tlb_entry = &pCurDTLB2[((gp_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask) * TLB2_WAYS];
     }
 
-    // select the target from invalid blocks first
-    if (tlb_entry[0].tag == TLB_INVALID_TAG) {
+    // select the target from invalid or stale blocks first
+    if (tlb2_entry_free<tlb_type>(tlb_entry[0])) {
         // update LRU bits
         tlb_entry[0].lru_bits  = 0x3;
         tlb_entry[1].lru_bits  = 0x2;
         tlb_entry[2].lru_bits &= 0x1;
         tlb_entry[3].lru_bits &= 0x1;
         return tlb_entry;
-    } else if (tlb_entry[1].tag == TLB_INVALID_TAG) {
+    } else if (tlb2_entry_free<tlb_type>(tlb_entry[1])) {
         // update LRU bits
         tlb_entry[0].lru_bits  = 0x2;
         tlb_entry[1].lru_bits  = 0x3;
         tlb_entry[2].lru_bits &= 0x1;
         tlb_entry[3].lru_bits &= 0x1;
         return &tlb_entry[1];
-    } else if (tlb_entry[2].tag == TLB_INVALID_TAG) {
+    } else if (tlb2_entry_free<tlb_type>(tlb_entry[2])) {
         // update LRU bits
         tlb_entry[0].lru_bits &= 0x1;
         tlb_entry[1].lru_bits &= 0x1;
         tlb_entry[2].lru_bits  = 0x3;
         tlb_entry[3].lru_bits  = 0x2;
         return &tlb_entry[2];
-    } else if (tlb_entry[3].tag == TLB_INVALID_TAG) {
+    } else if (tlb2_entry_free<tlb_type>(tlb_entry[3])) {
         // update LRU bits
         tlb_entry[0].lru_bits &= 0x1;
         tlb_entry[1].lru_bits &= 0x1;
@@ -508,35 +732,40 @@ static TLBEntry* tlb2_target_entry(uint32_t gp_va)
 #ifdef TLB_PROFILING
         num_entry_replacements++;
 #endif
+        TLBEntry* victim;
         if (tlb_entry[0].lru_bits == 0) {
             // update LRU bits
             tlb_entry[0].lru_bits  = 0x3;
             tlb_entry[1].lru_bits  = 0x2;
             tlb_entry[2].lru_bits &= 0x1;
             tlb_entry[3].lru_bits &= 0x1;
-            return tlb_entry;
+            victim = tlb_entry;
         } else if (tlb_entry[1].lru_bits == 0) {
             // update LRU bits
             tlb_entry[0].lru_bits  = 0x2;
             tlb_entry[1].lru_bits  = 0x3;
             tlb_entry[2].lru_bits &= 0x1;
             tlb_entry[3].lru_bits &= 0x1;
-            return &tlb_entry[1];
+            victim = &tlb_entry[1];
         } else if (tlb_entry[2].lru_bits == 0) {
             // update LRU bits
             tlb_entry[0].lru_bits &= 0x1;
             tlb_entry[1].lru_bits &= 0x1;
             tlb_entry[2].lru_bits  = 0x3;
             tlb_entry[3].lru_bits  = 0x2;
-            return &tlb_entry[2];
+            victim = &tlb_entry[2];
         } else {
             // update LRU bits
             tlb_entry[0].lru_bits &= 0x1;
             tlb_entry[1].lru_bits &= 0x1;
             tlb_entry[2].lru_bits  = 0x2;
             tlb_entry[3].lru_bits  = 0x3;
-            return &tlb_entry[3];
+            victim = &tlb_entry[3];
         }
+        // the primary TLB may still hold a copy of the evicted entry
+        tlb1_drop_copy((tlb_type == TLBType::ITLB) ? pCurITLB1 : pCurDTLB1,
+                       (gp_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask, victim->tag);
+        return victim;
     }
 }
 
@@ -560,12 +789,15 @@ static TLBEntry* itlb2_refill(uint32_t guest_va)
             // only PP = 0 (no access) causes ISI exception
             if (!bat_res.prot) {
                 mmu_exception_handler(Except_Type::EXC_ISI, 0x08000000);
+                return nullptr;
             }
             phys_addr = bat_res.phys;
             flags |= TLBFlags::TLBE_FROM_BAT; // tell the world we come from
         } else {
             // page address translation
             PATResult pat_res = page_address_translation(guest_va, true, !!(ppc_state.msr & MSR::PR), 0);
+            if (pat_res.fault)
+                return nullptr;
             phys_addr = pat_res.phys;
             flags = TLBFlags::TLBE_FROM_PAT; // tell the world we come from
         }
@@ -587,6 +819,8 @@ static TLBEntry* itlb2_refill(uint32_t guest_va)
         tlb_entry->host_va_offs_r = (int64_t)rgn_desc->mem_ptr - guest_va +
                                     (phys_addr - rgn_desc->start);
         tlb_entry->phys_tag = phys_addr & ~0xFFFUL;
+        tlb_entry->gen = itlb_gens.src[tlb_src(flags)];
+        tlb_index_add(tlb_entry);
     } else {
         ABORT_F("Instruction fetch from unmapped memory at 0x%08X!\n", phys_addr);
     }
@@ -594,6 +828,50 @@ static TLBEntry* itlb2_refill(uint32_t guest_va)
     return tlb_entry;
 }
 
+// one bit per physical page of directly accessed device memory, set by stores
+static uint64_t dev_mem_dirty_map[(1ULL << (32 - PPC_PAGE_SIZE_BITS)) / 64];
+
+static inline void dev_mem_mark_dirty(uint32_t phys_tag)
+{
+    const uint32_t page = phys_tag >> PPC_PAGE_SIZE_BITS;
+    dev_mem_dirty_map[page >> 6] |= 1ULL << (page & 63);
+}
+
+/** Check whether any page in the given physical range has been written
+    through a direct device page since the last call and forget about it. */
+bool mmu_dev_mem_dirty(uint32_t phys_addr, uint32_t size)
+{
+    uint64_t dirty = 0;
+
+    if (!size)
+        return false;
+
+    uint32_t first = phys_addr >> PPC_PAGE_SIZE_BITS;
+    uint32_t last  = (phys_addr + size - 1) >> PPC_PAGE_SIZE_BITS;
+
+    for (uint32_t page = first; page <= last; page = (page | 63) + 1) {
+        uint64_t mask = ~0ULL << (page & 63);
+        if ((last >> 6) == (page >> 6))
+            mask &= ~0ULL >> (63 - (last & 63));
+        dirty |= dev_mem_dirty_map[page >> 6] & mask;
+        dev_mem_dirty_map[page >> 6] &= ~mask;
+    }
+
+    return dirty != 0;
+}
+
+// host memory of an MMIO page the device lets us access directly, if any
+static inline uint8_t* dev_mem_page(const AddressMapEntry* rgn_desc, uint32_t phys_addr)
+{
+    const uint32_t page = phys_addr & PPC_PAGE_MASK;
+
+    if (!rgn_desc->devobj || (rgn_desc->start & ~PPC_PAGE_MASK) ||
+        page + (PPC_PAGE_SIZE - 1) > rgn_desc->end)
+        return nullptr;
+
+    return rgn_desc->devobj->get_direct_page(rgn_desc->start, page - rgn_desc->start);
+}
+
 static TLBEntry* dtlb2_refill(uint32_t guest_va, int is_write, bool is_dbg = false)
 {
     BATResult bat_res;
@@ -621,6 +899,7 @@ static TLBEntry* dtlb2_refill(uint32_t guest_va, int is_write, bool is_dbg = fal
                 ppc_state.spr[SPR::DSISR] = 0x08000000 | (is_write << 25);
                 ppc_state.spr[SPR::DAR]   = guest_va;
                 mmu_exception_handler(Except_Type::EXC_DSI, 0);
+                return nullptr;
             }
             phys_addr = bat_res.phys;
             flags = TLBFlags::PTE_SET_C; // prevent PTE.C updates for BAT
@@ -631,6 +910,8 @@ static TLBEntry* dtlb2_refill(uint32_t guest_va, int is_write, bool is_dbg = fal
         } else {
             // page address translation
             PATResult pat_res = page_address_translation(guest_va, false, !!(ppc_state.msr & MSR::PR), is_write);
+            if (pat_res.fault)
+                return nullptr;
             phys_addr = pat_res.phys;
             flags = TLBFlags::TLBE_FROM_PAT; // tell the world we come from
             if (pat_res.prot <= 2 || pat_res.prot == 6) {
@@ -654,7 +935,12 @@ static TLBEntry* dtlb2_refill(uint32_t guest_va, int is_write, bool is_dbg = fal
         // refill the secondary TLB
         tlb_entry = tlb2_target_entry<TLBType::DTLB>(tag);
         tlb_entry->tag = tag;
-        if (rgn_desc->type & RT_MMIO) { // MMIO region
+        uint8_t* dev_page = (rgn_desc->type & RT_MMIO) ? dev_mem_page(rgn_desc, phys_addr) : nullptr;
+        if (dev_page) { // device memory accessed like RAM
+            tlb_entry->flags = flags | TLBFlags::PAGE_MEM | TLBFlags::PAGE_DEV_MEM;
+            tlb_entry->host_va_offs_r = (int64_t)dev_page - tag;
+            tlb_entry->host_va_offs_w = tlb_entry->host_va_offs_r;
+        } else if (rgn_desc->type & RT_MMIO) { // MMIO region
             tlb_entry->flags = flags | TLBFlags::PAGE_IO;
             tlb_entry->rgn_desc = rgn_desc;
             tlb_entry->dev_base_va = guest_va - (phys_addr - rgn_desc->start);
@@ -670,6 +956,8 @@ static TLBEntry* dtlb2_refill(uint32_t guest_va, int is_write, bool is_dbg = fal
             }
         }
         tlb_entry->phys_tag = phys_addr & ~0xFFFUL;
+        tlb_entry->gen = dtlb_gens.src[tlb_src(flags)];
+        tlb_index_add(tlb_entry);
         return tlb_entry;
     } else {
         // In fuzz mode, unmapped accesses are expected (random opcodes touching
@@ -734,27 +1022,27 @@ static inline TLBEntry* lookup_secondary_tlb(uint32_t guest_va, uint32_t tag) {
         tlb_entry = &pCurDTLB2[((guest_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask) * TLB2_WAYS];
     }
 
-    if (tlb_entry->tag == tag) {
+    if (tlb_entry->tag == tag && tlb2_entry_valid<tlb_type>(tlb_entry[0])) {
         // update LRU bits
         tlb_entry[0].lru_bits  = 0x3;
         tlb_entry[1].lru_bits  = 0x2;
         tlb_entry[2].lru_bits &= 0x1;
         tlb_entry[3].lru_bits &= 0x1;
-    } else if (tlb_entry[1].tag == tag) {
+    } else if (tlb_entry[1].tag == tag && tlb2_entry_valid<tlb_type>(tlb_entry[1])) {
         // update LRU bits
         tlb_entry[0].lru_bits  = 0x2;
         tlb_entry[1].lru_bits  = 0x3;
         tlb_entry[2].lru_bits &= 0x1;
         tlb_entry[3].lru_bits &= 0x1;
         tlb_entry = &tlb_entry[1];
-    } else if (tlb_entry[2].tag == tag) {
+    } else if (tlb_entry[2].tag == tag && tlb2_entry_valid<tlb_type>(tlb_entry[2])) {
         // update LRU bits
         tlb_entry[0].lru_bits &= 0x1;
         tlb_entry[1].lru_bits &= 0x1;
         tlb_entry[2].lru_bits  = 0x3;
         tlb_entry[3].lru_bits  = 0x2;
         tlb_entry = &tlb_entry[2];
-    } else if (tlb_entry[3].tag == tag) {
+    } else if (tlb_entry[3].tag == tag && tlb2_entry_valid<tlb_type>(tlb_entry[3])) {
         // update LRU bits
         tlb_entry[0].lru_bits &= 0x1;
         tlb_entry[1].lru_bits &= 0x1;
@@ -767,6 +1055,20 @@ static inline TLBEntry* lookup_secondary_tlb(uint32_t guest_va, uint32_t tag) {
     return tlb_entry;
 }
 
+// make a guest memory page directly accessible once the TLB path has translated it
+static inline void fastmem_update(uint32_t guest_va, const TLBEntry* tlb_entry)
+{
+    if (!ppc_fastmem_enabled)
+        return;
+
+    const uint16_t wr_flags = TLBFlags::PAGE_WRITABLE | TLBFlags::PTE_SET_C;
+    bool writable = (tlb_entry->flags & wr_flags) == wr_flags &&
+                    tlb_entry->host_va_offs_w == tlb_entry->host_va_offs_r;
+    fastmem_map(guest_va, tlb_entry->phys_tag,
+                (const uint8_t *)(tlb_entry->host_va_offs_r + (guest_va & PPC_PAGE_MASK)),
+                writable, tlb_entry->flags & TLBE_FROM_PAT);
+}
+
 uint8_t *mmu_translate_imem(uint32_t vaddr, uint32_t *paddr)
 {
     TLBEntry *tlb1_entry, *tlb2_entry;
@@ -780,7 +1082,7 @@ uint8_t *mmu_translate_imem(uint32_t vaddr, uint32_t *paddr)
 
     // look up guest virtual address in the primary ITLB
     tlb1_entry = &pCurITLB1[(vaddr >> PPC_PAGE_SIZE_BITS) & tlb_size_mask];
-    if (tlb1_entry->tag == tag) { // primary ITLB hit -> fast path
+    if (tlb1_entry->tag == tlb1_tag<TLBType::ITLB>(tag)) { // primary ITLB hit -> fast path
 #ifdef TLB_PROFILING
         num_primary_itlb_hits++;
 #endif
@@ -795,6 +1097,8 @@ uint8_t *mmu_translate_imem(uint32_t vaddr, uint32_t *paddr)
             // secondary ITLB miss ->
             // perform full address translation and refill the secondary ITLB
             tlb2_entry = itlb2_refill(vaddr);
+            if (tlb2_entry == nullptr)
+                return nullptr; // ISI
         }
 #ifdef TLB_PROFILING
         else {
@@ -802,7 +1106,7 @@ uint8_t *mmu_translate_imem(uint32_t vaddr, uint32_t *paddr)
         }
 #endif
         // refill the primary ITLB
-        tlb1_entry->tag = tag;
+        tlb1_entry->tag = tlb1_tag<TLBType::ITLB>(tag);
         tlb1_entry->flags = tlb2_entry->flags;
         tlb1_entry->host_va_offs_r = tlb2_entry->host_va_offs_r;
         tlb1_entry->phys_tag = tlb2_entry->phys_tag;
@@ -838,6 +1142,8 @@ static void tlb_flush_secondary_entry(std::array<TLBEntry, TLB_SIZE*TLB2_WAYS> &
 void tlb_flush_entry(uint32_t ea)
 {
     const uint32_t tag = ea & TLB_VPS_MASK;
+    pte_cache_flush_entry(ea);
+    fastmem_unmap_page(ea);
     tlb_flush_primary_entry(itlb1_mode1, tag);
     tlb_flush_secondary_entry(itlb2_mode1, tag);
     tlb_flush_primary_entry(itlb1_mode2, tag);
@@ -862,7 +1168,7 @@ static void tlb_flush_entries(std::array<TLBEntry, N> &tlb, TLBFlags type) {
 }
 
 template <const TLBType tlb_type>
-void tlb_flush_entries(TLBFlags type)
+static void tlb_flush_entries_slow(TLBFlags type)
 {
     // Mode 1 is real addressing and thus can't contain any PAT entries by definition.
     bool flush_mode1 = type != TLBE_FROM_PAT;
@@ -891,6 +1197,47 @@ void tlb_flush_entries(TLBFlags type)
     }
 }
 
+// make all primary entries miss and revalidate against the secondary TLB
+template <const TLBType tlb_type>
+static void tlb1_advance_epoch()
+{
+    TLBGens& gens = (tlb_type == TLBType::ITLB) ? itlb_gens : dtlb_gens;
+
+    if (++gens.epoch == TLB_EPOCH_LIMIT) {
+        // old tags would alias after the wrap-around
+        const TLBFlags any = (TLBFlags)(PAGE_MEM | PAGE_IO | PAGE_NOPHYS);
+        gens.epoch = 0;
+        if (tlb_type == TLBType::ITLB) {
+            tlb_flush_entries(itlb1_mode1, any);
+            tlb_flush_entries(itlb1_mode2, any);
+            tlb_flush_entries(itlb1_mode3, any);
+        } else {
+            tlb_flush_entries(dtlb1_mode1, any);
+            tlb_flush_entries(dtlb1_mode2, any);
+            tlb_flush_entries(dtlb1_mode3, any);
+        }
+    }
+}
+
+template <const TLBType tlb_type>
+void tlb_flush_entries(TLBFlags type)
+{
+    TLBGens& gens = (tlb_type == TLBType::ITLB) ? itlb_gens : dtlb_gens;
+
+    if (tlb_type == TLBType::DTLB)
+        fastmem_unmap_translated(!(type & TLBE_FROM_BAT));
+
+    for (TLBFlags src_flag : {TLBE_FROM_BAT, TLBE_FROM_PAT}) {
+        if (!(type & src_flag))
+            continue;
+        // a wrapped generation could revive ancient entries so sweep them out
+        if (++gens.src[tlb_src(src_flag)] == 0)
+            tlb_flush_entries_slow<tlb_type>(src_flag);
+    }
+
+    tlb1_advance_epoch<tlb_type>();
+}
+
 bool gTLBFlushIBatEntries = false;
 bool gTLBFlushDBatEntries = false;
 bool gTLBFlushIPatEntries = false;
@@ -946,6 +1293,57 @@ void tlb_flush_all_entries()
     }
 }
 
+/** Drop all data translations of direct device pages.
+    Their devices will be asked again on next access. */
+void mmu_dev_mem_changed()
+{
+    tlb_flush_entries(dtlb1_mode1, PAGE_DEV_MEM);
+    tlb_flush_entries(dtlb1_mode2, PAGE_DEV_MEM);
+    tlb_flush_entries(dtlb1_mode3, PAGE_DEV_MEM);
+    tlb_flush_entries(dtlb2_mode1, PAGE_DEV_MEM);
+    tlb_flush_entries(dtlb2_mode2, PAGE_DEV_MEM);
+    tlb_flush_entries(dtlb2_mode3, PAGE_DEV_MEM);
+}
+
+/** Drop all translations to the physical range start..end after
+    the memory controller has changed its mapping. */
+void mmu_phys_range_changed(uint32_t start, uint32_t end)
+{
+    start &= PPC_PAGE_MASK;
+
+    for (uint32_t bucket_num = start >> TLB_INDEX_SHIFT;
+         bucket_num <= (end >> TLB_INDEX_SHIFT); bucket_num++) {
+        const uint32_t head = TLB2_POOL_SIZE + bucket_num;
+        for (uint32_t node = tlb_index_next[head]; node != head;) {
+            const uint32_t next = tlb_index_next[node];
+            TLBEntry* tlb_entry = &tlb2_pool[0][0] + node;
+            if (tlb_entry->tag == TLB_INVALID_TAG) {
+                tlb_index_unlink(node);
+            } else if (tlb_entry->phys_tag >= start && tlb_entry->phys_tag <= end) {
+                const uint32_t table = node / (TLB_SIZE * TLB2_WAYS);
+                const uint32_t set   = (node % (TLB_SIZE * TLB2_WAYS)) / TLB2_WAYS;
+                tlb1_drop_copy(tlb1_pool[table].data(), set, tlb_entry->tag);
+                tlb_entry->tag = TLB_INVALID_TAG;
+                tlb_index_unlink(node);
+            }
+            node = next;
+        }
+    }
+
+    // fastmem windows are keyed by effective address, they look the pages up
+    // by the physical address they recorded
+    fastmem_unmap_phys_range(start, end);
+
+    // predecoded blocks are keyed by physical address
+    ppc_block_cache_invalidate(start, end);
+
+    // cached PTEs point into the page table region
+    if (start <= last_ptab_area.end && end >= last_ptab_area.start) {
+        last_ptab_area = {0xFFFFFFFF, 0xFFFFFFFF, 0, 0, nullptr, nullptr};
+        pte_cache_flush();
+    }
+}
+
 static void mpc601_bat_update(uint32_t bat_reg)
 {
     PPC_BAT_entry *ibat_entry, *dbat_entry;
@@ -976,6 +1374,8 @@ static void mpc601_bat_update(uint32_t bat_reg)
         dbat_entry->valid = false;
     }
 
+    bat_lut_rebuild(ibat_lut, ibat_array, true);
+
     // MPC601 has unified BATs so we're going to flush both ITLB and DTLB
     if (!gTLBFlushIBatEntries || !gTLBFlushIPatEntries || !gTLBFlushDBatEntries || !gTLBFlushDPatEntries) {
         gTLBFlushIBatEntries = true;
@@ -1010,6 +1410,8 @@ static void ppc_ibat_update(uint32_t bat_reg)
     bat_entry->phys_hi = ppc_state.spr[upper_reg_num + 1] & hi_mask;
     bat_entry->bepi    = ppc_state.spr[upper_reg_num] & hi_mask;
 
+    bat_lut_rebuild(ibat_lut, ibat_array, false);
+
     if (!gTLBFlushIBatEntries || !gTLBFlushIPatEntries) {
         gTLBFlushIBatEntries = true;
         gTLBFlushIPatEntries = true;
@@ -1035,6 +1437,8 @@ static void ppc_dbat_update(uint32_t bat_reg)
     bat_entry->phys_hi = ppc_state.spr[upper_reg_num + 1] & hi_mask;
     bat_entry->bepi    = ppc_state.spr[upper_reg_num] & hi_mask;
 
+    bat_lut_rebuild(dbat_lut, dbat_array, false);
+
     if (!gTLBFlushDBatEntries || !gTLBFlushDPatEntries) {
         gTLBFlushDBatEntries = true;
         gTLBFlushDPatEntries = true;
@@ -1066,11 +1470,19 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
     TLBEntry *tlb1_entry, *tlb2_entry;
     uint8_t *host_va;
 
+    T value;
+    if (fastmem_usable<T>(guest_va) && fastmem_load<T>(guest_va, value)) {
+#ifdef MMU_PROFILING
+        dmem_reads_total++;
+#endif
+        return value;
+    }
+
     const uint32_t tag = guest_va & ~0xFFFUL;
 
     // look up guest virtual address in the primary TLB
     tlb1_entry = &pCurDTLB1[(guest_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask];
-    if (tlb1_entry->tag == tag) { // primary TLB hit -> fast path
+    if (tlb1_entry->tag == tlb1_tag<TLBType::DTLB>(tag)) { // primary TLB hit -> fast path
 #ifdef TLB_PROFILING
         num_primary_dtlb_hits++;
 #endif
@@ -1085,7 +1497,12 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
             // secondary TLB miss ->
             // perform full address translation and refill the secondary TLB
             tlb2_entry = dtlb2_refill(guest_va, 0);
+            if (tlb2_entry == nullptr) {
+                fastmem_mark_slow(guest_va);
+                return 0; // DSI
+            }
             if (tlb2_entry->flags & PAGE_NOPHYS) {
+                fastmem_mark_slow(guest_va);
                 return (T)UnmappedVal;
             }
         }
@@ -1098,14 +1515,18 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
         if (tlb2_entry->flags & TLBFlags::PAGE_MEM) { // is it a real memory region?
             // refill the primary TLB
             *tlb1_entry = *tlb2_entry;
+            tlb1_entry->tag = tlb1_tag<TLBType::DTLB>(tag);
             host_va = (uint8_t *)(tlb1_entry->host_va_offs_r + guest_va);
         } else { // otherwise, it's an access to a memory-mapped device
 #ifdef MMU_PROFILING
             iomem_reads_total++;
 #endif
+            fastmem_mark_slow(guest_va);
             if (sizeof(T) == 8) {
-                if (guest_va & 3)
+                if (guest_va & 3) {
                     ppc_alignment_exception(opcode, guest_va);
+                    return 0;
+                }
 
                 return (
                     ((T)tlb2_entry->rgn_desc->devobj->read(tlb2_entry->rgn_desc->start,
@@ -1130,6 +1551,8 @@ inline T mmu_read_vmem(uint32_t opcode, uint32_t guest_va)
     dmem_reads_total++;
 #endif
 
+    fastmem_update(guest_va, tlb1_entry);
+
     // handle unaligned memory accesses
     if (sizeof(T) > 1 && (guest_va & (sizeof(T) - 1))) {
         return read_unaligned<T>(opcode, guest_va, host_va);
@@ -1160,11 +1583,18 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
     TLBEntry *tlb1_entry, *tlb2_entry;
     uint8_t *host_va;
 
+    if (fastmem_usable<T>(guest_va) && fastmem_store<T>(guest_va, value)) {
+#ifdef MMU_PROFILING
+        dmem_writes_total++;
+#endif
+        return;
+    }
+
     const uint32_t tag = guest_va & ~0xFFFUL;
 
     // look up guest virtual address in the primary TLB
     tlb1_entry = &pCurDTLB1[(guest_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask];
-    if (tlb1_entry->tag == tag) { // primary TLB hit -> fast path
+    if (tlb1_entry->tag == tlb1_tag<TLBType::DTLB>(tag)) { // primary TLB hit -> fast path
 #ifdef TLB_PROFILING
         num_primary_dtlb_hits++;
 #endif
@@ -1172,10 +1602,12 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
             ppc_state.spr[SPR::DSISR] = 0x08000000 | (1 << 25);
             ppc_state.spr[SPR::DAR]   = guest_va;
             mmu_exception_handler(Except_Type::EXC_DSI, 0);
+            return;
         }
         if (!(tlb1_entry->flags & TLBFlags::PTE_SET_C)) {
             // perform full page address translation to update PTE.C bit
-            page_address_translation(guest_va, false, !!(ppc_state.msr & MSR::PR), true);
+            if (page_address_translation(guest_va, false, !!(ppc_state.msr & MSR::PR), true).fault)
+                return;
             tlb1_entry->flags |= TLBFlags::PTE_SET_C;
 
             // don't forget to update the secondary TLB as well
@@ -1184,6 +1616,8 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
                 tlb2_entry->flags |= TLBFlags::PTE_SET_C;
             }
         }
+        if (tlb1_entry->flags & TLBFlags::PAGE_DEV_MEM)
+            dev_mem_mark_dirty(tlb1_entry->phys_tag);
         host_va = (uint8_t *)(tlb1_entry->host_va_offs_w + guest_va);
     } else {
         // primary TLB miss -> look up address in the secondary TLB
@@ -1195,7 +1629,12 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
             // secondary TLB miss ->
             // perform full address translation and refill the secondary TLB
             tlb2_entry = dtlb2_refill(guest_va, 1);
+            if (tlb2_entry == nullptr) {
+                fastmem_mark_slow(guest_va);
+                return; // DSI
+            }
             if (tlb2_entry->flags & PAGE_NOPHYS) {
+                fastmem_mark_slow(guest_va);
                 return;
             }
         }
@@ -1209,25 +1648,33 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
             ppc_state.spr[SPR::DSISR] = 0x08000000 | (1 << 25);
             ppc_state.spr[SPR::DAR]   = guest_va;
             mmu_exception_handler(Except_Type::EXC_DSI, 0);
+            return;
         }
 
         if (!(tlb2_entry->flags & TLBFlags::PTE_SET_C)) {
             // perform full page address translation to update PTE.C bit
-            page_address_translation(guest_va, false, !!(ppc_state.msr & MSR::PR), true);
+            if (page_address_translation(guest_va, false, !!(ppc_state.msr & MSR::PR), true).fault)
+                return;
             tlb2_entry->flags |= TLBFlags::PTE_SET_C;
         }
 
         if (tlb2_entry->flags & TLBFlags::PAGE_MEM) { // is it a real memory region?
             // refill the primary TLB
             *tlb1_entry = *tlb2_entry;
+            tlb1_entry->tag = tlb1_tag<TLBType::DTLB>(tag);
+            if (tlb1_entry->flags & TLBFlags::PAGE_DEV_MEM)
+                dev_mem_mark_dirty(tlb1_entry->phys_tag);
             host_va = (uint8_t *)(tlb1_entry->host_va_offs_w + guest_va);
         } else { // otherwise, it's an access to a memory-mapped device
 #ifdef MMU_PROFILING
             iomem_writes_total++;
 #endif
+            fastmem_mark_slow(guest_va);
             if (sizeof(T) == 8) {
-                if (guest_va & 3)
+                if (guest_va & 3) {
                     ppc_alignment_exception(opcode, guest_va);
+                    return;
+                }
 
                 tlb2_entry->rgn_desc->devobj->write(tlb2_entry->rgn_desc->start,
                                                     static_cast<uint32_t>(guest_va - tlb2_entry->dev_base_va),
@@ -1248,6 +1695,8 @@ inline void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value)
     dmem_writes_total++;
 #endif
 
+    fastmem_update(guest_va, tlb1_entry);
+
     // handle unaligned memory accesses
     if (sizeof(T) > 1 && (guest_va & (sizeof(T) - 1))) {
         write_unaligned<T>(opcode, guest_va, host_va, value);
@@ -1277,12 +1726,165 @@ template void mmu_write_vmem<uint16_t>(uint32_t opcode, uint32_t guest_va, uint1
 template void mmu_write_vmem<uint32_t>(uint32_t opcode, uint32_t guest_va, uint32_t value);
 template void mmu_write_vmem<uint64_t>(uint32_t opcode, uint32_t guest_va, uint64_t value);
 
+/** Translate the data page containing guest_va for a bulk access.
+    Returns the host address of guest_va, which stays valid up to the end
+    of the guest page, or nullptr if the page isn't backed by memory or an
+    exception was raised. The caller tells them apart with ppc_faulted(). */
+uint8_t *mmu_translate_dmem(uint32_t guest_va, bool is_write)
+{
+    TLBEntry *tlb1_entry, *tlb2_entry;
+
+    const uint32_t tag = guest_va & ~0xFFFUL;
+
+    tlb1_entry = &pCurDTLB1[(guest_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask];
+    if (tlb1_entry->tag == tlb1_tag<TLBType::DTLB>(tag)) {
+#ifdef TLB_PROFILING
+        num_primary_dtlb_hits++;
+#endif
+    } else {
+        tlb2_entry = lookup_secondary_tlb<TLBType::DTLB>(guest_va, tag);
+        if (tlb2_entry == nullptr) {
+#ifdef TLB_PROFILING
+            num_dtlb_refills++;
+#endif
+            tlb2_entry = dtlb2_refill(guest_va, is_write);
+            if (tlb2_entry == nullptr || (tlb2_entry->flags & PAGE_NOPHYS))
+                return nullptr; // DSI or unmapped memory
+        }
+#ifdef TLB_PROFILING
+        else {
+            num_secondary_dtlb_hits++;
+        }
+#endif
+
+        if (!(tlb2_entry->flags & TLBFlags::PAGE_MEM))
+            return nullptr; // memory-mapped device
+
+        // refill the primary TLB
+        *tlb1_entry = *tlb2_entry;
+        tlb1_entry->tag = tlb1_tag<TLBType::DTLB>(tag);
+    }
+
+    if (!is_write)
+        return (uint8_t *)(tlb1_entry->host_va_offs_r + guest_va);
+
+    if (!(tlb1_entry->flags & TLBFlags::PAGE_WRITABLE)) {
+        ppc_state.spr[SPR::DSISR] = 0x08000000 | (1 << 25);
+        ppc_state.spr[SPR::DAR]   = guest_va;
+        mmu_exception_handler(Except_Type::EXC_DSI, 0);
+        return nullptr;
+    }
+    if (!(tlb1_entry->flags & TLBFlags::PTE_SET_C)) {
+        // perform full page address translation to update PTE.C bit
+        if (page_address_translation(guest_va, false, !!(ppc_state.msr & MSR::PR), true).fault)
+            return nullptr;
+        tlb1_entry->flags |= TLBFlags::PTE_SET_C;
+
+        tlb2_entry = lookup_secondary_tlb<TLBType::DTLB>(guest_va, tag);
+        if (tlb2_entry != nullptr) {
+            tlb2_entry->flags |= TLBFlags::PTE_SET_C;
+        }
+    }
+    if (tlb1_entry->flags & TLBFlags::PAGE_DEV_MEM)
+        dev_mem_mark_dirty(tlb1_entry->phys_tag);
+    return (uint8_t *)(tlb1_entry->host_va_offs_w + guest_va);
+}
+
+/** Read size bytes of guest memory into buf, copying whole pages at once.
+    Pages without memory behind them are accessed with the largest of
+    4, 2 and 1 byte accesses that fit the remaining size.
+    Returns the number of bytes read before an exception occurred. */
+uint32_t mmu_read_vmem_bulk(uint32_t opcode, uint32_t guest_va, uint8_t *buf, uint32_t size)
+{
+    uint32_t done = 0;
+
+    while (done < size) {
+        uint32_t va    = guest_va + done;
+        uint32_t chunk = std::min(size - done, PPC_PAGE_SIZE - (va & ~PPC_PAGE_MASK));
+
+        uint8_t *host_va = mmu_translate_dmem(va, false);
+        if (host_va) {
+            std::memcpy(buf + done, host_va, chunk);
+            done += chunk;
+            continue;
+        }
+        if (ppc_faulted())
+            return done;
+
+        for (uint32_t end = done + chunk; done < end;) {
+            uint32_t left = end - done;
+            if (left >= 4) {
+                WRITE_DWORD_BE_U(buf + done, mmu_read_vmem<uint32_t>(opcode, guest_va + done));
+                if (ppc_faulted())
+                    return done;
+                done += 4;
+            } else if (left >= 2) {
+                WRITE_WORD_BE_U(buf + done, mmu_read_vmem<uint16_t>(opcode, guest_va + done));
+                if (ppc_faulted())
+                    return done;
+                done += 2;
+            } else {
+                buf[done] = mmu_read_vmem<uint8_t>(opcode, guest_va + done);
+                if (ppc_faulted())
+                    return done;
+                done++;
+            }
+        }
+    }
+
+    return done;
+}
+
+/** Write size bytes from buf to guest memory, see mmu_read_vmem_bulk(). */
+uint32_t mmu_write_vmem_bulk(uint32_t opcode, uint32_t guest_va, const uint8_t *buf,
+                             uint32_t size)
+{
+    uint32_t done = 0;
+
+    while (done < size) {
+        uint32_t va    = guest_va + done;
+        uint32_t chunk = std::min(size - done, PPC_PAGE_SIZE - (va & ~PPC_PAGE_MASK));
+
+        uint8_t *host_va = mmu_translate_dmem(va, true);
+        if (host_va) {
+            std::memcpy(host_va, buf + done, chunk);
+            done += chunk;
+            continue;
+        }
+        if (ppc_faulted())
+            return done;
+
+        for (uint32_t end = done + chunk; done < end;) {
+            uint32_t left = end - done;
+            if (left >= 4) {
+                mmu_write_vmem<uint32_t>(opcode, guest_va + done, READ_DWORD_BE_U(buf + done));
+                if (ppc_faulted())
+                    return done;
+                done += 4;
+            } else if (left >= 2) {
+                mmu_write_vmem<uint16_t>(opcode, guest_va + done, READ_WORD_BE_U(buf + done));
+                if (ppc_faulted())
+                    return done;
+                done += 2;
+            } else {
+                mmu_write_vmem<uint8_t>(opcode, guest_va + done, buf[done]);
+                if (ppc_faulted())
+                    return done;
+                done++;
+            }
+        }
+    }
+
+    return done;
+}
+
 template <class T>
 static T read_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va)
 {
     if ((sizeof(T) == 8) && (guest_va & 3)) {
 #ifndef PPC_TESTS
         ppc_alignment_exception(opcode, guest_va);
+        return 0;
 #endif
     }
 
@@ -1298,6 +1900,8 @@ static T read_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va)
         // presumably very rare so don't waste time optimizing the code below.
         for (int i = 0; i < sizeof(T); guest_va++, i++) {
             result = (result << 8) | mmu_read_vmem<uint8_t>(opcode, guest_va);
+            if (ppc_faulted())
+                return 0;
         }
     } else {
 #ifdef MMU_PROFILING
@@ -1328,6 +1932,7 @@ static void write_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va
     if ((sizeof(T) == 8) && (guest_va & 3)) {
 #ifndef PPC_TESTS
         ppc_alignment_exception(opcode, guest_va);
+        return;
 #endif
     }
 
@@ -1344,6 +1949,8 @@ static void write_unaligned(uint32_t opcode, uint32_t guest_va, uint8_t *host_va
 
         for (int i = 0; i < sizeof(T); shift -= 8, guest_va++, i++) {
             mmu_write_vmem<uint8_t>(opcode, guest_va, (value >> shift) & 0xFF);
+            if (ppc_faulted())
+                return;
         }
     } else {
 #ifdef MMU_PROFILING
@@ -1409,6 +2016,10 @@ public:
                         .format = ProfileVarFmt::DEC,
                         .value = bat_transl_total});
 
+        vars.push_back({.name = "BAT Lookup Table Rebuilds",
+                        .format = ProfileVarFmt::DEC,
+                        .value = bat_lut_rebuilds});
+
         vars.push_back({.name = "Page Table Translations Total",
                         .format = ProfileVarFmt::DEC,
                         .value = ptab_transl_total});
@@ -1437,6 +2048,7 @@ public:
         iomem_writes_total = 0;
         exec_reads_total   = 0;
         bat_transl_total   = 0;
+        bat_lut_rebuilds   = 0;
         ptab_transl_total  = 0;
         unaligned_reads    = 0;
         unaligned_writes   = 0;
@@ -1486,6 +2098,14 @@ public:
         vars.push_back({.name = "Number of replaced TLB entries",
             .format = ProfileVarFmt::DEC,
             .value = num_entry_replacements});
+
+        vars.push_back({.name = "Number of PTEs found in the PTE cache",
+            .format = ProfileVarFmt::DEC,
+            .value = num_pte_cache_hits});
+
+        vars.push_back({.name = "Number of page table searches",
+            .format = ProfileVarFmt::DEC,
+            .value = num_pteg_searches});
     }
 
     void reset() {
@@ -1493,6 +2113,8 @@ public:
         num_secondary_dtlb_hits = 0;
         num_dtlb_refills        = 0;
         num_entry_replacements = 0;
+        num_pte_cache_hits      = 0;
+        num_pteg_searches       = 0;
     }
 };
 #endif
@@ -1591,6 +2213,9 @@ void mem_write_dbg(uint32_t virt_addr, uint64_t value, int size) {
     mmu_exception_handler     = ppc_exception_handler;
     ppc_state.spr[SPR::DSISR] = save_dsisr;
     ppc_state.spr[SPR::DAR]   = save_dar;
+
+    // the debugger may have patched code
+    ppc_block_cache_flush();
 }
 
 bool mmu_translate_dbg(uint32_t guest_va, uint32_t &guest_pa) {
@@ -1611,7 +2236,7 @@ bool mmu_translate_dbg(uint32_t guest_va, uint32_t &guest_pa) {
         tlb1_entry = &pCurDTLB1[(guest_va >> PPC_PAGE_SIZE_BITS) & tlb_size_mask];
 
         do {
-            if (tlb1_entry->tag != tag) {
+            if (tlb1_entry->tag != tlb1_tag<TLBType::DTLB>(tag)) {
                 // primary TLB miss -> look up address in the secondary TLB
                 tlb2_entry = lookup_secondary_tlb<TLBType::DTLB>(guest_va, tag);
                 if (tlb2_entry == nullptr) {
@@ -1627,6 +2252,7 @@ bool mmu_translate_dbg(uint32_t guest_va, uint32_t &guest_pa) {
                 if (tlb2_entry->flags & TLBFlags::PAGE_MEM) { // is it a real memory region?
                     // refill the primary TLB
                     *tlb1_entry = *tlb2_entry;
+                    tlb1_entry->tag = tlb1_tag<TLBType::DTLB>(tag);
                 }
                 else {
                     tlb1_entry = tlb2_entry;
@@ -1662,7 +2288,7 @@ static void invalidate_tlb_entries(std::array<TLBEntry, N> &tlb) {
         tlb_el.host_va_offs_r = 0;
         tlb_el.host_va_offs_w = 0;
         tlb_el.phys_tag = 0;
-        tlb_el.reserved = 0;
+        tlb_el.gen = 0;
     }
 }
 
@@ -1673,6 +2299,8 @@ void ppc_mmu_init()
     last_exec_area  = {0xFFFFFFFF, 0xFFFFFFFF, 0, 0, nullptr, nullptr};
     last_ptab_area  = {0xFFFFFFFF, 0xFFFFFFFF, 0, 0, nullptr, nullptr};
 
+    pte_cache_flush();
+
     mmu_exception_handler = ppc_exception_handler;
 
     if (is_601) {
@@ -1699,8 +2327,14 @@ void ppc_mmu_init()
     invalidate_tlb_entries(dtlb2_mode1);
     invalidate_tlb_entries(dtlb2_mode2);
     invalidate_tlb_entries(dtlb2_mode3);
+    itlb_gens = {};
+    dtlb_gens = {};
+    tlb_index_init();
+    mem_ctrl_instance->set_range_change_callback(mmu_phys_range_changed);
 
+    fastmem_init();
     mmu_change_mode();
+    fastmem_select(CurDTLBMode);
 
 #ifdef MMU_PROFILING
     gProfilerObj->register_profile("PPC:MMU",
@@ -68,6 +68,7 @@ typedef struct PATResult {
     uint32_t    phys;
     uint8_t     prot;
     uint8_t     pte_c_status; // status of the C bit of the PTE
+    bool        fault;        // translation raised an ISI/DSI exception
 } PATResult;
 
 /** DMA memory mapping result. */
@@ -104,7 +105,7 @@ typedef struct TLBEntry {
         };
     };
     uint32_t phys_tag;
-    uint32_t reserved;
+    uint32_t gen;       // generation of the translation source at refill time
 } TLBEntry;
 
 enum TLBFlags : uint16_t {
@@ -115,6 +116,7 @@ enum TLBFlags : uint16_t {
     TLBE_FROM_PAT = 1 << 4, // TLB entry has been translated with PAT
     PAGE_WRITABLE = 1 << 5, // page is writable
     PTE_SET_C     = 1 << 6, // tells if C bit of the PTE needs to be updated
+    PAGE_DEV_MEM  = 1 << 7, // memory page of a device, stores mark it dirty
 };
 
 extern std::function<void(uint32_t bat_reg)> ibat_update;
@@ -125,6 +127,13 @@ extern MapDmaResult mmu_map_dma_mem(uint32_t addr, uint32_t size, bool allow_mmi
 extern void mmu_change_mode(void);
 extern void mmu_pat_ctx_changed();
 extern void tlb_flush_entry(uint32_t ea);
+extern void pte_cache_flush_entry(uint32_t ea);
+extern void pte_cache_flush();
+extern void mmu_phys_range_changed(uint32_t start, uint32_t end);
+
+// Device pages accessed directly, see MMIODevice::get_direct_page()
+extern void mmu_dev_mem_changed();
+extern bool mmu_dev_mem_dirty(uint32_t phys_addr, uint32_t size);
 
 extern uint64_t mem_read_dbg(uint32_t virt_addr, uint32_t size);
 extern void mem_write_dbg(uint32_t virt_addr, uint64_t value, int size);
@@ -136,4 +145,11 @@ extern T mmu_read_vmem(uint32_t opcode, uint32_t guest_va);
 template <class T>
 extern void mmu_write_vmem(uint32_t opcode, uint32_t guest_va, T value);
 
+// Bulk data accesses translating once per page
+extern uint8_t *mmu_translate_dmem(uint32_t guest_va, bool is_write);
+extern uint32_t mmu_read_vmem_bulk(uint32_t opcode, uint32_t guest_va, uint8_t *buf,
+                                   uint32_t size);
+extern uint32_t mmu_write_vmem_bulk(uint32_t opcode, uint32_t guest_va, const uint8_t *buf,
+                                    uint32_t size);
+
 #endif    // PPCMMU_H
@@ -24,44 +24,39 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <core/bitops.h>
 #include <core/timermanager.h>
 #include <core/mathutils.h>
+#include "ppcblockcache.h"
 #include "ppcemu.h"
 #include "ppcmacros.h"
 #include "ppcmmu.h"
 #include <cinttypes>
+#include <cstring>
+#include <iterator>
 #include <vector>
 
 //Extract the registers desired and the values of the registers.
 
-// Affects CR Field 0 - For integer operations
-void ppc_changecrf0(uint32_t set_result) {
-    ppc_state.cr =
-        (ppc_state.cr & 0x0FFFFFFFU) // clear CR0
-        | (
-            (set_result == 0) ?
-                CRx_bit::CR_EQ
-            : (int32_t(set_result) < 0) ?
-                CRx_bit::CR_LT
-            :
-                CRx_bit::CR_GT
-        )
-        | ((ppc_state.spr[SPR::XER] & XER::SO) >> 3); // copy XER[SO] into CR0[SO].
+PPCLazyFlags ppc_lazy_flags;
+
+// Write pending CR0 and XER[CA] updates into ppc_state
+void ppc_materialize_flags() {
+    if (ppc_lazy_flags.cr0_state) {
+        ppc_state.cr = ppc_get_cr();
+        ppc_lazy_flags.cr0_state = 0;
+    }
+    if (ppc_lazy_flags.ca) {
+        ppc_state.spr[SPR::XER] = (ppc_state.spr[SPR::XER] & ~XER::CA) |
+            ((ppc_lazy_flags.ca & 1) << 29);
+        ppc_lazy_flags.ca = 0;
+    }
 }
 
 // Affects the XER register's Carry Bit
 inline static void ppc_carry(uint32_t a, uint32_t b) {
-    if (b < a) {
-        ppc_state.spr[SPR::XER] |= XER::CA;
-    } else {
-        ppc_state.spr[SPR::XER] &= ~XER::CA;
-    }
+    ppc_set_ca(b < a);
 }
 
 inline static void ppc_carry_sub(uint32_t a, uint32_t b) {
-    if (b >= a) {
-        ppc_state.spr[SPR::XER] |= XER::CA;
-    } else {
-        ppc_state.spr[SPR::XER] &= ~XER::CA;
-    }
+    ppc_set_ca(b >= a);
 }
 
 // Affects the XER register's SO and OV Bits
@@ -147,14 +142,10 @@ template void dppc_interpreter::ppc_add<CARRY1, RC1, OV1>(uint32_t opcode);
 template <field_rc rec, field_ov ov>
 void dppc_interpreter::ppc_adde(uint32_t opcode) {
     ppc_grab_regsdab(opcode);
-    uint32_t xer_ca       = !!(ppc_state.spr[SPR::XER] & XER::CA);
+    uint32_t xer_ca       = ppc_get_ca();
     uint32_t ppc_result_d = ppc_result_a + ppc_result_b + xer_ca;
 
-    if ((ppc_result_d < ppc_result_a) || (xer_ca && (ppc_result_d == ppc_result_a))) {
-        ppc_state.spr[SPR::XER] |= XER::CA;
-    } else {
-        ppc_state.spr[SPR::XER] &= ~XER::CA;
-    }
+    ppc_set_ca((ppc_result_d < ppc_result_a) || (xer_ca && (ppc_result_d == ppc_result_a)));
 
     if (ov)
         ppc_setsoov(ppc_result_a, ~ppc_result_b, ppc_result_d);
@@ -172,14 +163,10 @@ template void dppc_interpreter::ppc_adde<RC1, OV1>(uint32_t opcode);
 template <field_rc rec, field_ov ov>
 void dppc_interpreter::ppc_addme(uint32_t opcode) {
     ppc_grab_regsda(opcode);
-    uint32_t xer_ca       = !!(ppc_state.spr[SPR::XER] & XER::CA);
+    uint32_t xer_ca       = ppc_get_ca();
     uint32_t ppc_result_d = ppc_result_a + xer_ca - 1;
 
-    if (((xer_ca - 1) < 0xFFFFFFFFUL) || (ppc_result_d < ppc_result_a)) {
-        ppc_state.spr[SPR::XER] |= XER::CA;
-    } else {
-        ppc_state.spr[SPR::XER] &= ~XER::CA;
-    }
+    ppc_set_ca(((xer_ca - 1) < 0xFFFFFFFFUL) || (ppc_result_d < ppc_result_a));
 
     if (ov)
         ppc_setsoov(ppc_result_a, 0, ppc_result_d);
@@ -197,14 +184,10 @@ template void dppc_interpreter::ppc_addme<RC1, OV1>(uint32_t opcode);
 template <field_rc rec, field_ov ov>
 void dppc_interpreter::ppc_addze(uint32_t opcode) {
     ppc_grab_regsda(opcode);
-    uint32_t grab_xer     = !!(ppc_state.spr[SPR::XER] & XER::CA);
+    uint32_t grab_xer     = ppc_get_ca();
     uint32_t ppc_result_d = ppc_result_a + grab_xer;
 
-    if (ppc_result_d < ppc_result_a) {
-        ppc_state.spr[SPR::XER] |= XER::CA;
-    } else {
-        ppc_state.spr[SPR::XER] &= ~XER::CA;
-    }
+    ppc_set_ca(ppc_result_d < ppc_result_a);
 
     if (ov)
         ppc_setsoov(ppc_result_a, 0xFFFFFFFFUL, ppc_result_d);
@@ -223,7 +206,7 @@ void dppc_interpreter::ppc_subfic(uint32_t opcode) {
     ppc_grab_regsdasimm(opcode);
     uint32_t ppc_result_d = simm - ppc_result_a;
     if (simm == -1)
-        ppc_state.spr[SPR::XER] |= XER::CA;
+        ppc_set_ca(true);
     else
         ppc_carry(~ppc_result_a, ppc_result_d);
     ppc_store_iresult_reg(reg_d, ppc_result_d);
@@ -256,10 +239,10 @@ template void dppc_interpreter::ppc_subf<CARRY1, RC1, OV1>(uint32_t opcode);
 template <field_rc rec, field_ov ov>
 void dppc_interpreter::ppc_subfe(uint32_t opcode) {
     ppc_grab_regsdab(opcode);
-    uint32_t grab_ca      = !!(ppc_state.spr[SPR::XER] & XER::CA);
+    uint32_t grab_ca      = ppc_get_ca();
     uint32_t ppc_result_d = ~ppc_result_a + ppc_result_b + grab_ca;
     if (grab_ca && ppc_result_b == 0xFFFFFFFFUL)
-        ppc_state.spr[SPR::XER] |= XER::CA;
+        ppc_set_ca(true);
     else
         ppc_carry(~ppc_result_a, ppc_result_d);
 
@@ -279,13 +262,10 @@ template void dppc_interpreter::ppc_subfe<RC1, OV1>(uint32_t opcode);
 template <field_rc rec, field_ov ov>
 void dppc_interpreter::ppc_subfme(uint32_t opcode) {
     ppc_grab_regsda(opcode);
-    uint32_t grab_ca      = !!(ppc_state.spr[SPR::XER] & XER::CA);
+    uint32_t grab_ca      = ppc_get_ca();
     uint32_t ppc_result_d = ~ppc_result_a + grab_ca - 1;
 
-    if (ppc_result_a == 0xFFFFFFFFUL && !grab_ca)
-        ppc_state.spr[SPR::XER] &= ~XER::CA;
-    else
-        ppc_state.spr[SPR::XER] |= XER::CA;
+    ppc_set_ca(!(ppc_result_a == 0xFFFFFFFFUL && !grab_ca));
 
     if (ov) {
         if (ppc_result_d == ppc_result_a && int32_t(ppc_result_d) > 0)
@@ -308,13 +288,11 @@ template void dppc_interpreter::ppc_subfme<RC1, OV1>(uint32_t opcode);
 template <field_rc rec, field_ov ov>
 void dppc_interpreter::ppc_subfze(uint32_t opcode) {
     ppc_grab_regsda(opcode);
-    uint32_t grab_ca      = !!(ppc_state.spr[SPR::XER] & XER::CA);
+    uint32_t grab_ca      = ppc_get_ca();
     uint32_t ppc_result_d = ~ppc_result_a + grab_ca;
 
-    if (!ppc_result_d && grab_ca) // special case: ppc_result_d = 0 and CA=1
-        ppc_state.spr[SPR::XER] |= XER::CA;
-    else
-        ppc_state.spr[SPR::XER] &= ~XER::CA;
+    // special case: ppc_result_d = 0 and CA=1
+    ppc_set_ca(!ppc_result_d && grab_ca);
 
     if (ov) {
         if (ppc_result_d && ppc_result_d == ppc_result_a)
@@ -628,19 +606,14 @@ template <field_rc rec>
 void dppc_interpreter::ppc_sraw(uint32_t opcode) {
     ppc_grab_regssab(opcode);
 
-    // clear XER[CA] by default
-    ppc_state.spr[SPR::XER] &= ~XER::CA;
-
     if (ppc_result_b & 0x20) {
         // fill rA with the sign bit of rS
         ppc_result_a = int32_t(ppc_result_d) >> 31;
-        if (ppc_result_a) // if rA is negative
-            ppc_state.spr[SPR::XER] |= XER::CA;
+        ppc_set_ca(ppc_result_a); // CA is set if rA is negative
     } else {
         uint32_t shift = ppc_result_b & 0x1F;
         ppc_result_a   = int32_t(ppc_result_d) >> shift;
-        if ((int32_t(ppc_result_d) < 0) && (ppc_result_d & ((1U << shift) - 1)))
-            ppc_state.spr[SPR::XER] |= XER::CA;
+        ppc_set_ca((int32_t(ppc_result_d) < 0) && (ppc_result_d & ((1U << shift) - 1)));
     }
 
     if (rec)
@@ -656,11 +629,7 @@ template <field_rc rec>
 void dppc_interpreter::ppc_srawi(uint32_t opcode) {
     ppc_grab_regssash(opcode);
 
-    // clear XER[CA] by default
-    ppc_state.spr[SPR::XER] &= ~XER::CA;
-
-    if ((int32_t(ppc_result_d) < 0) && (ppc_result_d & ((1U << rot_sh) - 1)))
-        ppc_state.spr[SPR::XER] |= XER::CA;
+    ppc_set_ca((int32_t(ppc_result_d) < 0) && (ppc_result_d & ((1U << rot_sh) - 1)));
 
     ppc_result_a = int32_t(ppc_result_d) >> rot_sh;
 
@@ -721,7 +690,7 @@ void dppc_interpreter::ppc_rlwnm(uint32_t opcode) {
 
 void dppc_interpreter::ppc_mfcr(uint32_t opcode) {
     int reg_d            = (opcode >> 21) & 0x1F;
-    ppc_state.gpr[reg_d] = ppc_state.cr;
+    ppc_state.gpr[reg_d] = ppc_get_cr();
 }
 
 void dppc_interpreter::ppc_mtsr(uint32_t opcode) {
@@ -730,6 +699,7 @@ void dppc_interpreter::ppc_mtsr(uint32_t opcode) {
 #endif
     if (ppc_state.msr & MSR::PR) {
         ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::NOT_ALLOWED);
+        return;
     }
     int reg_s             = (opcode >> 21) & 0x1F;
     uint32_t grab_sr      = (opcode >> 16) & 0x0F;
@@ -745,6 +715,7 @@ void dppc_interpreter::ppc_mtsrin(uint32_t opcode) {
 #endif
     if (ppc_state.msr & MSR::PR) {
         ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::NOT_ALLOWED);
+        return;
     }
     ppc_grab_regssb(opcode);
     uint32_t grab_sr      = ppc_result_b >> 28;
@@ -760,6 +731,7 @@ void dppc_interpreter::ppc_mfsr(uint32_t opcode) {
 #endif
     if (ppc_state.msr & MSR::PR) {
         ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::NOT_ALLOWED);
+        return;
     }
     int reg_d            = (opcode >> 21) & 0x1F;
     uint32_t grab_sr     = (opcode >> 16) & 0x0F;
@@ -772,6 +744,7 @@ void dppc_interpreter::ppc_mfsrin(uint32_t opcode) {
 #endif
     if (ppc_state.msr & MSR::PR) {
         ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::NOT_ALLOWED);
+        return;
     }
     ppc_grab_regsdb(opcode);
     uint32_t grab_sr     = ppc_result_b >> 28;
@@ -784,6 +757,7 @@ void dppc_interpreter::ppc_mfmsr(uint32_t opcode) {
 #endif
     if (ppc_state.msr & MSR::PR) {
         ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::NOT_ALLOWED);
+        return;
     }
     uint32_t reg_d       = (opcode >> 21) & 0x1F;
     ppc_state.gpr[reg_d] = ppc_state.msr;
@@ -795,6 +769,7 @@ void dppc_interpreter::ppc_mtmsr(uint32_t opcode) {
 #endif
     if (ppc_state.msr & MSR::PR) {
         ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::NOT_ALLOWED);
+        return;
     }
     uint32_t reg_s = (opcode >> 21) & 0x1F;
     uint32_t old_msr_val = ppc_state.msr;
@@ -812,6 +787,13 @@ void dppc_interpreter::ppc_mtmsr(uint32_t opcode) {
         ppc_exception_handler(Except_Type::EXC_DECR, 0);
     } else {
         mmu_change_mode();
+
+        // stop executing until the next interrupt if a power saving mode is enabled
+        if ((ppc_state.msr & MSR::POW) && !is_601 &&
+            (ppc_state.spr[SPR::HID0] & (HID0_DOZE | HID0_NAP | HID0_SLEEP))) {
+            exec_flags |= EXEF_POW;
+            ppc_next_instruction_address = ppc_state.pc + 4;
+        }
     }
 }
 
@@ -954,6 +936,9 @@ void dppc_interpreter::ppc_mfspr(uint32_t opcode) {
     ppc_grab_dab(opcode);
     uint32_t ref_spr = (reg_b << 5) | reg_a;
 
+    if (ref_spr == SPR::XER)
+        ppc_sync_flags();
+
     if (ref_spr & 0x10) {
 #ifdef CPU_PROFILING
         num_supervisor_instrs++;
@@ -968,12 +953,14 @@ void dppc_interpreter::ppc_mfspr(uint32_t opcode) {
     case SPR::MQ:
         if (!(is_601 || include_601)) {
             ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::ILLEGAL_OP);
+            return;
         }
         ppc_state.gpr[reg_d] = ppc_state.spr[ref_spr];
         break;
     case SPR::RTCL_U:
         if (!is_601) {
             ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::ILLEGAL_OP);
+            return;
         }
         calc_rtcl_value();
         ppc_state.gpr[reg_d] =
@@ -983,6 +970,7 @@ void dppc_interpreter::ppc_mfspr(uint32_t opcode) {
     case SPR::RTCU_U:
         if (!is_601) {
             ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::ILLEGAL_OP);
+            return;
         }
         calc_rtcl_value();
         ppc_state.gpr[reg_d] =
@@ -992,6 +980,7 @@ void dppc_interpreter::ppc_mfspr(uint32_t opcode) {
     case SPR::DEC_U:
         if (!is_601) {
             ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::ILLEGAL_OP);
+            return;
         }
         // fallthrough
     case SPR::DEC_S:
@@ -1028,6 +1017,9 @@ void dppc_interpreter::ppc_mtspr(uint32_t opcode) {
     ppc_grab_dab(opcode);
     uint32_t ref_spr = (reg_b << 5) | reg_a;
 
+    if (ref_spr == SPR::XER)
+        ppc_sync_flags();
+
     if (ref_spr & 0x10) {
 #ifdef CPU_PROFILING
         num_supervisor_instrs++;
@@ -1052,6 +1044,7 @@ void dppc_interpreter::ppc_mtspr(uint32_t opcode) {
     case SPR::DEC_U:
         if (!is_601) {
             ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::ILLEGAL_OP);
+            return;
         }
         break;
     case SPR::XER:
@@ -1060,6 +1053,7 @@ void dppc_interpreter::ppc_mtspr(uint32_t opcode) {
     case SPR::SDR1:
         if (ppc_state.spr[ref_spr] != val) {
             ppc_state.spr[ref_spr] = val;
+            pte_cache_flush(); // the page table has moved
             mmu_pat_ctx_changed(); // adapt to SDR1 changes
         }
         break;
@@ -1159,11 +1153,13 @@ void dppc_interpreter::ppc_mtcrf(uint32_t opcode) {
         if (crm & 0x02) cr_mask |= 0x000000F0UL;
         if (crm & 0x01) cr_mask |= 0x0000000FUL;
     }
+    ppc_sync_flags();
     ppc_state.cr = (ppc_state.cr & ~cr_mask) | (ppc_result_d & cr_mask);
 }
 
 void dppc_interpreter::ppc_mcrxr(uint32_t opcode) {
     int crf_d    = (opcode >> 21) & 0x1C;
+    ppc_sync_flags();
     ppc_state.cr = (ppc_state.cr & ~(0xF0000000UL >> crf_d)) |
         ((ppc_state.spr[SPR::XER] & 0xF0000000UL) >> crf_d);
     ppc_state.spr[SPR::XER] &= 0x0FFFFFFF;
@@ -1219,7 +1215,7 @@ void dppc_interpreter::ppc_bc(uint32_t opcode) {
         (ppc_state.spr[SPR::CTR])--; /* decrement CTR */
     }
     ctr_ok = (br_bo & 0x04) | ((ppc_state.spr[SPR::CTR] != 0) == !(br_bo & 0x02));
-    cnd_ok = (br_bo & 0x10) | (!(ppc_state.cr & (0x80000000UL >> br_bi)) == !(br_bo & 0x08));
+    cnd_ok = (br_bo & 0x10) || (!(ppc_get_cr() & (0x80000000UL >> br_bi)) == !(br_bo & 0x08));
 
     if (ctr_ok && cnd_ok) {
         if (a)
@@ -1257,7 +1253,7 @@ void dppc_interpreter::ppc_bcctr(uint32_t opcode) {
         new_ctr = ctr;
     }
     ctr_ok = (br_bo & 0x04) | ((new_ctr != 0) == !(br_bo & 0x02));
-    cnd_ok = (br_bo & 0x10) | (!(ppc_state.cr & (0x80000000UL >> br_bi)) == !(br_bo & 0x08));
+    cnd_ok = (br_bo & 0x10) || (!(ppc_get_cr() & (0x80000000UL >> br_bi)) == !(br_bo & 0x08));
 
     if (ctr_ok && cnd_ok) {
         ppc_next_instruction_address = (ctr & ~3UL);
@@ -1284,7 +1280,7 @@ void dppc_interpreter::ppc_bclr(uint32_t opcode) {
         (ppc_state.spr[SPR::CTR])--; /* decrement CTR */
     }
     ctr_ok = (br_bo & 0x04) | ((ppc_state.spr[SPR::CTR] != 0) == !(br_bo & 0x02));
-    cnd_ok = (br_bo & 0x10) | (!(ppc_state.cr & (0x80000000UL >> br_bi)) == !(br_bo & 0x08));
+    cnd_ok = (br_bo & 0x10) || (!(ppc_get_cr() & (0x80000000UL >> br_bi)) == !(br_bo & 0x08));
 
     if (ctr_ok && cnd_ok) {
         ppc_next_instruction_address = (ppc_state.spr[SPR::LR] & ~3UL);
@@ -1311,6 +1307,8 @@ void dppc_interpreter::ppc_cmp(uint32_t opcode) {
     int crf_d = (opcode >> 21) & 0x1C;
     ppc_grab_regsab(opcode);
     uint32_t xercon = (ppc_state.spr[SPR::XER] & XER::SO) >> 3;
+    if (!crf_d)
+        ppc_discard_crf0();
     uint32_t cmp_c = (int32_t(ppc_result_a) == int32_t(ppc_result_b)) ? 0x20000000UL : \
         (int32_t(ppc_result_a) > int32_t(ppc_result_b)) ? 0x40000000UL : 0x80000000UL;
     ppc_state.cr = ((ppc_state.cr & ~(0xf0000000UL >> crf_d)) | ((cmp_c + xercon) >> crf_d));
@@ -1327,6 +1325,8 @@ void dppc_interpreter::ppc_cmpi(uint32_t opcode) {
     int crf_d = (opcode >> 21) & 0x1C;
     ppc_grab_regsasimm(opcode);
     uint32_t xercon = (ppc_state.spr[SPR::XER] & XER::SO) >> 3;
+    if (!crf_d)
+        ppc_discard_crf0();
     uint32_t cmp_c = (int32_t(ppc_result_a) == simm) ? 0x20000000UL : \
         (int32_t(ppc_result_a) > simm) ? 0x40000000UL : 0x80000000UL;
     ppc_state.cr = ((ppc_state.cr & ~(0xf0000000UL >> crf_d)) | ((cmp_c + xercon) >> crf_d));
@@ -1343,6 +1343,8 @@ void dppc_interpreter::ppc_cmpl(uint32_t opcode) {
     int crf_d = (opcode >> 21) & 0x1C;
     ppc_grab_regsab(opcode);
     uint32_t xercon = (ppc_state.spr[SPR::XER] & XER::SO) >> 3;
+    if (!crf_d)
+        ppc_discard_crf0();
     uint32_t cmp_c = (ppc_result_a == ppc_result_b) ? 0x20000000UL : \
         (ppc_result_a > ppc_result_b) ? 0x40000000UL : 0x80000000UL;
     ppc_state.cr = ((ppc_state.cr & ~(0xf0000000UL >> crf_d)) | ((cmp_c + xercon) >> crf_d));
@@ -1357,6 +1359,8 @@ void dppc_interpreter::ppc_cmpli(uint32_t opcode) {
 #endif
     ppc_grab_crfd_regsauimm(opcode);
     uint32_t xercon = (ppc_state.spr[SPR::XER] & XER::SO) >> 3;
+    if (!crf_d)
+        ppc_discard_crf0();
     uint32_t cmp_c = (ppc_result_a == uimm) ? 0x20000000UL : \
         (ppc_result_a > uimm) ? 0x40000000UL : 0x80000000UL;
     ppc_state.cr = ((ppc_state.cr & ~(0xf0000000UL >> crf_d)) | ((cmp_c + xercon) >> crf_d));
@@ -1368,6 +1372,8 @@ void dppc_interpreter::ppc_mcrf(uint32_t opcode) {
     int crf_d       = (opcode >> 21) & 0x1C;
     int crf_s       = (opcode >> 16) & 0x1C;
 
+    ppc_sync_flags();
+
     // extract and right justify source flags field
     uint32_t grab_s = (ppc_state.cr >> (28 - crf_s)) & 0xF;
 
@@ -1376,6 +1382,7 @@ void dppc_interpreter::ppc_mcrf(uint32_t opcode) {
 
 void dppc_interpreter::ppc_crand(uint32_t opcode) {
     ppc_grab_dab(opcode);
+    ppc_sync_flags();
     uint8_t ir = (ppc_state.cr >> (31 - reg_a)) & (ppc_state.cr >> (31 - reg_b));
     if (ir & 1) {
         ppc_state.cr |= (0x80000000UL >> reg_d);
@@ -1386,6 +1393,7 @@ void dppc_interpreter::ppc_crand(uint32_t opcode) {
 
 void dppc_interpreter::ppc_crandc(uint32_t opcode) {
     ppc_grab_dab(opcode);
+    ppc_sync_flags();
     if ((ppc_state.cr & (0x80000000UL >> reg_a)) && !(ppc_state.cr & (0x80000000UL >> reg_b))) {
         ppc_state.cr |= (0x80000000UL >> reg_d);
     } else {
@@ -1394,6 +1402,7 @@ void dppc_interpreter::ppc_crandc(uint32_t opcode) {
 }
 void dppc_interpreter::ppc_creqv(uint32_t opcode) {
     ppc_grab_dab(opcode);
+    ppc_sync_flags();
     uint8_t ir = (ppc_state.cr >> (31 - reg_a)) ^ (ppc_state.cr >> (31 - reg_b));
     if (ir & 1) { // compliment is implemented by swapping the following if/else bodies
         ppc_state.cr &= ~(0x80000000UL >> reg_d);
@@ -1403,6 +1412,7 @@ void dppc_interpreter::ppc_creqv(uint32_t opcode) {
 }
 void dppc_interpreter::ppc_crnand(uint32_t opcode) {
     ppc_grab_dab(opcode);
+    ppc_sync_flags();
     uint8_t ir = (ppc_state.cr >> (31 - reg_a)) & (ppc_state.cr >> (31 - reg_b));
     if (ir & 1) {
         ppc_state.cr &= ~(0x80000000UL >> reg_d);
@@ -1413,6 +1423,7 @@ void dppc_interpreter::ppc_crnand(uint32_t opcode) {
 
 void dppc_interpreter::ppc_crnor(uint32_t opcode) {
     ppc_grab_dab(opcode);
+    ppc_sync_flags();
     uint8_t ir = (ppc_state.cr >> (31 - reg_a)) | (ppc_state.cr >> (31 - reg_b));
     if (ir & 1) {
         ppc_state.cr &= ~(0x80000000UL >> reg_d);
@@ -1423,6 +1434,7 @@ void dppc_interpreter::ppc_crnor(uint32_t opcode) {
 
 void dppc_interpreter::ppc_cror(uint32_t opcode) {
     ppc_grab_dab(opcode);
+    ppc_sync_flags();
     uint8_t ir = (ppc_state.cr >> (31 - reg_a)) | (ppc_state.cr >> (31 - reg_b));
     if (ir & 1) {
         ppc_state.cr |= (0x80000000UL >> reg_d);
@@ -1433,6 +1445,7 @@ void dppc_interpreter::ppc_cror(uint32_t opcode) {
 
 void dppc_interpreter::ppc_crorc(uint32_t opcode) {
     ppc_grab_dab(opcode);
+    ppc_sync_flags();
     if ((ppc_state.cr & (0x80000000UL >> reg_a)) || !(ppc_state.cr & (0x80000000UL >> reg_b))) {
         ppc_state.cr |= (0x80000000UL >> reg_d);
     } else {
@@ -1441,6 +1454,7 @@ void dppc_interpreter::ppc_crorc(uint32_t opcode) {
 }
 void dppc_interpreter::ppc_crxor(uint32_t opcode) {
     ppc_grab_dab(opcode);
+    ppc_sync_flags();
     uint8_t ir = (ppc_state.cr >> (31 - reg_a)) ^ (ppc_state.cr >> (31 - reg_b));
     if (ir & 1) {
         ppc_state.cr |= (0x80000000UL >> reg_d);
@@ -1537,7 +1551,15 @@ void dppc_interpreter::ppc_sync(uint32_t opcode) {
 }
 
 void dppc_interpreter::ppc_icbi(uint32_t opcode) {
-    /* placeholder */
+    ppc_grab_regsab(opcode);
+    uint32_t ea = ppc_result_b + (reg_a ? ppc_result_a : 0);
+    uint32_t pa;
+
+    // predecoded instructions of this cache block may be stale now
+    if (mmu_translate_dbg(ea, pa))
+        ppc_block_cache_invalidate(pa & ~31UL, pa | 31);
+    else
+        ppc_block_cache_flush();
 }
 
 void dppc_interpreter::ppc_dcbf(uint32_t opcode) {
@@ -1575,9 +1597,20 @@ void dppc_interpreter::ppc_dcbz(uint32_t opcode) {
 
     ea &= 0xFFFFFFE0UL; // align EA on a 32-byte boundary
 
-    // the following is not especially efficient but necessary
-    // to make BlockZero under Mac OS 8.x and later to work
+    // the whole block lies within one page
+    uint8_t* host_va = mmu_translate_dmem(ea, true);
+    if (host_va) {
+        std::memset(host_va, 0, 32);
+        return;
+    }
+    if (ppc_faulted())
+        return;
+
+    // no memory behind this page, fall back to single writes
+    // all four writes hit the same page, only the first one can fault
     mmu_write_vmem<uint64_t>(opcode, ea +  0, 0);
+    if (ppc_faulted())
+        return;
     mmu_write_vmem<uint64_t>(opcode, ea +  8, 0);
     mmu_write_vmem<uint64_t>(opcode, ea + 16, 0);
     mmu_write_vmem<uint64_t>(opcode, ea + 24, 0);
@@ -1626,6 +1659,8 @@ void dppc_interpreter::ppc_stu(uint32_t opcode) {
         uint32_t ea = int32_t(int16_t(opcode));
         ea += ppc_result_a;
         mmu_write_vmem<T>(opcode, ea, ppc_result_d);
+        if (ppc_faulted())
+            return;
         ppc_state.gpr[reg_a] = ea;
     }
     else {
@@ -1648,6 +1683,8 @@ void dppc_interpreter::ppc_stux(uint32_t opcode) {
     if (reg_a != 0) {
         uint32_t ea = ppc_result_a + ppc_result_b;
         mmu_write_vmem<T>(opcode, ea, ppc_result_d);
+        if (ppc_faulted())
+            return;
         ppc_state.gpr[reg_a] = ea;
     }
     else {
@@ -1675,10 +1712,13 @@ void dppc_interpreter::ppc_stwcx(uint32_t opcode) {
 #endif
     ppc_grab_regssab(opcode);
     uint32_t ea = (reg_a == 0) ? ppc_result_b : (ppc_result_a + ppc_result_b);
+    ppc_discard_crf0();
     ppc_state.cr &= 0x0FFFFFFFUL; // clear CR0
     ppc_state.cr |= (ppc_state.spr[SPR::XER] & XER::SO) >> 3; // copy XER[SO] to CR0[SO]
     if (ppc_state.reserve) {
         mmu_write_vmem<uint32_t>(opcode, ea, ppc_result_d);
+        if (ppc_faulted())
+            return;
         ppc_state.reserve = false;
         ppc_state.cr |= 0x20000000UL; // set CR0[EQ]
     }
@@ -1705,12 +1745,16 @@ void dppc_interpreter::ppc_stmw(uint32_t opcode) {
     /* what should we do if EA is unaligned? */
     if (ea & 3) {
         ppc_alignment_exception(opcode, ea);
+        return;
     }
 
-    for (; reg_s <= 31; reg_s++) {
-        mmu_write_vmem<uint32_t>(opcode, ea, ppc_state.gpr[reg_s]);
-        ea += 4;
-    }
+    uint32_t words[32];
+    uint32_t num_words = 32 - reg_s;
+
+    for (uint32_t i = 0; i < num_words; i++)
+        words[i] = BYTESWAP_32(ppc_state.gpr[reg_s + i]);
+
+    mmu_write_vmem_bulk(opcode, ea, reinterpret_cast<uint8_t*>(words), num_words * 4);
 }
 
 template <class T>
@@ -1722,6 +1766,8 @@ void dppc_interpreter::ppc_lz(uint32_t opcode) {
     uint32_t ea = int32_t(int16_t(opcode));
     ea += reg_a ? ppc_result_a : 0;
     uint32_t ppc_result_d = mmu_read_vmem<T>(opcode, ea);
+    if (ppc_faulted())
+        return;
     ppc_store_iresult_reg(reg_d, ppc_result_d);
 }
 
@@ -1739,6 +1785,8 @@ void dppc_interpreter::ppc_lzu(uint32_t opcode) {
     if ((reg_a != reg_d) && reg_a != 0) {
         ea += ppc_result_a;
         uint32_t ppc_result_d = mmu_read_vmem<T>(opcode, ea);
+        if (ppc_faulted())
+            return;
         ppc_store_iresult_reg(reg_d, ppc_result_d);
         uint32_t ppc_result_a = ea;
         ppc_store_iresult_reg(reg_a, ppc_result_a);
@@ -1759,6 +1807,8 @@ void dppc_interpreter::ppc_lzx(uint32_t opcode) {
     ppc_grab_regsdab(opcode);
     uint32_t ea = ppc_result_b + (reg_a ? ppc_result_a : 0);
     uint32_t ppc_result_d = mmu_read_vmem<T>(opcode, ea);
+    if (ppc_faulted())
+        return;
     ppc_store_iresult_reg(reg_d, ppc_result_d);
 }
 
@@ -1775,6 +1825,8 @@ void dppc_interpreter::ppc_lzux(uint32_t opcode) {
     if ((reg_a != reg_d) && reg_a != 0) {
         uint32_t ea = ppc_result_a + ppc_result_b;
         uint32_t ppc_result_d = mmu_read_vmem<T>(opcode, ea);
+        if (ppc_faulted())
+            return;
         ppc_store_iresult_reg(reg_d, ppc_result_d);
         ppc_result_a = ea;
         ppc_store_iresult_reg(reg_a, ppc_result_a);
@@ -1795,6 +1847,8 @@ void dppc_interpreter::ppc_lha(uint32_t opcode) {
     uint32_t ea = int32_t(int16_t(opcode));
     ea += (reg_a ? ppc_result_a : 0);
     int16_t val = mmu_read_vmem<uint16_t>(opcode, ea);
+    if (ppc_faulted())
+        return;
     ppc_store_iresult_reg(reg_d, int32_t(val));
 }
 
@@ -1807,6 +1861,8 @@ void dppc_interpreter::ppc_lhau(uint32_t opcode) {
         uint32_t ea = int32_t(int16_t(opcode));
         ea += ppc_result_a;
         int16_t val = mmu_read_vmem<uint16_t>(opcode, ea);
+        if (ppc_faulted())
+            return;
         ppc_store_iresult_reg(reg_d, int32_t(val));
         uint32_t ppc_result_a = ea;
         ppc_store_iresult_reg(reg_a, ppc_result_a);
@@ -1823,6 +1879,8 @@ void dppc_interpreter::ppc_lhaux(uint32_t opcode) {
     if ((reg_a != reg_d) && reg_a != 0) {
         uint32_t ea = ppc_result_a + ppc_result_b;
         int16_t val = mmu_read_vmem<uint16_t>(opcode, ea);
+        if (ppc_faulted())
+            return;
         ppc_store_iresult_reg(reg_d, int32_t(val));
         uint32_t ppc_result_a = ea;
         ppc_store_iresult_reg(reg_a, ppc_result_a);
@@ -1839,6 +1897,8 @@ void dppc_interpreter::ppc_lhax(uint32_t opcode) {
     ppc_grab_regsdab(opcode);
     uint32_t ea = ppc_result_b + (reg_a ? ppc_result_a : 0);
     int16_t val = mmu_read_vmem<uint16_t>(opcode, ea);
+    if (ppc_faulted())
+        return;
     ppc_store_iresult_reg(reg_d, int32_t(val));
 }
 
@@ -1849,6 +1909,8 @@ void dppc_interpreter::ppc_lhbrx(uint32_t opcode) {
     ppc_grab_regsdab(opcode);
     uint32_t ea = ppc_result_b + (reg_a ? ppc_result_a : 0);
     uint32_t ppc_result_d = uint32_t(BYTESWAP_16(mmu_read_vmem<uint16_t>(opcode, ea)));
+    if (ppc_faulted())
+        return;
     ppc_store_iresult_reg(reg_d, ppc_result_d);
 }
 
@@ -1859,6 +1921,8 @@ void dppc_interpreter::ppc_lwbrx(uint32_t opcode) {
     ppc_grab_regsdab(opcode);
     uint32_t ea = ppc_result_b + (reg_a ? ppc_result_a : 0);
     uint32_t ppc_result_d = BYTESWAP_32(mmu_read_vmem<uint32_t>(opcode, ea));
+    if (ppc_faulted())
+        return;
     ppc_store_iresult_reg(reg_d, ppc_result_d);
 }
 
@@ -1871,6 +1935,8 @@ void dppc_interpreter::ppc_lwarx(uint32_t opcode) {
     uint32_t ea = ppc_result_b + (reg_a ? ppc_result_a : 0);
     ppc_state.reserve     = true;
     uint32_t ppc_result_d = mmu_read_vmem<uint32_t>(opcode, ea);
+    if (ppc_faulted())
+        return;
     ppc_store_iresult_reg(reg_d, ppc_result_d);
 }
 
@@ -1881,12 +1947,39 @@ void dppc_interpreter::ppc_lmw(uint32_t opcode) {
     ppc_grab_regsda(opcode);
     uint32_t ea = int32_t(int16_t(opcode));
     ea += (reg_a ? ppc_result_a : 0);
-    // How many words to load in memory - using a do-while for this
-    do {
-       ppc_state.gpr[reg_d] = mmu_read_vmem<uint32_t>(opcode, ea);
-       ea += 4;
-       reg_d++;
-    } while (reg_d < 32);
+
+    uint32_t words[32];
+    uint32_t num_words = 32 - reg_d;
+
+    // registers loaded before an exception keep their new values
+    num_words = mmu_read_vmem_bulk(opcode, ea, reinterpret_cast<uint8_t*>(words),
+                                   num_words * 4) / 4;
+
+    for (uint32_t i = 0; i < num_words; i++)
+        ppc_state.gpr[reg_d + i] = BYTESWAP_32(words[i]);
+}
+
+// Move a byte string into consecutive GPRs starting with reg, wrapping around
+// through GPR0. The last register is padded with zeros. Registers in skip_mask
+// aren't modified.
+static void ppc_string_to_regs(int reg, const uint8_t* buf, uint32_t size,
+                               uint32_t skip_mask = 0) {
+    for (uint32_t pos = 0; pos < size; pos += 4, reg = (reg + 1) & 0x1F) {
+        uint32_t val = 0;
+        for (uint32_t i = 0; i < 4 && pos + i < size; i++)
+            val |= buf[pos + i] << (24 - i * 8);
+        if (!(skip_mask & (1U << reg)))
+            ppc_state.gpr[reg] = val;
+    }
+}
+
+// Collect a byte string from consecutive GPRs starting with reg.
+static void ppc_regs_to_string(int reg, uint8_t* buf, uint32_t size) {
+    for (uint32_t pos = 0; pos < size; pos += 4, reg = (reg + 1) & 0x1F) {
+        uint32_t val = ppc_state.gpr[reg];
+        for (uint32_t i = 0; i < 4 && pos + i < size; i++)
+            buf[pos + i] = val >> (24 - i * 8);
+    }
 }
 
 void dppc_interpreter::ppc_lswi(uint32_t opcode) {
@@ -1898,31 +1991,12 @@ void dppc_interpreter::ppc_lswi(uint32_t opcode) {
     uint32_t grab_inb              = (opcode >> 11) & 0x1F;
     grab_inb                       = grab_inb ? grab_inb : 32;
 
-    while (grab_inb >= 4) {
-        ppc_state.gpr[reg_d] = mmu_read_vmem<uint32_t>(opcode, ea);
-        reg_d++;
-        if (reg_d >= 32) {    // wrap around through GPR0
-            reg_d = 0;
-        }
-        ea += 4;
-        grab_inb -= 4;
-    }
+    uint8_t buf[32];
+    uint32_t done = mmu_read_vmem_bulk(opcode, ea, buf, grab_inb);
+    if (done < grab_inb)
+        done &= ~3; // only fully loaded registers get updated
 
-    // handle remaining bytes
-    switch (grab_inb) {
-    case 1:
-        ppc_state.gpr[reg_d] = mmu_read_vmem<uint8_t>(opcode, ea) << 24;
-        break;
-    case 2:
-        ppc_state.gpr[reg_d] = mmu_read_vmem<uint16_t>(opcode, ea) << 16;
-        break;
-    case 3:
-        ppc_state.gpr[reg_d] = mmu_read_vmem<uint16_t>(opcode, ea) << 16;
-        ppc_state.gpr[reg_d] += mmu_read_vmem<uint8_t>(opcode, ea + 2) << 8;
-        break;
-    default:
-        break;
-    }
+    ppc_string_to_regs(reg_d, buf, done);
 }
 
 void dppc_interpreter::ppc_lswx(uint32_t opcode) {
@@ -1941,30 +2015,19 @@ void dppc_interpreter::ppc_lswx(uint32_t opcode) {
 */
 
     uint32_t ea = ppc_result_b + (reg_a ? ppc_result_a : 0);
-    int grab_inb = ppc_state.spr[SPR::XER] & 0x7F;
+    uint32_t grab_inb = ppc_state.spr[SPR::XER] & 0x7F;
 
-    while (grab_inb > 0) {
-        if (is_601 && (reg_d == reg_b || (reg_a != 0 && reg_d == reg_a))) {
-            /* skip loading reg_b for MPC601 */
-        } else {
-            switch (grab_inb) {
-            case 1:
-                ppc_state.gpr[reg_d] = mmu_read_vmem<uint8_t>(opcode, ea) << 24;
-                return;
-            case 2:
-                ppc_state.gpr[reg_d] = mmu_read_vmem<uint16_t>(opcode, ea) << 16;
-                return;
-            case 3:
-                ppc_state.gpr[reg_d] = (mmu_read_vmem<uint16_t>(opcode, ea) << 16)
-                                     | (mmu_read_vmem<uint8_t>(opcode, ea + 2) << 8);
-                return;
-            }
-            ppc_state.gpr[reg_d] = mmu_read_vmem<uint32_t>(opcode, ea);
-        }
-        reg_d = (reg_d + 1) & 0x1F; // wrap around through GPR0
-        ea += 4;
-        grab_inb -= 4;
-    }
+    /* skip loading reg_a and reg_b for MPC601 */
+    uint32_t skip_mask = 0;
+    if (is_601)
+        skip_mask = (1U << reg_b) | (reg_a ? 1U << reg_a : 0);
+
+    uint8_t buf[128];
+    uint32_t done = mmu_read_vmem_bulk(opcode, ea, buf, grab_inb);
+    if (done < grab_inb)
+        done &= ~3; // only fully loaded registers get updated
+
+    ppc_string_to_regs(reg_d, buf, done, skip_mask);
 }
 
 void dppc_interpreter::ppc_stswi(uint32_t opcode) {
@@ -1975,31 +2038,9 @@ void dppc_interpreter::ppc_stswi(uint32_t opcode) {
     uint32_t ea = reg_a ? ppc_result_a : 0;
     uint32_t grab_inb = rot_sh ? rot_sh : 32;
 
-    while (grab_inb >= 4) {
-        mmu_write_vmem<uint32_t>(opcode, ea, ppc_state.gpr[reg_s]);
-        reg_s++;
-        if (reg_s >= 32) {    // wrap around through GPR0
-            reg_s = 0;
-        }
-        ea += 4;
-        grab_inb -= 4;
-    }
-
-    // handle remaining bytes
-    switch (grab_inb) {
-    case 1:
-        mmu_write_vmem<uint8_t>(opcode, ea, ppc_state.gpr[reg_s] >> 24);
-        break;
-    case 2:
-        mmu_write_vmem<uint16_t>(opcode, ea, ppc_state.gpr[reg_s] >> 16);
-        break;
-    case 3:
-        mmu_write_vmem<uint16_t>(opcode, ea, ppc_state.gpr[reg_s] >> 16);
-        mmu_write_vmem<uint8_t>(opcode, ea + 2, (ppc_state.gpr[reg_s] >> 8) & 0xFF);
-        break;
-    default:
-        break;
-    }
+    uint8_t buf[128];
+    ppc_regs_to_string(reg_s, buf, grab_inb);
+    mmu_write_vmem_bulk(opcode, ea, buf, grab_inb);
 }
 
 void dppc_interpreter::ppc_stswx(uint32_t opcode) {
@@ -2010,31 +2051,9 @@ void dppc_interpreter::ppc_stswx(uint32_t opcode) {
     uint32_t ea = ppc_result_b + (reg_a ? ppc_result_a : 0);
     uint32_t grab_inb = ppc_state.spr[SPR::XER] & 127;
 
-    while (grab_inb >= 4) {
-        mmu_write_vmem<uint32_t>(opcode, ea, ppc_state.gpr[reg_s]);
-        reg_s++;
-        if (reg_s >= 32) {    // wrap around through GPR0
-            reg_s = 0;
-        }
-        ea += 4;
-        grab_inb -= 4;
-    }
-
-    // handle remaining bytes
-    switch (grab_inb) {
-    case 1:
-        mmu_write_vmem<uint8_t>(opcode, ea, ppc_state.gpr[reg_s] >> 24);
-        break;
-    case 2:
-        mmu_write_vmem<uint16_t>(opcode, ea, ppc_state.gpr[reg_s] >> 16);
-        break;
-    case 3:
-        mmu_write_vmem<uint16_t>(opcode, ea, ppc_state.gpr[reg_s] >> 16);
-        mmu_write_vmem<uint8_t>(opcode, ea + 2, (ppc_state.gpr[reg_s] >> 8) & 0xFF);
-        break;
-    default:
-        break;
-    }
+    uint8_t buf[128];
+    ppc_regs_to_string(reg_s, buf, grab_inb);
+    mmu_write_vmem_bulk(opcode, ea, buf, grab_inb);
 }
 
 void dppc_interpreter::ppc_eciwx(uint32_t opcode) {
@@ -2043,6 +2062,7 @@ void dppc_interpreter::ppc_eciwx(uint32_t opcode) {
     // error if EAR[E] != 1
     if (!(ppc_state.spr[282] & ear_enable)) {
         ppc_exception_handler(Except_Type::EXC_DSI, 0x0);
+        return;
     }
 
     ppc_grab_regsdab(opcode);
@@ -2050,9 +2070,12 @@ void dppc_interpreter::ppc_eciwx(uint32_t opcode) {
 
     if (ea & 0x3) {
         ppc_alignment_exception(opcode, ea);
+        return;
     }
 
     uint32_t ppc_result_d = mmu_read_vmem<uint32_t>(opcode, ea);
+    if (ppc_faulted())
+        return;
 
     ppc_store_iresult_reg(reg_d, ppc_result_d);
 }
@@ -2063,6 +2086,7 @@ void dppc_interpreter::ppc_ecowx(uint32_t opcode) {
     // error if EAR[E] != 1
     if (!(ppc_state.spr[282] & ear_enable)) {
         ppc_exception_handler(Except_Type::EXC_DSI, 0x0);
+        return;
     }
 
     ppc_grab_regssab(opcode);
@@ -2070,6 +2094,7 @@ void dppc_interpreter::ppc_ecowx(uint32_t opcode) {
 
     if (ea & 0x3) {
         ppc_alignment_exception(opcode, ea);
+        return;
     }
 
     mmu_write_vmem<uint32_t>(opcode, ea, ppc_result_d);
@@ -2093,13 +2118,13 @@ void dppc_interpreter::ppc_tlbia(uint32_t opcode) {
 #ifdef CPU_PROFILING
     num_supervisor_instrs++;
 #endif
-    /* placeholder */
     if (ppc_state.msr & MSR::PR) {
         ppc_exception_handler(Except_Type::EXC_PROGRAM, Exc_Cause::NOT_ALLOWED);
         return;
     }
 
-    LOG_F(ERROR, "tlbia needs to be implemented!");
+    pte_cache_flush();
+    mmu_pat_ctx_changed();
 }
 
 void dppc_interpreter::ppc_tlbld(uint32_t opcode) {
@@ -2126,3 +2151,55 @@ void dppc_interpreter::ppc_tlbsync(uint32_t opcode) {
         return;
     }
 }
+
+// Fused instruction pairs
+
+/* Pairs taken from a CPU_PROFILING_OPS dump of compiled code: string, copy,
+   sort, list, search, CRC, event dispatch, rectangle, recursion and jump
+   table loops. Listed are all pairs making up at least 1% of the whole run
+   and of at least two of these loops run on their own, most frequent first.
+   Re-run the dump before changing this list. Both handlers are inlined into
+   one function so the pair costs a single dispatch. Instructions still
+   execute one after the other so exceptions leave the same state as unfused
+   code. */
+template <PPCOpcode first, PPCOpcode second>
+[[gnu::flatten]] static void ppc_fused(uint32_t opcode1, uint32_t opcode2) {
+    first(opcode1);
+    if (exec_flags)
+        return;
+    ppc_state.pc += 4;
+    second(opcode2);
+}
+
+using namespace dppc_interpreter;
+
+const PPCFusedPair ppc_fused_pairs[] = {
+#define FUSE(a, b) {a, b, ppc_fused<a, b>}
+    {nullptr, nullptr, nullptr},
+    FUSE(ppc_addi<SHFT0>,   ppc_cmpl),                  // addi + cmplw
+    FUSE(ppc_lz<uint32_t>,  ppc_addi<SHFT0>),           // lwz + addi
+    FUSE(ppc_cmpl,          (ppc_bc<LK0, AA0>)),        // cmplw + bc
+    FUSE(ppc_addi<SHFT0>,   ppc_st<uint32_t>),          // addi + stw
+    FUSE(ppc_rlwinm,        ppc_cmpli),                 // rlwinm + cmplwi
+    FUSE(ppc_rlwinm,        ppc_addi<SHFT0>),           // rlwinm + addi
+    FUSE(ppc_rlwinm,        ppc_lzx<uint32_t>),         // slwi + lwzx
+    FUSE(ppc_addi<SHFT0>,   ppc_mtspr),                 // li + mtctr
+    FUSE(ppc_mtspr,         ppc_bclr<LK0>),             // mtlr + blr
+    FUSE(ppc_mfspr,         ppc_st<uint32_t>),          // mflr + stw
+    FUSE(ppc_st<uint32_t>,  ppc_stu<uint32_t>),         // stw + stwu
+    FUSE((ppc_logical<ppc_or, RC0>), (ppc_b<LK1, AA0>)),// mr + bl
+    FUSE(ppc_st<uint32_t>,  ppc_st<uint32_t>),          // stw + stw
+    FUSE(ppc_addi<SHFT0>,   (ppc_logical<ppc_or, RC0>)),// addi + mr
+    FUSE(ppc_addi<SHFT0>,   ppc_addi<SHFT0>),           // addi + addi
+    FUSE(ppc_st<uint32_t>,  (ppc_bc<LK0, AA0>)),        // stw + bc
+    FUSE(ppc_cmp,           (ppc_bc<LK0, AA0>)),        // cmpw + bc
+#undef FUSE
+};
+
+uint32_t ppc_fuse_pair(PPCOpcode first, PPCOpcode second) {
+    for (uint32_t i = 1; i < std::size(ppc_fused_pairs); i++) {
+        if (ppc_fused_pairs[i].first == first && ppc_fused_pairs[i].second == second)
+            return i;
+    }
+    return 0;
+}
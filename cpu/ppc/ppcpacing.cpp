@@ -0,0 +1,83 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Real-time pacing of the virtual clock. */
+
+#include "ppcpacing.h"
+
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <thread>
+
+bool   ppc_realtime       = false;
+double ppc_realtime_speed = 1.0;
+
+/** Longest single sleep, bounds how late a posted command is noticed. */
+constexpr uint64_t PPC_PACING_SLEEP_STEP_NS = 1000000;
+
+typedef std::chrono::steady_clock pacing_clock;
+
+static pacing_clock::time_point host_base;
+static uint64_t                 virt_base;
+
+void ppc_pacing_reset(uint64_t virt_ns) {
+    host_base = pacing_clock::now();
+    virt_base = virt_ns;
+}
+
+bool ppc_pacing_sync(uint64_t virt_ns, const std::atomic<bool>& wake) {
+    if (virt_ns < virt_base) {
+        ppc_pacing_reset(virt_ns);
+        return false;
+    }
+
+    auto virt_elapsed = std::chrono::nanoseconds(
+        uint64_t((virt_ns - virt_base) / std::max(ppc_realtime_speed, 0.001)));
+    auto target = host_base + virt_elapsed;
+    auto now    = pacing_clock::now();
+
+    if (now > target) {
+        // behind real time, forget about lag beyond the allowed drift
+        if (now - target > std::chrono::nanoseconds(PPC_PACING_MAX_DRIFT_NS)) {
+            LOG_F(9, "Pacing: guest %lld us behind, resynchronizing",
+                  (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+                      now - target).count());
+            host_base = now - std::chrono::nanoseconds(PPC_PACING_MAX_DRIFT_NS) - virt_elapsed;
+        }
+        return false;
+    }
+
+    if (target - now < std::chrono::nanoseconds(PPC_PACING_MIN_SLEEP_NS))
+        return false;
+
+    // ahead of real time, sleep it off in steps so posted commands get through
+    while (now < target && !wake.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_until(
+            std::min(target, now + std::chrono::nanoseconds(PPC_PACING_SLEEP_STEP_NS)));
+        now = pacing_clock::now();
+    }
+
+    return true;
+}
@@ -0,0 +1,61 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Real-time pacing of the virtual clock.
+
+    Virtual time is still derived from the instruction count, so pacing
+    changes when the host runs the guest, never what the guest computes.
+    Whenever the execution loops check for events, virtual time is compared
+    against host monotonic time scaled by the speed cap:
+
+    - if the guest is ahead, the CPU thread sleeps until host time catches
+      up, waking early when another thread posts a command;
+    - if the guest falls behind by more than the allowed drift, the lag is
+      written off so that it doesn't race ahead to make up for it later
+      (after a debugger stop or when the host is too slow).
+ */
+
+#ifndef PPC_PACING_H
+#define PPC_PACING_H
+
+#include <atomic>
+#include <cinttypes>
+
+/** Pace virtual time against host time. */
+extern bool ppc_realtime;
+
+/** Fastest the guest may run compared to real time, 1.0 = real time. */
+extern double ppc_realtime_speed;
+
+/** Largest lag of virtual time behind host time that is made up for. */
+constexpr uint64_t PPC_PACING_MAX_DRIFT_NS = 50000000;
+
+/** Sleeps shorter than this aren't worth the wakeup. */
+constexpr uint64_t PPC_PACING_MIN_SLEEP_NS = 200000;
+
+/** Start pacing from the given virtual time. */
+extern void ppc_pacing_reset(uint64_t virt_ns);
+
+/** Wait until host time has caught up with virtual time virt_ns.
+    Returns early once wake is set. Returns true if it slept. */
+extern bool ppc_pacing_sync(uint64_t virt_ns, const std::atomic<bool>& wake);
+
+#endif // PPC_PACING_H
@@ -0,0 +1,1402 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// The AltiVec (vector) opcodes for the processor - ppcvecopcodes.cpp
+
+/** Host SIMD instructions are selected at compile time. SSE2 covers most
+    integer and floating-point operations, SSSE3 adds a single instruction
+    vperm, SSE4.1 the remaining min/max variants and FMA a fused vmaddfp.
+    Everything else falls back to portable scalar code. */
+
+#include "ppcemu.h"
+#include "ppcmacros.h"
+#include "ppcmmu.h"
+#include <bit>
+#include <cfenv>
+#include <cinttypes>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#if defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// Access element i of a vector in big-endian element order.
+template <class T>
+static inline T& velem(VR_storage& v, int i) {
+    if constexpr (std::endian::native == std::endian::little)
+        i ^= 4 / sizeof(T) - 1;
+    if constexpr (std::is_same_v<T, float>)
+        return v.f[i];
+    else if constexpr (sizeof(T) == 1)
+        return reinterpret_cast<T&>(v.ub[i]);
+    else if constexpr (sizeof(T) == 2)
+        return reinterpret_cast<T&>(v.uh[i]);
+    else
+        return reinterpret_cast<T&>(v.uw[i]);
+}
+
+template <class T>
+static inline T velem(const VR_storage& v, int i) {
+    return velem<T>(const_cast<VR_storage&>(v), i);
+}
+
+template <class T>
+using vec_wide_t = std::conditional_t<sizeof(T) == 1,
+                                      std::conditional_t<std::is_signed_v<T>, int16_t, uint16_t>,
+                                      std::conditional_t<std::is_signed_v<T>, int32_t, uint32_t>>;
+
+template <class T>
+using vec_narrow_t = std::conditional_t<sizeof(T) == 4,
+                                        std::conditional_t<std::is_signed_v<T>, int16_t, uint16_t>,
+                                        std::conditional_t<std::is_signed_v<T>, int8_t, uint8_t>>;
+
+// Clamp val to the range of T, recording the saturation in VSCR[SAT].
+template <class T>
+static inline T vec_sat(int64_t val) {
+    if (val > int64_t(std::numeric_limits<T>::max())) {
+        ppc_state.vscr |= VSCR::SAT;
+        return std::numeric_limits<T>::max();
+    }
+    if (val < int64_t(std::numeric_limits<T>::min())) {
+        ppc_state.vscr |= VSCR::SAT;
+        return std::numeric_limits<T>::min();
+    }
+    return T(val);
+}
+
+// Apply fn to each pair of elements of vA and vB.
+template <class T, class F>
+static inline void vec_map(uint32_t opcode, F fn) {
+    ppc_grab_regsvdab(opcode);
+    VR_storage res;
+    for (int i = 0; i < int(16 / sizeof(T)); i++)
+        velem<T>(res, i) = fn(velem<T>(vr_a, i), velem<T>(vr_b, i));
+    ppc_state.vr[reg_d] = res;
+}
+
+// Set CR6 from the result of a vector compare.
+static inline void vec_update_cr6(const VR_storage& res) {
+    uint32_t all_set   = res.uw[0] & res.uw[1] & res.uw[2] & res.uw[3];
+    uint32_t any_set   = res.uw[0] | res.uw[1] | res.uw[2] | res.uw[3];
+    uint32_t crf       = (all_set == 0xFFFFFFFFUL ? 0x8 : 0) | (any_set ? 0 : 0x2);
+    ppc_state.cr = (ppc_state.cr & ~(0xFUL << 4)) | (crf << 4);
+}
+
+#if defined(__SSE2__)
+static inline __m128i vec_load(int reg) {
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(&ppc_state.vr[reg]));
+}
+
+static inline void vec_store(int reg, __m128i val) {
+    _mm_store_si128(reinterpret_cast<__m128i*>(&ppc_state.vr[reg]), val);
+}
+
+// Select elements of a where mask is set, elements of b otherwise.
+static inline __m128i vec_select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+template <class T>
+static inline __m128i vec_cmpeq(__m128i a, __m128i b) {
+    if constexpr (sizeof(T) == 1)
+        return _mm_cmpeq_epi8(a, b);
+    else if constexpr (sizeof(T) == 2)
+        return _mm_cmpeq_epi16(a, b);
+    else
+        return _mm_cmpeq_epi32(a, b);
+}
+
+template <class T>
+static inline __m128i vec_cmpgt(__m128i a, __m128i b) {
+    if constexpr (std::is_unsigned_v<T>) {
+        // SSE2 only has signed compares, bias both sides into the signed range
+        __m128i bias;
+        if constexpr (sizeof(T) == 1)
+            bias = _mm_set1_epi8(char(0x80));
+        else if constexpr (sizeof(T) == 2)
+            bias = _mm_set1_epi16(short(0x8000));
+        else
+            bias = _mm_set1_epi32(int(0x80000000));
+        a = _mm_xor_si128(a, bias);
+        b = _mm_xor_si128(b, bias);
+    }
+    if constexpr (sizeof(T) == 1)
+        return _mm_cmpgt_epi8(a, b);
+    else if constexpr (sizeof(T) == 2)
+        return _mm_cmpgt_epi16(a, b);
+    else
+        return _mm_cmpgt_epi32(a, b);
+}
+
+template <class T>
+static inline __m128i vec_max(__m128i a, __m128i b) {
+    if constexpr (std::is_same_v<T, uint8_t>)
+        return _mm_max_epu8(a, b);
+    else if constexpr (std::is_same_v<T, int16_t>)
+        return _mm_max_epi16(a, b);
+#if defined(__SSE4_1__)
+    else if constexpr (std::is_same_v<T, int8_t>)
+        return _mm_max_epi8(a, b);
+    else if constexpr (std::is_same_v<T, uint16_t>)
+        return _mm_max_epu16(a, b);
+    else if constexpr (std::is_same_v<T, int32_t>)
+        return _mm_max_epi32(a, b);
+    else if constexpr (std::is_same_v<T, uint32_t>)
+        return _mm_max_epu32(a, b);
+#endif
+    else
+        return vec_select(vec_cmpgt<T>(a, b), a, b);
+}
+
+template <class T>
+static inline __m128i vec_min(__m128i a, __m128i b) {
+    if constexpr (std::is_same_v<T, uint8_t>)
+        return _mm_min_epu8(a, b);
+    else if constexpr (std::is_same_v<T, int16_t>)
+        return _mm_min_epi16(a, b);
+#if defined(__SSE4_1__)
+    else if constexpr (std::is_same_v<T, int8_t>)
+        return _mm_min_epi8(a, b);
+    else if constexpr (std::is_same_v<T, uint16_t>)
+        return _mm_min_epu16(a, b);
+    else if constexpr (std::is_same_v<T, int32_t>)
+        return _mm_min_epi32(a, b);
+    else if constexpr (std::is_same_v<T, uint32_t>)
+        return _mm_min_epu32(a, b);
+#endif
+    else
+        return vec_select(vec_cmpgt<T>(a, b), b, a);
+}
+
+// Set VSCR[SAT] if the saturated result differs from the wrapped one.
+static inline void vec_check_sat(__m128i sat_res, __m128i mod_res) {
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(sat_res, mod_res)) != 0xFFFF)
+        ppc_state.vscr |= VSCR::SAT;
+}
+
+// Returns true if any element is an infinity or a NaN.
+static inline bool vec_any_special(__m128i v) {
+    const __m128i exp_mask = _mm_set1_epi32(0x7F800000);
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(v, exp_mask), exp_mask)) != 0;
+}
+
+// Replace denormals with zeroes of the same sign.
+static inline __m128i vec_flush(__m128i v) {
+    const __m128i exp_mask = _mm_set1_epi32(0x7F800000);
+    __m128i denorm = _mm_cmpeq_epi32(_mm_and_si128(v, exp_mask), _mm_setzero_si128());
+    return _mm_andnot_si128(_mm_and_si128(denorm, _mm_set1_epi32(0x7FFFFFFF)), v);
+}
+#endif
+
+/* Floating-point helpers.
+
+   AltiVec arithmetic always rounds to nearest and doesn't touch the FPSCR.
+   NaN operands are propagated (quieted) in vA, vB, vC priority, invalid
+   operations produce the default NaN. With VSCR[NJ] set, denormal operands
+   and results are replaced by zeroes. */
+
+constexpr uint32_t VEC_DEFAULT_NAN = 0x7FC00000UL;
+
+class VecRoundingGuard {
+public:
+    VecRoundingGuard() : rn(ppc_state.fpscr & FPSCR::RN_MASK) {
+        if (rn)
+            std::fesetround(FE_TONEAREST);
+    }
+    ~VecRoundingGuard() {
+        if (rn)
+            set_host_rounding_mode(rn);
+    }
+
+private:
+    uint8_t rn;
+};
+
+static inline bool vec_non_java() {
+    return ppc_state.vscr & VSCR::NJ;
+}
+
+static inline float vec_flush(float f, bool nj) {
+    if (nj && std::fpclassify(f) == FP_SUBNORMAL)
+        return std::copysign(0.0f, f);
+    return f;
+}
+
+template <class F, class... Args>
+static inline float vec_fp_elem(bool nj, F fn, Args... args) {
+    for (float arg : {args...}) {
+        if (std::isnan(arg))
+            return std::bit_cast<float>(std::bit_cast<uint32_t>(arg) | uint32_t(0x00400000));
+    }
+    float res = fn(vec_flush(args, nj)...);
+    if (std::isnan(res))
+        return std::bit_cast<float>(VEC_DEFAULT_NAN);
+    return vec_flush(res, nj);
+}
+
+template <class F>
+static inline void vec_fp_map1(uint32_t opcode, F fn) {
+    ppc_grab_regsvdb(opcode);
+    bool nj = vec_non_java();
+    VecRoundingGuard guard;
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.f[i] = vec_fp_elem(nj, fn, vr_b.f[i]);
+    ppc_state.vr[reg_d] = res;
+}
+
+template <class F>
+static inline void vec_fp_map2(uint32_t opcode, F fn) {
+    ppc_grab_regsvdab(opcode);
+    bool nj = vec_non_java();
+    VecRoundingGuard guard;
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.f[i] = vec_fp_elem(nj, fn, vr_a.f[i], vr_b.f[i]);
+    ppc_state.vr[reg_d] = res;
+}
+
+template <class F>
+static inline void vec_fp_map3(uint32_t opcode, F fn) {
+    ppc_grab_regsvdabc(opcode);
+    bool nj = vec_non_java();
+    VecRoundingGuard guard;
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.f[i] = vec_fp_elem(nj, fn, vr_a.f[i], vr_b.f[i], vr_c.f[i]);
+    ppc_state.vr[reg_d] = res;
+}
+
+#if defined(__SSE2__)
+// Run a SIMD implementation of a two operand floating-point instruction if
+// no element needs special treatment. Returns false otherwise.
+template <class S>
+static inline bool vec_fp_simd2(uint32_t opcode, S simd_fn) {
+    ppc_grab_regsvdab(opcode);
+    __m128i a = vec_load(reg_a);
+    __m128i b = vec_load(reg_b);
+    if (vec_any_special(a) || vec_any_special(b))
+        return false;
+    bool nj = vec_non_java();
+    if (nj) {
+        a = vec_flush(a);
+        b = vec_flush(b);
+    }
+    VecRoundingGuard guard;
+    __m128i res = _mm_castps_si128(simd_fn(_mm_castsi128_ps(a), _mm_castsi128_ps(b)));
+    vec_store(reg_d, nj ? vec_flush(res) : res);
+    return true;
+}
+#endif
+
+#if defined(__FMA__)
+template <class S>
+static inline bool vec_fp_simd3(uint32_t opcode, S simd_fn) {
+    ppc_grab_regsvdabc(opcode);
+    __m128i a = vec_load(reg_a);
+    __m128i b = vec_load(reg_b);
+    __m128i c = vec_load(reg_c);
+    if (vec_any_special(a) || vec_any_special(b) || vec_any_special(c))
+        return false;
+    bool nj = vec_non_java();
+    if (nj) {
+        a = vec_flush(a);
+        b = vec_flush(b);
+        c = vec_flush(c);
+    }
+    VecRoundingGuard guard;
+    __m128i res = _mm_castps_si128(simd_fn(_mm_castsi128_ps(a), _mm_castsi128_ps(b),
+                                           _mm_castsi128_ps(c)));
+    vec_store(reg_d, nj ? vec_flush(res) : res);
+    return true;
+}
+#endif
+
+/** Integer arithmetic. */
+
+template <class T>
+void dppc_interpreter::ppc_vaddum(uint32_t opcode) {
+#if defined(__SSE2__)
+    ppc_grab_regsvdab(opcode);
+    __m128i a = vec_load(reg_a);
+    __m128i b = vec_load(reg_b);
+    if constexpr (sizeof(T) == 1)
+        vec_store(reg_d, _mm_add_epi8(a, b));
+    else if constexpr (sizeof(T) == 2)
+        vec_store(reg_d, _mm_add_epi16(a, b));
+    else
+        vec_store(reg_d, _mm_add_epi32(a, b));
+#else
+    vec_map<T>(opcode, [](T a, T b) { return T(a + b); });
+#endif
+}
+
+template void dppc_interpreter::ppc_vaddum<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vaddum<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vaddum<uint32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vsubum(uint32_t opcode) {
+#if defined(__SSE2__)
+    ppc_grab_regsvdab(opcode);
+    __m128i a = vec_load(reg_a);
+    __m128i b = vec_load(reg_b);
+    if constexpr (sizeof(T) == 1)
+        vec_store(reg_d, _mm_sub_epi8(a, b));
+    else if constexpr (sizeof(T) == 2)
+        vec_store(reg_d, _mm_sub_epi16(a, b));
+    else
+        vec_store(reg_d, _mm_sub_epi32(a, b));
+#else
+    vec_map<T>(opcode, [](T a, T b) { return T(a - b); });
+#endif
+}
+
+template void dppc_interpreter::ppc_vsubum<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsubum<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsubum<uint32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vadds(uint32_t opcode) {
+#if defined(__SSE2__)
+    if constexpr (sizeof(T) < 4) {
+        ppc_grab_regsvdab(opcode);
+        __m128i a = vec_load(reg_a);
+        __m128i b = vec_load(reg_b);
+        __m128i res, mod_res;
+        if constexpr (sizeof(T) == 1) {
+            res     = std::is_signed_v<T> ? _mm_adds_epi8(a, b) : _mm_adds_epu8(a, b);
+            mod_res = _mm_add_epi8(a, b);
+        } else {
+            res     = std::is_signed_v<T> ? _mm_adds_epi16(a, b) : _mm_adds_epu16(a, b);
+            mod_res = _mm_add_epi16(a, b);
+        }
+        vec_check_sat(res, mod_res);
+        vec_store(reg_d, res);
+        return;
+    }
+#endif
+    vec_map<T>(opcode, [](T a, T b) { return vec_sat<T>(int64_t(a) + b); });
+}
+
+template void dppc_interpreter::ppc_vadds<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vadds<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vadds<uint32_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vadds<int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vadds<int16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vadds<int32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vsubs(uint32_t opcode) {
+#if defined(__SSE2__)
+    if constexpr (sizeof(T) < 4) {
+        ppc_grab_regsvdab(opcode);
+        __m128i a = vec_load(reg_a);
+        __m128i b = vec_load(reg_b);
+        __m128i res, mod_res;
+        if constexpr (sizeof(T) == 1) {
+            res     = std::is_signed_v<T> ? _mm_subs_epi8(a, b) : _mm_subs_epu8(a, b);
+            mod_res = _mm_sub_epi8(a, b);
+        } else {
+            res     = std::is_signed_v<T> ? _mm_subs_epi16(a, b) : _mm_subs_epu16(a, b);
+            mod_res = _mm_sub_epi16(a, b);
+        }
+        vec_check_sat(res, mod_res);
+        vec_store(reg_d, res);
+        return;
+    }
+#endif
+    vec_map<T>(opcode, [](T a, T b) { return vec_sat<T>(int64_t(a) - b); });
+}
+
+template void dppc_interpreter::ppc_vsubs<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsubs<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsubs<uint32_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsubs<int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsubs<int16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsubs<int32_t>(uint32_t opcode);
+
+void dppc_interpreter::ppc_vaddcuw(uint32_t opcode) {
+    vec_map<uint32_t>(opcode, [](uint32_t a, uint32_t b) { return uint32_t(a + b < a); });
+}
+
+void dppc_interpreter::ppc_vsubcuw(uint32_t opcode) {
+    vec_map<uint32_t>(opcode, [](uint32_t a, uint32_t b) { return uint32_t(a >= b); });
+}
+
+template <class T>
+void dppc_interpreter::ppc_vmax(uint32_t opcode) {
+#if defined(__SSE2__)
+    ppc_grab_regsvdab(opcode);
+    vec_store(reg_d, vec_max<T>(vec_load(reg_a), vec_load(reg_b)));
+#else
+    vec_map<T>(opcode, [](T a, T b) { return a > b ? a : b; });
+#endif
+}
+
+template void dppc_interpreter::ppc_vmax<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmax<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmax<uint32_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmax<int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmax<int16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmax<int32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vmin(uint32_t opcode) {
+#if defined(__SSE2__)
+    ppc_grab_regsvdab(opcode);
+    vec_store(reg_d, vec_min<T>(vec_load(reg_a), vec_load(reg_b)));
+#else
+    vec_map<T>(opcode, [](T a, T b) { return a < b ? a : b; });
+#endif
+}
+
+template void dppc_interpreter::ppc_vmin<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmin<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmin<uint32_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmin<int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmin<int16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmin<int32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vavg(uint32_t opcode) {
+#if defined(__SSE2__)
+    if constexpr (std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>) {
+        ppc_grab_regsvdab(opcode);
+        __m128i a = vec_load(reg_a);
+        __m128i b = vec_load(reg_b);
+        if constexpr (sizeof(T) == 1)
+            vec_store(reg_d, _mm_avg_epu8(a, b));
+        else
+            vec_store(reg_d, _mm_avg_epu16(a, b));
+        return;
+    }
+#endif
+    vec_map<T>(opcode, [](T a, T b) { return T((int64_t(a) + b + 1) >> 1); });
+}
+
+template void dppc_interpreter::ppc_vavg<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vavg<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vavg<uint32_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vavg<int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vavg<int16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vavg<int32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vmule(uint32_t opcode) {
+    using W = vec_wide_t<T>;
+    ppc_grab_regsvdab(opcode);
+    VR_storage res;
+    for (int i = 0; i < int(8 / sizeof(T)); i++)
+        velem<W>(res, i) = W(int64_t(velem<T>(vr_a, i * 2)) * velem<T>(vr_b, i * 2));
+    ppc_state.vr[reg_d] = res;
+}
+
+template void dppc_interpreter::ppc_vmule<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmule<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmule<int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmule<int16_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vmulo(uint32_t opcode) {
+    using W = vec_wide_t<T>;
+    ppc_grab_regsvdab(opcode);
+    VR_storage res;
+    for (int i = 0; i < int(8 / sizeof(T)); i++)
+        velem<W>(res, i) = W(int64_t(velem<T>(vr_a, i * 2 + 1)) * velem<T>(vr_b, i * 2 + 1));
+    ppc_state.vr[reg_d] = res;
+}
+
+template void dppc_interpreter::ppc_vmulo<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmulo<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmulo<int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmulo<int16_t>(uint32_t opcode);
+
+// Multiply-sum: each word of vC plus the products of the elements of vA
+// and vB within that word.
+template <class TA, class TB>
+static inline int64_t vec_msum(const VR_storage& a, const VR_storage& b, const VR_storage& c,
+                               int word) {
+    constexpr int n = 4 / sizeof(TA);
+    int64_t sum = 0;
+    for (int i = word * n; i < (word + 1) * n; i++)
+        sum += int64_t(velem<TA>(a, i)) * velem<TB>(b, i);
+    return sum;
+}
+
+void dppc_interpreter::ppc_vmsumubm(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = uint32_t(vec_msum<uint8_t, uint8_t>(vr_a, vr_b, vr_c, i) + vr_c.uw[i]);
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vmsummbm(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = uint32_t(vec_msum<int8_t, uint8_t>(vr_a, vr_b, vr_c, i) + vr_c.uw[i]);
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vmsumuhm(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = uint32_t(vec_msum<uint16_t, uint16_t>(vr_a, vr_b, vr_c, i) + vr_c.uw[i]);
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vmsumuhs(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = vec_sat<uint32_t>(vec_msum<uint16_t, uint16_t>(vr_a, vr_b, vr_c, i) +
+                                      vr_c.uw[i]);
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vmsumshm(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = uint32_t(vec_msum<int16_t, int16_t>(vr_a, vr_b, vr_c, i) + vr_c.uw[i]);
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vmsumshs(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = vec_sat<int32_t>(vec_msum<int16_t, int16_t>(vr_a, vr_b, vr_c, i) +
+                                     int32_t(vr_c.uw[i]));
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vmhaddshs(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+    VR_storage res;
+    for (int i = 0; i < 8; i++) {
+        int32_t prod = int32_t(velem<int16_t>(vr_a, i)) * velem<int16_t>(vr_b, i);
+        velem<int16_t>(res, i) = vec_sat<int16_t>(int64_t(prod >> 15) + velem<int16_t>(vr_c, i));
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vmhraddshs(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+    VR_storage res;
+    for (int i = 0; i < 8; i++) {
+        int32_t prod = int32_t(velem<int16_t>(vr_a, i)) * velem<int16_t>(vr_b, i) + 0x4000;
+        velem<int16_t>(res, i) = vec_sat<int16_t>(int64_t(prod >> 15) + velem<int16_t>(vr_c, i));
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vmladduhm(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+#if defined(__SSE2__)
+    vec_store(reg_d, _mm_add_epi16(_mm_mullo_epi16(vec_load(reg_a), vec_load(reg_b)),
+                                   vec_load(reg_c)));
+#else
+    VR_storage res;
+    for (int i = 0; i < 8; i++)
+        res.uh[i] = uint16_t(uint32_t(vr_a.uh[i]) * vr_b.uh[i] + vr_c.uh[i]);
+    ppc_state.vr[reg_d] = res;
+#endif
+}
+
+void dppc_interpreter::ppc_vsum4ubs(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++) {
+        int64_t sum = vr_b.uw[i];
+        for (int j = i * 4; j < i * 4 + 4; j++)
+            sum += velem<uint8_t>(vr_a, j);
+        res.uw[i] = vec_sat<uint32_t>(sum);
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vsum4sbs(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++) {
+        int64_t sum = int32_t(vr_b.uw[i]);
+        for (int j = i * 4; j < i * 4 + 4; j++)
+            sum += velem<int8_t>(vr_a, j);
+        res.uw[i] = vec_sat<int32_t>(sum);
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vsum4shs(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++) {
+        int64_t sum = int64_t(int32_t(vr_b.uw[i])) + velem<int16_t>(vr_a, i * 2) +
+                      velem<int16_t>(vr_a, i * 2 + 1);
+        res.uw[i] = vec_sat<int32_t>(sum);
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vsum2sws(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i += 2) {
+        int64_t sum = int64_t(int32_t(vr_a.uw[i])) + int32_t(vr_a.uw[i + 1]) +
+                      int32_t(vr_b.uw[i + 1]);
+        res.uw[i]     = 0;
+        res.uw[i + 1] = vec_sat<int32_t>(sum);
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vsumsws(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    int64_t sum = int32_t(vr_b.uw[3]);
+    for (int i = 0; i < 4; i++)
+        sum += int32_t(vr_a.uw[i]);
+    VR_storage res = {};
+    res.uw[3] = vec_sat<int32_t>(sum);
+    ppc_state.vr[reg_d] = res;
+}
+
+/** Logical and shift instructions. */
+
+template <logical_fun logical_op>
+void dppc_interpreter::ppc_vlogical(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+#if defined(__SSE2__)
+    __m128i a = vec_load(reg_a);
+    __m128i b = vec_load(reg_b);
+    __m128i res;
+    if (logical_op == logical_fun::ppc_and)
+        res = _mm_and_si128(a, b);
+    else if (logical_op == logical_fun::ppc_andc)
+        res = _mm_andnot_si128(b, a);
+    else if (logical_op == logical_fun::ppc_or)
+        res = _mm_or_si128(a, b);
+    else if (logical_op == logical_fun::ppc_nor)
+        res = _mm_xor_si128(_mm_or_si128(a, b), _mm_set1_epi32(-1));
+    else
+        res = _mm_xor_si128(a, b);
+    vec_store(reg_d, res);
+#else
+    VR_storage res;
+    for (int i = 0; i < 4; i++) {
+        if (logical_op == logical_fun::ppc_and)
+            res.uw[i] = vr_a.uw[i] & vr_b.uw[i];
+        else if (logical_op == logical_fun::ppc_andc)
+            res.uw[i] = vr_a.uw[i] & ~vr_b.uw[i];
+        else if (logical_op == logical_fun::ppc_or)
+            res.uw[i] = vr_a.uw[i] | vr_b.uw[i];
+        else if (logical_op == logical_fun::ppc_nor)
+            res.uw[i] = ~(vr_a.uw[i] | vr_b.uw[i]);
+        else
+            res.uw[i] = vr_a.uw[i] ^ vr_b.uw[i];
+    }
+    ppc_state.vr[reg_d] = res;
+#endif
+}
+
+template void dppc_interpreter::ppc_vlogical<ppc_and>(uint32_t opcode);
+template void dppc_interpreter::ppc_vlogical<ppc_andc>(uint32_t opcode);
+template void dppc_interpreter::ppc_vlogical<ppc_or>(uint32_t opcode);
+template void dppc_interpreter::ppc_vlogical<ppc_nor>(uint32_t opcode);
+template void dppc_interpreter::ppc_vlogical<ppc_xor>(uint32_t opcode);
+
+void dppc_interpreter::ppc_vsel(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+#if defined(__SSE2__)
+    vec_store(reg_d, vec_select(vec_load(reg_c), vec_load(reg_b), vec_load(reg_a)));
+#else
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = (vr_a.uw[i] & ~vr_c.uw[i]) | (vr_b.uw[i] & vr_c.uw[i]);
+    ppc_state.vr[reg_d] = res;
+#endif
+}
+
+// Element shift counts come from the low bits of the corresponding element of vB.
+template <class T>
+void dppc_interpreter::ppc_vrl(uint32_t opcode) {
+    vec_map<T>(opcode, [](T a, T b) { return std::rotl(a, b & (sizeof(T) * 8 - 1)); });
+}
+
+template void dppc_interpreter::ppc_vrl<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vrl<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vrl<uint32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vshl(uint32_t opcode) {
+    vec_map<T>(opcode, [](T a, T b) { return T(a << (b & (sizeof(T) * 8 - 1))); });
+}
+
+template void dppc_interpreter::ppc_vshl<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vshl<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vshl<uint32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vshr(uint32_t opcode) {
+    vec_map<T>(opcode, [](T a, T b) { return T(a >> (b & (sizeof(T) * 8 - 1))); });
+}
+
+template void dppc_interpreter::ppc_vshr<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vshr<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vshr<uint32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vsra(uint32_t opcode) {
+    using S = std::make_signed_t<T>;
+    vec_map<T>(opcode, [](T a, T b) { return T(S(a) >> (b & (sizeof(T) * 8 - 1))); });
+}
+
+template void dppc_interpreter::ppc_vsra<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsra<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsra<uint32_t>(uint32_t opcode);
+
+// Whole vector shifts take their count from the last byte of vB.
+void dppc_interpreter::ppc_vsl(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    unsigned sh = velem<uint8_t>(vr_b, 15) & 7;
+    VR_storage res;
+    for (int i = 0; i < 4; i++) {
+        uint64_t pair = (uint64_t(vr_a.uw[i]) << 32) | (i < 3 ? vr_a.uw[i + 1] : 0);
+        res.uw[i]     = uint32_t((pair << sh) >> 32);
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vsr(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    unsigned sh = velem<uint8_t>(vr_b, 15) & 7;
+    VR_storage res;
+    for (int i = 0; i < 4; i++) {
+        uint64_t pair = (uint64_t(i > 0 ? vr_a.uw[i - 1] : 0) << 32) | vr_a.uw[i];
+        res.uw[i]     = uint32_t(pair >> sh);
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vslo(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    int sh = (velem<uint8_t>(vr_b, 15) >> 3) & 15;
+    VR_storage res;
+    for (int i = 0; i < 16; i++)
+        velem<uint8_t>(res, i) = (i + sh < 16) ? velem<uint8_t>(vr_a, i + sh) : 0;
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vsro(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    int sh = (velem<uint8_t>(vr_b, 15) >> 3) & 15;
+    VR_storage res;
+    for (int i = 0; i < 16; i++)
+        velem<uint8_t>(res, i) = (i >= sh) ? velem<uint8_t>(vr_a, i - sh) : 0;
+    ppc_state.vr[reg_d] = res;
+}
+
+/** Integer compares. */
+
+template <class T, field_rc rec>
+void dppc_interpreter::ppc_vcmpeq(uint32_t opcode) {
+#if defined(__SSE2__)
+    ppc_grab_regsvdab(opcode);
+    vec_store(reg_d, vec_cmpeq<T>(vec_load(reg_a), vec_load(reg_b)));
+#else
+    int reg_d = (opcode >> 21) & 31;
+    vec_map<T>(opcode, [](T a, T b) { return a == b ? T(~0) : T(0); });
+#endif
+    if (rec)
+        vec_update_cr6(ppc_state.vr[reg_d]);
+}
+
+template void dppc_interpreter::ppc_vcmpeq<uint8_t, RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpeq<uint8_t, RC1>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpeq<uint16_t, RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpeq<uint16_t, RC1>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpeq<uint32_t, RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpeq<uint32_t, RC1>(uint32_t opcode);
+
+template <class T, field_rc rec>
+void dppc_interpreter::ppc_vcmpgt(uint32_t opcode) {
+#if defined(__SSE2__)
+    ppc_grab_regsvdab(opcode);
+    vec_store(reg_d, vec_cmpgt<T>(vec_load(reg_a), vec_load(reg_b)));
+#else
+    int reg_d = (opcode >> 21) & 31;
+    vec_map<T>(opcode, [](T a, T b) { return a > b ? T(~0) : T(0); });
+#endif
+    if (rec)
+        vec_update_cr6(ppc_state.vr[reg_d]);
+}
+
+template void dppc_interpreter::ppc_vcmpgt<uint8_t, RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<uint8_t, RC1>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<uint16_t, RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<uint16_t, RC1>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<uint32_t, RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<uint32_t, RC1>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<int8_t, RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<int8_t, RC1>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<int16_t, RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<int16_t, RC1>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<int32_t, RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgt<int32_t, RC1>(uint32_t opcode);
+
+/** Permutation, merge, splat, pack and unpack instructions. */
+
+void dppc_interpreter::ppc_vperm(uint32_t opcode) {
+    ppc_grab_regsvdabc(opcode);
+#if defined(__SSSE3__)
+    // byte element i lives at host byte (i ^ 3) on little-endian hosts
+    __m128i ctrl = vec_load(reg_c);
+    __m128i idx  = _mm_and_si128(ctrl, _mm_set1_epi8(0x0F));
+    if constexpr (std::endian::native == std::endian::little)
+        idx = _mm_xor_si128(idx, _mm_set1_epi8(0x03));
+    __m128i from_b = _mm_cmpeq_epi8(_mm_and_si128(ctrl, _mm_set1_epi8(0x10)), _mm_set1_epi8(0x10));
+    vec_store(reg_d, vec_select(from_b, _mm_shuffle_epi8(vec_load(reg_b), idx),
+                                _mm_shuffle_epi8(vec_load(reg_a), idx)));
+#else
+    VR_storage res;
+    for (int i = 0; i < 16; i++) {
+        uint8_t sel = velem<uint8_t>(vr_c, i);
+        velem<uint8_t>(res, i) = velem<uint8_t>((sel & 0x10) ? vr_b : vr_a, sel & 0xF);
+    }
+    ppc_state.vr[reg_d] = res;
+#endif
+}
+
+void dppc_interpreter::ppc_vsldoi(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    int sh = (opcode >> 6) & 15;
+    VR_storage res;
+    for (int i = 0; i < 16; i++) {
+        int src = i + sh;
+        velem<uint8_t>(res, i) = src < 16 ? velem<uint8_t>(vr_a, src) : velem<uint8_t>(vr_b, src - 16);
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+template <class T>
+void dppc_interpreter::ppc_vmrgh(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    VR_storage res;
+    for (int i = 0; i < int(8 / sizeof(T)); i++) {
+        velem<T>(res, i * 2)     = velem<T>(vr_a, i);
+        velem<T>(res, i * 2 + 1) = velem<T>(vr_b, i);
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+template void dppc_interpreter::ppc_vmrgh<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmrgh<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmrgh<uint32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vmrgl(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    constexpr int half = 8 / sizeof(T);
+    VR_storage res;
+    for (int i = 0; i < half; i++) {
+        velem<T>(res, i * 2)     = velem<T>(vr_a, half + i);
+        velem<T>(res, i * 2 + 1) = velem<T>(vr_b, half + i);
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+template void dppc_interpreter::ppc_vmrgl<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmrgl<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vmrgl<uint32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vsplt(uint32_t opcode) {
+    ppc_grab_regsvdb(opcode);
+    constexpr int num_elems = 16 / sizeof(T);
+    T val = velem<T>(vr_b, (opcode >> 16) & (num_elems - 1));
+    VR_storage res;
+    for (int i = 0; i < num_elems; i++)
+        velem<T>(res, i) = val;
+    ppc_state.vr[reg_d] = res;
+}
+
+template void dppc_interpreter::ppc_vsplt<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsplt<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vsplt<uint32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vspltis(uint32_t opcode) {
+    int reg_d = (opcode >> 21) & 31;
+    T simm    = T(int32_t(opcode << 11) >> 27);
+    VR_storage res;
+    for (int i = 0; i < int(16 / sizeof(T)); i++)
+        velem<T>(res, i) = simm;
+    ppc_state.vr[reg_d] = res;
+}
+
+template void dppc_interpreter::ppc_vspltis<int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vspltis<int16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vspltis<int32_t>(uint32_t opcode);
+
+// Pack the elements of vA followed by those of vB into the lower half
+// of their size, either by truncation or saturation.
+template <class T>
+void dppc_interpreter::ppc_vpkum(uint32_t opcode) {
+    using N = vec_narrow_t<T>;
+    ppc_grab_regsvdab(opcode);
+    constexpr int num_elems = 16 / sizeof(T);
+    VR_storage res;
+    for (int i = 0; i < num_elems; i++) {
+        velem<N>(res, i)             = N(velem<T>(vr_a, i));
+        velem<N>(res, num_elems + i) = N(velem<T>(vr_b, i));
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+template void dppc_interpreter::ppc_vpkum<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vpkum<uint32_t>(uint32_t opcode);
+
+template <class T, class N>
+void dppc_interpreter::ppc_vpks(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    constexpr int num_elems = 16 / sizeof(T);
+    VR_storage res;
+    for (int i = 0; i < num_elems; i++) {
+        velem<N>(res, i)             = vec_sat<N>(velem<T>(vr_a, i));
+        velem<N>(res, num_elems + i) = vec_sat<N>(velem<T>(vr_b, i));
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+template void dppc_interpreter::ppc_vpks<uint16_t, uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vpks<uint32_t, uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vpks<int16_t, uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vpks<int32_t, uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vpks<int16_t, int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vpks<int32_t, int16_t>(uint32_t opcode);
+
+static inline uint16_t vec_pack_pixel(uint32_t val) {
+    return ((val >> 9) & 0xFC00) | ((val >> 6) & 0x03E0) | ((val >> 3) & 0x001F);
+}
+
+void dppc_interpreter::ppc_vpkpx(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++) {
+        velem<uint16_t>(res, i)     = vec_pack_pixel(vr_a.uw[i]);
+        velem<uint16_t>(res, i + 4) = vec_pack_pixel(vr_b.uw[i]);
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+// Sign-extend the first (high) or last (low) half of the elements of vB.
+template <class T>
+void dppc_interpreter::ppc_vupkh(uint32_t opcode) {
+    using W = vec_wide_t<T>;
+    ppc_grab_regsvdb(opcode);
+    VR_storage res;
+    for (int i = 0; i < int(8 / sizeof(T)); i++)
+        velem<W>(res, i) = velem<T>(vr_b, i);
+    ppc_state.vr[reg_d] = res;
+}
+
+template void dppc_interpreter::ppc_vupkh<int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vupkh<int16_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_vupkl(uint32_t opcode) {
+    using W = vec_wide_t<T>;
+    ppc_grab_regsvdb(opcode);
+    constexpr int half = 8 / sizeof(T);
+    VR_storage res;
+    for (int i = 0; i < half; i++)
+        velem<W>(res, i) = velem<T>(vr_b, half + i);
+    ppc_state.vr[reg_d] = res;
+}
+
+template void dppc_interpreter::ppc_vupkl<int8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_vupkl<int16_t>(uint32_t opcode);
+
+static inline uint32_t vec_unpack_pixel(uint16_t val) {
+    return ((val & 0x8000) ? 0xFF000000UL : 0) | ((val & 0x7C00) << 6) |
+           ((val & 0x03E0) << 3) | (val & 0x001F);
+}
+
+void dppc_interpreter::ppc_vupkhpx(uint32_t opcode) {
+    ppc_grab_regsvdb(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = vec_unpack_pixel(velem<uint16_t>(vr_b, i));
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vupklpx(uint32_t opcode) {
+    ppc_grab_regsvdb(opcode);
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = vec_unpack_pixel(velem<uint16_t>(vr_b, i + 4));
+    ppc_state.vr[reg_d] = res;
+}
+
+/** Floating-point arithmetic. */
+
+void dppc_interpreter::ppc_vaddfp(uint32_t opcode) {
+#if defined(__SSE2__)
+    if (vec_fp_simd2(opcode, [](__m128 a, __m128 b) { return _mm_add_ps(a, b); }))
+        return;
+#endif
+    vec_fp_map2(opcode, [](float a, float b) { return a + b; });
+}
+
+void dppc_interpreter::ppc_vsubfp(uint32_t opcode) {
+#if defined(__SSE2__)
+    if (vec_fp_simd2(opcode, [](__m128 a, __m128 b) { return _mm_sub_ps(a, b); }))
+        return;
+#endif
+    vec_fp_map2(opcode, [](float a, float b) { return a - b; });
+}
+
+// vD = vA * vC + vB, the product isn't rounded.
+void dppc_interpreter::ppc_vmaddfp(uint32_t opcode) {
+#if defined(__FMA__)
+    if (vec_fp_simd3(opcode, [](__m128 a, __m128 b, __m128 c) { return _mm_fmadd_ps(a, c, b); }))
+        return;
+#endif
+    vec_fp_map3(opcode, [](float a, float b, float c) { return std::fmaf(a, c, b); });
+}
+
+// vD = -(vA * vC - vB)
+void dppc_interpreter::ppc_vnmsubfp(uint32_t opcode) {
+#if defined(__FMA__)
+    if (vec_fp_simd3(opcode, [](__m128 a, __m128 b, __m128 c) {
+            return _mm_xor_ps(_mm_fmsub_ps(a, c, b), _mm_set1_ps(-0.0f));
+        }))
+        return;
+#endif
+    vec_fp_map3(opcode, [](float a, float b, float c) { return -std::fmaf(a, c, -b); });
+}
+
+// Zeroes of opposite signs compare equal, +0 is the larger one.
+void dppc_interpreter::ppc_vmaxfp(uint32_t opcode) {
+#if defined(__SSE2__)
+    if (vec_fp_simd2(opcode, [](__m128 a, __m128 b) {
+            __m128 eq = _mm_cmpeq_ps(a, b);
+            return _mm_or_ps(_mm_and_ps(eq, _mm_and_ps(a, b)), _mm_andnot_ps(eq, _mm_max_ps(a, b)));
+        }))
+        return;
+#endif
+    vec_fp_map2(opcode, [](float a, float b) {
+        if (a == b)
+            return std::bit_cast<float>(std::bit_cast<uint32_t>(a) & std::bit_cast<uint32_t>(b));
+        return a > b ? a : b;
+    });
+}
+
+void dppc_interpreter::ppc_vminfp(uint32_t opcode) {
+#if defined(__SSE2__)
+    if (vec_fp_simd2(opcode, [](__m128 a, __m128 b) {
+            __m128 eq = _mm_cmpeq_ps(a, b);
+            return _mm_or_ps(_mm_and_ps(eq, _mm_or_ps(a, b)), _mm_andnot_ps(eq, _mm_min_ps(a, b)));
+        }))
+        return;
+#endif
+    vec_fp_map2(opcode, [](float a, float b) {
+        if (a == b)
+            return std::bit_cast<float>(std::bit_cast<uint32_t>(a) | std::bit_cast<uint32_t>(b));
+        return a < b ? a : b;
+    });
+}
+
+// The estimates are computed exactly, that's well within the required accuracy.
+void dppc_interpreter::ppc_vrefp(uint32_t opcode) {
+    vec_fp_map1(opcode, [](float b) { return 1.0f / b; });
+}
+
+void dppc_interpreter::ppc_vrsqrtefp(uint32_t opcode) {
+    vec_fp_map1(opcode, [](float b) { return 1.0f / std::sqrt(b); });
+}
+
+void dppc_interpreter::ppc_vexptefp(uint32_t opcode) {
+    vec_fp_map1(opcode, [](float b) { return std::exp2(b); });
+}
+
+void dppc_interpreter::ppc_vlogefp(uint32_t opcode) {
+    vec_fp_map1(opcode, [](float b) { return std::log2(b); });
+}
+
+void dppc_interpreter::ppc_vrfin(uint32_t opcode) {
+    vec_fp_map1(opcode, [](float b) { return std::nearbyint(b); });
+}
+
+void dppc_interpreter::ppc_vrfiz(uint32_t opcode) {
+    vec_fp_map1(opcode, [](float b) { return std::trunc(b); });
+}
+
+void dppc_interpreter::ppc_vrfip(uint32_t opcode) {
+    vec_fp_map1(opcode, [](float b) { return std::ceil(b); });
+}
+
+void dppc_interpreter::ppc_vrfim(uint32_t opcode) {
+    vec_fp_map1(opcode, [](float b) { return std::floor(b); });
+}
+
+// Fixed-point conversions scale by 2^UIMM where UIMM is in the vA field.
+void dppc_interpreter::ppc_vcfux(uint32_t opcode) {
+    ppc_grab_regsvdb(opcode);
+    int uimm = (opcode >> 16) & 31;
+    VecRoundingGuard guard;
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.f[i] = float(std::ldexp(double(vr_b.uw[i]), -uimm));
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vcfsx(uint32_t opcode) {
+    ppc_grab_regsvdb(opcode);
+    int uimm = (opcode >> 16) & 31;
+    VecRoundingGuard guard;
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.f[i] = float(std::ldexp(double(int32_t(vr_b.uw[i])), -uimm));
+    ppc_state.vr[reg_d] = res;
+}
+
+template <class T>
+static inline void vec_fp_to_fixed(uint32_t opcode) {
+    ppc_grab_regsvdb(opcode);
+    int uimm = (opcode >> 16) & 31;
+    VR_storage res;
+    for (int i = 0; i < 4; i++) {
+        float val = vr_b.f[i];
+        if (std::isnan(val)) {
+            res.uw[i] = 0;
+        } else {
+            double scaled = std::trunc(std::ldexp(double(val), uimm));
+            if (scaled > double(std::numeric_limits<T>::max()))
+                res.uw[i] = vec_sat<T>(std::numeric_limits<int64_t>::max());
+            else if (scaled < double(std::numeric_limits<T>::min()))
+                res.uw[i] = vec_sat<T>(std::numeric_limits<int64_t>::min());
+            else
+                res.uw[i] = T(int64_t(scaled));
+        }
+    }
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_vctuxs(uint32_t opcode) {
+    vec_fp_to_fixed<uint32_t>(opcode);
+}
+
+void dppc_interpreter::ppc_vctsxs(uint32_t opcode) {
+    vec_fp_to_fixed<int32_t>(opcode);
+}
+
+/** Floating-point compares. */
+
+template <field_rc rec>
+void dppc_interpreter::ppc_vcmpeqfp(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    bool nj = vec_non_java();
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = vec_flush(vr_a.f[i], nj) == vec_flush(vr_b.f[i], nj) ? 0xFFFFFFFFUL : 0;
+    ppc_state.vr[reg_d] = res;
+    if (rec)
+        vec_update_cr6(res);
+}
+
+template void dppc_interpreter::ppc_vcmpeqfp<RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpeqfp<RC1>(uint32_t opcode);
+
+template <field_rc rec>
+void dppc_interpreter::ppc_vcmpgefp(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    bool nj = vec_non_java();
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = vec_flush(vr_a.f[i], nj) >= vec_flush(vr_b.f[i], nj) ? 0xFFFFFFFFUL : 0;
+    ppc_state.vr[reg_d] = res;
+    if (rec)
+        vec_update_cr6(res);
+}
+
+template void dppc_interpreter::ppc_vcmpgefp<RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgefp<RC1>(uint32_t opcode);
+
+template <field_rc rec>
+void dppc_interpreter::ppc_vcmpgtfp(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    bool nj = vec_non_java();
+    VR_storage res;
+    for (int i = 0; i < 4; i++)
+        res.uw[i] = vec_flush(vr_a.f[i], nj) > vec_flush(vr_b.f[i], nj) ? 0xFFFFFFFFUL : 0;
+    ppc_state.vr[reg_d] = res;
+    if (rec)
+        vec_update_cr6(res);
+}
+
+template void dppc_interpreter::ppc_vcmpgtfp<RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpgtfp<RC1>(uint32_t opcode);
+
+// Bit 0 is set if vA > vB, bit 1 if vA < -vB. CR6 only tells if all elements are in bounds.
+template <field_rc rec>
+void dppc_interpreter::ppc_vcmpbfp(uint32_t opcode) {
+    ppc_grab_regsvdab(opcode);
+    bool nj = vec_non_java();
+    VR_storage res;
+    for (int i = 0; i < 4; i++) {
+        float a   = vec_flush(vr_a.f[i], nj);
+        float b   = vec_flush(vr_b.f[i], nj);
+        res.uw[i] = (a <= b ? 0 : 0x80000000UL) | (a >= -b ? 0 : 0x40000000UL);
+    }
+    ppc_state.vr[reg_d] = res;
+    if (rec) {
+        uint32_t crf = (res.uw[0] | res.uw[1] | res.uw[2] | res.uw[3]) ? 0 : 0x2;
+        ppc_state.cr = (ppc_state.cr & ~(0xFUL << 4)) | (crf << 4);
+    }
+}
+
+template void dppc_interpreter::ppc_vcmpbfp<RC0>(uint32_t opcode);
+template void dppc_interpreter::ppc_vcmpbfp<RC1>(uint32_t opcode);
+
+/** Status and control register. */
+
+void dppc_interpreter::ppc_mfvscr(uint32_t opcode) {
+    int reg_d = (opcode >> 21) & 31;
+    VR_storage res = {};
+    res.uw[3] = ppc_state.vscr;
+    ppc_state.vr[reg_d] = res;
+}
+
+void dppc_interpreter::ppc_mtvscr(uint32_t opcode) {
+    int reg_b = (opcode >> 11) & 31;
+    ppc_state.vscr = ppc_state.vr[reg_b].uw[3] & (VSCR::NJ | VSCR::SAT);
+}
+
+/** Vector loads and stores. They're decoded along with the other
+    X-form instructions and have to check MSR[VEC] themselves. */
+
+static inline bool vec_unavailable(uint32_t opcode) {
+    if (ppc_state.msr & MSR::VEC)
+        return false;
+    ppc_vec_off(opcode);
+    return true;
+}
+
+void dppc_interpreter::ppc_lvx(uint32_t opcode) {
+    if (vec_unavailable(opcode))
+        return;
+    ppc_grab_dab(opcode);
+    uint32_t ea = (ppc_state.gpr[reg_b] + (reg_a ? ppc_state.gpr[reg_a] : 0)) & ~15;
+    uint64_t hi = mmu_read_vmem<uint64_t>(opcode, ea);
+    if (ppc_faulted())
+        return;
+    uint64_t lo = mmu_read_vmem<uint64_t>(opcode, ea + 8);
+    if (ppc_faulted())
+        return;
+    VR_storage& vr_d = ppc_state.vr[reg_d];
+    vr_d.uw[0] = uint32_t(hi >> 32);
+    vr_d.uw[1] = uint32_t(hi);
+    vr_d.uw[2] = uint32_t(lo >> 32);
+    vr_d.uw[3] = uint32_t(lo);
+}
+
+void dppc_interpreter::ppc_stvx(uint32_t opcode) {
+    if (vec_unavailable(opcode))
+        return;
+    ppc_grab_dab(opcode);
+    uint32_t ea = (ppc_state.gpr[reg_b] + (reg_a ? ppc_state.gpr[reg_a] : 0)) & ~15;
+    const VR_storage& vr_s = ppc_state.vr[reg_d];
+    mmu_write_vmem<uint64_t>(opcode, ea, (uint64_t(vr_s.uw[0]) << 32) | vr_s.uw[1]);
+    if (ppc_faulted())
+        return;
+    mmu_write_vmem<uint64_t>(opcode, ea + 8, (uint64_t(vr_s.uw[2]) << 32) | vr_s.uw[3]);
+}
+
+template <class T>
+void dppc_interpreter::ppc_lvex(uint32_t opcode) {
+    if (vec_unavailable(opcode))
+        return;
+    ppc_grab_dab(opcode);
+    uint32_t ea = (ppc_state.gpr[reg_b] + (reg_a ? ppc_state.gpr[reg_a] : 0)) & ~(sizeof(T) - 1);
+    T val = mmu_read_vmem<T>(opcode, ea);
+    if (ppc_faulted())
+        return;
+    velem<T>(ppc_state.vr[reg_d], (ea & 15) / sizeof(T)) = val;
+}
+
+template void dppc_interpreter::ppc_lvex<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_lvex<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_lvex<uint32_t>(uint32_t opcode);
+
+template <class T>
+void dppc_interpreter::ppc_stvex(uint32_t opcode) {
+    if (vec_unavailable(opcode))
+        return;
+    ppc_grab_dab(opcode);
+    uint32_t ea = (ppc_state.gpr[reg_b] + (reg_a ? ppc_state.gpr[reg_a] : 0)) & ~(sizeof(T) - 1);
+    mmu_write_vmem<T>(opcode, ea, velem<T>(ppc_state.vr[reg_d], (ea & 15) / sizeof(T)));
+}
+
+template void dppc_interpreter::ppc_stvex<uint8_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_stvex<uint16_t>(uint32_t opcode);
+template void dppc_interpreter::ppc_stvex<uint32_t>(uint32_t opcode);
+
+// Permute control vectors for unaligned accesses, they don't touch memory.
+void dppc_interpreter::ppc_lvsl(uint32_t opcode) {
+    if (vec_unavailable(opcode))
+        return;
+    ppc_grab_dab(opcode);
+    uint32_t sh = (ppc_state.gpr[reg_b] + (reg_a ? ppc_state.gpr[reg_a] : 0)) & 15;
+    VR_storage& vr_d = ppc_state.vr[reg_d];
+    for (int i = 0; i < 16; i++)
+        velem<uint8_t>(vr_d, i) = uint8_t(sh + i);
+}
+
+void dppc_interpreter::ppc_lvsr(uint32_t opcode) {
+    if (vec_unavailable(opcode))
+        return;
+    ppc_grab_dab(opcode);
+    uint32_t sh = (ppc_state.gpr[reg_b] + (reg_a ? ppc_state.gpr[reg_a] : 0)) & 15;
+    VR_storage& vr_d = ppc_state.vr[reg_d];
+    for (int i = 0; i < 16; i++)
+        velem<uint8_t>(vr_d, i) = uint8_t(16 - sh + i);
+}
+
+void dppc_interpreter::ppc_dst(uint32_t opcode) {
+    // Data stream touches are only hints, they don't raise AltiVec unavailable
+    // exceptions either. dstst and dss are handled here as well.
+    return;
+}
@@ -0,0 +1,205 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Tests of the fixed-point virtual clock, its calibration and real-time pacing. */
+
+#include "../ppcclock.h"
+#include "../ppcemu.h"
+#include "../ppcpacing.h"
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+extern uint64_t g_icycles;
+
+typedef chrono::steady_clock host_clock;
+
+static int ntested;
+static int nfailed;
+
+static void check(bool cond, const char* msg) {
+    ntested++;
+    if (!cond) {
+        cout << "Clock test failed: " << msg << endl;
+        nfailed++;
+    }
+}
+
+static uint64_t host_ns_since(host_clock::time_point start) {
+    return chrono::duration_cast<chrono::nanoseconds>(host_clock::now() - start).count();
+}
+
+/** The fixed ratio must reproduce the plain shift, across rebases too. */
+static void test_fixed_ratio() {
+    ppc_clock_calibrate = false;
+    g_icycles           = 0;
+    ppc_cycles_pc       = ppc_state.pc;
+    ppc_clock_init(4);
+
+    check(ppc_clock_mips() == 62.5, "fixed ratio runs at 1000 / 16 MIPS");
+    check(ppc_clock_ns_to_cycles(1000) == 62, "1000 ns are 62 instructions at 16 ns each");
+    check(ppc_clock_ns_to_cycles(UINT64_MAX) == (1ULL << (63 - PPC_CLOCK_FRAC_BITS - 4)),
+          "far away deadlines are clamped instead of overflowing");
+
+    const uint64_t steps[] = {1, 12345, 0xFFFFFFFFULL, 0x100000005ULL, 0x2FFFFFFF7ULL,
+                              0x123456789AULL};
+    bool exact = true;
+    for (uint64_t cycles : steps) {
+        g_icycles = cycles;
+        ppc_clock_update();
+        exact &= get_virt_time_ns() == cycles << 4;
+    }
+    check(exact, "virtual time equals instructions << 4 across rebases");
+
+    // instructions of the current block retired so far count as well
+    ppc_cycles_pc = ppc_state.pc - 12;
+    check(get_virt_time_ns() == (g_icycles + 3) << 4, "retired block instructions are included");
+    ppc_cycles_pc = ppc_state.pc;
+}
+
+/** Run guest instructions at a steady host rate until the clock takes a
+    measurement, then compare it to the rate actually achieved. Skipped
+    instructions must not count as executed. */
+static void test_calibration() {
+    ppc_clock_calibrate = true;
+    is_deterministic    = false;
+    g_icycles           = 0;
+    ppc_clock_init(4);
+
+    auto     start      = host_clock::now();
+    uint64_t executed   = 0;
+    bool     continuous = true;
+
+    while (ppc_clock_mips() == 62.5 && host_ns_since(start) < 2000000000ULL) {
+        auto step = host_clock::now();
+        while (host_ns_since(step) < 10000)
+            ;
+        g_icycles += 2000;
+        ppc_clock_skipped += 1000;
+        executed += 1000;
+
+        uint64_t before = get_virt_time_ns();
+        ppc_clock_update();
+        continuous &= get_virt_time_ns() == before;
+    }
+
+    double expected = executed * 1000.0 / host_ns_since(start);
+    check(ppc_clock_mips() != 62.5, "a measurement is taken after the window elapsed");
+    check(fabs(ppc_clock_mips() - expected) < expected * 0.1,
+          "calibrated rate matches the executed instructions");
+    check(continuous, "virtual time doesn't jump when the rate changes");
+
+    double cycles = double(ppc_clock_ns_to_cycles(1000000));
+    check(fabs(cycles - ppc_clock_mips() * 1000) < ppc_clock_mips() * 10,
+          "deadlines convert at the calibrated rate");
+
+    ppc_clock_calibrate = false;
+}
+
+/** Deterministic execution keeps the fixed ratio even if asked to calibrate. */
+static void test_deterministic() {
+    ppc_clock_calibrate = true;
+    is_deterministic    = true;
+    g_icycles           = 0;
+    ppc_clock_init(4);
+
+    auto start = host_clock::now();
+    while (host_ns_since(start) < 300000000ULL) {
+        g_icycles += 1000;
+        ppc_clock_update();
+    }
+    check(ppc_clock_mips() == 62.5, "deterministic mode ignores the host speed");
+
+    ppc_clock_calibrate = false;
+    is_deterministic    = false;
+}
+
+/** Pacing sleeps off a lead of virtual time, scaled by the speed cap,
+    and writes off lag beyond the allowed drift. */
+static void test_pacing() {
+    const uint64_t ms = 1000000;
+    atomic<bool>   wake{false};
+
+    ppc_realtime_speed = 1.0;
+    ppc_pacing_reset(0);
+    auto start = host_clock::now();
+    check(ppc_pacing_sync(30 * ms, wake), "a lead of virtual time is slept off");
+    uint64_t slept = host_ns_since(start);
+    check(slept >= 29 * ms && slept < 500 * ms, "sleep lasts as long as the lead");
+
+    ppc_pacing_reset(0);
+    check(!ppc_pacing_sync(PPC_PACING_MIN_SLEEP_NS / 2, wake), "short leads aren't slept off");
+
+    ppc_realtime_speed = 2.0;
+    ppc_pacing_reset(0);
+    start = host_clock::now();
+    ppc_pacing_sync(60 * ms, wake);
+    slept = host_ns_since(start);
+    check(slept >= 29 * ms && slept < 50 * ms, "speed cap scales the lead");
+    ppc_realtime_speed = 1.0;
+
+    wake = true;
+    ppc_pacing_reset(0);
+    start = host_clock::now();
+    ppc_pacing_sync(10000 * ms, wake);
+    check(host_ns_since(start) < 500 * ms, "a posted command ends the sleep");
+    wake = false;
+
+    // a stalled guest only makes up for the allowed drift
+    ppc_pacing_reset(0);
+    this_thread::sleep_for(chrono::nanoseconds(PPC_PACING_MAX_DRIFT_NS + 150 * ms));
+    check(!ppc_pacing_sync(0, wake), "a lagging guest doesn't sleep");
+    start = host_clock::now();
+    check(ppc_pacing_sync(PPC_PACING_MAX_DRIFT_NS + 30 * ms, wake),
+          "lag beyond the allowed drift is written off");
+    slept = host_ns_since(start);
+    check(slept >= 29 * ms && slept < 500 * ms, "only the allowed drift is made up for");
+
+    // e.g. after the clock was restarted
+    ppc_pacing_reset(1000 * ms);
+    check(!ppc_pacing_sync(0, wake), "virtual time going back doesn't sleep");
+    start = host_clock::now();
+    ppc_pacing_sync(30 * ms, wake);
+    slept = host_ns_since(start);
+    check(slept >= 29 * ms && slept < 500 * ms, "virtual time going back restarts pacing");
+}
+
+int test_ppc_clock() {
+    ntested = 0;
+    nfailed = 0;
+
+    test_fixed_ratio();
+    test_calibration();
+    test_deterministic();
+    test_pacing();
+
+    g_icycles = 0;
+    ppc_clock_init(4);
+
+    cout << "Tested " << ntested << " clock properties. Failed: " << nfailed << "." << endl;
+
+    return nfailed;
+}
@@ -21,6 +21,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 /** @file Descriptor-based direct memory access emulation. */
 
+#include <core/commandqueue.h>
 #include <core/timermanager.h>
 #include <cpu/ppc/ppcmmu.h>
 #include <devices/common/dbdma.h>
@@ -508,9 +509,8 @@ DmaPullResult DMAChannel::pull_data(uint32_t req_len, uint32_t *avail_len, uint8
     // Uses a blocking lock — try_lock caused spurious NoMoreData returns when
     // the main thread held the mutex, making the cubeb callback return 0 frames
     // and permanently stopping the stream.
-    // defer_irq_mode still handles the TimerManager nesting concern: IRQ posts
-    // are deferred until after mtx is released so we never call TimerManager
-    // while holding this lock.
+    // IRQs are deferred via defer_irq_mode until mtx is released and then
+    // posted to the emulation thread through the CommandQueue.
     DmaPullResult result;
     bool post_deferred_irq = false;
 
@@ -565,10 +565,12 @@ DmaPullResult DMAChannel::pull_data(uint32_t req_len, uint32_t *avail_len, uint8
 
     // Post deferred IRQ notifications after releasing the DMA mutex.
     // int_ctrl and irq_id are set at init and never modified.
+    // A full queue is reported by the emulation thread, not from here.
     if (post_deferred_irq && this->int_ctrl) {
-        TimerManager::get_instance()->add_immediate_timer([this] {
-            this->int_ctrl->ack_dma_int(this->irq_id, 1);
-        });
+        CommandQueue::get_instance()->post([](void* ctx, uint64_t arg) {
+            DMAChannel* ch = static_cast<DMAChannel*>(ctx);
+            ch->int_ctrl->ack_dma_int(ch->irq_id, 1);
+        }, this);
     }
 
     return result;
@@ -49,10 +49,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
     pull_data uses a blocking lock so the cubeb callback always gets data or
     a legitimate NoMoreData result, and never stops the stream due to spurious
     lock contention.  IRQ notifications are deferred until after mtx is released
-    (via defer_irq_mode) to avoid calling TimerManager while holding this lock.
-
-    Lock ordering: mtx → TimerManager::recursive_mutex.  Timer callbacks
-    MUST NOT acquire DMAChannel::mtx to avoid deadlock.
+    (via defer_irq_mode) and then posted to the emulation thread through the
+    CommandQueue, so the audio thread never touches TimerManager or the
+    interrupt controller.
 
     The data pointer returned by pull_data points into guest physical RAM
     (via mmu_map_dma_mem).  Guest RAM mappings are stable during emulation,
@@ -34,6 +34,14 @@ public:
     virtual uint32_t read(uint32_t rgn_start, uint32_t offset, int size)              = 0;
     virtual void write(uint32_t rgn_start, uint32_t offset, uint32_t value, int size) = 0;
     virtual ~MMIODevice()                                                             = default;
+
+    // Return host memory for the page at offset if the CPU may access it
+    // directly instead of calling read/write. Stores to such pages are
+    // reported by mmu_dev_mem_dirty(). Removing the region drops such pages,
+    // otherwise call mmu_dev_mem_changed() when one stops being valid.
+    virtual uint8_t* get_direct_page(uint32_t rgn_start, uint32_t offset) {
+        return nullptr;
+    }
 };
 
 #define SIZE_ARG(size) (size == 4 ? 'l' : size == 2 ? 'w' : \
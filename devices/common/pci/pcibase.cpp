@@ -157,10 +157,9 @@ int PCIBase::attach_exp_rom_image(const std::string img_path)
         for (this->exp_rom_size = 1 << 11; this->exp_rom_size < exp_rom_image_size; this->exp_rom_size <<= 1) {}
 
         // ROM image ok - go ahead and load it
-        this->exp_rom_data = std::unique_ptr<uint8_t[]> (new uint8_t[this->exp_rom_size]);
-        img_file.seekg(0, std::ios::beg);
-        img_file.read((char *)this->exp_rom_data.get(), exp_rom_image_size);
-        memset(&this->exp_rom_data[exp_rom_image_size], 0xff, this->exp_rom_size - exp_rom_image_size);
+        if (!this->exp_rom_data.open(img_path, this->exp_rom_size, 0xff)) {
+            throw std::runtime_error("could not load ROM dump image");
+        }
 
         if (exp_rom_image_size == this->exp_rom_size) {
             LOG_F(INFO, "%s: loaded expansion rom (%d bytes).",
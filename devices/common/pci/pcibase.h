@@ -24,6 +24,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <devices/common/mmiodevice.h>
 #include <devices/common/pci/pcihost.h>
+#include <utils/mappedfile.h>
 
 #include <cinttypes>
 #include <functional>
@@ -175,7 +176,7 @@ protected:
     uint32_t    exp_rom_addr = 0;    // expansion ROM base address
     uint32_t    exp_rom_size = 0;    // expansion ROM size in bytes
 
-    std::unique_ptr<uint8_t[]> exp_rom_data;
+    MappedFile  exp_rom_data;        // expansion ROM image padded with 0xFF
 
     // 0 = not writable; 1 = bit is enabled in command register
     uint16_t    command_cfg = 0xffff - (1<<3) - (1<<7); // disable: special cycles and stepping
@@ -24,6 +24,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
     Author: Max Poliakovski
 */
 
+#include <core/commandqueue.h>
 #include <core/timermanager.h>
 #include <cpu/ppc/ppcemu.h>
 #include <cpu/ppc/ppcmmu.h>
@@ -658,7 +659,7 @@ DmaPullResult AmicSndOutDma::pull_data(uint32_t req_len, uint32_t *avail_len,
     // Uses a blocking lock — try_lock caused spurious NoMoreData returns when
     // the main thread held the mutex, making the cubeb callback return 0 frames
     // and permanently stopping the stream (boot chime cuts out).
-    // defer_irq still handles the TimerManager nesting concern.
+    // The IRQ is posted to the emulation thread after the lock is released.
 
     DmaPullResult result;
     bool post_irq = false;
@@ -677,8 +678,8 @@ DmaPullResult AmicSndOutDma::pull_data(uint32_t req_len, uint32_t *avail_len,
                 this->dma_out_ctrl |= PDM_DMA_IF1;
 
             // Inline of update_irq() logic — keep in sync.
-            // Deferred because TimerManager's mutex would cause
-            // priority inversion on the RT thread.
+            // Deferred because the interrupt controller belongs to
+            // the emulation thread.
             uint8_t new_level = !!((this->dma_out_ctrl >> 4) & this->dma_out_ctrl);
             if (new_level != this->irq_level) {
                 this->irq_level = new_level;
@@ -710,11 +711,12 @@ DmaPullResult AmicSndOutDma::pull_data(uint32_t req_len, uint32_t *avail_len,
 
     // Post deferred IRQ notification after releasing the DMA mutex.
     // int_ctrl and snd_dma_irq_id are set at init and never modified.
+    // A full queue is reported by the emulation thread, not from here.
     if (post_irq) {
-        TimerManager::get_instance()->add_immediate_timer(
-            [this, post_irq_level] {
-                this->int_ctrl->ack_dma_int(this->snd_dma_irq_id, post_irq_level);
-            });
+        CommandQueue::get_instance()->post([](void* ctx, uint64_t arg) {
+            AmicSndOutDma* dma = static_cast<AmicSndOutDma*>(ctx);
+            dma->int_ctrl->ack_dma_int(dma->snd_dma_irq_id, (uint8_t)arg);
+        }, this, post_irq_level);
     }
 
     return result;
@@ -371,7 +371,7 @@ private:
 
     // DMA IRQ flag registers
     // These are currently only accessed from the main thread (AMIC::read
-    // and ack_dma_int via TimerManager callbacks both run on the main thread).
+    // and ack_dma_int via timers and posted commands both run on the main thread).
     // Atomic for defensive safety in case a future change introduces
     // cross-thread access.
     std::atomic<uint8_t>     dma_ifr0{0};
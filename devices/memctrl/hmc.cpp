@@ -94,8 +94,13 @@ void HMC::remap_ram_regions() {
     if (this->bank_b_size && this->bank_b_start != bank_b_addr) {
         AddressMapEntry *ref_entry = find_range(this->bank_b_start);
         if (ref_entry) {
+            uint32_t old_start = ref_entry->start;
+            uint32_t old_end   = ref_entry->end;
             ref_entry->end   = bank_b_addr + (ref_entry->end - ref_entry->start);
             ref_entry->start = bank_b_addr;
+            update_phys_map();
+            notify_range_change(old_start, old_end);
+            notify_range_change(ref_entry->start, ref_entry->end);
 
             this->bank_b_start = bank_b_addr;
             LOG_F(INFO, "%s: successfully relocated bank B mem region to 0x%X",
@@ -19,8 +19,10 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <cpu/ppc/ppcfastmem.h>
 #include <devices/memctrl/memctrlbase.h>
 #include <devices/common/mmiodevice.h>
+#include <utils/mappedfile.h>
 
 #include <algorithm>
 #include <array>
@@ -29,6 +31,45 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <vector>
 #include <loguru.hpp>
 
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#define HOST_ANON_MMAP
+#endif
+
+#ifdef HOST_ANON_MMAP
+constexpr size_t HOST_HUGE_PAGE_SIZE = 2 << 20;
+
+// Anonymous mappings are zero-filled and only committed when a page is first
+// touched, so large RAM configurations don't cost anything until the guest
+// uses them. Regions spanning whole huge pages are aligned to them and marked
+// for transparent huge pages to cut down on host TLB misses.
+static uint8_t* guest_mem_map(size_t size) {
+    size_t map_size = size >= HOST_HUGE_PAGE_SIZE ? size + HOST_HUGE_PAGE_SIZE : size;
+
+    uint8_t* ptr = (uint8_t*)mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == (uint8_t*)MAP_FAILED)
+        return nullptr;
+
+    if (map_size != size) {
+        // trim the mapping down to a huge page aligned one
+        uint8_t* start = (uint8_t*)(((uintptr_t)ptr + HOST_HUGE_PAGE_SIZE - 1) &
+                                    ~(uintptr_t)(HOST_HUGE_PAGE_SIZE - 1));
+        size_t   head  = start - ptr;
+        if (head)
+            munmap(ptr, head);
+        if (map_size - head > size)
+            munmap(start + size, map_size - head - size);
+        ptr = start;
+#ifdef MADV_HUGEPAGE
+        madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+    }
+
+    return ptr;
+}
+#endif
+
 MemCtrlBase::~MemCtrlBase() {
     for (auto& entry : address_map) {
         if (entry)
@@ -36,8 +77,15 @@ MemCtrlBase::~MemCtrlBase() {
     }
 
     for (auto& reg : mem_regions) {
-        if (reg)
-            delete (reg);
+        if (fastmem_free(reg.ptr))
+            continue;
+#ifdef HOST_ANON_MMAP
+        if (reg.mapped) {
+            munmap(reg.ptr, reg.size);
+            continue;
+        }
+#endif
+        delete[] reg.ptr;
     }
     this->mem_regions.clear();
     this->address_map.clear();
@@ -98,10 +146,23 @@ static inline bool match_mem_entry(const AddressMapEntry* entry,
 }
 
 
+// marks physical map slots that need an address_map search
+static AddressMapEntry* const PHYS_MAP_SCAN = reinterpret_cast<AddressMapEntry*>(uintptr_t(1));
+
 AddressMapEntry* MemCtrlBase::find_range(uint32_t addr) {
-    for (auto& entry : address_map) {
-        if (addr >= entry->start && addr <= entry->end)
-            return entry;
+    const PhysMapDir& dir = this->phys_map[addr >> PHYS_DIR_SHIFT];
+
+    AddressMapEntry* map_entry = dir.pages ?
+        (*dir.pages)[(addr >> PHYS_PAGE_SHIFT) & (PHYS_DIR_PAGES - 1)] : dir.entry;
+
+    if (map_entry != PHYS_MAP_SCAN) {
+        if (map_entry)
+            return map_entry;
+    } else {
+        for (auto& entry : address_map) {
+            if (addr >= entry->start && addr <= entry->end)
+                return entry;
+        }
     }
 
 #if defined(FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION)
@@ -132,6 +193,48 @@ AddressMapEntry* MemCtrlBase::find_range(uint32_t addr) {
 }
 
 
+// Record that entry covers all (full) or only a part of a physical map slot.
+static inline void phys_map_mark(AddressMapEntry*& slot, AddressMapEntry* entry, bool full) {
+    slot = (!slot && full) ? entry : PHYS_MAP_SCAN;
+}
+
+void MemCtrlBase::update_phys_map() {
+    constexpr uint64_t dir_size  = 1ULL << PHYS_DIR_SHIFT;
+    constexpr uint64_t page_size = 1ULL << PHYS_PAGE_SHIFT;
+
+    for (auto& dir : this->phys_map) {
+        dir.entry = nullptr;
+        dir.pages.reset();
+    }
+
+    for (auto& entry : address_map) {
+        uint64_t start = entry->start;
+        uint64_t end   = uint64_t(entry->end) + 1;
+
+        for (uint64_t dir_addr = start & ~(dir_size - 1); dir_addr < end; dir_addr += dir_size) {
+            PhysMapDir& dir = this->phys_map[dir_addr >> PHYS_DIR_SHIFT];
+            uint64_t dir_end = dir_addr + dir_size;
+
+            if (!dir.pages) {
+                if (start <= dir_addr && end >= dir_end) {
+                    phys_map_mark(dir.entry, entry, true);
+                    continue;
+                }
+                // split the directory slot into pages
+                dir.pages = std::make_unique<PhysMapPages>();
+                dir.pages->fill(dir.entry);
+            }
+
+            uint64_t page_addr = std::max(start, dir_addr) & ~(page_size - 1);
+            for (; page_addr < std::min(end, dir_end); page_addr += page_size) {
+                phys_map_mark((*dir.pages)[(page_addr >> PHYS_PAGE_SHIFT) & (PHYS_DIR_PAGES - 1)],
+                              entry, start <= page_addr && end >= page_addr + page_size);
+            }
+        }
+    }
+}
+
+
 AddressMapEntry* MemCtrlBase::find_range_exact(uint32_t addr, uint32_t size,
                                                MMIODevice* dev_instance)
 {
@@ -225,8 +328,17 @@ AddressMapEntry* MemCtrlBase::add_mem_region(uint32_t start_addr, uint32_t size,
         return nullptr;
 
     if (!mem_ptr) {
-        mem_ptr = new uint8_t[size](); // allocate and clear to zero
-        this->mem_regions.push_back(mem_ptr);
+        bool mapped = false;
+
+        // guest memory must be shareable for fastmem
+        mem_ptr = fastmem_alloc(size);
+#ifdef HOST_ANON_MMAP
+        if (!mem_ptr)
+            mapped = (mem_ptr = guest_mem_map(size)) != nullptr;
+#endif
+        if (!mem_ptr)
+            mem_ptr = new uint8_t[size](); // allocate and clear to zero
+        this->mem_regions.push_back({mem_ptr, size, mapped});
     }
 
     entry = new AddressMapEntry;
@@ -252,6 +364,9 @@ AddressMapEntry* MemCtrlBase::add_mem_region(uint32_t start_addr, uint32_t size,
             }),
             entry);
 
+    update_phys_map();
+    notify_range_change(start_addr, end);
+
     LOG_F(INFO, "Added mem region 0x%X..0x%X (%s%s%s%s) -> 0x%X", start_addr, end,
         entry->type & RT_ROM ? "ROM," : "",
         entry->type & RT_RAM ? "RAM," : "",
@@ -308,6 +423,8 @@ AddressMapEntry* MemCtrlBase::add_mem_mirror_common(uint32_t start_addr, uint32_
     entry->mem_ptr = ref_entry->mem_ptr + offset;
 
     this->address_map.push_back(entry);
+    update_phys_map();
+    notify_range_change(start_addr, end);
 
     LOG_F(INFO, "Added mem region mirror 0x%X..0x%X (%s%s%s%s) -> 0x%X : 0x%X..0x%X%s%s%s",
         start_addr, end,
@@ -355,6 +472,29 @@ AddressMapEntry* MemCtrlBase::set_data(uint32_t load_addr, const uint8_t* data,
 }
 
 
+AddressMapEntry* MemCtrlBase::set_data(uint32_t load_addr, const MappedFile& file) {
+    AddressMapEntry* ref_entry = find_range(load_addr);
+    if (!ref_entry)
+        return nullptr;
+
+    uint8_t* dest = ref_entry->mem_ptr + (load_addr - ref_entry->start);
+
+    // only our own anonymous mappings can be replaced, guest memory
+    // shared with fastmem has to stay in its backing
+    if (!(ref_entry->type & RT_MIRROR) && file.size() <= ref_entry->end - load_addr + 1) {
+        for (auto& reg : mem_regions) {
+            if (reg.mapped && dest >= reg.ptr && dest + file.size() <= reg.ptr + reg.size) {
+                if (file.map_to(dest))
+                    return ref_entry;
+                break;
+            }
+        }
+    }
+
+    return this->set_data(load_addr, file.data(), (uint32_t)file.size());
+}
+
+
 AddressMapEntry* MemCtrlBase::add_mmio_region(uint32_t start_addr, uint32_t size, MMIODevice* dev_instance)
 {
     AddressMapEntry *entry;
@@ -374,6 +514,8 @@ AddressMapEntry* MemCtrlBase::add_mmio_region(uint32_t start_addr, uint32_t size
     entry->mem_ptr = 0;
 
     this->address_map.push_back(entry);
+    update_phys_map();
+    notify_range_change(start_addr, end);
 
     LOG_F(INFO, "Added mmio region 0x%X..0x%X%s%s%s",
         start_addr, end,
@@ -400,6 +542,10 @@ bool MemCtrlBase::remove_mmio_region(uint32_t start_addr, uint32_t size, MMIODev
         }
     ), address_map.end());
 
+    update_phys_map();
+    if (found)
+        notify_range_change(start_addr, end);
+
     if (found == 0)
         LOG_F(ERROR, "Cannot find mmio region 0x%X..0x%X%s%s%s to remove",
             start_addr, end,
@@ -447,6 +593,8 @@ AddressMapEntry* MemCtrlBase::remove_region(AddressMapEntry* entry)
         }
     ), address_map.end());
 
+    update_phys_map();
+
     if (found == 0) {
         LOG_F(ERROR, "Cannot find mem region %s to remove",
             get_entry_str(entry).c_str()
@@ -454,6 +602,8 @@ AddressMapEntry* MemCtrlBase::remove_region(AddressMapEntry* entry)
         return nullptr;
     }
 
+    notify_range_change(entry->start, entry->end);
+
     return entry;
 }
 
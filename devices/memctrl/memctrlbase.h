@@ -22,10 +22,14 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #ifndef MEMORY_CONTROLLER_BASE_H
 #define MEMORY_CONTROLLER_BASE_H
 
+#include <array>
 #include <cinttypes>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
+class MappedFile;
 class MMIODevice;
 
 /* Common DRAM capacities. */
@@ -80,6 +84,10 @@ public:
 
     virtual AddressMapEntry* set_data(uint32_t reg_addr, const uint8_t* data, uint32_t size);
 
+    // like set_data() but shares the file pages instead of copying them
+    // when the region's memory allows that
+    AddressMapEntry* set_data(uint32_t reg_addr, const MappedFile& file);
+
     AddressMapEntry* find_range(uint32_t addr);
     AddressMapEntry* find_range_exact(uint32_t addr, uint32_t size,
                                       MMIODevice* dev_instance);
@@ -93,6 +101,12 @@ public:
 
     void dump_regions();
 
+    // called with the first and last address of each physical range
+    // whose mapping has been added, removed or moved
+    void set_range_change_callback(std::function<void(uint32_t start, uint32_t end)> cb) {
+        this->range_change_cb = cb;
+    }
+
 protected:
     AddressMapEntry* add_mem_region(
         uint32_t start_addr, uint32_t size, uint32_t dest_addr, uint32_t type,
@@ -102,9 +116,43 @@ protected:
     AddressMapEntry* add_mem_mirror_common(uint32_t start_addr, uint32_t dest_addr,
                                            uint32_t offset=0, uint32_t size=0);
 
+    // must be called after an address map entry has been changed in place
+    void update_phys_map();
+
+    void notify_range_change(uint32_t start, uint32_t end) {
+        if (this->range_change_cb)
+            this->range_change_cb(start, end);
+    }
+
 private:
-    std::vector<uint8_t*> mem_regions;
+    /** Host memory allocated for a RAM or ROM region. */
+    typedef struct MemRegionBacking {
+        uint8_t* ptr;
+        size_t   size;
+        bool     mapped; // anonymous mapping rather than heap memory
+    } MemRegionBacking;
+
+    std::vector<MemRegionBacking> mem_regions;
     std::vector<AddressMapEntry*> address_map;
+
+    /* Two-level physical map for find_range(). Each directory slot covers
+       4 MB and either points to the only entry covering all of it or to a
+       table of 4 KB page slots. Slots of ranges that aren't covered by
+       exactly one entry hold PHYS_MAP_SCAN so that address_map is searched. */
+    static constexpr int PHYS_DIR_SHIFT  = 22;
+    static constexpr int PHYS_PAGE_SHIFT = 12;
+    static constexpr int PHYS_DIR_PAGES  = 1 << (PHYS_DIR_SHIFT - PHYS_PAGE_SHIFT);
+
+    typedef std::array<AddressMapEntry*, PHYS_DIR_PAGES> PhysMapPages;
+
+    typedef struct PhysMapDir {
+        AddressMapEntry*              entry = nullptr;
+        std::unique_ptr<PhysMapPages> pages;
+    } PhysMapDir;
+
+    std::array<PhysMapDir, 1 << (32 - PHYS_DIR_SHIFT)> phys_map;
+
+    std::function<void(uint32_t start, uint32_t end)> range_change_cb = nullptr;
 };
 
 #endif // MEMORY_CONTROLLER_BASE_H
@@ -513,18 +513,18 @@ void PlatinumCtrl::enable_display() {
     // attach framebuffer conversion routine
     switch (this->pixel_depth) {
     case 8:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_8bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_8bpp_indexed(src, dst_buf, dst_pitch);
         };
         break;
     case 16:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_15bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_15bpp<BE>(src, dst_buf, dst_pitch);
         };
         break;
     case 32:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_32bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_32bpp<BE>(src, dst_buf, dst_pitch);
         };
         break;
     default:
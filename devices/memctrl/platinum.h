@@ -300,7 +300,7 @@ constexpr auto PLATINUM_IOREG_BASE  = 0xF8000000UL;
 class PlatinumCtrl : public MemCtrlBase, public VideoCtrlBase, public MMIODevice {
 public:
     PlatinumCtrl();
-    ~PlatinumCtrl() = default;
+    ~PlatinumCtrl() { this->stop_refresh_task(); }
 
     static std::unique_ptr<HWComponent> create() {
         return std::unique_ptr<PlatinumCtrl>(new PlatinumCtrl());
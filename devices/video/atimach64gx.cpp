@@ -25,6 +25,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
 #include <core/bitops.h>
+#include <cpu/ppc/ppcmmu.h>
 #include <devices/deviceregistry.h>
 #include <devices/video/atimach64gx.h>
 #include <devices/video/displayid.h>
@@ -656,7 +657,7 @@ uint32_t AtiMach64Gx::read(uint32_t rgn_start, uint32_t offset, int size)
     // memory mapped expansion ROM region
     if (rgn_start == this->exp_rom_addr) {
         if (offset < this->exp_rom_size)
-            return read_mem(&this->exp_rom_data[offset], size);
+            return read_mem(&this->exp_rom_data.data()[offset], size);
         LOG_F(WARNING, "%s: read  unmapped ROM region %08x.%c", this->name.c_str(), offset, SIZE_ARG(size));
         return 0;
     }
@@ -683,6 +684,18 @@ void AtiMach64Gx::write(uint32_t rgn_start, uint32_t offset, uint32_t value, int
         this->name.c_str(), offset, SIZE_ARG(size), size * 2, value);
 }
 
+uint8_t* AtiMach64Gx::get_direct_page(uint32_t rgn_start, uint32_t offset)
+{
+    if (rgn_start == this->aperture_base[0] && offset + 0x1000 <= uint32_t(this->vram_size))
+        return &this->vram_ptr[offset];
+    return nullptr;
+}
+
+bool AtiMach64Gx::direct_vram_dirty()
+{
+    return this->aperture_base[0] && mmu_dev_mem_dirty(this->aperture_base[0], this->vram_size);
+}
+
 void AtiMach64Gx::verbose_pixel_format(int crtc_index) {
     if (crtc_index) {
         LOG_F(ERROR, "CRTC2 not supported yet");
@@ -765,6 +778,7 @@ void AtiMach64Gx::crtc_update()
     }
 
     static uint8_t bits_per_pixel[8] = {0, 0, 4, 8, 16, 24, 32, 0};
+    this->pixel_depth = bits_per_pixel[this->pixel_format];
 
     int new_fb_pitch_reg = extract_bits<uint32_t>(this->regs[ATI_CRTC_OFF_PITCH],
         ATI_CRTC_PITCH, ATI_CRTC_PITCH_size);
@@ -811,33 +825,28 @@ void AtiMach64Gx::crtc_update()
     // set up frame buffer converter
     switch (this->pixel_format) {
     case 2:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            draw_fb = false;
-            this->convert_frame_4bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_4bpp_indexed(src, dst_buf, dst_pitch);
         };
         break;
     case 3:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            draw_fb = false;
-            this->convert_frame_8bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_8bpp_indexed(src, dst_buf, dst_pitch);
         };
         break;
     case 4:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            draw_fb = false;
-            this->convert_frame_15bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_15bpp<BE>(src, dst_buf, dst_pitch);
         };
         break;
     case 5:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            draw_fb = false;
-            this->convert_frame_24bpp(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_24bpp(src, dst_buf, dst_pitch);
         };
         break;
     case 6:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            draw_fb = false;
-            this->convert_frame_32bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_32bpp<BE>(src, dst_buf, dst_pitch);
         };
         break;
     default:
@@ -35,7 +35,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 class AtiMach64Gx : public PCIDevice, public VideoCtrlBase {
 public:
     AtiMach64Gx();
-    ~AtiMach64Gx() = default;
+    ~AtiMach64Gx() { this->stop_refresh_task(); }
 
     static std::unique_ptr<HWComponent> create() {
         return std::unique_ptr<AtiMach64Gx>(new AtiMach64Gx());
@@ -56,6 +56,7 @@ public:
     // MMIODevice methods
     uint32_t read(uint32_t rgn_start, uint32_t offset, int size);
     void write(uint32_t rgn_start, uint32_t offset, uint32_t value, int size);
+    uint8_t* get_direct_page(uint32_t rgn_start, uint32_t offset);
 
 protected:
     void notify_bar_change(int bar_num);
@@ -73,6 +74,7 @@ protected:
     void verbose_pixel_format(int crtc_index);
     void draw_hw_cursor(uint8_t *dst_buf, int dst_pitch);
     void get_cursor_position(int& x, int& y);
+    bool direct_vram_dirty();
 
 private:
     void change_one_bar(uint32_t &aperture, uint32_t aperture_size, uint32_t aperture_new, int bar_num);
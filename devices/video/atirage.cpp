@@ -20,6 +20,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include <core/bitops.h>
+#include <cpu/ppc/ppcmmu.h>
 #include <devices/common/hwcomponent.h>
 #include <devices/common/pci/pcidevice.h>
 #include <devices/deviceregistry.h>
@@ -642,7 +643,7 @@ uint32_t ATIRage::read(uint32_t rgn_start, uint32_t offset, int size)
     // memory mapped expansion ROM region
     if (rgn_start == this->exp_rom_addr) {
         if (offset < this->exp_rom_size)
-            return read_mem(&this->exp_rom_data[offset], size);
+            return read_mem(&this->exp_rom_data.data()[offset], size);
         LOG_F(WARNING, "%s: read  unmapped ROM region %08x.%c",
             this->name.c_str(), offset, SIZE_ARG(size));
         return 0;
@@ -693,6 +694,33 @@ void ATIRage::write(uint32_t rgn_start, uint32_t offset, uint32_t value, int siz
           this->name.c_str(), offset, SIZE_ARG(size), size * 2, value);
 }
 
+uint8_t* ATIRage::get_direct_page(uint32_t rgn_start, uint32_t offset)
+{
+    if (rgn_start != this->aperture_base[0])
+        return nullptr;
+
+    // both VRAM regions are stored the same way, only the frame
+    // conversion cares about the endianness
+    if (offset + 0x1000 <= this->framebuffer_size) // little-endian VRAM region
+        return &this->vram_ptr[offset];
+    if (offset >= BE_FB_OFFSET && offset - BE_FB_OFFSET + 0x1000 <= this->vram_size)
+        return &this->vram_ptr[offset - BE_FB_OFFSET]; // big-endian VRAM region
+
+    return nullptr; // pages with registers
+}
+
+bool ATIRage::direct_vram_dirty()
+{
+    if (!this->aperture_base[0])
+        return false;
+
+    // always check both apertures so that neither stays dirty
+    bool le_dirty = mmu_dev_mem_dirty(this->aperture_base[0], this->framebuffer_size);
+    bool be_dirty = mmu_dev_mem_dirty(this->aperture_base[0] + BE_FB_OFFSET,
+                                      std::min(this->vram_size, BE_FB_OFFSET));
+    return le_dirty || be_dirty;
+}
+
 float ATIRage::calc_pll_freq(int scale, int fb_div) const {
     return (ATI_XTAL * scale * fb_div) / this->plls[PLL_REF_DIV];
 }
@@ -787,6 +815,7 @@ void ATIRage::crtc_update() {
     }
 
     static uint8_t bits_per_pixel[8] = {0, 4, 8, 16, 16, 24, 32, 0};
+    this->pixel_depth = bits_per_pixel[this->pixel_format];
 
     int new_fb_pitch = extract_bits<uint32_t>(this->regs[ATI_CRTC_OFF_PITCH],
         ATI_CRTC_PITCH, ATI_CRTC_PITCH_size) * bits_per_pixel[this->pixel_format];
@@ -838,47 +867,40 @@ void ATIRage::crtc_update() {
     // set up frame buffer converter
     switch (this->pixel_format) {
     case 1:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            draw_fb = false;
-            this->convert_frame_4bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_4bpp_indexed(src, dst_buf, dst_pitch);
         };
         break;
     case 2:
         if (bit_set(this->regs[ATI_DAC_CNTL], ATI_DAC_DIRECT)) {
-            this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-                draw_fb = false;
-                this->convert_frame_8bpp(dst_buf, dst_pitch);
+            this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+                convert_frame_8bpp(src, dst_buf, dst_pitch);
             };
         }
         else {
-            this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-                draw_fb = false;
-                this->convert_frame_8bpp_indexed(dst_buf, dst_pitch);
+            this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+                convert_frame_8bpp_indexed(src, dst_buf, dst_pitch);
             };
         }
         break;
     case 3:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            draw_fb = false;
-            this->convert_frame_15bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_15bpp<BE>(src, dst_buf, dst_pitch);
         };
         break;
     case 4:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            draw_fb = false;
-            this->convert_frame_16bpp<LE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_16bpp<LE>(src, dst_buf, dst_pitch);
         };
         break;
     case 5:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            draw_fb = false;
-            this->convert_frame_24bpp(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_24bpp(src, dst_buf, dst_pitch);
         };
         break;
     case 6:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            draw_fb = false;
-            this->convert_frame_32bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_32bpp<BE>(src, dst_buf, dst_pitch);
         };
         break;
     default:
@@ -45,7 +45,7 @@ enum {
 class ATIRage : public PCIDevice, public VideoCtrlBase {
 public:
     ATIRage(uint16_t dev_id);
-    ~ATIRage() = default;
+    ~ATIRage() { this->stop_refresh_task(); }
 
     static std::unique_ptr<HWComponent> create_gt() {
         return std::unique_ptr<ATIRage>(new ATIRage(ATI_RAGE_GT_DEV_ID));
@@ -65,6 +65,7 @@ public:
     // MMIODevice methods
     uint32_t read(uint32_t rgn_start, uint32_t offset, int size);
     void write(uint32_t rgn_start, uint32_t offset, uint32_t value, int size);
+    uint8_t* get_direct_page(uint32_t rgn_start, uint32_t offset);
 
     // PCI device methods
     uint32_t pci_cfg_read(uint32_t reg_offs, AccessDetails &details);
@@ -85,6 +86,7 @@ protected:
     void crtc_update();
     void draw_hw_cursor(uint8_t *dst_buf, int dst_pitch);
     void get_cursor_position(int& x, int& y);
+    bool direct_vram_dirty();
 
 private:
     void change_one_bar(uint32_t &aperture, uint32_t aperture_size,
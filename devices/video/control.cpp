@@ -36,6 +36,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
     Kudos to joevt#3510 for his precious technical help and HW hacking.
  */
 
+#include <cpu/ppc/ppcmmu.h>
 #include <devices/common/i2c/i2c.h>
 #include <devices/deviceregistry.h>
 #include <devices/ioctrl/macio.h>
@@ -213,6 +214,31 @@ static const char * get_name_controlreg(int offset) {
     }
 }
 
+uint8_t* ControlVideo::get_direct_page(uint32_t rgn_start, uint32_t offset)
+{
+    // Only pages that read() and write() map to the same single VRAM
+    // location can be accessed directly. Mirrors written to both banks,
+    // the bank interleaving of 128bit mode and missing banks can't.
+    if (rgn_start != this->vram_base || !(offset & 0x800000))
+        return nullptr;
+
+    uint32_t bank = (offset >> 21) & 3;
+
+    if (this->enables & VRAM_WIDE_MODE)
+        return (this->vram_banks == 3) ? &this->vram_ptr[offset & 0x3FFFFF] : nullptr;
+
+    switch (this->vram_banks) {
+    case 1: // standard bank
+        return (bank != 3) ? &this->vram_ptr[offset & 0x1FFFFF] : nullptr;
+    case 2: // optional bank
+        return (bank == 3) ? &this->vram_ptr[offset & 0x1FFFFF] : nullptr;
+    case 3: // both banks
+        return (bank >= 2) ? &this->vram_ptr[offset & 0x3FFFFF] : nullptr;
+    }
+
+    return nullptr;
+}
+
 uint32_t ControlVideo::read(uint32_t rgn_start, uint32_t offset, int size)
 {
     if (rgn_start == this->vram_base) {
@@ -538,6 +564,8 @@ void ControlVideo::write(uint32_t rgn_start, uint32_t offset, uint32_t value, in
                     this->blank_display();
                 }
             }
+            if ((this->enables ^ value) & VRAM_WIDE_MODE)
+                mmu_dev_mem_changed(); // VRAM layout of the aperture changes
             this->enables = value & 0xFFF;
             if (this->enables & FB_ENDIAN_LITTLE)
                 LOG_F(ERROR, "%s: little-endian framebuffer is not implemented yet", this->name.c_str());
@@ -624,18 +652,18 @@ void ControlVideo::enable_display()
     // get pixel depth from RaDACal
     switch (this->pixel_depth) {
     case 8:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_8bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_8bpp_indexed(src, dst_buf, dst_pitch);
         };
         break;
     case 16:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_15bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_15bpp<BE>(src, dst_buf, dst_pitch);
         };
         break;
     case 32:
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_32bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_32bpp<BE>(src, dst_buf, dst_pitch);
         };
         break;
     default:
@@ -112,7 +112,7 @@ enum {
 class ControlVideo : public PCIDevice, public VideoCtrlBase {
 public:
     ControlVideo();
-    ~ControlVideo() = default;
+    ~ControlVideo() { this->stop_refresh_task(); }
 
     static std::unique_ptr<HWComponent> create() {
         return std::unique_ptr<ControlVideo>(new ControlVideo());
@@ -123,6 +123,7 @@ public:
     // MMIODevice methods
     uint32_t read(uint32_t rgn_start, uint32_t offset, int size);
     void write(uint32_t rgn_start, uint32_t offset, uint32_t value, int size);
+    uint8_t* get_direct_page(uint32_t rgn_start, uint32_t offset);
 
 protected:
     void change_one_bar(uint32_t &aperture, uint32_t aperture_size, uint32_t aperture_new,
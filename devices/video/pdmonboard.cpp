@@ -119,32 +119,32 @@ void PdmOnboardVideo::set_depth_internal(int width)
 {
     switch (this->pixel_depth) {
     case 1:
-        this->convert_fb_cb = [this](uint8_t* dst_buf, int dst_pitch) {
-            this->pdm_convert_frame_1bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t* dst_buf, int dst_pitch) {
+            pdm_convert_frame_1bpp_indexed(src, dst_buf, dst_pitch);
         };
         this->fb_pitch = width >> 3; // one byte contains 8 pixels
         break;
     case 2:
-        this->convert_fb_cb = [this](uint8_t* dst_buf, int dst_pitch) {
-            this->pdm_convert_frame_2bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t* dst_buf, int dst_pitch) {
+            pdm_convert_frame_2bpp_indexed(src, dst_buf, dst_pitch);
         };
         this->fb_pitch = width >> 2; // one byte contains 4 pixels
         break;
     case 4:
-        this->convert_fb_cb = [this](uint8_t* dst_buf, int dst_pitch) {
-            this->pdm_convert_frame_4bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t* dst_buf, int dst_pitch) {
+            pdm_convert_frame_4bpp_indexed(src, dst_buf, dst_pitch);
         };
         this->fb_pitch = width >> 1; // one byte contains 2 pixels
         break;
     case 8:
-        this->convert_fb_cb = [this](uint8_t* dst_buf, int dst_pitch) {
-            this->convert_frame_8bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t* dst_buf, int dst_pitch) {
+            convert_frame_8bpp_indexed(src, dst_buf, dst_pitch);
         };
         this->fb_pitch = width; // one byte contains 1 pixel
         break;
     case 16:
-        this->convert_fb_cb = [this](uint8_t* dst_buf, int dst_pitch) {
-            this->convert_frame_15bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t* dst_buf, int dst_pitch) {
+            convert_frame_15bpp<BE>(src, dst_buf, dst_pitch);
         };
         this->fb_pitch = width << 1; // 1 pixel is 2 bytes
         break;
@@ -265,24 +265,25 @@ void PdmOnboardVideo::set_fb_base() {
     CLUT entry #127 (%01111111) and a black pixel to #255 (%11111111).
     It requres a non-standard conversion routine implemented below.
  */
-void PdmOnboardVideo::pdm_convert_frame_1bpp_indexed(uint8_t *dst_buf, int dst_pitch)
+void PdmOnboardVideo::pdm_convert_frame_1bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
     uint64_t pixels;
 
     // prepare cached ARGB values for white & black pixels
-    pixels = ((uint64_t)this->palette[127] << 32) | this->palette[255];
+    pixels = ((uint64_t)src.palette[127] << 32) | src.palette[255];
 
-    src_pitch = this->fb_pitch - ((this->active_width + 7) >> 3);
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - ((src.width + 7) >> 3);
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr - 1;
+    src_row = src.fb_ptr - 1;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
+    for (int h = src.height; h > 0; h--) {
         uint8_t bit = 0x00;
         uint8_t c;
-        for (int x = this->active_width; x > 0; x--) {
+        for (int x = src.width; x > 0; x--) {
             if (!bit) {
                 src_row += 1;
                 bit = 0x80;
@@ -297,27 +298,28 @@ void PdmOnboardVideo::pdm_convert_frame_1bpp_indexed(uint8_t *dst_buf, int dst_p
     }
 }
 
-void PdmOnboardVideo::pdm_convert_frame_2bpp_indexed(uint8_t *dst_buf, int dst_pitch)
+void PdmOnboardVideo::pdm_convert_frame_2bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
 
-    src_pitch = this->fb_pitch - (this->active_width >> 2);
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - (src.width >> 2);
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr;
+    src_row = src.fb_ptr;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
+    for (int h = src.height; h > 0; h--) {
         uint8_t c;
-        for (int x = this->active_width >> 2; x > 0; x--) {
+        for (int x = src.width >> 2; x > 0; x--) {
             c = *src_row;
-            WRITE_DWORD_LE_A(dst_row, this->palette[c & 0xc0 | 0x3f]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[c & 0xc0 | 0x3f]);
             dst_row += 4;
-            WRITE_DWORD_LE_A(dst_row, this->palette[(c << 2) & 0xc0 | 0x3f]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[(c << 2) & 0xc0 | 0x3f]);
             dst_row += 4;
-            WRITE_DWORD_LE_A(dst_row, this->palette[(c << 4) & 0xc0 | 0x3f]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[(c << 4) & 0xc0 | 0x3f]);
             dst_row += 4;
-            WRITE_DWORD_LE_A(dst_row, this->palette[(uint8_t)(c << 6) | 0x3f]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[(uint8_t)(c << 6) | 0x3f]);
             dst_row += 4;
             src_row += 1;
         }
@@ -326,23 +328,24 @@ void PdmOnboardVideo::pdm_convert_frame_2bpp_indexed(uint8_t *dst_buf, int dst_p
     }
 }
 
-void PdmOnboardVideo::pdm_convert_frame_4bpp_indexed(uint8_t *dst_buf, int dst_pitch)
+void PdmOnboardVideo::pdm_convert_frame_4bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
 
-    src_pitch = this->fb_pitch - (this->active_width >> 1);
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - (src.width >> 1);
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr;
+    src_row = src.fb_ptr;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
+    for (int h = src.height; h > 0; h--) {
         uint8_t c;
-        for (int x = this->active_width >> 1; x > 0; x--) {
+        for (int x = src.width >> 1; x > 0; x--) {
             c = *src_row;
-            WRITE_DWORD_LE_A(dst_row, this->palette[c & 0xf0 | 0x0f]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[c & 0xf0 | 0x0f]);
             dst_row += 4;
-            WRITE_DWORD_LE_A(dst_row, this->palette[(uint8_t)(c << 4) | 0x0f]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[(uint8_t)(c << 4) | 0x0f]);
             dst_row += 4;
             src_row += 1;
         }
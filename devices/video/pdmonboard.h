@@ -48,7 +48,7 @@ enum PdmVideoMode : uint8_t {
 class PdmOnboardVideo : public VideoCtrlBase {
 public:
     PdmOnboardVideo();
-    ~PdmOnboardVideo() = default;
+    ~PdmOnboardVideo() { this->stop_refresh_task(); }
 
     uint8_t get_video_mode() const {
         return ((this->video_mode & 0x1F) | this->blanking);
@@ -74,9 +74,9 @@ protected:
     void    disable_video_internal();
     void    set_fb_base();
 
-    void pdm_convert_frame_1bpp_indexed(uint8_t *dst_buf, int dst_pitch);
-    void pdm_convert_frame_2bpp_indexed(uint8_t *dst_buf, int dst_pitch);
-    void pdm_convert_frame_4bpp_indexed(uint8_t *dst_buf, int dst_pitch);
+    static void pdm_convert_frame_1bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
+    static void pdm_convert_frame_2bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
+    static void pdm_convert_frame_4bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
 
 private:
     uint8_t     video_mode;
@@ -349,20 +349,20 @@ void Sixty6Video::enable_display()
         // fallthrough
     case 1:
         this->pixel_depth = 8;
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_8bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_8bpp_indexed(src, dst_buf, dst_pitch);
         };
         break;
     case 2:
         this->pixel_depth = 16;
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_15bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_15bpp<BE>(src, dst_buf, dst_pitch);
         };
         break;
     case 3:
         this->pixel_depth = 32;
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_32bpp<BE>(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_32bpp<BE>(src, dst_buf, dst_pitch);
         };
         break;
     }
@@ -104,6 +104,7 @@ class Sixty6Video: public VideoCtrlBase, public IobusDevice, public HWComponent
 
 public:
     Sixty6Video();
+    ~Sixty6Video() { this->stop_refresh_task(); }
 
     static std::unique_ptr<HWComponent> create() {
         return std::unique_ptr<Sixty6Video>(new Sixty6Video());
@@ -210,13 +210,13 @@ void TaosVideo::enable_display() {
 
     if (bit_set(this->color_mode, 31)) {
         this->pixel_depth = 16;
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_15bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_15bpp_indexed(src, dst_buf, dst_pitch);
         };
     } else {
         this->pixel_depth = 8;
-        this->convert_fb_cb = [this](uint8_t *dst_buf, int dst_pitch) {
-            this->convert_frame_8bpp_indexed(dst_buf, dst_pitch);
+        this->convert_fb_cb = [](const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+            convert_frame_8bpp_indexed(src, dst_buf, dst_pitch);
         };
     }
 
@@ -234,24 +234,25 @@ void TaosVideo::disable_display() {
     this->crtc_on  = false;
 }
 
-void TaosVideo::convert_frame_15bpp_indexed(uint8_t *dst_buf, int dst_pitch) {
-    uint8_t     *src_row, *dst_row;
-    uint16_t    c;
-    uint32_t    pix;
-    int         src_pitch;
+void TaosVideo::convert_frame_15bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch) {
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    uint16_t      c;
+    uint32_t      pix;
+    int           src_pitch;
 
-    src_row = this->fb_ptr;
+    src_row = src.fb_ptr;
     dst_row = dst_buf;
 
-    src_pitch = this->fb_pitch - 2 * this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - 2 * src.width;
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
+    for (int h = src.height; h > 0; h--) {
+        for (int x = src.width; x > 0; x--) {
             c = READ_WORD_BE_A(src_row);
-            pix = (this->palette[(c >> 10) & 0x1F] & 0x00FF0000) |
-                  (this->palette[(c >>  5) & 0x1F] & 0x0000FF00) |
-                  (this->palette[ c        & 0x1F] & 0xFF0000FF);
+            pix = (src.palette[(c >> 10) & 0x1F] & 0x00FF0000) |
+                  (src.palette[(c >>  5) & 0x1F] & 0x0000FF00) |
+                  (src.palette[ c        & 0x1F] & 0xFF0000FF);
             WRITE_DWORD_LE_A(dst_row, pix);
             src_row += 2;
             dst_row += 4;
@@ -168,7 +168,7 @@ private:
 class TaosVideo : public VideoCtrlBase, public MMIODevice {
 public:
     TaosVideo();
-    ~TaosVideo() = default;
+    ~TaosVideo() { this->stop_refresh_task(); }
 
     static std::unique_ptr<HWComponent> create() {
         return std::unique_ptr<TaosVideo>(new TaosVideo());
@@ -181,7 +181,7 @@ public:
 private:
     void enable_display();
     void disable_display();
-    void convert_frame_15bpp_indexed(uint8_t *dst_buf, int dst_pitch);
+    static void convert_frame_15bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
 
     std::unique_ptr<AthensClocks>   clk_gen = nullptr;
     std::unique_ptr<Bt856>          vid_enc = nullptr;
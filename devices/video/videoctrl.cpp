@@ -21,12 +21,21 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 /** @file Video Controller base class implementation. */
 
+#include <core/commandqueue.h>
 #include <core/timermanager.h>
+#include <cpu/ppc/ppcemu.h>
 #include <devices/common/hwinterrupt.h>
 #include <devices/video/videoctrl.h>
 #include <memaccess.h>
+#include <loguru.hpp>
 
 #include <cinttypes>
+#include <cstring>
+
+// Emscripten builds have no threads, frames are converted synchronously there
+#ifndef __EMSCRIPTEN__
+#define VIDEO_RENDER_THREAD
+#endif
 
 VideoCtrlBase::VideoCtrlBase(int width, int height)
 {
@@ -69,24 +78,216 @@ void VideoCtrlBase::update_screen()
         return;
     }
 
+    if (this->draw_fb_is_dynamic && this->direct_vram_dirty())
+        this->draw_fb = true;
+
+    if (this->draw_fb) {
+        this->queue_frame();
+    } else if (this->draw_fb_is_dynamic) {
+        this->display.update_skipped();
+    }
+}
+
+void VideoCtrlBase::present(std::function<void(uint8_t *dst_buf, int dst_pitch)> draw_cb)
+{
     int cursor_x = 0;
     int cursor_y = 0;
     if (this->cursor_on) {
         this->get_cursor_position(cursor_x, cursor_y);
     }
 
-    if (this->draw_fb) {
-        if (this->cursor_dirty) {
-            this->setup_hw_cursor();
-            this->cursor_dirty = false;
+    if (this->cursor_dirty) {
+        this->setup_hw_cursor();
+        this->cursor_dirty = false;
+    }
+
+    this->display.update(
+        draw_cb, this->cursor_ovl_cb,
+        this->cursor_on, cursor_x, cursor_y,
+        this->draw_fb_is_dynamic);
+}
+
+void VideoCtrlBase::queue_frame()
+{
+    if (!this->convert_fb_cb || !this->fb_ptr || this->fb_pitch <= 0 ||
+        this->active_width <= 0 || this->active_height <= 0)
+        return;
+
+    // deterministic runs present at fixed points in virtual time
+    if (!this->render_thread.joinable()) {
+        FrameSnapshot src = {this->fb_ptr, this->fb_pitch, this->active_width,
+                             this->active_height, this->palette};
+        if (this->draw_fb_is_dynamic)
+            this->draw_fb = false;
+        this->present([this, &src](uint8_t *dst_buf, int dst_pitch) {
+            this->convert_fb_cb(src, dst_buf, dst_pitch);
+        });
+        return;
+    }
+
+    // show what has been converted so far, also covers frames whose
+    // present command couldn't be posted because the queue was full
+    this->present_ready_frame();
+
+    // the snapshot size depends on the pixel depth
+    if (this->pixel_depth <= 0)
+        return;
+
+    RenderFrame* frame = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(this->render_mutex);
+        // replace a frame that is still waiting for conversion, it's stale
+        for (auto& f : this->frames) {
+            if (f.state == FRAME_QUEUED) {
+                frame = &f;
+                break;
+            }
         }
-        this->display.update(
-            this->convert_fb_cb, this->cursor_ovl_cb,
-            this->cursor_on, cursor_x, cursor_y,
-            this->draw_fb_is_dynamic);
-    } else if (this->draw_fb_is_dynamic) {
-        this->display.update_skipped();
+        if (!frame) {
+            for (auto& f : this->frames) {
+                if (f.state == FRAME_FREE) {
+                    frame = &f;
+                    break;
+                }
+            }
+        }
+        if (!frame)
+            return; // both busy, try again at the next refresh
+        frame->state = FRAME_CONVERTING; // keep the render thread away
+    }
+
+    // the last row ends with the last visible pixel,
+    // the framebuffer may end right there
+    size_t fb_size = size_t(this->fb_pitch) * (this->active_height - 1) +
+                     (size_t(this->active_width) * this->pixel_depth + 7) / 8;
+    frame->fb_copy.resize(fb_size);
+    std::memcpy(frame->fb_copy.data(), this->fb_ptr, fb_size);
+    std::memcpy(frame->palette, this->palette, sizeof(frame->palette));
+    frame->src = {frame->fb_copy.data(), this->fb_pitch, this->active_width,
+                  this->active_height, frame->palette};
+    frame->convert_cb = this->convert_fb_cb;
+    frame->seq = ++this->frame_seq;
+
+    if (this->draw_fb_is_dynamic)
+        this->draw_fb = false;
+
+    {
+        std::lock_guard<std::mutex> lock(this->render_mutex);
+        frame->state = FRAME_QUEUED;
     }
+    this->render_cv.notify_one();
+}
+
+void VideoCtrlBase::present_ready_frame()
+{
+    RenderFrame* frame = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(this->render_mutex);
+        // only present the newest frame
+        for (auto& f : this->frames) {
+            if (f.state != FRAME_READY)
+                continue;
+            if (frame && frame->seq > f.seq) {
+                f.state = FRAME_FREE;
+            } else {
+                if (frame)
+                    frame->state = FRAME_FREE;
+                frame = &f;
+            }
+        }
+    }
+
+    if (!frame)
+        return;
+
+    // drop frames that no longer match the display mode
+    if (this->blank_on || frame->src.width != this->active_width ||
+        frame->src.height != this->active_height) {
+        this->draw_fb = true;
+    } else {
+        this->present([frame](uint8_t *dst_buf, int dst_pitch) {
+            int row_bytes = frame->src.width * 4;
+            for (int y = 0; y < frame->src.height; y++)
+                std::memcpy(dst_buf + y * dst_pitch, &frame->pixels[y * row_bytes], row_bytes);
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(this->render_mutex);
+    frame->state = FRAME_FREE;
+}
+
+void VideoCtrlBase::render_loop()
+{
+    std::unique_lock<std::mutex> lock(this->render_mutex);
+
+    while (true) {
+        RenderFrame* frame = nullptr;
+        this->render_cv.wait(lock, [this, &frame]() {
+            frame = nullptr;
+            for (auto& f : this->frames) {
+                if (f.state == FRAME_QUEUED)
+                    frame = &f;
+            }
+            return this->render_quit || frame;
+        });
+        if (this->render_quit)
+            break;
+
+        frame->state = FRAME_CONVERTING;
+        lock.unlock();
+
+        int dst_pitch = frame->src.width * 4;
+        frame->pixels.resize(size_t(dst_pitch) * frame->src.height);
+        frame->convert_cb(frame->src, frame->pixels.data(), dst_pitch);
+
+        lock.lock();
+        frame->state = FRAME_READY;
+        if (!this->present_posted) {
+            this->present_posted = CommandQueue::get_instance()->post(
+                [](void* ctx, uint64_t) {
+                    VideoCtrlBase* self = static_cast<VideoCtrlBase*>(ctx);
+                    {
+                        std::lock_guard<std::mutex> lock(self->render_mutex);
+                        self->present_posted = false;
+                    }
+                    self->present_ready_frame();
+                }, this);
+        }
+    }
+}
+
+void VideoCtrlBase::start_render_thread()
+{
+#ifdef VIDEO_RENDER_THREAD
+    if (this->render_thread.joinable() || is_deterministic)
+        return;
+
+    this->render_quit = false;
+    this->render_thread = std::thread(&VideoCtrlBase::render_loop, this);
+#endif
+}
+
+void VideoCtrlBase::stop_render_thread()
+{
+    if (!this->render_thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(this->render_mutex);
+        this->render_quit = true;
+    }
+    this->render_cv.notify_one();
+    this->render_thread.join();
+
+    // the present command refers to this object which may go away,
+    // drop it along with the frames in flight and redraw at the next refresh
+    if (this->present_posted) {
+        CommandQueue::get_instance()->discard(this);
+        this->present_posted = false;
+    }
+    for (auto& f : this->frames)
+        f.state = FRAME_FREE;
+    this->draw_fb = true;
 }
 
 void VideoCtrlBase::set_draw_fb() {
@@ -99,6 +300,7 @@ void VideoCtrlBase::set_cursor_dirty() {
 
 void VideoCtrlBase::start_refresh_task() {
     this->display.configure(this->active_width, this->active_height);
+    this->start_render_thread();
 
     uint64_t refresh_interval = static_cast<uint64_t>(1.0f / refresh_rate * NS_PER_SEC + 0.5);
     this->refresh_task_id = TimerManager::get_instance()->add_cyclic_timer(
@@ -127,6 +329,8 @@ void VideoCtrlBase::start_refresh_task() {
 }
 
 void VideoCtrlBase::stop_refresh_task() {
+    this->stop_render_thread();
+
     if (this->refresh_task_id) {
         TimerManager::get_instance()->cancel_timer(this->refresh_task_id);
         this->refresh_task_id = 0;
@@ -161,26 +365,27 @@ void VideoCtrlBase::setup_hw_cursor(int cursor_width, int cursor_height)
     this->cursor_on = true;
 }
 
-void VideoCtrlBase::convert_frame_1bpp_indexed(uint8_t *dst_buf, int dst_pitch)
+void VideoCtrlBase::convert_frame_1bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
 
-    src_pitch = this->fb_pitch - ((this->active_width + 7) >> 3);
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - ((src.width + 7) >> 3);
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr - 1;
+    src_row = src.fb_ptr - 1;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
+    for (int h = src.height; h > 0; h--) {
         uint8_t bit = 0x00;
         uint8_t c;
-        for (int x = this->active_width; x > 0; x--) {
+        for (int x = src.width; x > 0; x--) {
             if (!bit) {
                 src_row += 1;
                 bit = 0x80;
                 c = *src_row;
             }
-            WRITE_DWORD_LE_A(dst_row, this->palette[!!(c & bit)]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[!!(c & bit)]);
             bit >>= 1;
             dst_row += 4;
         }
@@ -189,27 +394,28 @@ void VideoCtrlBase::convert_frame_1bpp_indexed(uint8_t *dst_buf, int dst_pitch)
     }
 }
 
-void VideoCtrlBase::convert_frame_2bpp_indexed(uint8_t *dst_buf, int dst_pitch)
+void VideoCtrlBase::convert_frame_2bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
 
-    src_pitch = this->fb_pitch - (this->active_width >> 2);
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - (src.width >> 2);
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr;
+    src_row = src.fb_ptr;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
+    for (int h = src.height; h > 0; h--) {
         uint8_t c;
-        for (int x = this->active_width >> 2; x > 0; x--) {
+        for (int x = src.width >> 2; x > 0; x--) {
             c = *src_row;
-            WRITE_DWORD_LE_A(dst_row, this->palette[c >> 6]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[c >> 6]);
             dst_row += 4;
-            WRITE_DWORD_LE_A(dst_row, this->palette[(c >> 4) & 3]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[(c >> 4) & 3]);
             dst_row += 4;
-            WRITE_DWORD_LE_A(dst_row, this->palette[(c >> 2) & 3]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[(c >> 2) & 3]);
             dst_row += 4;
-            WRITE_DWORD_LE_A(dst_row, this->palette[c & 3]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[c & 3]);
             dst_row += 4;
             src_row += 1;
         }
@@ -218,23 +424,24 @@ void VideoCtrlBase::convert_frame_2bpp_indexed(uint8_t *dst_buf, int dst_pitch)
     }
 }
 
-void VideoCtrlBase::convert_frame_4bpp_indexed(uint8_t *dst_buf, int dst_pitch)
+void VideoCtrlBase::convert_frame_4bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
 
-    src_pitch = this->fb_pitch - (this->active_width >> 1);
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - (src.width >> 1);
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr;
+    src_row = src.fb_ptr;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
+    for (int h = src.height; h > 0; h--) {
         uint8_t c;
-        for (int x = this->active_width >> 1; x > 0; x--) {
+        for (int x = src.width >> 1; x > 0; x--) {
             c = *src_row;
-            WRITE_DWORD_LE_A(dst_row, this->palette[c >> 4]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[c >> 4]);
             dst_row += 4;
-            WRITE_DWORD_LE_A(dst_row, this->palette[c & 15]);
+            WRITE_DWORD_LE_A(dst_row, src.palette[c & 15]);
             dst_row += 4;
             src_row += 1;
         }
@@ -243,19 +450,20 @@ void VideoCtrlBase::convert_frame_4bpp_indexed(uint8_t *dst_buf, int dst_pitch)
     }
 }
 
-void VideoCtrlBase::convert_frame_8bpp_indexed(uint8_t *dst_buf, int dst_pitch)
+void VideoCtrlBase::convert_frame_8bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
 
-    src_pitch = this->fb_pitch - this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - src.width;
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr;
+    src_row = src.fb_ptr;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
-            WRITE_DWORD_LE_A(dst_row, this->palette[*src_row++]);
+    for (int h = src.height; h > 0; h--) {
+        for (int x = src.width; x > 0; x--) {
+            WRITE_DWORD_LE_A(dst_row, src.palette[*src_row++]);
             dst_row += 4;
         }
         src_row += src_pitch;
@@ -265,45 +473,46 @@ void VideoCtrlBase::convert_frame_8bpp_indexed(uint8_t *dst_buf, int dst_pitch)
 
 #if 0
 // alternative version to the above but only works for little endian host
-void VideoCtrlBase::convert_frame_8bpp_32LE_indexed(uint8_t *dst_buf, int dst_pitch)
+void VideoCtrlBase::convert_frame_8bpp_32LE_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *dst_row;
-    uint32_t *src_row;
-    int     src_pitch;
+    uint8_t        *dst_row;
+    const uint32_t *src_row;
+    int            src_pitch;
 
-    src_pitch = this->fb_pitch - this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - src.width;
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = (uint32_t*)this->fb_ptr;
+    src_row = (const uint32_t*)src.fb_ptr;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width >> 2; x > 0; x--) {
+    for (int h = src.height; h > 0; h--) {
+        for (int x = src.width >> 2; x > 0; x--) {
             uint32_t pixels = *src_row++;
-            WRITE_DWORD_LE_A(dst_row     , this->palette[(uint8_t)(pixels      )]);
-            WRITE_DWORD_LE_A(dst_row +  4, this->palette[(uint8_t)(pixels >>  8)]);
-            WRITE_DWORD_LE_A(dst_row +  8, this->palette[(uint8_t)(pixels >> 16)]);
-            WRITE_DWORD_LE_A(dst_row + 12, this->palette[(uint8_t)(pixels >> 24)]);
+            WRITE_DWORD_LE_A(dst_row     , src.palette[(uint8_t)(pixels      )]);
+            WRITE_DWORD_LE_A(dst_row +  4, src.palette[(uint8_t)(pixels >>  8)]);
+            WRITE_DWORD_LE_A(dst_row +  8, src.palette[(uint8_t)(pixels >> 16)]);
+            WRITE_DWORD_LE_A(dst_row + 12, src.palette[(uint8_t)(pixels >> 24)]);
             dst_row += 16;
         }
-        src_row = (uint32_t*)((uint8_t*)src_row + src_pitch);
+        src_row = (const uint32_t*)((const uint8_t*)src_row + src_pitch);
         dst_row += dst_pitch;
     }
 }
 #endif
 
 // RGB332
-void VideoCtrlBase::convert_frame_8bpp(uint8_t *dst_buf, int dst_pitch)
+void VideoCtrlBase::convert_frame_8bpp(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
 
-    src_pitch = this->fb_pitch - this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - src.width;
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr;
+    src_row = src.fb_ptr;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
+    for (int h = src.height; h > 0; h--) {
+        for (int x = src.width; x > 0; x--) {
             uint32_t c = *src_row++;
             uint32_t r = ((c << 16) & 0x00E00000) | ((c << 13) & 0x001C0000) | ((c << 10) & 0x00030000);
             uint32_t g = ((c << 11) & 0x0000E000) | ((c <<  8) & 0x00001C00) | ((c <<  5) & 0x00000300);
@@ -318,18 +527,19 @@ void VideoCtrlBase::convert_frame_8bpp(uint8_t *dst_buf, int dst_pitch)
 
 // RGB555
 template <VideoCtrlBase::fb_endian endian>
-void VideoCtrlBase::convert_frame_15bpp(uint8_t *dst_buf, int dst_pitch)
+void VideoCtrlBase::convert_frame_15bpp(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
 
-    src_pitch = this->fb_pitch - 2 * this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - 2 * src.width;
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr;
+    src_row = src.fb_ptr;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
+    for (int h = src.height; h > 0; h--) {
+        for (int x = src.width; x > 0; x--) {
             uint32_t c = (endian == BE) ? READ_WORD_BE_A(src_row) : READ_WORD_LE_A(src_row);
             uint32_t r = ((c << 9) & 0x00F80000) | ((c << 4) & 0x00070000);
             uint32_t g = ((c << 6) & 0x0000F800) | ((c << 1) & 0x00000700);
@@ -342,23 +552,24 @@ void VideoCtrlBase::convert_frame_15bpp(uint8_t *dst_buf, int dst_pitch)
         dst_row += dst_pitch;
     }
 }
-template void VideoCtrlBase::convert_frame_15bpp<VideoCtrlBase::BE>(uint8_t *dst_buf, int dst_pitch);
-template void VideoCtrlBase::convert_frame_15bpp<VideoCtrlBase::LE>(uint8_t *dst_buf, int dst_pitch);
+template void VideoCtrlBase::convert_frame_15bpp<VideoCtrlBase::BE>(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
+template void VideoCtrlBase::convert_frame_15bpp<VideoCtrlBase::LE>(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
 
 // RGB565
 template <VideoCtrlBase::fb_endian endian>
-void VideoCtrlBase::convert_frame_16bpp(uint8_t *dst_buf, int dst_pitch)
+void VideoCtrlBase::convert_frame_16bpp(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
 
-    src_pitch = this->fb_pitch - 2 * this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - 2 * src.width;
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr;
+    src_row = src.fb_ptr;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
+    for (int h = src.height; h > 0; h--) {
+        for (int x = src.width; x > 0; x--) {
             uint32_t c = (endian == BE) ? READ_WORD_BE_A(src_row) : READ_WORD_LE_A(src_row);
             uint32_t r = ((c << 8) & 0x00F80000) | ((c << 3) & 0x00070000);
             uint32_t g = ((c << 5) & 0x0000FC00) | ((c >> 1) & 0x00000300);
@@ -371,23 +582,24 @@ void VideoCtrlBase::convert_frame_16bpp(uint8_t *dst_buf, int dst_pitch)
         dst_row += dst_pitch;
     }
 }
-template void VideoCtrlBase::convert_frame_16bpp<VideoCtrlBase::BE>(uint8_t *dst_buf, int dst_pitch);
-template void VideoCtrlBase::convert_frame_16bpp<VideoCtrlBase::LE>(uint8_t *dst_buf, int dst_pitch);
+template void VideoCtrlBase::convert_frame_16bpp<VideoCtrlBase::BE>(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
+template void VideoCtrlBase::convert_frame_16bpp<VideoCtrlBase::LE>(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
 
 
 // RGB888
-void VideoCtrlBase::convert_frame_24bpp(uint8_t *dst_buf, int dst_pitch)
+void VideoCtrlBase::convert_frame_24bpp(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint8_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint8_t *src_row;
+    uint8_t       *dst_row;
+    int           src_pitch;
 
-    src_pitch = this->fb_pitch - 3 * this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - 3 * src.width;
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = this->fb_ptr;
+    src_row = src.fb_ptr;
     dst_row = dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
+    for (int h = src.height; h > 0; h--) {
+        for (int x = src.width; x > 0; x--) {
             uint32_t c = (src_row[0] << 16) | (src_row[1] << 8) | src_row[2];
             WRITE_DWORD_LE_A(dst_row, c);
             src_row += 3;
@@ -400,26 +612,27 @@ void VideoCtrlBase::convert_frame_24bpp(uint8_t *dst_buf, int dst_pitch)
 
 // ARGB8888
 template <VideoCtrlBase::fb_endian endian>
-void VideoCtrlBase::convert_frame_32bpp(uint8_t *dst_buf, int dst_pitch)
+void VideoCtrlBase::convert_frame_32bpp(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)
 {
-    uint32_t *src_row, *dst_row;
-    int     src_pitch;
+    const uint32_t *src_row;
+    uint32_t       *dst_row;
+    int            src_pitch;
 
-    src_pitch = this->fb_pitch - 4 * this->active_width;
-    dst_pitch = dst_pitch - 4 * this->active_width;
+    src_pitch = src.fb_pitch - 4 * src.width;
+    dst_pitch = dst_pitch - 4 * src.width;
 
-    src_row = (uint32_t*)this->fb_ptr;
+    src_row = (const uint32_t*)src.fb_ptr;
     dst_row = (uint32_t*)dst_buf;
-    for (int h = this->active_height; h > 0; h--) {
-        for (int x = this->active_width; x > 0; x--) {
+    for (int h = src.height; h > 0; h--) {
+        for (int x = src.width; x > 0; x--) {
             uint32_t c = (endian == BE) ? READ_DWORD_BE_A(src_row) : READ_DWORD_LE_A(src_row);
             WRITE_DWORD_LE_A(dst_row, c);
             src_row++;
             dst_row++;
         }
-        src_row = (uint32_t*)((uint8_t*)src_row + src_pitch);
+        src_row = (const uint32_t*)((const uint8_t*)src_row + src_pitch);
         dst_row = (uint32_t*)((uint8_t*)dst_row + dst_pitch);
     }
 }
-template void VideoCtrlBase::convert_frame_32bpp<VideoCtrlBase::BE>(uint8_t *dst_buf, int dst_pitch);
-template void VideoCtrlBase::convert_frame_32bpp<VideoCtrlBase::LE>(uint8_t *dst_buf, int dst_pitch);
+template void VideoCtrlBase::convert_frame_32bpp<VideoCtrlBase::BE>(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
+template void VideoCtrlBase::convert_frame_32bpp<VideoCtrlBase::LE>(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
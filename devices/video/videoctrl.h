@@ -28,10 +28,23 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <devices/video/display.h>
 
 #include <cinttypes>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 class WindowEvent;
 
+/** Framebuffer contents a converter turns into ARGB pixels. */
+typedef struct FrameSnapshot {
+    const uint8_t*  fb_ptr;     // first visible pixel
+    int             fb_pitch;
+    int             width;
+    int             height;
+    const uint32_t* palette;    // 256 entries in RGBA format
+} FrameSnapshot;
+
 class VideoCtrlBase {
 public:
     typedef enum {
@@ -61,22 +74,26 @@ public:
     virtual void draw_hw_cursor(uint8_t *dst_buf, int dst_pitch) {}
     virtual void get_cursor_position(int& x, int& y) { x = 0; y = 0; }
 
-    // converters for various framebuffer pixel depths
-    void convert_frame_1bpp_indexed(uint8_t *dst_buf, int dst_pitch);
-    void convert_frame_2bpp_indexed(uint8_t *dst_buf, int dst_pitch);
-    void convert_frame_4bpp_indexed(uint8_t *dst_buf, int dst_pitch);
-    void convert_frame_8bpp_indexed(uint8_t *dst_buf, int dst_pitch);
+    // VRAM written through direct pages since the last call?
+    virtual bool direct_vram_dirty() { return false; }
+
+    // converters for various framebuffer pixel depths, static because they
+    // run on the render thread and must not touch anything but their arguments
+    static void convert_frame_1bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
+    static void convert_frame_2bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
+    static void convert_frame_4bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
+    static void convert_frame_8bpp_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
 #if 0
-    void convert_frame_8bpp_32LE_indexed(uint8_t *dst_buf, int dst_pitch);
+    static void convert_frame_8bpp_32LE_indexed(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
 #endif
-    void convert_frame_8bpp(uint8_t *dst_buf, int dst_pitch);
+    static void convert_frame_8bpp(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
     template <VideoCtrlBase::fb_endian endian>
-    void convert_frame_15bpp(uint8_t *dst_buf, int dst_pitch);
+    static void convert_frame_15bpp(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
     template <VideoCtrlBase::fb_endian endian>
-    void convert_frame_16bpp(uint8_t *dst_buf, int dst_pitch);
-    void convert_frame_24bpp(uint8_t *dst_buf, int dst_pitch);
+    static void convert_frame_16bpp(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
+    static void convert_frame_24bpp(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
     template <VideoCtrlBase::fb_endian endian>
-    void convert_frame_32bpp(uint8_t *dst_buf, int dst_pitch);
+    static void convert_frame_32bpp(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch);
 
 protected:
     // CRT controller parameters
@@ -90,7 +107,7 @@ protected:
     int         vert_total = 0;
     int         hori_blank = 0;
     int         vert_blank = 0;
-    int         pixel_depth;
+    int         pixel_depth = 0; // bits per pixel
     int         pixel_format;
     float       pixel_clock;
     float       refresh_rate;
@@ -117,11 +134,47 @@ protected:
             this->int_ctrl->ack_int(this->irq_id, irq_line_state);
     };
 
-    std::function<void(uint8_t *dst_buf, int dst_pitch)> convert_fb_cb = nullptr;
+    std::function<void(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)> convert_fb_cb = nullptr;
     std::function<void(uint8_t *dst_buf, int dst_pitch)> cursor_ovl_cb = nullptr;
 
 private:
+    void queue_frame();
+    void present(std::function<void(uint8_t *dst_buf, int dst_pitch)> draw_cb);
+    void present_ready_frame();
+    void start_render_thread();
+    void stop_render_thread();
+    void render_loop();
+
     Display display;
+
+    /* Frames are converted on a render thread. At refresh time the emulation
+       thread copies the framebuffer and palette into a free slot, the render
+       thread converts it and posts a command to present the result. With two
+       slots one frame can be copied while the other is being converted. */
+    typedef enum {
+        FRAME_FREE,
+        FRAME_QUEUED,       // snapshot taken, waiting for conversion
+        FRAME_CONVERTING,
+        FRAME_READY,        // converted, waiting to be presented
+    } FrameState;
+
+    typedef struct RenderFrame {
+        FrameState           state = FRAME_FREE;
+        uint64_t             seq   = 0;
+        FrameSnapshot        src   = {};
+        std::vector<uint8_t> fb_copy;
+        uint32_t             palette[256];
+        std::vector<uint8_t> pixels; // converted ARGB, 4 * width bytes per row
+        std::function<void(const FrameSnapshot& src, uint8_t *dst_buf, int dst_pitch)> convert_cb;
+    } RenderFrame;
+
+    RenderFrame             frames[2];
+    uint64_t                frame_seq = 0;
+    std::thread             render_thread;
+    std::mutex              render_mutex;   // guards frame states and the flags below
+    std::condition_variable render_cv;
+    bool                    render_quit = false;
+    bool                    present_posted = false; // present command in the queue
 };
 
 #endif // VIDEO_CTRL_H
@@ -138,17 +138,16 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
     // Dispatch the fuzzed opcode. Be defensive: if the opcode table somehow
     // isn't initialized, fall back to ppc_illegalop instead of segfaulting on
     // a null/zero function pointer (the failure mode observed in CI "fuzz-extended").
-    uint32_t idx = ((opcode >> 15) & 0x1F800) | (opcode & 0x7FF);
-    PPCOpcode *table = ppc_opcode_grabber;
-    if (!table) {
+    PPCOpcode handler = ppc_decode_opcode(opcode);
+    if (!handler) {
         initialize_ppc_opcode_table();
-        table = ppc_opcode_grabber;
+        handler = ppc_decode_opcode(opcode);
     }
-    PPCOpcode handler = (table && idx < 64 * 2048) ? table[idx] : nullptr;
     if (!handler) {
         handler = ppc_illegalop;
     }
     handler(opcode);
+    ppc_sync_flags();
 
     return 0;
 }
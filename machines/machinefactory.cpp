@@ -34,10 +34,10 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <machines/machineproperties.h>
 #include <machines/romidentity.h>
 #include <memaccess.h>
+#include <utils/mappedfile.h>
 
 #include <cinttypes>
 #include <cstring>
-#include <fstream>
 #include <tuple>
 #include <iostream>
 #include <iomanip>
@@ -99,7 +99,7 @@ static const map<string, string> PropHelp = {
     {"pds",             "specify device for the processsor direct slot"},
 };
 
-static uint32_t adler32(char *buf, size_t len) {
+static uint32_t adler32(const char *buf, size_t len) {
     uint32_t sum1 = 1;
     uint32_t sum2 = 0;
     while (len--) {
@@ -109,7 +109,7 @@ static uint32_t adler32(char *buf, size_t len) {
     return sum1 + 65536 * sum2;
 }
 
-static uint32_t oldworldchecksum(char *buf, size_t len) {
+static uint32_t oldworldchecksum(const char *buf, size_t len) {
     uint32_t ck = 0;
     while (len) {
         ck += READ_WORD_BE_A(buf);
@@ -292,38 +292,25 @@ void MachineFactory::register_settings(const PropMap& props) {
 
 }
 
-size_t MachineFactory::read_boot_rom(string& rom_filepath, char *rom_data)
+size_t MachineFactory::read_boot_rom(string& rom_filepath, MappedFile& rom_file)
 {
-    ifstream rom_file;
-    size_t file_size;
-
-    rom_file.open(rom_filepath, ios::in | ios::binary);
-    if (rom_file.fail()) {
+    // pad the image to 4 MB with zeros for machine_name_from_rom()
+    if (!rom_file.open(rom_filepath, 4 * 1024 * 1024)) {
         LOG_F(ERROR, "Could not open the specified ROM file.");
-        file_size = 0;
-        goto bail_out;
+        return 0;
     }
 
-    rom_file.seekg(0, rom_file.end);
-    file_size = rom_file.tellg();
+    size_t file_size = rom_file.size();
     if (file_size < 64 * 1024 || file_size > 4 * 1024 * 1024) {
         LOG_F(ERROR, "Unexpected ROM file size: %zu bytes. Expected size is 1 or 4 megabytes.", file_size);
-        file_size = 0;
-        goto bail_out;
-    }
-
-    if (rom_data) {
-        rom_file.seekg(0, ios::beg);
-        rom_file.read(rom_data, file_size);
+        rom_file.close();
+        return 0;
     }
 
-bail_out:
-    rom_file.close();
-
     return file_size;
 }
 
-string MachineFactory::machine_name_from_rom(char *rom_data, size_t rom_size) {
+string MachineFactory::machine_name_from_rom(const char *rom_data, size_t rom_size) {
     uint32_t date = 0;
     uint16_t major_version = 0;
     uint16_t minor_version = 0;
@@ -573,9 +560,10 @@ string MachineFactory::machine_name_from_rom(char *rom_data, size_t rom_size) {
     return machine_name;
 }
 
-/* Read ROM file content and transfer it to the dedicated ROM region */
-int MachineFactory::load_boot_rom(char *rom_data, size_t rom_size) {
+/* Transfer ROM file content to the dedicated ROM region */
+int MachineFactory::load_boot_rom(const MappedFile& rom_file) {
     int      result = 0;
+    size_t   rom_size = rom_file.size();
     uint32_t rom_load_addr;
     //AddressMapEntry *rom_reg;
 
@@ -593,7 +581,7 @@ int MachineFactory::load_boot_rom(char *rom_data, size_t rom_size) {
             gMachineObj->get_comp_by_type(HWCompType::MEM_CTRL));
 
         if ((/*rom_reg = */mem_ctrl->find_rom_region())) {
-            mem_ctrl->set_data(rom_load_addr, (uint8_t*)rom_data, (uint32_t)rom_size);
+            mem_ctrl->set_data(rom_load_addr, rom_file);
         } else {
             LOG_F(ERROR, "Could not locate physical ROM region!");
             result = -1;
@@ -603,11 +591,11 @@ int MachineFactory::load_boot_rom(char *rom_data, size_t rom_size) {
     return result;
 }
 
-int MachineFactory::create_machine_for_id(string& id, char *rom_data, size_t rom_size) {
+int MachineFactory::create_machine_for_id(string& id, const MappedFile& rom_file) {
     if (MachineFactory::create(id) < 0) {
         return -1;
     }
-    if (load_boot_rom(rom_data, rom_size) < 0) {
+    if (load_boot_rom(rom_file) < 0) {
         return -1;
     }
     return 0;
@@ -103,8 +103,12 @@ int MachineYosemite::initialize(const std::string &id) {
     uint64_t bus_freq      = 66820000ULL;
     uint64_t timebase_freq = bus_freq / 4;
 
-    // initialize virtual CPU and request MPC750 CPU aka G3
-    ppc_cpu_init(grackle_obj, PPC_VER::MPC750, false, timebase_freq);
+    // initialize virtual CPU, either an MPC750 aka G3 or an MPC7400 aka G4
+    std::string cpu = GET_STR_PROP("cpu");
+    if (cpu == "7400")
+        ppc_cpu_init(grackle_obj, PPC_VER::MPC7400, false, timebase_freq);
+    else
+        ppc_cpu_init(grackle_obj, PPC_VER::MPC750, false, timebase_freq);
 
     // set CPU PLL ratio to 3.5
     ppc_state.spr[SPR::HID1] = 0xE << 28;
@@ -129,6 +133,8 @@ static const PropMap yosemite_settings = {
         new StrProperty("Ide0:0")},
     {"pci_J12",
         new StrProperty("AtiMach64Gx")},
+    {"cpu",
+        new StrProperty("750", std::vector<std::string>({"750", "7400"}))},
 };
 
 static std::vector<std::string> yosemite_devices = {
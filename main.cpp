@@ -25,12 +25,16 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <core/hostevents.h>
 #include <core/timermanager.h>
 #include <cpu/ppc/ppcdisasm.h>
+#include <cpu/ppc/ppcclock.h>
 #include <cpu/ppc/ppcemu.h>
+#include <cpu/ppc/ppcfastmem.h>
 #include <cpu/ppc/ppcmmu.h>
+#include <cpu/ppc/ppcpacing.h>
 #include <debugger/debugger.h>
 #include <devices/common/ofnvram.h>
 #include <machines/machinebase.h>
 #include <machines/machinefactory.h>
+#include <utils/mappedfile.h>
 #include <utils/profiler.h>
 #include <main.h>
 
@@ -94,7 +98,7 @@ public:
 const WorkingDirectoryValidator WorkingDirectory;
 
 void run_machine(
-    std::string machine_str, char *rom_data, size_t rom_size, uint32_t execution_mode
+    std::string machine_str, const MappedFile& rom_file, uint32_t execution_mode
     ,const std::vector<std::string> &env_vars
     ,uint32_t profiling_interval_ms
 );
@@ -107,8 +111,9 @@ int main(int argc, char** argv) {
     app.allow_windows_style_options(); /* we want Windows-style options */
     app.allow_extras();
 
-    bool realtime_enabled = false;
     bool debugger_enabled = false;
+    bool threaded_enabled = false;
+    bool jit_enabled = false;
     string keyboard_string = "Eng_USA";
 
     const std::map<std::string, int> kbd_map{
@@ -121,17 +126,31 @@ int main(int argc, char** argv) {
 
     auto execution_mode_group = app.add_option_group("execution mode")
         ->require_option(-1);
-    execution_mode_group->add_flag("-r,--realtime", realtime_enabled,
-        "Run the emulator in real-time");
     execution_mode_group->add_flag("-d,--debugger", debugger_enabled,
         "Enter the built-in debugger");
+    execution_mode_group->add_flag("-t,--threaded", threaded_enabled,
+        "Run the predecoded threaded interpreter");
+    execution_mode_group->add_flag("-j,--jit", jit_enabled,
+        "Translate frequently executed code to host code");
     app.add_option("-k,--keyboard", keyboard_string, "Specify keyboard ID");
     app.add_option("-w,--workingdir", working_directory_path, "Specifies working directory")
         ->check(WorkingDirectory);
     app.add_option("-b,--bootrom", bootrom_path, "Specifies BootROM path")
         ->check(CLI::ExistingFile);
+    app.add_flag("-r,--realtime", ppc_realtime,
+        "Keep emulated time in step with the host clock");
+    app.add_option("--max-speed", ppc_realtime_speed,
+        "Emulated time per host second in real-time mode (default is 1.0)")
+        ->check(CLI::PositiveNumber);
+    app.add_option("--event-check-interval", ppc_event_check_interval,
+        "Maximum instructions executed between checks for pending events (default is 64)")
+        ->check(CLI::Range(1u, UINT32_MAX));
+    app.add_flag("--calibrate-clock", ppc_clock_calibrate,
+        "Match the emulated CPU speed to the measured host speed");
     app.add_flag("--deterministic", is_deterministic,
         "Make execution deterministic");
+    app.add_flag("--fastmem", ppc_fastmem_enabled,
+        "Map guest memory into the host address space for faster access");
 
     bool              log_to_stderr = false;
     loguru::Verbosity log_verbosity = loguru::Verbosity_INFO;
@@ -181,6 +200,10 @@ int main(int argc, char** argv) {
 
     if (debugger_enabled) {
         execution_mode = debugger;
+    } else if (jit_enabled) {
+        execution_mode = jit;
+    } else if (threaded_enabled) {
+        execution_mode = threaded_int;
     }
 
     /* initialize logging */
@@ -189,7 +212,7 @@ int main(int argc, char** argv) {
     loguru::g_preamble_thread  = false;
     loguru::g_preamble_uptime  = !log_no_uptime;
 
-    if (execution_mode == interpreter && !log_to_stderr) {
+    if (execution_mode != debugger && !log_to_stderr) {
         loguru::g_stderr_verbosity = loguru::Verbosity_OFF;
         loguru::init(argc, argv);
         loguru::add_file("dingusppc.log", loguru::Append, log_verbosity);
@@ -198,14 +221,14 @@ int main(int argc, char** argv) {
         loguru::init(argc, argv);
     }
 
-    auto rom_data = std::unique_ptr<char[]>(new char[4 * 1024 * 1024]);
-    memset(&rom_data[0], 0, static_cast<size_t>(4 * 1024 * 1024));
-    size_t rom_size = MachineFactory::read_boot_rom(bootrom_path, &rom_data[0]);
+    MappedFile rom_file;
+    size_t rom_size = MachineFactory::read_boot_rom(bootrom_path, rom_file);
     if (!rom_size) {
         return 1;
     }
 
-    string machine_str_from_rom = MachineFactory::machine_name_from_rom(&rom_data[0], rom_size);
+    string machine_str_from_rom = MachineFactory::machine_name_from_rom(
+        (const char*)rom_file.data(), rom_size);
     if (machine_str_from_rom.empty()) {
         LOG_F(ERROR, "Could not autodetect machine from ROM.");
     } else {
@@ -283,8 +306,7 @@ int main(int argc, char** argv) {
     while (true) {
         run_machine(
             machine_str,
-            &rom_data[0],
-            rom_size,
+            rom_file,
             execution_mode,
             env_vars,
             profiling_interval_ms);
@@ -313,8 +335,7 @@ int main(int argc, char** argv) {
     return 0;
 }
 
-void run_machine(std::string machine_str, char* rom_data,
-    size_t rom_size,
+void run_machine(std::string machine_str, const MappedFile& rom_file,
     uint32_t execution_mode,
     const std::vector<std::string> &env_vars,
     uint32_t
@@ -322,7 +343,7 @@ void run_machine(std::string machine_str, char* rom_data,
      profiling_interval_ms
 #endif
 ) {
-    if (MachineFactory::create_machine_for_id(machine_str, rom_data, rom_size) < 0) {
+    if (MachineFactory::create_machine_for_id(machine_str, rom_file) < 0) {
         return;
     }
 
@@ -386,6 +407,8 @@ void run_machine(std::string machine_str, char* rom_data,
         DppcDebugger::get_instance()->enter_debugger();
         break;
     case threaded_int:
+    case jit:
+        ppc_exec_mode = EXEC_MODE(execution_mode);
         power_off_reason = po_starting_up;
         DppcDebugger::get_instance()->enter_debugger();
         break;
@@ -0,0 +1,243 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file MappedFile tests.
+ *
+ * Tests open ROM-like files through MappedFile and check the content and
+ * padding of the view, that files which can't be used are rejected and
+ * that map_to() places the file content into an existing anonymous
+ * mapping without ever writing back to the file.
+ *
+ * All files are created in the host's temporary directory and removed
+ * again at the end.
+ */
+
+#include <utils/mappedfile.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define HOST_FILE_MMAP
+#endif
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+namespace fs = std::filesystem;
+
+// ---------------------------------------------------------------------------
+// Test framework
+// ---------------------------------------------------------------------------
+static int tests_run    = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do {         \
+    tests_run++;                             \
+    if (!(cond)) {                           \
+        cerr << "FAIL: " << msg             \
+             << " (" << __FILE__            \
+             << ":" << __LINE__ << ")"      \
+             << endl;                        \
+        tests_failed++;                      \
+    }                                        \
+} while (0)
+
+// ---------------------------------------------------------------------------
+// Fixtures
+// ---------------------------------------------------------------------------
+
+// not a multiple of the page size so the last page is partially used
+static constexpr size_t ROM_SIZE = 5000;
+
+static fs::path g_tmp_dir;
+
+static std::vector<uint8_t> rom_pattern(size_t size, uint8_t seed) {
+    std::vector<uint8_t> buf(size);
+    for (size_t i = 0; i < size; i++)
+        buf[i] = uint8_t(i * 7 + seed);
+    return buf;
+}
+
+static std::string write_file(const char* name, const std::vector<uint8_t>& content) {
+    fs::path path = g_tmp_dir / name;
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write((const char*)content.data(), content.size());
+    return path.string();
+}
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                                std::istreambuf_iterator<char>());
+}
+
+// ---------------------------------------------------------------------------
+// Tests
+// ---------------------------------------------------------------------------
+static void test_open_reads_content() {
+    auto rom = rom_pattern(ROM_SIZE, 1);
+    std::string path = write_file("rom.bin", rom);
+
+    MappedFile file;
+    TEST_ASSERT(file.open(path), "open() must accept a regular file");
+    TEST_ASSERT(file.is_open(), "is_open() after a successful open()");
+    TEST_ASSERT(file.size() == ROM_SIZE, "size() must report the file size");
+    TEST_ASSERT(file.data() && !memcmp(file.data(), rom.data(), ROM_SIZE),
+                "view must hold the file content");
+}
+
+static void test_open_pads_view() {
+    auto rom = rom_pattern(ROM_SIZE, 2);
+    std::string path = write_file("rom_pad.bin", rom);
+    const size_t view_size = 3 * ROM_SIZE;
+
+    MappedFile file;
+    TEST_ASSERT(file.open(path, view_size, 0xFF), "open() with padding");
+    TEST_ASSERT(file.size() == ROM_SIZE, "size() must not include the padding");
+    TEST_ASSERT(!memcmp(file.data(), rom.data(), ROM_SIZE),
+                "padding must not disturb the file content");
+
+    bool filled = true;
+    for (size_t i = ROM_SIZE; i < view_size; i++)
+        filled &= file.data()[i] == 0xFF;
+    TEST_ASSERT(filled, "view must be padded with the fill byte");
+
+    MappedFile zero_file;
+    TEST_ASSERT(zero_file.open(path, view_size), "open() with zero padding");
+
+    bool zeroed = true;
+    for (size_t i = ROM_SIZE; i < view_size; i++)
+        zeroed &= zero_file.data()[i] == 0;
+    TEST_ASSERT(zeroed, "view must be zero-padded by default");
+}
+
+static void test_open_failures() {
+    MappedFile file;
+
+    TEST_ASSERT(!file.open((g_tmp_dir / "missing.bin").string()),
+                "open() must fail for a missing file");
+    TEST_ASSERT(!file.is_open() && !file.data() && !file.size(),
+                "failed open() must leave the object closed");
+
+    std::string empty = write_file("empty.bin", {});
+    TEST_ASSERT(!file.open(empty), "open() must fail for an empty file");
+    TEST_ASSERT(!file.is_open(), "empty file must not be opened");
+
+#ifdef HOST_FILE_MMAP
+    TEST_ASSERT(!file.open(g_tmp_dir.string()), "open() must fail for a directory");
+    TEST_ASSERT(!file.is_open(), "directory must not be opened");
+#endif
+}
+
+static void test_reopen_and_close() {
+    auto rom_a = rom_pattern(ROM_SIZE, 3);
+    auto rom_b = rom_pattern(ROM_SIZE / 2, 4);
+    std::string path_a = write_file("rom_a.bin", rom_a);
+    std::string path_b = write_file("rom_b.bin", rom_b);
+
+    MappedFile file;
+    TEST_ASSERT(file.open(path_a), "open() first file");
+    TEST_ASSERT(file.open(path_b), "open() must replace an open file");
+    TEST_ASSERT(file.size() == rom_b.size() &&
+                !memcmp(file.data(), rom_b.data(), rom_b.size()),
+                "view must show the second file after reopening");
+
+    TEST_ASSERT(!file.open((g_tmp_dir / "missing.bin").string()),
+                "reopening a missing file must fail");
+    TEST_ASSERT(!file.is_open(), "failed reopen must close the previous file");
+
+    TEST_ASSERT(file.open(path_a), "open() after a failure");
+    file.close();
+    TEST_ASSERT(!file.is_open() && !file.data() && !file.size(),
+                "close() must reset the view");
+    file.close();
+    TEST_ASSERT(!file.is_open(), "close() must be idempotent");
+}
+
+static void test_map_to() {
+    auto rom = rom_pattern(ROM_SIZE, 5);
+    std::string path = write_file("rom_map.bin", rom);
+
+    MappedFile file;
+    TEST_ASSERT(file.open(path), "open() file to map");
+
+#ifdef HOST_FILE_MMAP
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t area_size = (ROM_SIZE + page_size - 1) & ~(page_size - 1);
+    uint8_t* area = (uint8_t*)mmap(nullptr, area_size, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    TEST_ASSERT(area != (uint8_t*)MAP_FAILED, "anonymous mapping for map_to()");
+    if (area == (uint8_t*)MAP_FAILED)
+        return;
+
+    area[1] = 0xAA;
+    TEST_ASSERT(!file.map_to(area + 1), "map_to() must reject an unaligned destination");
+    TEST_ASSERT(area[1] == 0xAA, "rejected map_to() must leave the destination alone");
+
+    TEST_ASSERT(file.map_to(area), "map_to() a page aligned destination");
+    TEST_ASSERT(!memcmp(area, rom.data(), ROM_SIZE),
+                "destination must show the file content");
+
+    // guest writes to ROM ranges must stay private
+    area[0] = ~rom[0];
+    TEST_ASSERT(read_file(path) == rom, "writes to the mapped range must not reach the file");
+    TEST_ASSERT(!memcmp(file.data(), rom.data(), ROM_SIZE),
+                "writes to the mapped range must not reach the view");
+
+    munmap(area, area_size);
+#else
+    uint8_t dest[ROM_SIZE];
+    TEST_ASSERT(!file.map_to(dest), "map_to() is unsupported without host mmap");
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+int main() {
+    g_tmp_dir = fs::temp_directory_path() / ("dppc_mappedfile_" +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(g_tmp_dir);
+
+    cout << "Running MappedFile tests..." << endl;
+
+    test_open_reads_content();
+    test_open_pads_view();
+    test_open_failures();
+    test_reopen_and_close();
+    test_map_to();
+
+    std::error_code ec;
+    fs::remove_all(g_tmp_dir, ec);
+
+    cout << tests_run    << " tests run, "
+         << tests_failed << " failed." << endl;
+
+    return tests_failed ? 1 : 0;
+}
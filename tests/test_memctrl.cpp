@@ -0,0 +1,193 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file Guest memory allocation tests.
+ *
+ * Tests check the host memory MemCtrlBase allocates for RAM and ROM
+ * regions: it must read as zero, large regions must be aligned for
+ * transparent huge pages and only be committed once touched, and all of
+ * it must be released again with the memory controller. Memory supplied
+ * by the caller must be left alone.
+ */
+
+#include <devices/memctrl/memctrlbase.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define HOST_ANON_MMAP
+#endif
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+// ---------------------------------------------------------------------------
+// Test framework
+// ---------------------------------------------------------------------------
+static int tests_run    = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do {         \
+    tests_run++;                             \
+    if (!(cond)) {                           \
+        cerr << "FAIL: " << msg             \
+             << " (" << __FILE__            \
+             << ":" << __LINE__ << ")"      \
+             << endl;                        \
+        tests_failed++;                      \
+    }                                        \
+} while (0)
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+static constexpr uint32_t RAM_BASE  = 0x00000000;
+static constexpr uint32_t RAM_SIZE  = 64 << 20;
+static constexpr uint32_t ROM_BASE  = 0xFFC00000;
+static constexpr uint32_t ROM_SIZE  = 4 << 20;
+static constexpr uint32_t VRAM_BASE = 0xF0000000;
+static constexpr uint32_t VRAM_SIZE = 64 << 10; // below the huge page size
+
+static constexpr size_t   HUGE_PAGE_SIZE = 2 << 20;
+
+static bool is_zero(const uint8_t* ptr, size_t size, size_t stride) {
+    for (size_t i = 0; i < size; i += stride) {
+        if (ptr[i])
+            return false;
+    }
+    return !ptr[size - 1];
+}
+
+#ifdef HOST_ANON_MMAP
+/** Returns 1 if the host page at ptr is resident, 0 if it isn't
+    and -1 if it isn't mapped at all. */
+static int page_state(const uint8_t* ptr) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    void*  page      = (void*)((uintptr_t)ptr & ~(uintptr_t)(page_size - 1));
+#ifdef __APPLE__
+    char   vec;
+#else
+    unsigned char vec;
+#endif
+    if (mincore(page, page_size, &vec) < 0)
+        return errno == ENOMEM ? -1 : 0;
+    return vec & 1;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Tests
+// ---------------------------------------------------------------------------
+static void test_regions_read_zero() {
+    auto mem_ctrl = std::make_unique<MemCtrlBase>();
+
+    TEST_ASSERT(mem_ctrl->add_ram_region(RAM_BASE, RAM_SIZE), "add RAM region");
+    TEST_ASSERT(mem_ctrl->add_rom_region(ROM_BASE, ROM_SIZE), "add ROM region");
+    TEST_ASSERT(mem_ctrl->add_ram_region(VRAM_BASE, VRAM_SIZE), "add small RAM region");
+
+    uint8_t* ram  = mem_ctrl->get_region_hostmem_ptr(RAM_BASE);
+    uint8_t* rom  = mem_ctrl->get_region_hostmem_ptr(ROM_BASE);
+    uint8_t* vram = mem_ctrl->get_region_hostmem_ptr(VRAM_BASE);
+    TEST_ASSERT(ram && rom && vram, "regions must have host memory");
+    if (!ram || !rom || !vram)
+        return;
+
+    TEST_ASSERT(is_zero(ram, RAM_SIZE, 4096), "RAM must read as zero");
+    TEST_ASSERT(is_zero(rom, ROM_SIZE, 4096), "ROM must read as zero");
+    TEST_ASSERT(is_zero(vram, VRAM_SIZE, 1), "small RAM region must read as zero");
+
+    ram[0] = 0x55;
+    ram[RAM_SIZE - 1] = 0xAA;
+    vram[VRAM_SIZE - 1] = 0x11;
+    TEST_ASSERT(ram[0] == 0x55 && ram[RAM_SIZE - 1] == 0xAA && vram[VRAM_SIZE - 1] == 0x11,
+                "region memory must be writable up to its end");
+}
+
+static void test_large_regions_lazy() {
+#ifdef HOST_ANON_MMAP
+    auto mem_ctrl = std::make_unique<MemCtrlBase>();
+    mem_ctrl->add_ram_region(RAM_BASE, RAM_SIZE);
+
+    uint8_t* ram = mem_ctrl->get_region_hostmem_ptr(RAM_BASE);
+    TEST_ASSERT(ram, "RAM region must have host memory");
+    if (!ram)
+        return;
+
+    TEST_ASSERT(!((uintptr_t)ram & (HUGE_PAGE_SIZE - 1)),
+                "large regions must be aligned to huge pages");
+
+    TEST_ASSERT(page_state(ram + RAM_SIZE / 2) == 0, "untouched RAM must not be committed");
+    ram[RAM_SIZE / 2] = 1;
+    TEST_ASSERT(page_state(ram + RAM_SIZE / 2) == 1, "touched RAM must be committed");
+    TEST_ASSERT(page_state(ram + RAM_SIZE / 2 + 2 * HUGE_PAGE_SIZE) == 0,
+                "touching RAM must not commit distant pages");
+#endif
+}
+
+static void test_regions_released() {
+#ifdef HOST_ANON_MMAP
+    auto mem_ctrl = std::make_unique<MemCtrlBase>();
+    mem_ctrl->add_ram_region(RAM_BASE, RAM_SIZE);
+    mem_ctrl->add_ram_region(VRAM_BASE, VRAM_SIZE);
+
+    uint8_t* ram  = mem_ctrl->get_region_hostmem_ptr(RAM_BASE);
+    uint8_t* vram = mem_ctrl->get_region_hostmem_ptr(VRAM_BASE);
+    TEST_ASSERT(page_state(ram) >= 0 && page_state(vram) >= 0, "regions must be mapped");
+
+    mem_ctrl.reset();
+    TEST_ASSERT(page_state(ram) < 0 && page_state(ram + RAM_SIZE - 1) < 0,
+                "RAM must be unmapped with the memory controller");
+    TEST_ASSERT(page_state(vram) < 0, "small RAM region must be unmapped as well");
+#endif
+}
+
+static void test_caller_memory_kept() {
+    static uint8_t buf[VRAM_SIZE];
+
+    auto mem_ctrl = std::make_unique<MemCtrlBase>();
+    mem_ctrl->add_ram_region(VRAM_BASE, VRAM_SIZE, buf);
+    TEST_ASSERT(mem_ctrl->get_region_hostmem_ptr(VRAM_BASE) == buf,
+                "caller supplied memory must be used as is");
+
+    // freeing or unmapping buf would crash here
+    mem_ctrl.reset();
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+int main() {
+    cout << "Running memory controller tests..." << endl;
+
+    test_regions_read_zero();
+    test_large_regions_lazy();
+    test_regions_released();
+    test_caller_memory_kept();
+
+    cout << tests_run    << " tests run, "
+         << tests_failed << " failed." << endl;
+
+    return tests_failed ? 1 : 0;
+}
@@ -19,6 +19,7 @@ the Free Software Foundation, either version 3 of the License, or
  *      callback vs the main emulator thread).
  */
 
+#include <core/commandqueue.h>
 #include <cpu/ppc/ppcemu.h>
 #include <devices/common/dbdma.h>
 #include <devices/ioctrl/amic.h>
@@ -539,6 +540,113 @@ static void test_dma_concurrent_pull_data_reg_write() {
                 "concurrent pull_data + reg_write should not deadlock or race");
 }
 
+// ---------------------------------------------------------------------------
+// 15. CommandQueue::discard() only drops the commands of its context, so a
+//     device going away leaves the commands of everybody else alone.
+// ---------------------------------------------------------------------------
+
+static void test_command_queue_discard() {
+    cout << "  test_command_queue_discard..." << endl;
+
+    CommandQueue* queue = CommandQueue::get_instance();
+    command_fn count = [](void* ctx, uint64_t) { (*static_cast<int*>(ctx))++; };
+
+    int dropped = 0, kept = 0;
+    for (int i = 0; i < 4; i++) {
+        queue->post(count, &dropped);
+        queue->post(count, &kept);
+    }
+    queue->discard(&dropped);
+    queue->process_commands();
+
+    TEST_ASSERT(dropped == 0, "discarded commands should not run");
+    TEST_ASSERT(kept == 4, "commands of other contexts should still run");
+}
+
+// ---------------------------------------------------------------------------
+// 16. CommandQueue with several producers: every command runs exactly once
+//     and the commands of each producer run in the order they were posted.
+// ---------------------------------------------------------------------------
+
+static void test_command_queue_multi_producer() {
+    cout << "  test_command_queue_multi_producer..." << endl;
+
+    constexpr int PRODUCERS     = 4;
+    constexpr int ITERS         = 50'000;
+    constexpr int MAX_IN_FLIGHT = 32; // per producer, all of them fit into the queue
+
+    struct Producer {
+        std::atomic<int> num_run{0};
+        bool             in_order = true;
+    };
+    Producer producers[PRODUCERS];
+
+    CommandQueue* queue = CommandQueue::get_instance();
+    command_fn run = [](void* ctx, uint64_t arg) {
+        Producer* p = static_cast<Producer*>(ctx);
+        int n = p->num_run.load(std::memory_order_relaxed);
+        if (arg != uint64_t(n))
+            p->in_order = false;
+        p->num_run.store(n + 1, std::memory_order_release);
+    };
+
+    std::atomic<int> num_full{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < PRODUCERS; t++) {
+        threads.emplace_back([&, t]{
+            Producer& p = producers[t];
+            for (int i = 0; i < ITERS; i++) {
+                while (i - p.num_run.load(std::memory_order_acquire) >= MAX_IN_FLIGHT)
+                    std::this_thread::yield();
+                while (!queue->post(run, &p, i)) {
+                    num_full++;
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // the test thread is the single consumer
+    int total;
+    do {
+        queue->process_commands();
+        total = 0;
+        for (auto& p : producers)
+            total += p.num_run.load(std::memory_order_acquire);
+    } while (total < PRODUCERS * ITERS);
+
+    for (auto& th : threads)
+        th.join();
+
+    bool in_order = true;
+    for (auto& p : producers)
+        in_order &= p.in_order && p.num_run == ITERS;
+    TEST_ASSERT(in_order, "commands of each producer should run once and in order");
+    TEST_ASSERT(num_full == 0, "queue should not fill up with bounded producers");
+}
+
+// ---------------------------------------------------------------------------
+// 17. CommandQueue full: posting fails instead of blocking and the commands
+//     that made it into the queue still run.
+// ---------------------------------------------------------------------------
+
+static void test_command_queue_full() {
+    cout << "  test_command_queue_full..." << endl;
+
+    CommandQueue* queue = CommandQueue::get_instance();
+    command_fn count = [](void* ctx, uint64_t) { (*static_cast<int*>(ctx))++; };
+
+    int num_posted = 0, num_run = 0;
+    while (num_posted < 100'000 && queue->post(count, &num_run))
+        num_posted++;
+    queue->process_commands();
+
+    TEST_ASSERT(num_posted < 100'000, "post should fail once the queue is full");
+    TEST_ASSERT(num_run == num_posted, "all posted commands should run");
+    TEST_ASSERT(queue->post(count, &num_run), "post should succeed after the queue was drained");
+    queue->process_commands();
+}
+
 // ===========================================================================
 
 int main() {
@@ -567,6 +675,11 @@ int main() {
     test_amic_snd_concurrent_ctrl();
     test_amic_snd_concurrent_enable_disable();
 
+    cout << endl << "Command queue tests:" << endl;
+    test_command_queue_discard();
+    test_command_queue_multi_producer();
+    test_command_queue_full();
+
     cout << endl;
     cout << "Results: " << tests_run << " tests, "
          << tests_failed << " failed" << endl;
@@ -0,0 +1,137 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <utils/mappedfile.h>
+#include <loguru.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HOST_FILE_MMAP
+#endif
+
+MappedFile::~MappedFile() {
+    this->close();
+}
+
+#ifdef HOST_FILE_MMAP
+static inline size_t page_round_up(size_t size) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+#endif
+
+bool MappedFile::open(const std::string& path, size_t view_size, uint8_t fill) {
+    this->close();
+
+#ifdef HOST_FILE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || !st.st_size) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t file_size = st.st_size;
+    size_t map_size  = page_round_up(std::max(file_size, view_size));
+
+    // reserve the whole view so the padding follows the file content
+    uint8_t* view = (uint8_t*)mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (view != (uint8_t*)MAP_FAILED) {
+        if (mmap(view, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                 fd, 0) != view) {
+            munmap(view, map_size);
+            view = (uint8_t*)MAP_FAILED;
+        }
+    }
+
+    if (view != (uint8_t*)MAP_FAILED) {
+        // the rest of the last file page and the anonymous pages are
+        // zero-filled, so only a non-zero fill costs private pages
+        if (fill && view_size > file_size)
+            memset(view + file_size, fill, view_size - file_size);
+        mprotect(view, map_size, PROT_READ);
+
+        this->view      = view;
+        this->view_size = map_size;
+        this->file_size = file_size;
+        this->fd        = fd;
+        return true;
+    }
+
+    ::close(fd);
+    LOG_F(WARNING, "Could not map %s, reading it instead", path.c_str());
+#endif
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (file.fail())
+        return false;
+
+    file.seekg(0, std::ios::end);
+    this->file_size = file.tellg();
+    this->view_size = std::max(this->file_size, view_size);
+
+    this->copy = std::unique_ptr<uint8_t[]>(new uint8_t[this->view_size]);
+    file.seekg(0, std::ios::beg);
+    file.read((char*)this->copy.get(), this->file_size);
+    memset(&this->copy[this->file_size], fill, this->view_size - this->file_size);
+
+    this->view = this->copy.get();
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef HOST_FILE_MMAP
+    if (this->fd >= 0) {
+        munmap(this->view, this->view_size);
+        ::close(this->fd);
+        this->fd = -1;
+    }
+#endif
+    this->copy.reset();
+    this->view      = nullptr;
+    this->view_size = 0;
+    this->file_size = 0;
+}
+
+bool MappedFile::map_to(uint8_t* dest) const {
+#ifdef HOST_FILE_MMAP
+    if (this->fd < 0 || ((uintptr_t)dest & (sysconf(_SC_PAGESIZE) - 1)))
+        return false;
+
+    // stays writable so that a later set_data() on the range still works,
+    // which just gives the touched pages a private copy
+    return mmap(dest, this->file_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_FIXED, this->fd, 0) == dest;
+#else
+    return false;
+#endif
+}
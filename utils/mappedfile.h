@@ -0,0 +1,72 @@
+/*
+DingusPPC - The Experimental PowerPC Macintosh emulator
+Copyright (C) 2018-26 The DingusPPC Development Team
+          (See CREDITS.MD for more details)
+
+(You may also contact divingkxt or powermax2286 on Discord)
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/** @file Read-only view of a file such as a ROM image.
+
+    Where the host supports it, the file is mapped privately rather than
+    read into memory so that processes using the same file share its pages
+    in the host page cache. Other hosts get a heap copy of the file.
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cinttypes>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /** Open the file at path. The view is padded with fill bytes up to
+        view_size if that's larger than the file. */
+    bool open(const std::string& path, size_t view_size = 0, uint8_t fill = 0);
+    void close();
+
+    bool is_open() const { return this->view != nullptr; }
+
+    const uint8_t* data() const { return this->view; }
+
+    /** Size of the file, not including the padding. */
+    size_t size() const { return this->file_size; }
+
+    /** Replace the pages at dest with a private mapping of the file.
+        dest must be page aligned and part of an anonymous private mapping
+        at least size() bytes long. Returns false if the file can't be mapped
+        there, in which case dest is left alone. */
+    bool map_to(uint8_t* dest) const;
+
+private:
+    uint8_t*    view      = nullptr;
+    size_t      view_size = 0;
+    size_t      file_size = 0;
+    int         fd        = -1;
+
+    std::unique_ptr<uint8_t[]> copy; // file content if it couldn't be mapped
+};
+
+#endif // MAPPED_FILE_H